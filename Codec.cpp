@@ -0,0 +1,518 @@
+#include "Codec.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Size of the BMP file header
+static size_t constexpr BMP_FILE_HEADER_SIZE = 14;
+
+// Size of the BMP info header (BITMAPINFOHEADER)
+static size_t constexpr BMP_INFO_HEADER_SIZE = 40;
+
+// Size of the BMP info header with color masks (BITMAPV4HEADER), used for images with alpha
+static size_t constexpr BMP_V4_HEADER_SIZE = 108;
+
+// Size of the smallest BMP info header with an alpha mask (BITMAPV3INFOHEADER)
+static size_t constexpr BMP_V3_HEADER_SIZE = 56;
+
+// BMP compression of uncompressed pixels (BI_RGB), and of uncompressed pixels described by masks (BI_BITFIELDS)
+static uint32_t constexpr BMP_RGB       = 0;
+static uint32_t constexpr BMP_BITFIELDS = 3;
+
+// BMP channel masks of BGRA pixels
+static uint32_t constexpr BMP_RED_MASK   = 0x00ff0000;
+static uint32_t constexpr BMP_GREEN_MASK = 0x0000ff00;
+static uint32_t constexpr BMP_BLUE_MASK  = 0x000000ff;
+static uint32_t constexpr BMP_ALPHA_MASK = 0xff000000;
+
+// Size of the TGA header
+static size_t constexpr TGA_HEADER_SIZE = 18;
+
+// Largest packet in a TGA RLE stream (in pixels)
+static int constexpr TGA_MAX_PACKET = 128;
+
+// Reads a little-endian 16-bit value
+static uint32_t get16(uint8_t const * p)
+{
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8);
+}
+
+// Reads a little-endian 32-bit value
+static uint32_t get32(uint8_t const * p)
+{
+    return get16(p) | (get16(p + 2) << 16);
+}
+
+// Writes a little-endian 16-bit value
+static void put16(uint8_t * p, uint32_t value)
+{
+    p[0] = uint8_t(value);
+    p[1] = uint8_t(value >> 8);
+}
+
+// Writes a little-endian 32-bit value
+static void put32(uint8_t * p, uint32_t value)
+{
+    put16(p, value);
+    put16(p + 2, value >> 16);
+}
+
+// Returns true if the stored rows lie within the file
+static bool rowsFit(ImageInfo const & info, size_t size)
+{
+    return info.dataOffset <= size && uint64_t(info.pitch) * info.height <= size - info.dataOffset;
+}
+
+// Returns true if the stored palette lies within the file
+static bool paletteFits(ImageInfo const & info, size_t size)
+{
+    return info.paletteOffset <= size &&
+           uint64_t(info.paletteStride) * info.paletteSize <= size - info.paletteOffset;
+}
+
+// Reads the description of a BMP file
+static bool readBmpInfo(uint8_t const * data, size_t size, ImageInfo * info)
+{
+    if (size < BMP_FILE_HEADER_SIZE + BMP_INFO_HEADER_SIZE)
+        return false;
+
+    uint8_t const * dib         = data + BMP_FILE_HEADER_SIZE;
+    uint32_t        dibSize     = get32(dib);
+    int32_t         width       = int32_t(get32(dib + 4));
+    int32_t         height      = int32_t(get32(dib + 8));
+    uint32_t        bits        = get16(dib + 14);
+    uint32_t        compression = get32(dib + 16);
+    uint32_t        colors      = get32(dib + 32);
+
+    // Only uncompressed (BI_RGB) 8, 24 and 32-bit images, and 32-bit BGRA or BGRX images described by masks
+    // (BI_BITFIELDS) are supported. The masks follow a BITMAPINFOHEADER, and are part of the later headers.
+    if (dibSize < BMP_INFO_HEADER_SIZE || width <= 0 || height == 0 || height == INT32_MIN)
+        return false;
+    if (compression != BMP_RGB && (compression != BMP_BITFIELDS || bits != 32))
+        return false;
+
+    // The fourth byte of a 32-bit pixel is alpha only if the masks say so
+    bool alpha = false;
+    if (compression == BMP_BITFIELDS)
+    {
+        if (size < BMP_FILE_HEADER_SIZE + BMP_INFO_HEADER_SIZE + 12)
+            return false;
+        if (get32(dib + 40) != BMP_RED_MASK || get32(dib + 44) != BMP_GREEN_MASK || get32(dib + 48) != BMP_BLUE_MASK)
+            return false;
+        uint32_t alphaMask = (dibSize >= BMP_V3_HEADER_SIZE) ? get32(dib + 52) : 0;
+        if (alphaMask != 0 && alphaMask != BMP_ALPHA_MASK)
+            return false;
+        alpha = alphaMask != 0;
+    }
+
+    ImageInfo & i = *info;
+    i             = ImageInfo();
+    i.format      = ImageFormat::BMP;
+    i.width       = width;
+    i.height      = (height < 0) ? -height : height;
+    i.bottomUp    = height > 0;
+    i.dataOffset  = get32(data + 10);
+    i.pitch       = (uint64_t(width) * bits + 31) / 32 * 4;
+    switch (bits)
+    {
+    case 8:
+        i.pixelFormat   = PixelFormat::PIXEL8;
+        i.pixelSize     = 1;
+        i.paletteFormat = PixelFormat::BGRA;
+        i.paletteSize   = (colors == 0) ? 256 : int(std::min<uint32_t>(colors, 257));
+        i.paletteStride = 4;
+        i.paletteOffset = BMP_FILE_HEADER_SIZE + dibSize;
+        break;
+    case 24:
+        i.pixelFormat = PixelFormat::BGR;
+        i.pixelSize   = 3;
+        break;
+    case 32:
+        i.pixelFormat = PixelFormat::BGRA;
+        i.pixelSize   = 4;
+        i.opaque      = !alpha;
+        break;
+    default:
+        return false;
+    }
+    return i.paletteSize <= 256 && paletteFits(i, size) && rowsFit(i, size);
+}
+
+// Reads the description of a TGA file
+static bool readTgaInfo(uint8_t const * data, size_t size, ImageInfo * info)
+{
+    if (size < TGA_HEADER_SIZE)
+        return false;
+
+    uint32_t idLength     = data[0];
+    uint32_t colorMapType = data[1];
+    uint32_t imageType    = data[2];
+    uint32_t firstEntry   = get16(data + 3);
+    uint32_t mapLength    = get16(data + 5);
+    uint32_t mapDepth     = data[7];
+    uint32_t width        = get16(data + 12);
+    uint32_t height       = get16(data + 14);
+    uint32_t bits         = data[16];
+    uint32_t descriptor   = data[17];
+
+    // Right-to-left images are not supported
+    if (colorMapType > 1 || width == 0 || height == 0 || (descriptor & 0x10) != 0)
+        return false;
+
+    ImageInfo & i = *info;
+    i             = ImageInfo();
+    i.format      = ImageFormat::TGA;
+    i.width       = int(width);
+    i.height      = int(height);
+    i.bottomUp    = (descriptor & 0x20) == 0;
+    i.compressed  = imageType >= 9;
+
+    size_t mapOffset = TGA_HEADER_SIZE + idLength;
+    size_t mapSize   = (colorMapType == 1) ? mapLength * ((mapDepth + 7) / 8) : 0;
+    switch (imageType)
+    {
+    case 1:
+    case 9:
+        if (colorMapType != 1 || bits != 8 || firstEntry != 0 || mapLength > 256 || (mapDepth != 24 && mapDepth != 32))
+            return false;
+        i.pixelFormat   = PixelFormat::PIXEL8;
+        i.pixelSize     = 1;
+        i.paletteFormat = (mapDepth == 24) ? PixelFormat::BGR : PixelFormat::BGRA;
+        i.paletteSize   = int(mapLength);
+        i.paletteStride = int(mapDepth / 8);
+        i.paletteOffset = mapOffset;
+        break;
+    case 2:
+    case 10:
+        if (bits != 24 && bits != 32)
+            return false;
+        i.pixelFormat = (bits == 24) ? PixelFormat::BGR : PixelFormat::BGRA;
+        i.pixelSize   = int(bits / 8);
+        break;
+    case 3:
+    case 11:
+        if (bits != 8)
+            return false;
+        i.pixelFormat = PixelFormat::PIXEL8;
+        i.pixelSize   = 1;
+        break;
+    default:
+        return false;
+    }
+
+    i.dataOffset = mapOffset + mapSize;
+    i.pitch      = i.compressed ? 0 : size_t(i.width) * i.pixelSize;
+    return paletteFits(i, size) && rowsFit(i, size);
+}
+
+// Skips whitespace and comments in a PNM header
+static size_t skipPnmSpace(uint8_t const * data, size_t size, size_t offset)
+{
+    while (offset < size)
+    {
+        if (data[offset] == '#')
+        {
+            while (offset < size && data[offset] != '\n')
+                ++offset;
+        }
+        else if (data[offset] == ' ' || data[offset] == '\t' || data[offset] == '\r' || data[offset] == '\n')
+        {
+            ++offset;
+        }
+        else
+        {
+            break;
+        }
+    }
+    return offset;
+}
+
+// Reads a decimal value in a PNM header, returning 0 if there is none
+static uint32_t readPnmValue(uint8_t const * data, size_t size, size_t * offset)
+{
+    size_t   o     = skipPnmSpace(data, size, *offset);
+    uint32_t value = 0;
+    while (o < size && data[o] >= '0' && data[o] <= '9' && value < 0x1000000)
+    {
+        value = value * 10 + (data[o] - '0');
+        ++o;
+    }
+    *offset = o;
+    return value;
+}
+
+// Reads the description of a PGM (P5) or PPM (P6) file
+static bool readPnmInfo(uint8_t const * data, size_t size, ImageInfo * info)
+{
+    size_t   offset = 2;
+    bool     gray   = data[1] == '5';
+    uint32_t width  = readPnmValue(data, size, &offset);
+    uint32_t height = readPnmValue(data, size, &offset);
+    uint32_t maxval = readPnmValue(data, size, &offset);
+
+    // Only 8-bit samples are supported. A single whitespace character separates the header from the pixels.
+    if (width == 0 || height == 0 || maxval != 255 || offset >= size)
+        return false;
+
+    ImageInfo & i = *info;
+    i             = ImageInfo();
+    i.format      = ImageFormat::PNM;
+    i.width       = int(width);
+    i.height      = int(height);
+    i.pixelFormat = gray ? PixelFormat::PIXEL8 : PixelFormat::RGB;
+    i.pixelSize   = gray ? 1 : 3;
+    i.dataOffset  = offset + 1;
+    i.pitch       = size_t(i.width) * i.pixelSize;
+    return rowsFit(i, size);
+}
+
+//! The format is determined from the contents, not from a file name. All parts of the file that are needed to decode
+//! the image must lie within the buffer, except for the packets of an RLE-compressed image, which are checked by
+//! scanRle().
+//!
+//! @param  data    Image file
+//! @param  size    Size of the image file (in bytes)
+//! @param  info    Receives the description
+//!
+//! @return     false if the file is not a supported image
+bool ImageCodec::readInfo(void const * data, size_t size, ImageInfo * info)
+{
+    uint8_t const * bytes = static_cast<uint8_t const *>(data);
+    if (size >= 2 && bytes[0] == 'B' && bytes[1] == 'M')
+        return readBmpInfo(bytes, size, info);
+    if (size >= 2 && bytes[0] == 'P' && (bytes[1] == '5' || bytes[1] == '6'))
+        return readPnmInfo(bytes, size, info);
+
+    // TGA files have no signature, so this is the last resort
+    return readTgaInfo(bytes, size, info);
+}
+
+//! The packets are not decoded, only their headers are read. Each row then can be decoded independently. Packets may
+//! span rows.
+//!
+//! @param  data    Image file
+//! @param  size    Size of the image file (in bytes)
+//! @param  info    Description of the image file, from readInfo()
+//! @param  rows    Receives the start of each row
+//!
+//! @return     false if the packets do not cover the image or extend past the end of the file
+bool ImageCodec::scanRle(void const * data, size_t size, ImageInfo const & info, std::vector<RleRow> * rows)
+{
+    assert(info.compressed);
+
+    uint8_t const * bytes  = static_cast<uint8_t const *>(data);
+    uint64_t const  total  = uint64_t(info.width) * info.height;
+    uint64_t        pixel  = 0;                 // Index of the first pixel in the packet
+    uint64_t        start  = 0;                 // Index of the first pixel of the next row
+    size_t          offset = info.dataOffset;   // Offset of the packet
+
+    rows->clear();
+    rows->reserve(info.height);
+    while (pixel < total)
+    {
+        if (offset >= size)
+            return false;
+
+        int    count  = (bytes[offset] & 0x7f) + 1;
+        size_t length = 1 + ((bytes[offset] & 0x80) ? 1 : count) * size_t(info.pixelSize);
+        if (length > size - offset)
+            return false;
+
+        for (; start < pixel + count && start < total; start += info.width)
+        {
+            rows->push_back({ offset, int(start - pixel) });
+        }
+        pixel  += count;
+        offset += length;
+    }
+    return true;
+}
+
+//! @param  data    Image file
+//! @param  info    Description of the image file, from readInfo()
+//! @param  row     Start of the row, from scanRle()
+//! @param  dst     Receives the row of stored pixels
+void ImageCodec::decodeRleRow(void const * data, ImageInfo const & info, RleRow const & row, uint8_t * dst)
+{
+    uint8_t const * src       = static_cast<uint8_t const *>(data) + row.offset;
+    size_t const    pixelSize = info.pixelSize;
+    int             skip      = row.consumed;
+    int             remaining = info.width;
+    while (remaining > 0)
+    {
+        uint8_t header = *src++;
+        int     count  = std::min((header & 0x7f) + 1 - skip, remaining);
+        if (header & 0x80)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                memcpy(dst, src, pixelSize);
+                dst += pixelSize;
+            }
+            src += pixelSize;
+        }
+        else
+        {
+            src += skip * pixelSize;
+            memcpy(dst, src, count * pixelSize);
+            dst += count * pixelSize;
+            src += ((header & 0x7f) + 1 - skip) * pixelSize;
+        }
+        remaining -= count;
+        skip       = 0;
+    }
+}
+
+//! Packets do not span rows, so that the rows can be located quickly when the image is decoded.
+//!
+//! @param  fp          File
+//! @param  row         Stored pixels
+//! @param  count       Number of pixels
+//! @param  pixelSize   Size of a stored pixel (in bytes)
+//!
+//! @return     true if the packets were written
+bool ImageCodec::writeRleRow(FILE * fp, uint8_t const * row, int count, int pixelSize)
+{
+    auto same = [row, pixelSize] (int a, int b) { return memcmp(row + a * pixelSize, row + b * pixelSize, pixelSize) == 0; };
+
+    int i = 0;
+    while (i < count)
+    {
+        // A run of at least two identical pixels is written as a run packet
+        int run = 1;
+        while (i + run < count && run < TGA_MAX_PACKET && same(i, i + run))
+            ++run;
+        if (run > 1)
+        {
+            if (fputc(0x80 | (run - 1), fp) == EOF || fwrite(row + i * pixelSize, pixelSize, 1, fp) != 1)
+                return false;
+            i += run;
+            continue;
+        }
+
+        // Otherwise, the pixels up to the next run are written as a raw packet
+        int raw = 1;
+        while (i + raw < count && raw < TGA_MAX_PACKET && !(i + raw + 1 < count && same(i + raw, i + raw + 1)))
+            ++raw;
+        if (fputc(raw - 1, fp) == EOF || fwrite(row + i * pixelSize, pixelSize, raw, fp) != size_t(raw))
+            return false;
+        i += raw;
+    }
+    return true;
+}
+
+//! The rows are stored from the top down (the height is negative).
+//!
+//! @param  fp              File
+//! @param  width           Width of the image
+//! @param  height          Height of the image
+//! @param  bitsPerPixel    8, 24 or 32
+//! @param  palette         256 BGRX entries if bitsPerPixel is 8, otherwise ignored
+//!
+//! @return     true if the headers were written
+bool ImageCodec::writeBmpHeader(FILE * fp, int width, int height, int bitsPerPixel, uint8_t const * palette)
+{
+    assert(bitsPerPixel == 8 || bitsPerPixel == 24 || bitsPerPixel == 32);
+    assert(bitsPerPixel != 8 || palette);
+
+    // 32-bit images have alpha, which only a header with masks can describe
+
+    size_t const   dibSize     = (bitsPerPixel == 32) ? BMP_V4_HEADER_SIZE : BMP_INFO_HEADER_SIZE;
+    size_t const   headerSize  = BMP_FILE_HEADER_SIZE + dibSize;
+    uint64_t const paletteSize = (bitsPerPixel == 8) ? 256 * 4 : 0;
+    uint64_t const pitch       = (uint64_t(width) * bitsPerPixel + 31) / 32 * 4;
+    uint64_t const dataOffset  = headerSize + paletteSize;
+    uint64_t const fileSize    = dataOffset + pitch * height;
+    if (fileSize > UINT32_MAX)
+        return false;
+
+    uint8_t header[BMP_FILE_HEADER_SIZE + BMP_V4_HEADER_SIZE] = {};
+    header[0] = 'B';
+    header[1] = 'M';
+    put32(header + 2, uint32_t(fileSize));
+    put32(header + 10, uint32_t(dataOffset));
+
+    uint8_t * dib = header + BMP_FILE_HEADER_SIZE;
+    put32(dib, uint32_t(dibSize));
+    put32(dib + 4, uint32_t(width));
+    put32(dib + 8, uint32_t(-height));
+    put16(dib + 12, 1);
+    put16(dib + 14, uint32_t(bitsPerPixel));
+    put32(dib + 16, (bitsPerPixel == 32) ? BMP_BITFIELDS : BMP_RGB);
+    put32(dib + 20, uint32_t(pitch * height));
+    put32(dib + 32, (bitsPerPixel == 8) ? 256 : 0);
+    if (bitsPerPixel == 32)
+    {
+        put32(dib + 40, BMP_RED_MASK);
+        put32(dib + 44, BMP_GREEN_MASK);
+        put32(dib + 48, BMP_BLUE_MASK);
+        put32(dib + 52, BMP_ALPHA_MASK);
+        put32(dib + 56, 0x73524742); // LCS_sRGB
+    }
+
+    return fwrite(header, 1, headerSize, fp) == headerSize &&
+           fwrite(palette, 1, size_t(paletteSize), fp) == paletteSize;
+}
+
+//! The rows are stored from the top down.
+//!
+//! @param  fp                      File
+//! @param  width                   Width of the image
+//! @param  height                  Height of the image
+//! @param  bitsPerPixel            8, 24 or 32
+//! @param  rle                     True if the rows will be RLE-compressed
+//! @param  gray                    True if the image is grayscale (bitsPerPixel must be 8)
+//! @param  palette                 256 BGR or BGRA entries, or nullptr if there is no palette
+//! @param  paletteBitsPerEntry     24 or 32, if there is a palette
+//!
+//! @return     true if the header was written
+bool ImageCodec::writeTgaHeader(FILE *          fp,
+                                int             width,
+                                int             height,
+                                int             bitsPerPixel,
+                                bool            rle,
+                                bool            gray,
+                                uint8_t const * palette,
+                                int             paletteBitsPerEntry)
+{
+    assert(bitsPerPixel == 8 || bitsPerPixel == 24 || bitsPerPixel == 32);
+    assert(!palette || paletteBitsPerEntry == 24 || paletteBitsPerEntry == 32);
+
+    if (width <= 0 || height <= 0 || width > 0xffff || height > 0xffff)
+        return false;
+
+    int type = palette ? 1 : (gray ? 3 : 2);
+    if (rle)
+        type += 8;
+
+    uint8_t header[TGA_HEADER_SIZE] = {};
+    header[1]  = palette ? 1 : 0;
+    header[2]  = uint8_t(type);
+    put16(header + 5, palette ? 256 : 0);
+    header[7]  = palette ? uint8_t(paletteBitsPerEntry) : 0;
+    put16(header + 12, uint32_t(width));
+    put16(header + 14, uint32_t(height));
+    header[16] = uint8_t(bitsPerPixel);
+    header[17] = uint8_t(0x20 | ((bitsPerPixel == 32) ? 8 : 0));
+
+    size_t const paletteSize = palette ? 256 * size_t(paletteBitsPerEntry / 8) : 0;
+    return fwrite(header, 1, sizeof(header), fp) == sizeof(header) &&
+           (!palette || fwrite(palette, 1, paletteSize, fp) == paletteSize);
+}
+
+//! @param  fp      File
+//! @param  width   Width of the image
+//! @param  height  Height of the image
+//! @param  gray    True for PGM (P5), false for PPM (P6)
+//!
+//! @return     true if the header was written
+bool ImageCodec::writePnmHeader(FILE * fp, int width, int height, bool gray)
+{
+    if (width <= 0 || height <= 0)
+        return false;
+    return fprintf(fp, "%s\n%d %d\n255\n", gray ? "P5" : "P6", width, height) > 0;
+}
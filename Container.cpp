@@ -0,0 +1,174 @@
+#include "Container.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static char const MAGIC[4] = { 'B', 'T', 'M', 'P' };
+
+static_assert(sizeof(ContainerHeader) == 64, "The size of the header is part of the format");
+
+// Alignment of the sections of a container and of its rows
+static size_t constexpr ALIGNMENT = Bitmap<uint8_t>::ROW_ALIGNMENT;
+
+// Size of the space reserved for a bitmap's bookkeeping before the image data
+static size_t constexpr RESERVED_SIZE = Bitmap<uint8_t>::BUFFER_HEADER_SIZE;
+
+// Rounds a size up to a multiple of the alignment
+static uint64_t aligned(uint64_t size, uint64_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+//! @param  format              Pixel format
+//! @param  pixelSize           Size of a pixel (in bytes)
+//! @param  width               Width of the image
+//! @param  height              Height of the image
+//! @param  pitch               Pitch of the stored rows. It must be a multiple of Bitmap::ROW_ALIGNMENT.
+//! @param  paletteFormat       Pixel format of the palette entries
+//! @param  paletteEntrySize    Size of a palette entry (in bytes)
+//! @param  paletteSize         Number of palette entries, or 0 if there is no palette
+//!
+//! @return     header of the container
+ContainerHeader ContainerHeader::layout(PixelFormat format,
+                                        size_t      pixelSize,
+                                        int         width,
+                                        int         height,
+                                        size_t      pitch,
+                                        PixelFormat paletteFormat /*= PixelFormat::UNKNOWN*/,
+                                        size_t      paletteEntrySize /*= 0*/,
+                                        size_t      paletteSize /*= 0*/)
+{
+    assert(width >= 0 && height >= 0);
+    assert(pitch >= width * pixelSize && pitch % ALIGNMENT == 0);
+
+    ContainerHeader header{};
+    memcpy(header.magic, MAGIC, sizeof(header.magic));
+    header.version          = VERSION;
+    header.format           = uint32_t(format);
+    header.pixelSize        = uint32_t(pixelSize);
+    header.width            = width;
+    header.height           = height;
+    header.pitch            = pitch;
+    header.alignment        = uint32_t(ALIGNMENT);
+    header.paletteFormat    = uint32_t(paletteFormat);
+    header.paletteEntrySize = uint32_t(paletteEntrySize);
+    header.paletteSize      = uint32_t(paletteSize);
+    header.paletteOffset    = aligned(sizeof(header), ALIGNMENT);
+    uint64_t end            = header.paletteOffset + aligned(paletteEntrySize * paletteSize, ALIGNMENT);
+    header.dataOffset       = end + RESERVED_SIZE;
+    return header;
+}
+
+//! The header is checked for consistency, and all of the sections it describes must lie within the buffer.
+//!
+//! @param  buffer  Container
+//! @param  size    Size of the container (in bytes)
+//! @param  header  Receives the header
+//!
+//! @return     true if the header is valid
+bool ContainerHeader::read(void const * buffer, size_t size, ContainerHeader * header)
+{
+    if (size < sizeof(*header))
+        return false;
+
+    ContainerHeader & h = *header;
+    memcpy(&h, buffer, sizeof(h));
+
+    uint64_t const paletteBytes = uint64_t(h.paletteEntrySize) * h.paletteSize;
+    return memcmp(h.magic, MAGIC, sizeof(h.magic)) == 0 &&
+           h.version == VERSION &&
+           h.pixelSize > 0 &&
+           h.width >= 0 &&
+           h.height >= 0 &&
+           h.pitch >= uint64_t(h.width) * h.pixelSize &&
+           h.pitch % h.pixelSize == 0 &&
+           h.alignment > 0 &&
+           (h.alignment & (h.alignment - 1)) == 0 &&
+           h.pitch % h.alignment == 0 &&
+           h.dataOffset % h.alignment == 0 &&
+           h.dataOffset >= sizeof(h) &&
+           h.dataOffset <= size &&
+           (h.height == 0 || h.pitch <= (size - h.dataOffset) / uint64_t(h.height)) &&
+           h.paletteOffset <= size &&
+           paletteBytes <= size - h.paletteOffset;
+}
+
+//! The reserved space preceding the image data must not overlap the header or the palette, and the image data must
+//! be aligned to Bitmap::ROW_ALIGNMENT in memory.
+//!
+//! @param  buffer  Container
+//!
+//! @return     true if the image data can be adopted
+bool ContainerHeader::adoptable(void const * buffer) const
+{
+    uint64_t end = sizeof(*this);
+    if (paletteSize > 0)
+        end = std::max(end, paletteOffset + uint64_t(paletteEntrySize) * paletteSize);
+    return dataOffset >= end + RESERVED_SIZE &&
+           (reinterpret_cast<uintptr_t>(buffer) + dataOffset) % ALIGNMENT == 0;
+}
+
+//! The padding and the reserved space are filled with zeros.
+//!
+//! @param  palette     Palette entries, or nullptr if there is no palette
+//! @param  rows        First row of the image
+//! @param  srcPitch    Pitch of the image
+//! @param  buffer      Buffer to receive the container
+//! @param  size        Size of the buffer (in bytes)
+//!
+//! @return     size of the container, or 0 if the buffer is too small
+size_t ContainerHeader::write(void const * palette, void const * rows, size_t srcPitch, void * buffer, size_t size) const
+{
+    if (size < this->size())
+        return 0;
+
+    char * out = static_cast<char *>(buffer);
+    memset(out, 0, size_t(dataOffset));
+    memcpy(out, this, sizeof(*this));
+    if (palette)
+        memcpy(out + paletteOffset, palette, size_t(paletteEntrySize) * paletteSize);
+
+    size_t const rowSize = size_t(width) * pixelSize;
+    for (int y = 0; y < height; ++y)
+    {
+        char * row = out + dataOffset + y * pitch;
+        memcpy(row, static_cast<char const *>(rows) + y * srcPitch, rowSize);
+        memset(row + rowSize, 0, size_t(pitch) - rowSize);
+    }
+    return this->size();
+}
+
+//! The padding and the reserved space are filled with zeros.
+//!
+//! @param  path        Path of the file
+//! @param  palette     Palette entries, or nullptr if there is no palette
+//! @param  rows        First row of the image
+//! @param  srcPitch    Pitch of the image
+//!
+//! @return     true if the container was written
+bool ContainerHeader::save(char const * path, void const * palette, void const * rows, size_t srcPitch) const
+{
+    FILE * fp = fopen(path, "wb");
+    if (!fp)
+        return false;
+
+    // Everything up to the first row is assembled in memory and written at once
+    std::vector<char> head(size_t(dataOffset), 0);
+    memcpy(head.data(), this, sizeof(*this));
+    if (palette)
+        memcpy(head.data() + paletteOffset, palette, size_t(paletteEntrySize) * paletteSize);
+    bool ok = fwrite(head.data(), 1, head.size(), fp) == head.size();
+
+    size_t const      rowSize = size_t(width) * pixelSize;
+    std::vector<char> padding(size_t(pitch) - rowSize, 0);
+    for (int y = 0; ok && y < height; ++y)
+    {
+        ok = fwrite(static_cast<char const *>(rows) + y * srcPitch, 1, rowSize, fp) == rowSize &&
+             fwrite(padding.data(), 1, padding.size(), fp) == padding.size();
+    }
+    return (fclose(fp) == 0) && ok;
+}
@@ -0,0 +1,134 @@
+#include "Dither.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Width and height of the Bayer matrix
+static int constexpr BAYER_SIZE = 8;
+
+// Width and height of the blue-noise matrix
+static int constexpr BLUE_NOISE_SIZE = 32;
+
+// Standard deviation of the filter used to find clusters and voids when generating blue noise
+static double constexpr BLUE_NOISE_SIGMA = 1.5;
+
+static uint16_t const BAYER_VALUES[BAYER_SIZE * BAYER_SIZE] =
+{
+     0, 32,  8, 40,  2, 34, 10, 42,
+    48, 16, 56, 24, 50, 18, 58, 26,
+    12, 44,  4, 36, 14, 46,  6, 38,
+    60, 28, 52, 20, 62, 30, 54, 22,
+     3, 35, 11, 43,  1, 33,  9, 41,
+    51, 19, 59, 27, 49, 17, 57, 25,
+    15, 47,  7, 39, 13, 45,  5, 37,
+    63, 31, 55, 23, 61, 29, 53, 21
+};
+
+// Generates a blue-noise threshold matrix by the void-and-cluster method (Ulichney, 1993).
+//
+// The energy of a location is the sum of a Gaussian of its (wrapped) distance to every set location. The tightest
+// cluster is the set location with the most energy and the largest void is the clear location with the least. The
+// energies are updated incrementally as locations are set and cleared.
+static std::vector<uint16_t> voidAndCluster()
+{
+    int constexpr N    = BLUE_NOISE_SIZE;
+    int constexpr AREA = N * N;
+
+    std::vector<double> filter(AREA);
+    for (int dy = 0; dy < N; ++dy)
+    {
+        for (int dx = 0; dx < N; ++dx)
+        {
+            int const wx = std::min(dx, N - dx);
+            int const wy = std::min(dy, N - dy);
+            filter[dy * N + dx] = std::exp(-(wx * wx + wy * wy) / (2.0 * BLUE_NOISE_SIGMA * BLUE_NOISE_SIGMA));
+        }
+    }
+
+    std::vector<double> energy(AREA, 0.0);
+    std::vector<bool>   set(AREA, false);
+    auto toggle = [&] (int i, bool value) {
+        set[i] = value;
+        double const sign = value ? 1.0 : -1.0;
+        int const    x    = i % N;
+        int const    y    = i / N;
+        for (int j = 0; j < AREA; ++j)
+        {
+            energy[j] += sign * filter[((j / N - y + N) % N) * N + (j % N - x + N) % N];
+        }
+    };
+    auto extreme = [&] (bool value) {
+        int best = -1;
+        for (int i = 0; i < AREA; ++i)
+        {
+            if (set[i] == value && (best < 0 || (value ? energy[i] > energy[best] : energy[i] < energy[best])))
+                best = i;
+        }
+        return best;
+    };
+
+    // Start with a tenth of the locations set at random, and then move points from clusters into voids until the
+    // distribution is even
+
+    int      ones = 0;
+    unsigned seed = 13;
+    while (ones < AREA / 10)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        int const i = int((seed >> 8) % AREA);
+        if (!set[i])
+        {
+            toggle(i, true);
+            ++ones;
+        }
+    }
+    for (;;)
+    {
+        int const cluster = extreme(true);
+        toggle(cluster, false);
+        int const gap = extreme(false);
+        toggle(gap, true);
+        if (gap == cluster)
+            break;
+    }
+    std::vector<bool>   initial       = set;
+    std::vector<double> initialEnergy = energy;
+    int const           initialOnes   = ones;
+
+    // Rank the initial points by removing the tightest clusters first
+
+    std::vector<uint16_t> ranks(AREA);
+    while (ones > 0)
+    {
+        int const cluster = extreme(true);
+        toggle(cluster, false);
+        ranks[cluster] = uint16_t(--ones);
+    }
+
+    // Rank the rest by filling the largest voids first
+
+    set    = initial;
+    energy = initialEnergy;
+    for (ones = initialOnes; ones < AREA; ++ones)
+    {
+        int const gap = extreme(false);
+        toggle(gap, true);
+        ranks[gap] = uint16_t(ones);
+    }
+    return ranks;
+}
+
+ThresholdMatrix const & ThresholdMatrix::bayer()
+{
+    static ThresholdMatrix const matrix{ BAYER_SIZE, BAYER_SIZE * BAYER_SIZE, BAYER_VALUES };
+    return matrix;
+}
+
+//! The matrix is generated once, on the first call.
+ThresholdMatrix const & ThresholdMatrix::blueNoise()
+{
+    static std::vector<uint16_t> const values = voidAndCluster();
+    static ThresholdMatrix const       matrix{ BLUE_NOISE_SIZE, BLUE_NOISE_SIZE * BLUE_NOISE_SIZE, values.data() };
+    return matrix;
+}
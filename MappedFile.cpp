@@ -0,0 +1,164 @@
+#include "MappedFile.h"
+
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BITMAP_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define BITMAP_HAS_MMAP 0
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+//! @param  rhs     Mapping to move. It is left closed.
+MappedFile::MappedFile(MappedFile && rhs)
+    : data_(std::exchange(rhs.data_, nullptr))
+    , size_(std::exchange(rhs.size_, 0))
+    , mode_(rhs.mode_)
+{
+}
+
+//! @param  rhs     Mapping to move. It is left closed.
+MappedFile & MappedFile::operator =(MappedFile && rhs)
+{
+    if (&rhs != this)
+    {
+        close();
+        data_ = std::exchange(rhs.data_, nullptr);
+        size_ = std::exchange(rhs.size_, 0);
+        mode_ = rhs.mode_;
+    }
+    return *this;
+}
+
+//! The file is opened only for reading in either mode. An empty file cannot be mapped.
+//!
+//! @param  path    Path of the file
+//! @param  mode    How to map the file
+//!
+//! @return     true if the file was mapped
+bool MappedFile::open(char const * path, Mode mode /*= Mode::READ_ONLY*/)
+{
+    close();
+
+#if BITMAP_HAS_MMAP
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0 || uint64_t(info.st_size) > SIZE_MAX)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    size_t size = size_t(info.st_size);
+    void * data;
+    if (mode == Mode::COPY_ON_WRITE)
+        data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    else
+        data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+
+    // The mapping remains valid after the file is closed
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    data_ = data;
+    size_ = size;
+    mode_ = mode;
+    return true;
+#else
+    (void)path;
+    (void)mode;
+    return false;
+#endif
+}
+
+void MappedFile::close()
+{
+#if BITMAP_HAS_MMAP
+    if (data_)
+        munmap(data_, size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+void * MappedFile::writableData()
+{
+    assert(mode_ == Mode::COPY_ON_WRITE);
+    return data_;
+}
+
+//! The advice applies to the pages overlapping the range. It is only a hint and may be ignored.
+//!
+//! @param  access  Expected pattern of access
+//! @param  offset  Start of the range
+//! @param  size    Size of the range, or 0 for the rest of the contents
+void MappedFile::advise(Access access, size_t offset /*= 0*/, size_t size /*= 0*/) const
+{
+    assert(offset <= size_);
+    if (!data_)
+        return;
+    if (size == 0)
+        size = size_ - offset;
+
+#if BITMAP_HAS_MMAP
+    int advice = POSIX_MADV_NORMAL;
+    if (access == Access::SEQUENTIAL)
+        advice = POSIX_MADV_SEQUENTIAL;
+    else if (access == Access::RANDOM)
+        advice = POSIX_MADV_RANDOM;
+
+    void * start = pages(offset, &size);
+    posix_madvise(start, size, advice);
+#else
+    (void)access;
+#endif
+}
+
+//! @param  offset  Start of the range
+//! @param  size    Size of the range
+void MappedFile::prefetch(size_t offset, size_t size) const
+{
+    assert(offset <= size_);
+    if (!data_ || size == 0)
+        return;
+
+#if BITMAP_HAS_MMAP
+    void * start = pages(offset, &size);
+    posix_madvise(start, size, POSIX_MADV_WILLNEED);
+#endif
+}
+
+bool MappedFile::isSupported()
+{
+    return BITMAP_HAS_MMAP != 0;
+}
+
+void * MappedFile::pages(size_t offset, size_t * pSize) const
+{
+    size_t end = offset + *pSize;
+    if (end > size_)
+        end = size_;
+
+#if BITMAP_HAS_MMAP
+    size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+#else
+    size_t pageSize = 4096;
+#endif
+    size_t first = offset - offset % pageSize;
+    *pSize = end - first;
+    return static_cast<char *>(data_) + first;
+}
@@ -0,0 +1,78 @@
+#include "Palette.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+//! @param  keys    Raw values of the entries
+//! @param  colors  Entries (red, green, blue)
+//! @param  count   Number of entries (1 - 256)
+PaletteIndex::PaletteIndex(uint32_t const * keys, uint8_t const (*colors)[3], int count)
+{
+    assert(count > 0 && count <= MAX_ENTRIES);
+
+    memcpy(keys_, keys, count * sizeof(*keys));
+    memcpy(colors_, colors, count * sizeof(*colors));
+
+    // Only the first of equal entries is put in the hash table, so it is the one found. The table is twice the size of
+    // the largest palette, so there is always an empty slot to end a search.
+
+    std::fill(std::begin(slots_), std::end(slots_), int16_t(-1));
+    for (int i = 0; i < count; ++i)
+    {
+        int slot = slotOf(keys[i]);
+        while (slots_[slot] >= 0 && keys_[slots_[slot]] != keys[i])
+        {
+            slot = (slot + 1) & (HASH_SIZE - 1);
+        }
+        if (slots_[slot] < 0)
+            slots_[slot] = int16_t(i);
+    }
+
+    // The nearest entry to any color in a cell is no farther from it than the entry whose farthest point in the cell is
+    // nearest. So only the entries whose nearest point in the cell is within that distance are candidates. They are
+    // sorted by that distance, so that a search can stop at the first candidate farther than the nearest entry found.
+
+    int constexpr CELL_SIZE = 1 << CELL_SHIFT;
+    int constexpr MASK      = (1 << GRID_BITS) - 1;
+
+    Candidate cell[MAX_ENTRIES];
+    starts_[0] = 0;
+    for (int c = 0; c < GRID_CELLS; ++c)
+    {
+        int lo[3];
+        for (int channel = 0; channel < 3; ++channel)
+        {
+            lo[channel] = ((c >> ((2 - channel) * GRID_BITS)) & MASK) << CELL_SHIFT;
+        }
+
+        int bound = INT32_MAX;
+        for (int i = 0; i < count; ++i)
+        {
+            int nearest  = 0;
+            int farthest = 0;
+            for (int channel = 0; channel < 3; ++channel)
+            {
+                int const v     = colors[i][channel];
+                int const below = lo[channel] - v;
+                int const above = v - (lo[channel] + CELL_SIZE - 1);
+                int const d     = std::max({ below, above, 0 });
+                int const f     = std::max(v - lo[channel], lo[channel] + CELL_SIZE - 1 - v);
+                nearest  += d * d;
+                farthest += f * f;
+            }
+            cell[i] = Candidate{ nearest, i };
+            bound   = std::min(bound, farthest);
+        }
+
+        Candidate * const end = std::remove_if(cell, cell + count, [bound] (Candidate const & candidate) {
+            return candidate.distance > bound;
+        });
+        std::sort(cell, end, [] (Candidate const & a, Candidate const & b) {
+            return (a.distance != b.distance) ? a.distance < b.distance : a.entry < b.entry;
+        });
+        candidates_.insert(candidates_.end(), cell, end);
+        starts_[c + 1] = uint32_t(candidates_.size());
+    }
+}
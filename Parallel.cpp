@@ -0,0 +1,135 @@
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cassert>
+
+//! @param  threads     Number of threads doing work, including the calling thread, or 0 to match the hardware
+ThreadPool::ThreadPool(int threads /*= 0*/)
+{
+    assert(threads >= 0);
+    if (threads == 0)
+        threads = std::max(int(std::thread::hardware_concurrency()), 1);
+
+    workers_.reserve(threads - 1);
+    for (int i = 1; i < threads; ++i)
+    {
+        workers_.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    queued_.notify_all();
+    for (auto & worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+//! The calls are distributed among the workers and the calling thread, in no particular order.
+//!
+//! @param  count   Number of calls
+//! @param  task    Function to call
+void ThreadPool::run(int count, std::function<void(int)> const & task)
+{
+    if (count <= 0)
+        return;
+
+    if (count == 1 || workers_.empty())
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            task(i);
+        }
+        return;
+    }
+
+    Job job{ &task, count, 0, 0 };
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    jobs_.push_back(&job);
+    queued_.notify_all();
+
+    while (job.next < job.count)
+    {
+        int i = claim(&job);
+        lock.unlock();
+        task(i);
+        lock.lock();
+        ++job.finished;
+    }
+
+    // Wait for the workers to finish their calls. Once they have, none of them refers to the job.
+    finished_.wait(lock, [&job] { return job.finished == job.count; });
+}
+
+//! The pool is created on first use and has one thread per hardware thread.
+ThreadPool & ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::work()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;)
+    {
+        queued_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+        if (stop_)
+            return;
+
+        Job * job = jobs_.front();
+        int   i   = claim(job);
+        lock.unlock();
+        (*job->task)(i);
+        lock.lock();
+        if (++job->finished == job->count)
+            finished_.notify_all();
+    }
+}
+
+int ThreadPool::claim(Job * job)
+{
+    assert(job->next < job->count);
+
+    int i = job->next++;
+    if (job->next == job->count)
+        jobs_.erase(std::find(jobs_.begin(), jobs_.end(), job));
+    return i;
+}
+
+//! The bands are processed on the calling thread unless the execution is PARALLEL and there is enough data to give
+//! each thread at least PARALLEL_MIN_BAND_SIZE bytes. Bands do not overlap and together cover every row.
+//!
+//! @param  execution   How to process the bands
+//! @param  rows        Number of rows
+//! @param  rowSize     Amount of data in each row (in bytes)
+//! @param  f           Function called for each band with the first row and one past the last row
+void forEachBand(Execution execution, int rows, size_t rowSize, std::function<void(int begin, int end)> const & f)
+{
+    if (rows <= 0)
+        return;
+
+    size_t bands = 1;
+    if (execution == Execution::PARALLEL)
+    {
+        bands = std::min({ size_t(ThreadPool::shared().size()), rows * rowSize / PARALLEL_MIN_BAND_SIZE, size_t(rows) });
+    }
+
+    if (bands <= 1)
+    {
+        f(0, rows);
+        return;
+    }
+
+    ThreadPool::shared().run(int(bands), [rows, bands, &f] (int i) {
+        int begin = int(rows * size_t(i) / bands);
+        int end   = int(rows * size_t(i + 1) / bands);
+        f(begin, end);
+    });
+}
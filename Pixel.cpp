@@ -2,7 +2,7 @@
 
 // Instantiate common pixel formats here
 
-template class Pixel16<0x01, 0x1f, 0x3f, 0x1f,  0, 11, 5, 0>;
+template class Pixel16<0, 0x1f, 0x3f, 0x1f,  0, 11, 5, 0>;
 template class Pixel16<0x01, 0x1f, 0x1f, 0x1f, 15, 10, 5, 0>;
 
 template class Pixel24<0, 1, 2>;
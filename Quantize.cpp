@@ -0,0 +1,322 @@
+#include "Quantize.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// Number of levels in the histogram's octree. The leaves are the cells of the histogram.
+static int constexpr OCTREE_DEPTH = ColorQuantizer::HISTOGRAM_BITS;
+
+// Mask of a channel's index in the histogram
+static int constexpr CHANNEL_MASK = (1 << ColorQuantizer::HISTOGRAM_BITS) - 1;
+
+// Returns the index of a channel of a histogram cell
+static int channelOf(int cell, int channel)
+{
+    return (cell >> ((2 - channel) * ColorQuantizer::HISTOGRAM_BITS)) & CHANNEL_MASK;
+}
+
+// Returns the average of a sum of values, rounded
+static uint8_t average(uint64_t sum, uint64_t count)
+{
+    return uint8_t((sum + count / 2) / count);
+}
+
+ColorQuantizer::ColorQuantizer()
+    : cells_(HISTOGRAM_SIZE, Cell{ 0, 0, 0, 0 })
+{
+}
+
+//! @param  r       Red
+//! @param  g       Green
+//! @param  b       Blue
+//! @param  count   Number of times to add the color
+void ColorQuantizer::add(uint8_t r, uint8_t g, uint8_t b, uint32_t count /*= 1*/)
+{
+    Cell & cell = cells_[cellOf(r, g, b)];
+    cell.count += count;
+    cell.r     += uint64_t(r) * count;
+    cell.g     += uint64_t(g) * count;
+    cell.b     += uint64_t(b) * count;
+}
+
+void ColorQuantizer::clear()
+{
+    std::fill(cells_.begin(), cells_.end(), Cell{ 0, 0, 0, 0 });
+}
+
+int ColorQuantizer::cells() const
+{
+    return int(std::count_if(cells_.begin(), cells_.end(), [] (Cell const & cell) { return cell.count > 0; }));
+}
+
+//! If the histogram uses no more than maxColors cells, each used cell gets its own color.
+//!
+//! @param  method      How to choose the colors
+//! @param  colors      Receives the colors (red, green, blue)
+//! @param  maxColors   Maximum number of colors to choose (1 - 256)
+//!
+//! @return     number of colors chosen, or 0 if the histogram is empty
+int ColorQuantizer::build(QuantizeMethod method, uint8_t (*colors)[3], int maxColors /*= MAX_COLORS*/) const
+{
+    assert(maxColors > 0 && maxColors <= MAX_COLORS);
+    if (method == QuantizeMethod::MEDIAN_CUT)
+        return medianCut(colors, maxColors);
+    else
+        return octree(colors, maxColors);
+}
+
+// The used cells of the histogram are the leaves of an octree, 5 levels deep. Nodes at the deepest level are merged
+// into their parents, least used first, until there are few enough leaves. If merging a whole level is not enough,
+// the next level up is merged in the same way.
+int ColorQuantizer::octree(uint8_t (*colors)[3], int maxColors) const
+{
+    struct Node
+    {
+        Cell sum;           // Sum of the cells below the node
+        int  children[8];   // Indexes of the children, or 0 if none
+        int  level;         // Depth of the node
+        bool leaf;          // True if the children have been merged into this node, or it is a cell
+    };
+
+    std::vector<Node> nodes(1, Node{ { 0, 0, 0, 0 }, {}, 0, false });
+    int               leaves = 0;
+    for (int c = 0; c < HISTOGRAM_SIZE; ++c)
+    {
+        Cell const & cell = cells_[c];
+        if (cell.count == 0)
+            continue;
+
+        int n = 0;
+        for (int level = 0;; ++level)
+        {
+            Node & node = nodes[n];
+            node.sum.count += cell.count;
+            node.sum.r     += cell.r;
+            node.sum.g     += cell.g;
+            node.sum.b     += cell.b;
+            if (level == OCTREE_DEPTH)
+                break;
+
+            int const bit   = OCTREE_DEPTH - 1 - level;
+            int const child = (((channelOf(c, 0) >> bit) & 1) << 2) |
+                              (((channelOf(c, 1) >> bit) & 1) << 1) |
+                              ((channelOf(c, 2) >> bit) & 1);
+            if (nodes[n].children[child] == 0)
+            {
+                nodes[n].children[child] = int(nodes.size());
+                nodes.push_back(Node{ { 0, 0, 0, 0 }, {}, level + 1, level + 1 == OCTREE_DEPTH });
+                if (level + 1 == OCTREE_DEPTH)
+                    ++leaves;
+            }
+            n = nodes[n].children[child];
+        }
+    }
+    if (leaves == 0)
+        return 0;
+
+    // Reduce the tree
+
+    for (int level = OCTREE_DEPTH - 1; level >= 0 && leaves > maxColors; --level)
+    {
+        std::vector<int> reducible;
+        for (int n = 0; n < int(nodes.size()); ++n)
+        {
+            if (nodes[n].level == level && !nodes[n].leaf)
+                reducible.push_back(n);
+        }
+        std::sort(reducible.begin(), reducible.end(), [&nodes] (int a, int b) {
+            return nodes[a].sum.count < nodes[b].sum.count;
+        });
+        for (int n : reducible)
+        {
+            if (leaves <= maxColors)
+                break;
+            int const children = int(std::count_if(std::begin(nodes[n].children),
+                                                   std::end(nodes[n].children),
+                                                   [] (int child) { return child != 0; }));
+            nodes[n].leaf  = true;
+            leaves        -= children - 1;
+        }
+    }
+
+    // The colors are the averages of the leaves
+
+    int              count = 0;
+    std::vector<int> stack(1, 0);
+    while (!stack.empty())
+    {
+        Node const & node = nodes[stack.back()];
+        stack.pop_back();
+        if (node.leaf)
+        {
+            colors[count][0] = average(node.sum.r, node.sum.count);
+            colors[count][1] = average(node.sum.g, node.sum.count);
+            colors[count][2] = average(node.sum.b, node.sum.count);
+            ++count;
+            continue;
+        }
+        for (int child : node.children)
+        {
+            if (child != 0)
+                stack.push_back(child);
+        }
+    }
+    assert(count == leaves);
+    return count;
+}
+
+// Every used cell starts in a single box. The box with the most colors is split across its longest side at the
+// median, until there are enough boxes or no box has more than one cell.
+int ColorQuantizer::medianCut(uint8_t (*colors)[3], int maxColors) const
+{
+    struct Box
+    {
+        int      begin;     // First cell
+        int      end;       // End of the cells
+        uint64_t count;     // Number of colors
+    };
+
+    std::vector<int> used;
+    uint64_t         total = 0;
+    for (int c = 0; c < HISTOGRAM_SIZE; ++c)
+    {
+        if (cells_[c].count > 0)
+        {
+            used.push_back(c);
+            total += cells_[c].count;
+        }
+    }
+    if (used.empty())
+        return 0;
+
+    std::vector<Box> boxes(1, Box{ 0, int(used.size()), total });
+    while (int(boxes.size()) < maxColors)
+    {
+        // Find the box with the most colors that can be split
+
+        Box * box = nullptr;
+        for (Box & b : boxes)
+        {
+            if (b.end - b.begin >= 2 && (!box || b.count > box->count))
+                box = &b;
+        }
+        if (!box)
+            break;
+
+        // Sort its cells along the longest side
+
+        int lo[3] = { CHANNEL_MASK, CHANNEL_MASK, CHANNEL_MASK };
+        int hi[3] = { 0, 0, 0 };
+        for (int i = box->begin; i < box->end; ++i)
+        {
+            for (int channel = 0; channel < 3; ++channel)
+            {
+                lo[channel] = std::min(lo[channel], channelOf(used[i], channel));
+                hi[channel] = std::max(hi[channel], channelOf(used[i], channel));
+            }
+        }
+        int axis = 0;
+        for (int channel = 1; channel < 3; ++channel)
+        {
+            if (hi[channel] - lo[channel] > hi[axis] - lo[axis])
+                axis = channel;
+        }
+        std::sort(used.begin() + box->begin, used.begin() + box->end, [axis] (int a, int b) {
+            int const ca = channelOf(a, axis);
+            int const cb = channelOf(b, axis);
+            return (ca != cb) ? ca < cb : a < b;
+        });
+
+        // Split at the median. Each half gets at least one cell.
+
+        uint64_t below = 0;
+        int      split = box->begin;
+        while (split < box->end - 1 && below + cells_[used[split]].count <= box->count / 2)
+        {
+            below += cells_[used[split]].count;
+            ++split;
+        }
+        split = std::clamp(split, box->begin + 1, box->end - 1);
+        below = 0;
+        for (int i = box->begin; i < split; ++i)
+        {
+            below += cells_[used[i]].count;
+        }
+
+        Box const upper{ split, box->end, box->count - below };
+        box->end   = split;
+        box->count = below;
+        boxes.push_back(upper);
+    }
+
+    // The colors are the averages of the boxes
+
+    for (size_t i = 0; i < boxes.size(); ++i)
+    {
+        Cell sum{ 0, 0, 0, 0 };
+        for (int j = boxes[i].begin; j < boxes[i].end; ++j)
+        {
+            Cell const & cell = cells_[used[j]];
+            sum.count += cell.count;
+            sum.r     += cell.r;
+            sum.g     += cell.g;
+            sum.b     += cell.b;
+        }
+        colors[i][0] = average(sum.r, sum.count);
+        colors[i][1] = average(sum.g, sum.count);
+        colors[i][2] = average(sum.b, sum.count);
+    }
+    return int(boxes.size());
+}
+
+//! @param  colors      Palette entries (red, green, blue)
+//! @param  count       Number of entries (1 - 256)
+//! @param  execution   How to build the table
+InverseColormap::InverseColormap(uint8_t const (*colors)[3], int count, Execution execution /*= Execution::SEQUENTIAL*/)
+{
+    build(colors, count, execution);
+}
+
+// Each plane of red values is searched separately. The first of equally near entries is chosen.
+void InverseColormap::build(uint8_t const (*colors)[3], int count, Execution execution)
+{
+    assert(count > 0 && count <= ColorQuantizer::MAX_COLORS);
+
+    int constexpr SIZE  = 1 << BITS;
+    int constexpr SHIFT = 8 - BITS;
+    int constexpr HALF  = 1 << (SHIFT - 1);
+
+    table_.resize(ColorQuantizer::HISTOGRAM_SIZE);
+    uint8_t * const table = table_.data();
+    forEachBand(execution, SIZE, SIZE * SIZE * count, [&] (int begin, int end) {
+        for (int ri = begin; ri < end; ++ri)
+        {
+            for (int gi = 0; gi < SIZE; ++gi)
+            {
+                for (int bi = 0; bi < SIZE; ++bi)
+                {
+                    int const r            = (ri << SHIFT) + HALF;
+                    int const g            = (gi << SHIFT) + HALF;
+                    int const b            = (bi << SHIFT) + HALF;
+                    int       best         = 0;
+                    int       bestDistance = INT32_MAX;
+                    for (int i = 0; i < count; ++i)
+                    {
+                        int const dr       = r - colors[i][0];
+                        int const dg       = g - colors[i][1];
+                        int const db       = b - colors[i][2];
+                        int const distance = dr * dr + dg * dg + db * db;
+                        if (distance < bestDistance)
+                        {
+                            best         = i;
+                            bestDistance = distance;
+                        }
+                    }
+                    table[(ri << (2 * BITS)) | (gi << BITS) | bi] = uint8_t(best);
+                }
+            }
+        }
+    });
+}
@@ -3,14 +3,36 @@
 
 #pragma once
 
+#include "Bitmap/BitmapView.h"
+#include "Bitmap/Blend.h"
+#include "Bitmap/ColorKey.h"
+#include "Bitmap/Fill.h"
 #include "Bitmap/Palette.h"
+#include "Bitmap/Parallel.h"
 #include "Bitmap/Pixel.h"
 #include "Rect/Rect.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+//! Clips a copy of a rect from a source image to a destination image so that it lies entirely within both.
+inline void clipCopy(Rect * srcRect, int srcW, int srcH, int * dstX, int * dstY, int dstW, int dstH);
 
 //! An image type.
+//!
+//! The image data is allocated from a std::pmr::memory_resource, so bitmaps can be backed by arenas or pools. As with
+//! the std::pmr containers, the resource is fixed for the lifetime of the bitmap and a copy-constructed bitmap uses the
+//! default resource unless one is specified.
+//!
+//! A bitmap can optionally share its image data with its copies (see setCopyOnWrite()). In that case, the image data is
+//! reference-counted and a bitmap makes a private copy only when it is first modified through data(), view(), copy()
+//! or any other non-const access.
 template <typename Pixel>
 class Bitmap
 {
@@ -22,15 +44,46 @@ public:
     //! Size of a pixel in bytes
     static size_t constexpr PIXEL_SIZE = sizeof(Pixel);
 
+    //! View of the pixels in a bitmap.
+    using View = BitmapView<Pixel>;
+
+    //! Read-only view of the pixels in a bitmap.
+    using ConstView = BitmapView<Pixel const>;
+
+    //! Alignment of the image data (in bytes), and the default row alignment used by alignedPitch().
+    static size_t constexpr ROW_ALIGNMENT = 64;
+
+    //! Size of the bookkeeping header that precedes the image data in memory (in bytes). See adopt().
+    static size_t constexpr BUFFER_HEADER_SIZE = ROW_ALIGNMENT;
+
+    //! A copy operation in a batch (see copy(Blit const *, size_t, Execution)).
+    struct Blit
+    {
+        ConstView src;      //!< Source image
+        Rect      srcRect;  //!< Region of the source image to copy
+        int       dstX;     //!< Where to place the copy
+        int       dstY;     //!< Where to place the copy
+    };
+
     //! Constructor.
     Bitmap() = default;
 
     //! Constructor.
-    Bitmap(int width, int height, size_t pitch = 0, Pixel const * data = nullptr);
+    explicit Bitmap(std::pmr::memory_resource * resource);
+
+    //! Constructor.
+    Bitmap(int                         width,
+           int                         height,
+           size_t                      pitch    = 0,
+           Pixel const *               data     = nullptr,
+           std::pmr::memory_resource * resource = nullptr);
 
     //! Copy constructor.
     Bitmap(Bitmap const & rhs);
 
+    //! Copy constructor using a specific memory resource.
+    Bitmap(Bitmap const & rhs, std::pmr::memory_resource * resource);
+
     //! Move constructor.
     Bitmap(Bitmap && rhs);
 
@@ -46,10 +99,8 @@ public:
     //! Loads an image
     void load(int width, int height, size_t pitch, Pixel const * data);
 
-#if 0
-    //! References an image
-    void reference(int width, int height, size_t pitch, Pixel * data);
-#endif
+    //! Uses existing memory as the image data, without copying it.
+    void adopt(int width, int height, size_t pitch, Pixel * data);
 
     //! Returns the pixel at (y, x)
     Pixel pixel(int x, int y) const { return data_ ? *addressOf(x, y) : Pixel(); }
@@ -63,57 +114,205 @@ public:
     //! Returns the pitch of the bitmap (in bytes).
     size_t pitch() const { return pitch_; }
 
-#if 0
-    //! Returns true if the bitmap references an external image.
-    bool referenced() const { return referenced_; }
-#endif
+    //! Returns the memory resource that provides the image data.
+    std::pmr::memory_resource * resource() const { return resource_; }
+
+    //! Returns the size of the allocated image data (in bytes).
+    size_t capacity() const { return data_ ? bufferOf(data_)->size : 0; }
+
+    //! Frees any allocated image data not used by the current image.
+    void shrinkToFit();
+
+    //! Enables or disables sharing of the image data with copies of this bitmap.
+    void setCopyOnWrite(bool enable);
+
+    //! Returns true if copies of this bitmap share its image data until they are modified.
+    bool copyOnWrite() const { return copyOnWrite_; }
+
+    //! Returns true if the image data is currently shared with another bitmap.
+    bool shared() const { return data_ && bufferOf(data_)->references.load(std::memory_order_acquire) > 1; }
 
     //! Returns a pointer to the pixel at (y, x).
     Pixel const * data(int x = 0, int y = 0) const { return addressOf(x, y); }
 
     //! Returns a pointer to the pixel at (y, x).
-    Pixel * data(int x = 0, int y = 0) { return const_cast<Pixel *>(addressOf(x, y)); }
+    Pixel * data(int x = 0, int y = 0) { detach(); return const_cast<Pixel *>(addressOf(x, y)); }
+
+    //! Returns a read-only view of the entire bitmap.
+    ConstView view() const { return ConstView(width_, height_, pitch_, data_); }
+
+    //! Returns a view of the entire bitmap.
+    View view() { detach(); return View(width_, height_, pitch_, data_); }
+
+    //! Returns a read-only view of a region of this bitmap.
+    ConstView view(int x, int y, int width, int height) const { return view().subview(x, y, width, height); }
+
+    //! Returns a view of a region of this bitmap.
+    View view(int x, int y, int width, int height) { return view().subview(x, y, width, height); }
 
     //! Creates a bitmap from a region of this bitmap.
     Bitmap region(int x, int y, int width, int height, size_t pitch = 0) const;
 
     //! Copies a section of another bitmap into this bitmap
-    void copy(Bitmap const & src, Rect const & srcRect, int dstX, int dstY);
+    void copy(Bitmap const & src,
+              Rect const &   srcRect,
+              int            dstX,
+              int            dstY,
+              Execution      execution = Execution::SEQUENTIAL)
+    {
+        copy(src.view(), srcRect, dstX, dstY, execution);
+    }
+
+    //! Copies a section of an image into this bitmap
+    void copy(ConstView const & src,
+              Rect const &      srcRect,
+              int               dstX,
+              int               dstY,
+              Execution         execution = Execution::SEQUENTIAL);
+
+    //! Copies sections of many images into this bitmap
+    void copy(Blit const * blits, size_t count, Execution execution = Execution::SEQUENTIAL);
+
+    //! Composites a section of another bitmap onto this bitmap
+    void blend(Bitmap const & src,
+               Rect const &   srcRect,
+               int            dstX,
+               int            dstY,
+               BlendMode      mode,
+               Execution      execution = Execution::SEQUENTIAL)
+    {
+        blend(src.view(), srcRect, dstX, dstY, mode, execution);
+    }
+
+    //! Composites a section of an image onto this bitmap
+    void blend(ConstView const & src,
+               Rect const &      srcRect,
+               int               dstX,
+               int               dstY,
+               BlendMode         mode,
+               Execution         execution = Execution::SEQUENTIAL);
+
+    //! Copies a section of another bitmap into this bitmap, except for the pixels matching a color key
+    void copyKeyed(Bitmap const & src,
+                   Rect const &   srcRect,
+                   int            dstX,
+                   int            dstY,
+                   Pixel const &  key,
+                   Execution      execution = Execution::SEQUENTIAL)
+    {
+        copyKeyed(src.view(), srcRect, dstX, dstY, key, execution);
+    }
+
+    //! Copies a section of an image into this bitmap, except for the pixels matching a color key
+    void copyKeyed(ConstView const & src,
+                   Rect const &      srcRect,
+                   int               dstX,
+                   int               dstY,
+                   Pixel const &     key,
+                   Execution         execution = Execution::SEQUENTIAL);
+
+    //! Sets every pixel in a region of this bitmap to a value
+    void fill(Rect const & rect, Pixel const & value, Execution execution = Execution::SEQUENTIAL);
+
+    //! Sets all of the image data to 0
+    void clear(Execution execution = Execution::SEQUENTIAL);
+
+    //! Returns the smallest pitch for the given width in which every row is aligned.
+    static size_t alignedPitch(int width, size_t alignment = ROW_ALIGNMENT);
 
 protected:
 
     int width_    = 0;          //!< Width (in pixels)
     int height_   = 0;          //!< Height (in pixels)
     size_t pitch_ = 0;          //!< Pitch (in bytes)
-#if 0
-    bool referenced_ = false;   //!< If true, then this bitmap does not "own" the image data
-#endif
     Pixel * data_ = nullptr;    //!< Bitmap image data
 
 private:
 
-    // Clips a rect so that it lies entirely within both the source and destination bitmaps.
-    static void clip(Rect * srcRect, int srcW, int srcH, int * dstX, int * dstY, int dstW, int dstH);
+    // Header preceding the image data in every allocation
+    struct Buffer
+    {
+        std::atomic<int> references;            // Number of bitmaps sharing the image data
+        size_t size;                            // Size of the image data (in bytes)
+        std::pmr::memory_resource * resource;   // Source of the allocation
+    };
+
+    // The header is padded to preserve the alignment of the image data
+    static_assert(sizeof(Buffer) <= BUFFER_HEADER_SIZE, "The buffer header does not fit");
+
+    // Approximate size of the band of destination rows processed at a time by a batched copy (in bytes)
+    static size_t constexpr BLIT_BAND_SIZE = 128 * 1024;
+
+    // Fills larger than this (in bytes) bypass the cache
+    static size_t constexpr STREAMING_FILL_SIZE = 8 * 1024 * 1024;
+
+    std::pmr::memory_resource * resource_ = std::pmr::get_default_resource(); // Source of image data
+    bool copyOnWrite_ = false;                                                 // If true, copies share the image data
+
+    // Clips a section of an image to this bitmap and calls f(src, dst, width) for each pair of rows
+    template <typename RowFunction>
+    void forEachRow(ConstView const & src, Rect const & srcRect, int dstX, int dstY, Execution execution, RowFunction f);
 
     // Returns a pointer to the pixel at (y,x)
     Pixel const * addressOf(int x, int y) const;
 
     // Creates a copy of image data
-    static Pixel * createCopy(Pixel const * data, size_t pitch, int height);
+    Pixel * createCopy(Pixel const * data, size_t pitch, int height);
+
+    // Copies the image data of another bitmap, sharing it if possible
+    void assign(Bitmap const & rhs);
+
+    // Ensures that the image data is not shared and holds at least size bytes, reusing the current allocation if possible
+    void reserve(size_t size);
+
+    // Makes a private copy of the image data if it is shared
+    void detach()
+    {
+        if (copyOnWrite_ && shared())
+        {
+            Pixel * copy = createCopy(data_, pitch_, height_);
+            release();
+            data_ = copy;
+        }
+    }
+
+    // Allocates image data aligned to ROW_ALIGNMENT
+    Pixel * allocate(size_t size);
+
+    // Gives up this bitmap's reference to the image data, freeing it if it is not shared
+    void release();
+
+    // Returns the header of the buffer containing the image data
+    static Buffer * bufferOf(Pixel const * data)
+    {
+        return reinterpret_cast<Buffer *>(const_cast<char *>(reinterpret_cast<char const *>(data)) - BUFFER_HEADER_SIZE);
+    }
 };
 
+//! @param  resource    Source of image data, or nullptr for the default resource
+template <class Pixel>
+Bitmap<Pixel>::Bitmap(std::pmr::memory_resource * resource)
+    : resource_(resource ? resource : std::pmr::get_default_resource())
+{
+}
+
+//! The image data is always aligned to ROW_ALIGNMENT. Pass a pitch returned by alignedPitch() to align every row.
+//!
 //! @param  width       Width
 //! @param  height      Height
 //! @param  pitch       Pitch of the referenced image data, or 0 if it is determined by the width
 //! @param  data        Referenced image data
+//! @param  resource    Source of image data, or nullptr for the default resource
 template <class Pixel>
-Bitmap<Pixel>::Bitmap(int width, int height, size_t pitch /*= 0*/, Pixel const * data /*= nullptr*/)
+Bitmap<Pixel>::Bitmap(int                         width,
+                      int                         height,
+                      size_t                      pitch /*= 0*/,
+                      Pixel const *               data /*= nullptr*/,
+                      std::pmr::memory_resource * resource /*= nullptr*/)
     : width_(width)
     , height_(height)
     , pitch_((pitch > 0) ? pitch : width * PIXEL_SIZE)
-#if 0
-    , referenced_(true)
-#endif
+    , resource_(resource ? resource : std::pmr::get_default_resource())
 {
     assert(width >= 0);
     assert(height >= 0);
@@ -121,7 +320,7 @@ Bitmap<Pixel>::Bitmap(int width, int height, size_t pitch /*= 0*/, Pixel const *
     assert(pitch % PIXEL_SIZE == 0);
     if (pitch_ > 0 && height_ > 0)
     {
-        data_ = reinterpret_cast<Pixel *>(new char[pitch_ * height_]);
+        data_ = allocate(pitch_ * height_);
         if (data)
             memcpy(data_, data, pitch_ * height_);
     }
@@ -133,121 +332,112 @@ Bitmap<Pixel>::Bitmap(int width, int height, size_t pitch /*= 0*/, Pixel const *
     }
 }
 
+//! The copy's image data is allocated from the default memory resource. If the copy-on-write mode of rhs is enabled,
+//! then the copy shares its image data instead.
+//!
+//! @param  rhs         Bitmap to copy
 template <class Pixel>
 Bitmap<Pixel>::Bitmap(Bitmap const & rhs)
+    : Bitmap(rhs, nullptr)
+{
+}
+
+//! @param  rhs         Bitmap to copy
+//! @param  resource    Source of the copy's image data, or nullptr for the default resource
+template <class Pixel>
+Bitmap<Pixel>::Bitmap(Bitmap const & rhs, std::pmr::memory_resource * resource)
     : width_(rhs.width_)
     , height_(rhs.height_)
     , pitch_(rhs.pitch_)
-#if 0
-    , referenced_(rhs.referenced_)
-#endif
+    , resource_(resource ? resource : std::pmr::get_default_resource())
 {
-#if 0
-    if (referenced_)
-        data_ = rhs.data_;
-    else
-#endif
-    if (rhs.data_ && pitch_ > 0 && height_ > 0)
-        data_ = createCopy(rhs.data_, pitch_, height_);
+    assign(rhs);
 }
 
+//! The moved-to bitmap takes over the memory resource of the moved-from bitmap.
+//!
+//! @param  rhs         Bitmap to move
 template <class Pixel>
 Bitmap<Pixel>::Bitmap(Bitmap && rhs)
     : width_(rhs.width_)
     , height_(rhs.height_)
     , pitch_(rhs.pitch_)
-#if 0
-    , referenced_(rhs.referenced_)
-#endif
     , data_(rhs.data_)
+    , resource_(rhs.resource_)
+    , copyOnWrite_(rhs.copyOnWrite_)
 {
-#if 0
-    if (rhs.data_)
-        rhs.referenced_ = true;
-#else
     rhs.width_  = 0;
     rhs.height_ = 0;
     rhs.pitch_  = 0;
     rhs.data_   = nullptr;
-#endif
 }
 
 template <class Pixel>
 Bitmap<Pixel>::~Bitmap()
 {
-#if 0
-    if (!referenced_ && data_)
-        delete[] data_;
-#else
-    delete[] data_;
-#endif
+    release();
 }
 
+//! The memory resource of this bitmap is not changed. If the copy-on-write mode of rhs is enabled, then this bitmap
+//! shares its image data. Otherwise, the current allocation is reused if it is large enough.
+//!
+//! @param  rhs         Bitmap to copy
 template <class Pixel>
 Bitmap<Pixel> & Bitmap<Pixel>::operator =(Bitmap const & rhs)
 {
     if (this == &rhs)
         return *this;
 
-#if 0
-    if (!referenced_ && data_)
-        delete[] data_;
-#else
-    delete[] data_;
-#endif
-
     width_  = rhs.width_;
     height_ = rhs.height_;
     pitch_  = rhs.pitch_;
-#if 0
-    referenced_ = rhs.referenced_;
-    if (referenced_)
-        data_ = rhs.data_;
-    else
-#endif
-    if (rhs.data_ && pitch_ > 0 && height_ > 0)
-        data_ = createCopy(rhs.data_, pitch_, height_);
+    if (rhs.data_ && !rhs.copyOnWrite_ && pitch_ > 0 && height_ > 0)
+    {
+        reserve(pitch_ * height_);
+        memcpy(data_, rhs.data_, pitch_ * height_);
+        copyOnWrite_ = false;
+    }
     else
-        data_ = nullptr;
+    {
+        release();
+        assign(rhs);
+    }
 
     return *this;
 }
 
+//! The memory resource of this bitmap is not changed. If the two bitmaps use different memory resources, then the
+//! image data is copied rather than moved.
+//!
+//! @param  rhs         Bitmap to move
 template <class Pixel>
 Bitmap<Pixel> & Bitmap<Pixel>::operator =(Bitmap && rhs)
 {
     if (this == &rhs)
         return *this;
 
-#if 0
-    if (!referenced_ && data_)
-        delete[] data_;
-#else
-    delete[] data_;
-#endif
+    if (*resource_ != *rhs.resource_)
+        return *this = static_cast<Bitmap const &>(rhs);
+
+    release();
 
     width_  = rhs.width_;
     height_ = rhs.height_;
     pitch_  = rhs.pitch_;
-#if 0
-    referenced_ = rhs.referenced_;
-#endif
     data_ = rhs.data_;
+    copyOnWrite_ = rhs.copyOnWrite_;
 
-#if 0
-    if (!rhs.referenced_)
-        rhs.data_ = nullptr;
-#else
     rhs.width_  = 0;
     rhs.height_ = 0;
     rhs.pitch_  = 0;
     rhs.data_   = nullptr;
-#endif
 
     return *this;
 }
 
-//! This function replaces the current image with the specified data.
+//! This function replaces the current image with the specified data. The current allocation is reused if it is large
+//! enough, so repeatedly loading images of the same size does not allocate. Use shrinkToFit() to release the excess
+//! after loading a smaller image.
 //!
 //! @param  width       New width
 //! @param  height      New height
@@ -261,51 +451,74 @@ void Bitmap<Pixel>::load(int width, int height, size_t pitch, Pixel const * data
     assert(pitch == 0 || pitch >= width * PIXEL_SIZE);
     assert(data);
 
-#if 0
-    if (!referenced_ && data_)
-        delete[] data_;
-#else
-    delete[] data_;
-#endif
-
     width_  = width;
     height_ = height;
     pitch_  = (pitch > 0) ? pitch : width * PIXEL_SIZE;
-#if 0
-    referenced_ = false;
-#endif
-    data_ = createCopy(data, pitch_, height_);
+    reserve(pitch_ * height_);
+    memmove(data_, data, pitch_ * height_); // The data may be in the current allocation
 }
 
-#if 0
-//! This function replaces the current image with a reference to the specified data.
+//! The data must be aligned to ROW_ALIGNMENT and preceded by BUFFER_HEADER_SIZE bytes of writable memory, which hold
+//! the reference count and other bookkeeping. The memory is never freed by the bitmap, so it must outlive this bitmap
+//! and any copies sharing it. This allows an image stored in a buffer or a mapped file (such as a container, see
+//! BitmapContainer) to be used as a bitmap with no copying.
 //!
-//! @param  width       New width
-//! @param  height      New height
-//! @param  pitch       Pitch of the referenced image, or 0 if it is determined by the width
-//! @param  data        Referenced image data
+//! The bitmap may modify the memory, and it reuses the memory when loading an image that fits. Operations that need
+//! more memory allocate it from the bitmap's memory resource.
 //!
-//! @return void
+//! @param  width       Width
+//! @param  height      Height
+//! @param  pitch       Pitch of the image data, or 0 if it is determined by the width
+//! @param  data        Image data
 template <class Pixel>
-void Bitmap<Pixel>::reference(int width, int height, size_t pitch, Pixel * data)
+void Bitmap<Pixel>::adopt(int width, int height, size_t pitch, Pixel * data)
 {
-    assert(data);
     assert(width > 0);
     assert(height > 0);
     assert(pitch == 0 || pitch >= width * PIXEL_SIZE);
+    assert(data);
+    assert(reinterpret_cast<uintptr_t>(data) % ROW_ALIGNMENT == 0);
 
-    if (!referenced_ && data_)
-        delete[] data_;
+    release();
+    width_  = width;
+    height_ = height;
+    pitch_  = (pitch > 0) ? pitch : width * PIXEL_SIZE;
 
-    width_      = width;
-    height_     = height;
-    pitch_      = (pitch > 0) ? pitch : width * PIXEL_SIZE;
-    referenced_ = true;
-    data_       = data;
+    // The null resource does nothing when the buffer is deallocated
+    void * header = reinterpret_cast<char *>(data) - BUFFER_HEADER_SIZE;
+    new (header) Buffer{ { 1 }, pitch_ * height_, std::pmr::null_memory_resource() };
+    data_ = data;
 }
-#endif // if 0
 
-//! This function creates a bitmap that references a region in this bitmap. Use copy() to create a copy of the region.
+template <class Pixel>
+void Bitmap<Pixel>::shrinkToFit()
+{
+    if (data_ && capacity() > pitch_ * height_)
+    {
+        Pixel * copy = createCopy(data_, pitch_, height_);
+        release();
+        data_ = copy;
+    }
+}
+
+//! When enabled, copies of this bitmap (and copies of those copies) share the image data until one of them is
+//! modified. When disabled, the image data is no longer shared by future copies, but any current sharing
+//! continues until a sharing bitmap is modified.
+//!
+//! @param  enable      If true, copy-on-write is enabled
+//!
+//! @warning    Pointers and views obtained through non-const access before a copy is made will still refer to the
+//!             shared image data.
+template <class Pixel>
+void Bitmap<Pixel>::setCopyOnWrite(bool enable)
+{
+    if (!enable)
+        detach();
+    copyOnWrite_ = enable;
+}
+
+//! This function creates a bitmap containing a copy of a region in this bitmap. Use view() to reference a region
+//! without copying it.
 //!
 //! @param  x           Left of the region
 //! @param  y           Top of the region
@@ -320,42 +533,328 @@ Bitmap<Pixel> Bitmap<Pixel>::region(int x, int y, int width, int height, size_t
 {
     Rect srcRect{ 0, 0, width_, height_ };
     srcRect.clip(Rect{ x, y, width, height });
-#if 0
-    return Bitmap<Pixel>(srcRect.width, srcRect.height, pitch_, addressOf(srcRect.x, srcRect.y), pitch);
-#else
     Bitmap<Pixel> r(srcRect.width, srcRect.height, pitch);
     r.copy(*this, srcRect, 0, 0);
     return r;
-#endif
 }
 
-//! @param  src         Source bitmap
-//! @param  srcRect     Region of the source bitmap to copy
-//! @param  dstY        Where to place the copy
+//! With Execution::PARALLEL, large copies are split into row bands that are copied concurrently by the shared thread
+//! pool (see forEachBand()). Small copies are always done on the calling thread.
+//!
+//! @param  src         Source image
+//! @param  srcRect     Region of the source image to copy
 //! @param  dstX        Where to place the copy
+//! @param  dstY        Where to place the copy
+//! @param  execution   How to perform the copy
+//!
+//! @warning    The source must not overlap the destination region.
 template <class Pixel>
-void Bitmap<Pixel>::copy(Bitmap const & src, Rect const & srcRect, int dstY, int dstX)
+void Bitmap<Pixel>::copy(ConstView const & src,
+                         Rect const &      srcRect,
+                         int               dstX,
+                         int               dstY,
+                         Execution         execution /*= Execution::SEQUENTIAL*/)
 {
     Rect rect = srcRect;
-    clip(&rect, src.width(), src.height(), &dstX, &dstY, width_, height_);
+    clipCopy(&rect, src.width(), src.height(), &dstX, &dstY, width_, height_);
 
     if (rect.width <= 0 || rect.height <= 0)
         return;
 
-    int srcY = rect.y;
-    int srcX = rect.x;
-    for (int i = 0; i < rect.height; ++i)
+    detach();
+
+    char const * s        = reinterpret_cast<char const *>(src.data(rect.x, rect.y));
+    char *       d        = reinterpret_cast<char *>(data_) + dstY * pitch_ + dstX * PIXEL_SIZE;
+    size_t       srcPitch = src.pitch();
+    size_t       dstPitch = pitch_;
+    size_t       size     = rect.width * PIXEL_SIZE;
+
+    forEachBand(execution, rect.height, size, [=] (int begin, int end) {
+        char const * sRow = s + begin * srcPitch;
+        char *       dRow = d + begin * dstPitch;
+
+        // If the rows are contiguous in both images, the band can be copied all at once
+        if (srcPitch == size && dstPitch == size)
+        {
+            memcpy(dRow, sRow, (end - begin) * size);
+            return;
+        }
+
+        for (int i = begin; i < end; ++i)
+        {
+            memcpy(dRow, sRow, size);
+            sRow += srcPitch;
+            dRow += dstPitch;
+        }
+    });
+}
+
+//! The operations are clipped up front and then performed one band of destination rows at a time, so that the rows
+//! of each band stay in the cache while every operation touching the band is applied. Within a band, the operations
+//! are applied in the order given, so where destinations overlap, later operations overwrite earlier ones just as if
+//! copy() had been called for each one.
+//!
+//! With Execution::PARALLEL, the bands of a large batch are distributed among the threads of the shared thread pool.
+//!
+//! @param  blits       Copy operations
+//! @param  count       Number of operations
+//! @param  execution   How to perform the copies
+//!
+//! @warning    No source may overlap this bitmap's image data.
+template <class Pixel>
+void Bitmap<Pixel>::copy(Blit const * blits, size_t count, Execution execution /*= Execution::SEQUENTIAL*/)
+{
+    assert(blits || count == 0);
+
+    // A clipped copy operation
+    struct Operation
+    {
+        char const * src;       // First source pixel
+        size_t       srcPitch;  // Pitch of the source
+        size_t       offset;    // Offset of the first pixel in each destination row (in bytes)
+        size_t       size;      // Size of each row (in bytes)
+        int          top;       // First destination row
+        int          bottom;    // One past the last destination row
+    };
+
+    std::vector<Operation> operations;
+    operations.reserve(count);
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        Blit const & blit = blits[i];
+        Rect         rect = blit.srcRect;
+        int          dstX = blit.dstX;
+        int          dstY = blit.dstY;
+        clipCopy(&rect, blit.src.width(), blit.src.height(), &dstX, &dstY, width_, height_);
+        if (rect.width <= 0 || rect.height <= 0)
+            continue;
+
+        operations.push_back(Operation{ reinterpret_cast<char const *>(blit.src.data(rect.x, rect.y)),
+                                        blit.src.pitch(),
+                                        dstX * PIXEL_SIZE,
+                                        rect.width * PIXEL_SIZE,
+                                        dstY,
+                                        dstY + rect.height });
+        total += rect.height * rect.width * PIXEL_SIZE;
+    }
+
+    if (operations.empty())
+        return;
+
+    detach();
+
+    // Sort the operations into the bands they touch, preserving their order
+
+    int const bandHeight = std::max(int(BLIT_BAND_SIZE / pitch_), 1);
+    int const bandCount  = (height_ + bandHeight - 1) / bandHeight;
+
+    std::vector<size_t> first(bandCount + 1, 0);   // Index in members of the first operation in each band
+    for (auto const & op : operations)
     {
-        Pixel *       d = const_cast<Pixel *>(addressOf(dstX, dstY));
-        Pixel const * s = src.data(srcX, srcY);
-        memcpy(d, s, rect.width * PIXEL_SIZE);
-        ++srcY;
-        ++dstY;
+        for (int b = op.top / bandHeight; b <= (op.bottom - 1) / bandHeight; ++b)
+        {
+            ++first[b + 1];
+        }
     }
+    for (int b = 0; b < bandCount; ++b)
+    {
+        first[b + 1] += first[b];
+    }
+
+    std::vector<int>    members(first[bandCount]);  // Indexes of the operations touching each band
+    std::vector<size_t> next(first.begin(), first.end() - 1);
+    for (int i = 0; i < int(operations.size()); ++i)
+    {
+        for (int b = operations[i].top / bandHeight; b <= (operations[i].bottom - 1) / bandHeight; ++b)
+        {
+            members[next[b]++] = i;
+        }
+    }
+
+    char * const data   = reinterpret_cast<char *>(data_);
+    size_t const pitch  = pitch_;
+    int const    height = height_;
+
+    forEachBand(execution, bandCount, total / bandCount, [&] (int begin, int end) {
+        for (int b = begin; b < end; ++b)
+        {
+            int bandTop    = b * bandHeight;
+            int bandBottom = std::min(bandTop + bandHeight, height);
+            for (size_t m = first[b]; m < first[b + 1]; ++m)
+            {
+                Operation const & op     = operations[members[m]];
+                int               top    = std::max(op.top, bandTop);
+                int               bottom = std::min(op.bottom, bandBottom);
+                char const *      s      = op.src + (top - op.top) * op.srcPitch;
+                char *            d      = data + top * pitch + op.offset;
+                for (int y = top; y < bottom; ++y)
+                {
+                    memcpy(d, s, op.size);
+                    s += op.srcPitch;
+                    d += pitch;
+                }
+            }
+        }
+    });
+}
+
+//! The region is clipped exactly as it is by copy(). Only 32-bit formats with alpha (such as PixelARGB) can be blended,
+//! and their color channels are assumed to be premultiplied by alpha. See BlendMode for the operations.
+//!
+//! @param  src         Source image
+//! @param  srcRect     Region of the source image to composite
+//! @param  dstX        Where to place the region
+//! @param  dstY        Where to place the region
+//! @param  mode        Compositing operation
+//! @param  execution   How to perform the operation
+//!
+//! @warning    The source must not overlap the destination region.
+template <class Pixel>
+void Bitmap<Pixel>::blend(ConstView const & src,
+                          Rect const &      srcRect,
+                          int               dstX,
+                          int               dstY,
+                          BlendMode         mode,
+                          Execution         execution /*= Execution::SEQUENTIAL*/)
+{
+    forEachRow(src, srcRect, dstX, dstY, execution, [mode] (Pixel const * s, Pixel * d, int width) {
+        PixelBlender<Pixel>::blendRow(mode, s, d, width);
+    });
+}
+
+//! The region is clipped exactly as it is by copy(). Pixels are compared bit for bit, so the key can be any value,
+//! including a palette index. The copy is fastest where the source has long runs of either keyed or non-keyed pixels.
+//!
+//! @param  src         Source image
+//! @param  srcRect     Region of the source image to copy
+//! @param  dstX        Where to place the copy
+//! @param  dstY        Where to place the copy
+//! @param  key         Source pixels with this value are not copied
+//! @param  execution   How to perform the copy
+//!
+//! @warning    The source must not overlap the destination region.
+template <class Pixel>
+void Bitmap<Pixel>::copyKeyed(ConstView const & src,
+                              Rect const &      srcRect,
+                              int               dstX,
+                              int               dstY,
+                              Pixel const &     key,
+                              Execution         execution /*= Execution::SEQUENTIAL*/)
+{
+    Pixel k = key;
+    forEachRow(src, srcRect, dstX, dstY, execution, [k] (Pixel const * s, Pixel * d, int width) {
+        ColorKeyCopier<Pixel>::copyRow(s, d, width, k);
+    });
+}
+
+//! The region is clipped to the bounds of the bitmap. Fills larger than a typical last-level cache use non-temporal
+//! stores, so they do not evict the rest of the cache.
+//!
+//! @param  rect        Region to fill
+//! @param  value       Value to store
+//! @param  execution   How to perform the fill
+template <class Pixel>
+void Bitmap<Pixel>::fill(Rect const & rect, Pixel const & value, Execution execution /*= Execution::SEQUENTIAL*/)
+{
+    Rect clipped{ 0, 0, width_, height_ };
+    clipped.clip(rect);
+    if (clipped.width <= 0 || clipped.height <= 0)
+        return;
+
+    detach();
+
+    char * const d         = reinterpret_cast<char *>(data_) + clipped.y * pitch_ + clipped.x * PIXEL_SIZE;
+    size_t const pitch     = pitch_;
+    int const    width     = clipped.width;
+    bool const   streaming = size_t(clipped.height) * width * PIXEL_SIZE > STREAMING_FILL_SIZE;
+
+    // If the rows are contiguous, each band can be filled all at once
+    bool const contiguous = width * PIXEL_SIZE == pitch;
+
+    forEachBand(execution, clipped.height, width * PIXEL_SIZE, [=, &value] (int begin, int end) {
+        char * row = d + begin * pitch;
+        if (contiguous)
+        {
+            PixelFiller<Pixel>::fillRow(reinterpret_cast<Pixel *>(row), size_t(end - begin) * width, value, streaming);
+            return;
+        }
+        for (int i = begin; i < end; ++i)
+        {
+            PixelFiller<Pixel>::fillRow(reinterpret_cast<Pixel *>(row), width, value, streaming);
+            row += pitch;
+        }
+    });
 }
 
+//! Any padding at the ends of the rows is cleared too.
+//!
+//! @param  execution   How to perform the operation
 template <class Pixel>
-void Bitmap<Pixel>::clip(Rect * srcRect, int srcW, int srcH, int * dstX, int * dstY, int dstW, int dstH)
+void Bitmap<Pixel>::clear(Execution execution /*= Execution::SEQUENTIAL*/)
+{
+    if (!data_)
+        return;
+
+    detach();
+
+    char * const d         = reinterpret_cast<char *>(data_);
+    size_t const pitch     = pitch_;
+    bool const   streaming = height_ * pitch > STREAMING_FILL_SIZE;
+
+    forEachBand(execution, height_, pitch, [=] (int begin, int end) {
+        uint8_t * const band = reinterpret_cast<uint8_t *>(d + begin * pitch);
+        PixelFiller<uint8_t>::fillRow(band, size_t(end - begin) * pitch, 0, streaming);
+    });
+}
+
+template <class Pixel>
+template <typename RowFunction>
+void Bitmap<Pixel>::forEachRow(ConstView const & src,
+                               Rect const &      srcRect,
+                               int               dstX,
+                               int               dstY,
+                               Execution         execution,
+                               RowFunction       f)
+{
+    Rect rect = srcRect;
+    clipCopy(&rect, src.width(), src.height(), &dstX, &dstY, width_, height_);
+
+    if (rect.width <= 0 || rect.height <= 0)
+        return;
+
+    detach();
+
+    char const * s        = reinterpret_cast<char const *>(src.data(rect.x, rect.y));
+    char *       d        = reinterpret_cast<char *>(data_) + dstY * pitch_ + dstX * PIXEL_SIZE;
+    size_t       srcPitch = src.pitch();
+    size_t       dstPitch = pitch_;
+    int          width    = rect.width;
+
+    forEachBand(execution, rect.height, width * PIXEL_SIZE, [=, &f] (int begin, int end) {
+        char const * sRow = s + begin * srcPitch;
+        char *       dRow = d + begin * dstPitch;
+        for (int i = begin; i < end; ++i)
+        {
+            f(reinterpret_cast<Pixel const *>(sRow), reinterpret_cast<Pixel *>(dRow), width);
+            sRow += srcPitch;
+            dRow += dstPitch;
+        }
+    });
+}
+
+//! The rect is moved and shrunk so that it lies within the source, and the destination is moved by the same amount.
+//! Then the destination and the rect are moved and shrunk together so that the copy lies within the destination. The
+//! width or height of the clipped rect is 0 or less if nothing is left to copy.
+//!
+//! @param  srcRect     Rect to copy from the source (updated)
+//! @param  srcW        Width of the source
+//! @param  srcH        Height of the source
+//! @param  dstX        Location of the copy in the destination (updated)
+//! @param  dstY        Location of the copy in the destination (updated)
+//! @param  dstW        Width of the destination
+//! @param  dstH        Height of the destination
+inline void clipCopy(Rect * srcRect, int srcW, int srcH, int * dstX, int * dstY, int dstW, int dstH)
 {
     assert(srcW >= 0);
     assert(srcH >= 0);
@@ -415,6 +914,29 @@ void Bitmap<Pixel>::clip(Rect * srcRect, int srcW, int srcH, int * dstX, int * d
     *dstY    = dy;
 }
 
+//! The returned pitch is a multiple of both the alignment and the size of a pixel. Since the image data is always
+//! aligned to ROW_ALIGNMENT, constructing a bitmap with this pitch guarantees that every row starts on an aligned
+//! address (as long as the alignment divides ROW_ALIGNMENT or is a multiple of it) and that rows do not share cache
+//! lines.
+//!
+//! @param  width       Width of the bitmap (in pixels)
+//! @param  alignment   Required row alignment (in bytes). Must be a power of 2.
+//!
+//! @return     pitch (in bytes)
+template <class Pixel>
+size_t Bitmap<Pixel>::alignedPitch(int width, size_t alignment /*= ROW_ALIGNMENT*/)
+{
+    assert(width >= 0);
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    size_t step = alignment;
+    while (step % PIXEL_SIZE != 0)
+    {
+        step += alignment;
+    }
+    return (width * PIXEL_SIZE + step - 1) / step * step;
+}
+
 template <class Pixel>
 Pixel const * Bitmap<Pixel>::addressOf(int x, int y) const
 {
@@ -430,9 +952,63 @@ Pixel const * Bitmap<Pixel>::addressOf(int x, int y) const
 template <class Pixel>
 Pixel * Bitmap<Pixel>::createCopy(Pixel const * data, size_t pitch, int height)
 {
-    Pixel * copy = reinterpret_cast<Pixel *>(new char[pitch * height]);
+    Pixel * copy = allocate(pitch * height);
     memcpy(copy, data, pitch * height);
     return copy;
 }
 
+template <class Pixel>
+void Bitmap<Pixel>::assign(Bitmap const & rhs)
+{
+    copyOnWrite_ = rhs.copyOnWrite_;
+    if (!rhs.data_ || pitch_ == 0 || height_ == 0)
+    {
+        data_ = nullptr;
+    }
+    else if (copyOnWrite_)
+    {
+        bufferOf(rhs.data_)->references.fetch_add(1, std::memory_order_relaxed);
+        data_ = rhs.data_;
+    }
+    else
+    {
+        data_ = createCopy(rhs.data_, pitch_, height_);
+    }
+}
+
+template <class Pixel>
+void Bitmap<Pixel>::reserve(size_t size)
+{
+    if (data_ && !shared() && capacity() >= size)
+        return;
+
+    release();
+    data_ = allocate(size);
+}
+
+template <class Pixel>
+Pixel * Bitmap<Pixel>::allocate(size_t size)
+{
+    void *   p      = resource_->allocate(BUFFER_HEADER_SIZE + size, ROW_ALIGNMENT);
+    Buffer * buffer = new (p) Buffer{ { 1 }, size, resource_ };
+    return reinterpret_cast<Pixel *>(reinterpret_cast<char *>(buffer) + BUFFER_HEADER_SIZE);
+}
+
+template <class Pixel>
+void Bitmap<Pixel>::release()
+{
+    if (data_)
+    {
+        Buffer * buffer = bufferOf(data_);
+        if (buffer->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            std::pmr::memory_resource * resource = buffer->resource;
+            size_t size = buffer->size;
+            buffer->~Buffer();
+            resource->deallocate(buffer, BUFFER_HEADER_SIZE + size, ROW_ALIGNMENT);
+        }
+        data_ = nullptr;
+    }
+}
+
 #endif // !defined(BITMAP_BITMAP_H)
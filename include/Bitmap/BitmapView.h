@@ -0,0 +1,130 @@
+#if !defined(BITMAP_BITMAPVIEW_H)
+#define BITMAP_BITMAPVIEW_H
+
+#pragma once
+
+#include "Rect/Rect.h"
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+
+//! A non-owning view of an image.
+//!
+//! A view refers to pixels owned by a Bitmap or by an external buffer. It never allocates or copies, so it is cheap to
+//! create and to pass by value. A view of const pixels (BitmapView<Pixel const>) only permits reading.
+//!
+//! @note   The referenced pixels must outlive the view.
+template <typename Pixel>
+class BitmapView
+{
+public:
+
+    //! Pixel type (without qualifiers).
+    using PixelType = std::remove_const_t<Pixel>;
+
+    //! Size of a pixel in bytes
+    static size_t constexpr PIXEL_SIZE = sizeof(Pixel);
+
+    //! Constructor.
+    BitmapView() = default;
+
+    //! Constructor.
+    BitmapView(int width, int height, size_t pitch, Pixel * data);
+
+    //! Conversion from a view of mutable pixels to a view of const pixels.
+    template <typename Other, typename = std::enable_if_t<std::is_same<Other const, Pixel>::value && !std::is_const<Other>::value>>
+    BitmapView(BitmapView<Other> const & rhs)
+        : BitmapView(rhs.width(), rhs.height(), rhs.pitch(), rhs.data())
+    {
+    }
+
+    //! Returns the pixel at (x, y)
+    PixelType pixel(int x, int y) const { return data_ ? *addressOf(x, y) : PixelType(); }
+
+    //! Returns the width of the view (in pixels).
+    int width() const { return width_; }
+
+    //! Returns the height of the view (in pixels).
+    int height() const { return height_; }
+
+    //! Returns the pitch of the view (in bytes).
+    size_t pitch() const { return pitch_; }
+
+    //! Returns true if the view refers to no pixels.
+    bool empty() const { return data_ == nullptr; }
+
+    //! Returns a pointer to the pixel at (x, y).
+    Pixel * data(int x = 0, int y = 0) const { return addressOf(x, y); }
+
+    //! Returns a pointer to the first pixel in row y.
+    Pixel * row(int y) const { return addressOf(0, y); }
+
+    //! Returns a view of a region of this view.
+    BitmapView subview(int x, int y, int width, int height) const;
+
+private:
+
+    // Returns a pointer to the pixel at (x, y)
+    Pixel * addressOf(int x, int y) const;
+
+    int width_    = 0;          // Width (in pixels)
+    int height_   = 0;          // Height (in pixels)
+    size_t pitch_ = 0;          // Pitch (in bytes)
+    Pixel * data_ = nullptr;    // Referenced image data
+};
+
+//! @param  width       Width
+//! @param  height      Height
+//! @param  pitch       Pitch of the referenced image data, or 0 if it is determined by the width
+//! @param  data        Referenced image data
+template <typename Pixel>
+BitmapView<Pixel>::BitmapView(int width, int height, size_t pitch, Pixel * data)
+    : width_(width)
+    , height_(height)
+    , pitch_((pitch > 0) ? pitch : width * PIXEL_SIZE)
+    , data_(data)
+{
+    assert(width >= 0);
+    assert(height >= 0);
+    assert(pitch == 0 || pitch >= width * PIXEL_SIZE);
+    if (!data_ || width_ == 0 || height_ == 0)
+    {
+        width_  = 0;
+        height_ = 0;
+        pitch_  = 0;
+        data_   = nullptr;
+    }
+}
+
+//! The region is clipped to the bounds of this view. The resulting view has the same pitch as this view.
+//!
+//! @param  x           Left of the region
+//! @param  y           Top of the region
+//! @param  width       Width of the region
+//! @param  height      Height of the region
+//!
+//! @return     view of the region
+template <typename Pixel>
+BitmapView<Pixel> BitmapView<Pixel>::subview(int x, int y, int width, int height) const
+{
+    Rect rect{ 0, 0, width_, height_ };
+    rect.clip(Rect{ x, y, width, height });
+    if (rect.width <= 0 || rect.height <= 0)
+        return BitmapView();
+    return BitmapView(rect.width, rect.height, pitch_, addressOf(rect.x, rect.y));
+}
+
+template <typename Pixel>
+Pixel * BitmapView<Pixel>::addressOf(int x, int y) const
+{
+    assert(!data_ || (x >= 0 && x < width_));
+    assert(!data_ || (y >= 0 && y < height_));
+
+    if (!data_)
+        return nullptr;
+
+    using Byte = std::conditional_t<std::is_const<Pixel>::value, char const, char>;
+    return reinterpret_cast<Pixel *>(reinterpret_cast<Byte *>(data_) + y * pitch_) + x;
+}
+
+#endif // !defined(BITMAP_BITMAPVIEW_H)
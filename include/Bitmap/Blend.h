@@ -0,0 +1,180 @@
+#if !defined(BITMAP_BLEND_H)
+#define BITMAP_BLEND_H
+
+#pragma once
+
+#include "Bitmap/Pixel.h"
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//! Porter-Duff compositing operations.
+//!
+//! The color channels are assumed to be premultiplied by alpha. In the descriptions, s and d are the source and
+//! destination channels, and sa and da are the source and destination alphas, all in the range [0, 1]. Each formula
+//! applies to every channel, including alpha.
+enum class BlendMode
+{
+    SRC_OVER,   //!< d = s + d * (1 - sa)
+    SRC_IN,     //!< d = s * da
+    DST_OVER,   //!< d = d + s * (1 - da)
+    ADD,        //!< d = min(s + d, 1)
+    MULTIPLY    //!< d = s * d + s * (1 - da) + d * (1 - sa)
+};
+
+//! Blends rows of pixels.
+//!
+//! Only 32-bit formats with alpha are supported. The arithmetic is done with 8-bit integer channels and every product
+//! is rounded to nearest. The rows are vectorized with SSE2 and the results do not depend on whether SSE2 is available.
+template <typename Pixel>
+class PixelBlender
+{
+public:
+
+    static_assert(sizeof(Pixel) == 4 && Pixel::BYTE_CHANNELS && Pixel::HAS_ALPHA,
+                  "Only 32-bit pixels with alpha can be blended");
+
+    //! Blends a row of source pixels into a row of destination pixels.
+    static void blendRow(BlendMode mode, Pixel const * src, Pixel * dst, int count);
+
+private:
+
+    template <BlendMode MODE>
+    static void blendRow(uint8_t const * src, uint8_t * dst, int count);
+
+    // Returns the blended value of a single channel
+    template <BlendMode MODE>
+    static unsigned blendChannel(unsigned s, unsigned d, unsigned sa, unsigned da);
+
+    // Returns a * b / 255, rounded to nearest
+    static unsigned multiply(unsigned a, unsigned b)
+    {
+        unsigned t = a * b + 128;
+        return (t + (t >> 8)) >> 8;
+    }
+
+#if defined(__SSE2__)
+    // Blends two pixels with 16-bit channels
+    template <BlendMode MODE>
+    static __m128i blend2(__m128i s, __m128i d);
+
+    // Returns a * b / 255, rounded to nearest, for 16-bit channels
+    static __m128i multiply(__m128i a, __m128i b)
+    {
+        __m128i t = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    }
+
+    // Returns 255 - a for 16-bit channels
+    static __m128i invert(__m128i a) { return _mm_sub_epi16(_mm_set1_epi16(255), a); }
+
+    // Returns the alpha of two pixels with 16-bit channels, replicated in every channel
+    static __m128i alphaOf(__m128i p)
+    {
+        int constexpr A = Pixel::ALPHA_BYTE;
+        return _mm_shufflehi_epi16(_mm_shufflelo_epi16(p, _MM_SHUFFLE(A, A, A, A)), _MM_SHUFFLE(A, A, A, A));
+    }
+#endif
+};
+
+//! @param  mode    Compositing operation
+//! @param  src     Source pixels
+//! @param  dst     Destination pixels
+//! @param  count   Number of pixels
+template <typename Pixel>
+void PixelBlender<Pixel>::blendRow(BlendMode mode, Pixel const * src, Pixel * dst, int count)
+{
+    uint8_t const * s = reinterpret_cast<uint8_t const *>(src);
+    uint8_t *       d = reinterpret_cast<uint8_t *>(dst);
+    switch (mode)
+    {
+        case BlendMode::SRC_OVER: blendRow<BlendMode::SRC_OVER>(s, d, count); break;
+        case BlendMode::SRC_IN:   blendRow<BlendMode::SRC_IN>(s, d, count);   break;
+        case BlendMode::DST_OVER: blendRow<BlendMode::DST_OVER>(s, d, count); break;
+        case BlendMode::ADD:      blendRow<BlendMode::ADD>(s, d, count);      break;
+        case BlendMode::MULTIPLY: blendRow<BlendMode::MULTIPLY>(s, d, count); break;
+    }
+}
+
+template <typename Pixel>
+template <BlendMode MODE>
+void PixelBlender<Pixel>::blendRow(uint8_t const * src, uint8_t * dst, int count)
+{
+    int i = 0;
+
+#if defined(__SSE2__)
+    __m128i const zero = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i * 4));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<__m128i const *>(dst + i * 4));
+        __m128i r;
+        if constexpr (MODE == BlendMode::ADD)
+        {
+            r = _mm_adds_epu8(s, d);
+        }
+        else
+        {
+            __m128i lo = blend2<MODE>(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+            __m128i hi = blend2<MODE>(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+            r = _mm_packus_epi16(lo, hi);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), r);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        uint8_t const * s  = src + i * 4;
+        uint8_t *       d  = dst + i * 4;
+        unsigned        sa = s[Pixel::ALPHA_BYTE];
+        unsigned        da = d[Pixel::ALPHA_BYTE];
+        for (int c = 0; c < 4; ++c)
+        {
+            d[c] = uint8_t(blendChannel<MODE>(s[c], d[c], sa, da));
+        }
+    }
+}
+
+template <typename Pixel>
+template <BlendMode MODE>
+unsigned PixelBlender<Pixel>::blendChannel(unsigned s, unsigned d, unsigned sa, unsigned da)
+{
+    unsigned r = 0;
+    if constexpr (MODE == BlendMode::SRC_OVER)
+        r = s + multiply(d, 255 - sa);
+    else if constexpr (MODE == BlendMode::SRC_IN)
+        r = multiply(s, da);
+    else if constexpr (MODE == BlendMode::DST_OVER)
+        r = d + multiply(s, 255 - da);
+    else if constexpr (MODE == BlendMode::ADD)
+        r = s + d;
+    else if constexpr (MODE == BlendMode::MULTIPLY)
+        r = multiply(s, d) + multiply(s, 255 - da) + multiply(d, 255 - sa);
+    return std::min(r, 255u);
+}
+
+#if defined(__SSE2__)
+template <typename Pixel>
+template <BlendMode MODE>
+__m128i PixelBlender<Pixel>::blend2(__m128i s, __m128i d)
+{
+    // The results may exceed 255, but they are saturated when packed back to 8 bits
+    if constexpr (MODE == BlendMode::SRC_OVER)
+        return _mm_add_epi16(s, multiply(d, invert(alphaOf(s))));
+    else if constexpr (MODE == BlendMode::SRC_IN)
+        return multiply(s, alphaOf(d));
+    else if constexpr (MODE == BlendMode::DST_OVER)
+        return _mm_add_epi16(d, multiply(s, invert(alphaOf(d))));
+    else if constexpr (MODE == BlendMode::ADD)
+        return _mm_add_epi16(s, d);
+    else
+        return _mm_add_epi16(_mm_add_epi16(multiply(s, d), multiply(s, invert(alphaOf(d)))),
+                             multiply(d, invert(alphaOf(s))));
+}
+#endif // defined(__SSE2__)
+
+#endif // !defined(BITMAP_BLEND_H)
@@ -0,0 +1,549 @@
+#if !defined(BITMAP_CODEC_H)
+#define BITMAP_CODEC_H
+
+#pragma once
+
+#include "Bitmap/Bitmap.h"
+#include "Bitmap/BitmapView.h"
+#include "Bitmap/Convert.h"
+#include "Bitmap/Palette.h"
+#include "Bitmap/PalettizedBitmap.h"
+#include "Bitmap/Parallel.h"
+#include "Bitmap/Pixel.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+//! Image file formats read and written by the codecs.
+enum class ImageFormat
+{
+    UNKNOWN,    //!< Not a supported format
+    BMP,        //!< Windows bitmap (uncompressed 8-bit palettized, 24-bit, and 32-bit with or without alpha)
+    TGA,        //!< Truevision TGA (8-bit palettized and grayscale, 24-bit and 32-bit, uncompressed or RLE)
+    PNM         //!< Netpbm PGM (P5) and PPM (P6), with a maximum value of 255
+};
+
+//! Description of an image file, as stored.
+struct ImageInfo
+{
+    ImageFormat format        = ImageFormat::UNKNOWN;   //!< File format
+    int         width         = 0;                      //!< Width (in pixels)
+    int         height        = 0;                      //!< Height (in pixels)
+    PixelFormat pixelFormat   = PixelFormat::UNKNOWN;   //!< Stored pixel format (PIXEL8, RGB, BGR or BGRA)
+    int         pixelSize     = 0;                      //!< Size of a stored pixel (in bytes)
+    PixelFormat paletteFormat = PixelFormat::UNKNOWN;   //!< Stored palette entry format, or UNKNOWN if none
+    int         paletteSize   = 0;                      //!< Number of palette entries
+    int         paletteStride = 0;                      //!< Distance between stored palette entries (in bytes)
+    size_t      paletteOffset = 0;                      //!< Offset of the palette in the file (in bytes)
+    size_t      dataOffset    = 0;                      //!< Offset of the pixels in the file (in bytes)
+    size_t      pitch         = 0;                      //!< Distance between stored rows, or 0 if compressed
+    bool        bottomUp      = false;                  //!< True if the rows are stored from the bottom up
+    bool        compressed    = false;                  //!< True if the rows are run-length encoded
+    bool        opaque        = false;                  //!< True if the stored alpha is unused and pixels are opaque
+
+    //! Returns true if the pixels are palette indexes.
+    bool palettized() const { return paletteFormat != PixelFormat::UNKNOWN; }
+};
+
+//! Reads and writes BMP, TGA and PNM images.
+//!
+//! Images are decoded from memory (for example, a MappedFile) directly into the rows of the destination, converting
+//! each row to the destination pixel format as it goes, so there is no intermediate image. Rows stored from the bottom
+//! up are simply written to the destination from the bottom up. Uncompressed rows are independent, and RLE-compressed
+//! TGA rows are located with a quick scan of the packets, so rows can be decoded in parallel.
+//!
+//! Images are encoded row by row to a file, so there is no intermediate image either.
+class ImageCodec
+{
+public:
+
+    //! Where a row of an RLE-compressed image starts.
+    struct RleRow
+    {
+        size_t offset;      //!< Offset of the packet containing the first pixel of the row
+        int    consumed;    //!< Number of pixels in the packet that belong to previous rows
+    };
+
+    //! Reads the description of an image file.
+    static bool readInfo(void const * data, size_t size, ImageInfo * info);
+
+    //! Locates the start of each row in an RLE-compressed image.
+    static bool scanRle(void const * data, size_t size, ImageInfo const & info, std::vector<RleRow> * rows);
+
+    //! Decodes a row of an RLE-compressed image, which must have been located with scanRle().
+    static void decodeRleRow(void const * data, ImageInfo const & info, RleRow const & row, uint8_t * dst);
+
+    //! Writes a row of stored pixels as RLE packets.
+    static bool writeRleRow(FILE * fp, uint8_t const * row, int count, int pixelSize);
+
+    //! Writes the headers and palette of a BMP file.
+    static bool writeBmpHeader(FILE * fp, int width, int height, int bitsPerPixel, uint8_t const * palette);
+
+    //! Writes the header and palette of a TGA file.
+    static bool writeTgaHeader(FILE *          fp,
+                               int             width,
+                               int             height,
+                               int             bitsPerPixel,
+                               bool            rle,
+                               bool            gray,
+                               uint8_t const * palette,
+                               int             paletteBitsPerEntry);
+
+    //! Writes the header of a PNM file.
+    static bool writePnmHeader(FILE * fp, int width, int height, bool gray);
+
+    //! Decodes an image into a view of the same size.
+    template <typename Pixel>
+    static bool decode(void const *              data,
+                       size_t                    size,
+                       ImageInfo const &         info,
+                       BitmapView<Pixel> const & dst,
+                       Execution                 execution);
+
+    //! Reads the palette of an image.
+    template <typename Color>
+    static void readPalette(void const * data, ImageInfo const & info, Palette<Color> * palette);
+
+    //! Writes the rows of an image, converted to a stored pixel format.
+    template <typename Stored, typename Pixel>
+    static bool writeRows(FILE * fp, BitmapView<Pixel> const & src, size_t pitch, bool rle);
+
+private:
+
+    // Converts a row of stored pixels to the destination format
+    template <typename Pixel, typename Stored>
+    static void storeRow(uint8_t const * src, Pixel * dst, int count, Palette<Pixel> const * palette);
+
+    // Converts a row of stored BGRA pixels to the destination format, ignoring their alpha
+    template <typename Pixel>
+    static void storeOpaqueRow(uint8_t const * src, Pixel * dst, int count, Palette<Pixel> const * palette);
+
+    // Expands a row of palette indexes
+    template <typename Pixel>
+    static void expandRow(uint8_t const * src, Pixel * dst, int count, Palette<Pixel> const * palette);
+};
+
+//! The stored pixels are converted to the destination format. Palettized images can be decoded into Bitmap<uint8_t>
+//! (the indexes) or into any color format (the palette is applied). Grayscale images can only be decoded into
+//! Bitmap<uint8_t>.
+//!
+//! @param  data        Image file
+//! @param  size        Size of the image file (in bytes)
+//! @param  info        Description of the image file, from readInfo()
+//! @param  dst         Destination. It must be the same size as the image.
+//! @param  execution   How to decode the rows
+//!
+//! @return     false if the image is corrupt or cannot be converted to the destination format
+template <typename Pixel>
+bool ImageCodec::decode(void const *              data,
+                        size_t                    size,
+                        ImageInfo const &         info,
+                        BitmapView<Pixel> const & dst,
+                        Execution                 execution)
+{
+    if (dst.width() != info.width || dst.height() != info.height)
+        return false;
+
+    // Choose the conversion from the stored format
+
+    using StoreRow = void (*)(uint8_t const *, Pixel *, int, Palette<Pixel> const *);
+    StoreRow       store = nullptr;
+    Palette<Pixel> palette;
+    if constexpr (std::is_class_v<Pixel>)
+    {
+        if (info.palettized())
+        {
+            readPalette(data, info, &palette);
+            store = expandRow<Pixel>;
+        }
+        else if (info.pixelFormat == PixelFormat::RGB)
+            store = storeRow<Pixel, PixelRGB>;
+        else if (info.pixelFormat == PixelFormat::BGR)
+            store = storeRow<Pixel, PixelBGR>;
+        else if (info.pixelFormat == PixelFormat::BGRA && info.opaque)
+            store = storeOpaqueRow<Pixel>;
+        else if (info.pixelFormat == PixelFormat::BGRA)
+            store = storeRow<Pixel, PixelBGRA>;
+    }
+    else
+    {
+        if (info.pixelFormat == PixelFormat::PIXEL8 && sizeof(Pixel) == 1)
+            store = storeRow<Pixel, Pixel>;
+    }
+    if (!store)
+        return false;
+
+    // Locate the rows
+
+    uint8_t const *     bytes = static_cast<uint8_t const *>(data);
+    std::vector<RleRow> rle;
+    if (info.compressed && !scanRle(data, size, info, &rle))
+        return false;
+
+    // Decode the rows. Compressed rows are first decoded to the stored format.
+
+    Palette<Pixel> const * lut = &palette;
+    forEachBand(execution, info.height, info.width * sizeof(Pixel), [&] (int begin, int end) {
+        std::vector<uint8_t> row(info.compressed ? size_t(info.width) * info.pixelSize : 0);
+        for (int r = begin; r < end; ++r)
+        {
+            uint8_t const * src;
+            if (info.compressed)
+            {
+                decodeRleRow(data, info, rle[r], row.data());
+                src = row.data();
+            }
+            else
+            {
+                src = bytes + info.dataOffset + r * info.pitch;
+            }
+            int y = info.bottomUp ? info.height - 1 - r : r;
+            store(src, dst.row(y), info.width, lut);
+        }
+    });
+    return true;
+}
+
+//! Entries that are not stored are set to 0. The unused fourth byte of BMP palette entries is treated as an opaque
+//! alpha value.
+//!
+//! @param  data        Image file
+//! @param  info        Description of the image file, from readInfo()
+//! @param  palette     Receives the palette
+template <typename Color>
+void ImageCodec::readPalette(void const * data, ImageInfo const & info, Palette<Color> * palette)
+{
+    uint8_t const * src = static_cast<uint8_t const *>(data) + info.paletteOffset;
+    memset(palette->entries(), 0, sizeof(Color) * Palette<Color>::PALETTE_SIZE);
+    for (int i = 0; i < info.paletteSize; ++i)
+    {
+        uint8_t entry[4] = { 0, 0, 0, 0xff };
+        memcpy(entry, src + i * info.paletteStride, (info.paletteFormat == PixelFormat::BGR) ? 3 : 4);
+        if (info.format == ImageFormat::BMP)
+            entry[3] = 0xff;
+
+        if constexpr (std::is_class_v<Color>)
+        {
+            if (info.paletteFormat == PixelFormat::BGR)
+                PixelConverter<Color, PixelBGR>::convertRow(reinterpret_cast<PixelBGR const *>(entry), &(*palette)[i], 1);
+            else
+                PixelConverter<Color, PixelBGRA>::convertRow(reinterpret_cast<PixelBGRA const *>(entry), &(*palette)[i], 1);
+        }
+    }
+}
+
+//! @param  fp      File
+//! @param  src     Image
+//! @param  pitch   Size of each stored row (in bytes), including any padding
+//! @param  rle     If true, the rows are written as RLE packets and pitch is ignored
+//!
+//! @return     true if the rows were written
+template <typename Stored, typename Pixel>
+bool ImageCodec::writeRows(FILE * fp, BitmapView<Pixel> const & src, size_t pitch, bool rle)
+{
+    using SrcPixel = std::remove_const_t<Pixel>;
+
+    std::vector<uint8_t> row(std::max(pitch, src.width() * sizeof(Stored)), 0);
+    Stored *             stored = reinterpret_cast<Stored *>(row.data());
+    for (int y = 0; y < src.height(); ++y)
+    {
+        if constexpr (std::is_same_v<Stored, SrcPixel>)
+            memcpy(stored, src.row(y), src.width() * sizeof(Stored));
+        else
+            PixelConverter<Stored, SrcPixel>::convertRow(src.row(y), stored, src.width());
+
+        bool ok;
+        if (rle)
+            ok = writeRleRow(fp, row.data(), src.width(), int(sizeof(Stored)));
+        else
+            ok = fwrite(row.data(), 1, pitch, fp) == pitch;
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+template <typename Pixel, typename Stored>
+void ImageCodec::storeRow(uint8_t const * src, Pixel * dst, int count, Palette<Pixel> const *)
+{
+    if constexpr (std::is_same_v<Pixel, Stored>)
+        memcpy(dst, src, count * sizeof(Pixel));
+    else
+        PixelConverter<Pixel, Stored>::convertRow(reinterpret_cast<Stored const *>(src), dst, count);
+}
+
+template <typename Pixel>
+void ImageCodec::storeOpaqueRow(uint8_t const * src, Pixel * dst, int count, Palette<Pixel> const *)
+{
+    // The pixels are made opaque in small blocks, which are then converted
+
+    int constexpr BLOCK = 64;
+    PixelBGRA     block[BLOCK];
+    for (int i = 0; i < count; i += BLOCK)
+    {
+        int n = std::min(count - i, BLOCK);
+        memcpy(block, src + i * sizeof(PixelBGRA), n * sizeof(PixelBGRA));
+        for (int j = 0; j < n; ++j)
+        {
+            reinterpret_cast<uint8_t *>(&block[j])[3] = 0xff;
+        }
+        PixelConverter<Pixel, PixelBGRA>::convertRow(block, dst + i, n);
+    }
+}
+
+template <typename Pixel>
+void ImageCodec::expandRow(uint8_t const * src, Pixel * dst, int count, Palette<Pixel> const * palette)
+{
+    palette->expand(count, 1, src, count, dst, count * sizeof(Pixel));
+}
+
+//! Reads the description of an image file.
+//!
+//! @param  data    Image file
+//! @param  size    Size of the image file (in bytes)
+//! @param  info    Receives the description
+//!
+//! @return     false if the file is not a supported image
+inline bool readImageInfo(void const * data, size_t size, ImageInfo * info)
+{
+    return ImageCodec::readInfo(data, size, info);
+}
+
+//! Decodes an image into a view of the same size.
+//!
+//! See ImageCodec::decode() for the supported conversions.
+//!
+//! @param  data        Image file
+//! @param  size        Size of the image file (in bytes)
+//! @param  dst         Destination. It must be the same size as the image.
+//! @param  execution   How to decode the rows
+//!
+//! @return     false if the file is not a supported image, it is corrupt, or it does not match the destination
+template <typename Pixel>
+bool decodeImage(void const *              data,
+                 size_t                    size,
+                 BitmapView<Pixel> const & dst,
+                 Execution                 execution = Execution::SEQUENTIAL)
+{
+    ImageInfo info;
+    return ImageCodec::readInfo(data, size, &info) && ImageCodec::decode(data, size, info, dst, execution);
+}
+
+//! Decodes an image into a bitmap.
+//!
+//! If the bitmap is already the size of the image, the image is decoded into its current image data. Otherwise, the
+//! bitmap is replaced with one of the right size.
+//!
+//! @param  data        Image file
+//! @param  size        Size of the image file (in bytes)
+//! @param  dst         Destination
+//! @param  execution   How to decode the rows
+//!
+//! @return     false if the file is not a supported image, it is corrupt, or it cannot be converted to the pixel type
+template <typename Pixel>
+bool decodeImage(void const * data, size_t size, Bitmap<Pixel> * dst, Execution execution = Execution::SEQUENTIAL)
+{
+    ImageInfo info;
+    if (!ImageCodec::readInfo(data, size, &info))
+        return false;
+    if (dst->width() != info.width || dst->height() != info.height)
+        *dst = Bitmap<Pixel>(info.width, info.height, 0, nullptr, dst->resource());
+    return ImageCodec::decode(data, size, info, dst->view(), execution);
+}
+
+//! Decodes a palettized image into a palettized bitmap.
+//!
+//! If the bitmap is already the size of the image, the image is decoded into its current image data. Otherwise, the
+//! bitmap is replaced with one of the right size.
+//!
+//! @param  data        Image file
+//! @param  size        Size of the image file (in bytes)
+//! @param  dst         Destination
+//! @param  execution   How to decode the rows
+//!
+//! @return     false if the file is not a supported image, it is corrupt, or it is not palettized
+template <typename Color>
+bool decodeImage(void const *              data,
+                 size_t                    size,
+                 PalettizedBitmap<Color> * dst,
+                 Execution                 execution = Execution::SEQUENTIAL)
+{
+    ImageInfo info;
+    if (!ImageCodec::readInfo(data, size, &info) || !info.palettized())
+        return false;
+    if (dst->width() != info.width || dst->height() != info.height)
+        *dst = PalettizedBitmap<Color>(info.width, info.height, dst->resource());
+    if (!ImageCodec::decode(data, size, info, dst->view(), execution))
+        return false;
+
+    Palette<Color> palette;
+    ImageCodec::readPalette(data, info, &palette);
+    dst->setPalette(palette);
+    return true;
+}
+
+//! Writes an image as a BMP file.
+//!
+//! 8-bit images are written with a grayscale palette, images with alpha as 32-bit and others as 24-bit. 32-bit images
+//! have a BITMAPV4HEADER with an alpha mask, since the fourth byte of other 32-bit BMP pixels is unused. The rows are
+//! written from the top down.
+//!
+//! @param  fp      File
+//! @param  src     Image
+//!
+//! @return     true if the image was written
+template <typename Pixel>
+bool saveBmp(FILE * fp, BitmapView<Pixel> const & src)
+{
+    using SrcPixel = std::remove_const_t<Pixel>;
+
+    if constexpr (!std::is_class_v<SrcPixel>)
+    {
+        static_assert(sizeof(SrcPixel) == 1, "Only 8-bit values can be written without a pixel format");
+        uint8_t palette[256 * 4];
+        for (int i = 0; i < 256; ++i)
+        {
+            memset(palette + i * 4, i, 3);
+            palette[i * 4 + 3] = 0;
+        }
+        return ImageCodec::writeBmpHeader(fp, src.width(), src.height(), 8, palette) &&
+               ImageCodec::writeRows<uint8_t>(fp, src, (src.width() + 3) & ~3, false);
+    }
+    else if constexpr (SrcPixel::HAS_ALPHA)
+    {
+        return ImageCodec::writeBmpHeader(fp, src.width(), src.height(), 32, nullptr) &&
+               ImageCodec::writeRows<PixelBGRA>(fp, src, src.width() * 4, false);
+    }
+    else
+    {
+        return ImageCodec::writeBmpHeader(fp, src.width(), src.height(), 24, nullptr) &&
+               ImageCodec::writeRows<PixelBGR>(fp, src, (src.width() * 3 + 3) & ~3, false);
+    }
+}
+
+//! Writes a palettized image as an 8-bit BMP file.
+//!
+//! @param  fp      File
+//! @param  src     Image
+//!
+//! @return     true if the image was written
+template <typename Color>
+bool saveBmp(FILE * fp, PalettizedBitmap<Color> const & src)
+{
+    Palette<Color> const palette = src.palette();
+    PixelBGRA            entries[256];
+    PixelConverter<PixelBGRA, Color>::convertRow(palette.entries(), entries, 256);
+    uint8_t * bytes = reinterpret_cast<uint8_t *>(entries);
+    for (int i = 0; i < 256; ++i)
+    {
+        bytes[i * 4 + 3] = 0;
+    }
+    return ImageCodec::writeBmpHeader(fp, src.width(), src.height(), 8, bytes) &&
+           ImageCodec::writeRows<uint8_t>(fp, src.view(), (src.width() + 3) & ~3, false);
+}
+
+//! Writes an image as a TGA file.
+//!
+//! 8-bit images are written as grayscale, images with alpha as 32-bit and others as 24-bit. The rows are written from
+//! the top down.
+//!
+//! @param  fp      File
+//! @param  src     Image
+//! @param  rle     If true, the rows are RLE-compressed
+//!
+//! @return     true if the image was written
+template <typename Pixel>
+bool saveTga(FILE * fp, BitmapView<Pixel> const & src, bool rle = false)
+{
+    using SrcPixel = std::remove_const_t<Pixel>;
+
+    if constexpr (!std::is_class_v<SrcPixel>)
+    {
+        static_assert(sizeof(SrcPixel) == 1, "Only 8-bit values can be written without a pixel format");
+        return ImageCodec::writeTgaHeader(fp, src.width(), src.height(), 8, rle, true, nullptr, 0) &&
+               ImageCodec::writeRows<uint8_t>(fp, src, src.width(), rle);
+    }
+    else if constexpr (SrcPixel::HAS_ALPHA)
+    {
+        return ImageCodec::writeTgaHeader(fp, src.width(), src.height(), 32, rle, false, nullptr, 0) &&
+               ImageCodec::writeRows<PixelBGRA>(fp, src, src.width() * 4, rle);
+    }
+    else
+    {
+        return ImageCodec::writeTgaHeader(fp, src.width(), src.height(), 24, rle, false, nullptr, 0) &&
+               ImageCodec::writeRows<PixelBGR>(fp, src, src.width() * 3, rle);
+    }
+}
+
+//! Writes a palettized image as an 8-bit color-mapped TGA file.
+//!
+//! The palette is written as 32-bit entries if the color format has alpha, and as 24-bit entries otherwise.
+//!
+//! @param  fp      File
+//! @param  src     Image
+//! @param  rle     If true, the rows are RLE-compressed
+//!
+//! @return     true if the image was written
+template <typename Color>
+bool saveTga(FILE * fp, PalettizedBitmap<Color> const & src, bool rle = false)
+{
+    Palette<Color> const palette = src.palette();
+    bool                 ok;
+    if constexpr (Color::HAS_ALPHA)
+    {
+        PixelBGRA entries[256];
+        PixelConverter<PixelBGRA, Color>::convertRow(palette.entries(), entries, 256);
+        ok = ImageCodec::writeTgaHeader(fp,
+                                        src.width(),
+                                        src.height(),
+                                        8,
+                                        rle,
+                                        false,
+                                        reinterpret_cast<uint8_t const *>(entries),
+                                        32);
+    }
+    else
+    {
+        PixelBGR entries[256];
+        PixelConverter<PixelBGR, Color>::convertRow(palette.entries(), entries, 256);
+        ok = ImageCodec::writeTgaHeader(fp,
+                                        src.width(),
+                                        src.height(),
+                                        8,
+                                        rle,
+                                        false,
+                                        reinterpret_cast<uint8_t const *>(entries),
+                                        24);
+    }
+    return ok && ImageCodec::writeRows<uint8_t>(fp, src.view(), src.width(), rle);
+}
+
+//! Writes an image as a PGM (8-bit images) or PPM (all others) file.
+//!
+//! @param  fp      File
+//! @param  src     Image
+//!
+//! @return     true if the image was written
+template <typename Pixel>
+bool savePnm(FILE * fp, BitmapView<Pixel> const & src)
+{
+    using SrcPixel = std::remove_const_t<Pixel>;
+
+    if constexpr (!std::is_class_v<SrcPixel>)
+    {
+        static_assert(sizeof(SrcPixel) == 1, "Only 8-bit values can be written without a pixel format");
+        return ImageCodec::writePnmHeader(fp, src.width(), src.height(), true) &&
+               ImageCodec::writeRows<uint8_t>(fp, src, src.width(), false);
+    }
+    else
+    {
+        return ImageCodec::writePnmHeader(fp, src.width(), src.height(), false) &&
+               ImageCodec::writeRows<PixelRGB>(fp, src, src.width() * 3, false);
+    }
+}
+
+#endif // !defined(BITMAP_CODEC_H)
@@ -0,0 +1,206 @@
+#if !defined(BITMAP_COLORKEY_H)
+#define BITMAP_COLORKEY_H
+
+#pragma once
+
+#include "Bitmap/Simd.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//! Copies rows of pixels, skipping the pixels that match a color key.
+//!
+//! Pixels are compared bit for bit, so the key works for any pixel type, including palette indexes. Rows of 8, 16 and
+//! 32-bit pixels are compared with SSE2 (or AVX2), 16 or 32 bytes at a time, and rows of 24-bit pixels with SSSE3, 5
+//! pixels at a time, if the processor supports them. Blocks consisting entirely of keyed pixels are skipped, blocks
+//! without any keyed pixels are stored directly, and only mixed blocks are merged with the destination.
+template <typename Pixel>
+class ColorKeyCopier
+{
+public:
+
+    //! Copies a row of pixels, except those matching the key.
+    static void copyRow(Pixel const * src, Pixel * dst, int count, Pixel const & key);
+
+private:
+
+    static size_t constexpr PIXEL_SIZE = sizeof(Pixel);
+
+    // Returns true if the pixel matches the key
+    static bool keyed(Pixel const & p, Pixel const & key) { return memcmp(&p, &key, PIXEL_SIZE) == 0; }
+
+#if defined(__SSE2__)
+    // Returns a mask of the bytes of the pixels in v that match the key
+    static __m128i match(__m128i v, __m128i key);
+#endif
+
+#if defined(BITMAP_AVX2)
+    // Copies as many 8, 16 or 32-bit pixels as possible with AVX2 and returns the number copied
+    BITMAP_TARGET_AVX2 static int copyRowAvx2(Pixel const * src, Pixel * dst, int count, uint32_t key);
+
+    // Returns a mask of the bytes of the pixels in v that match the key
+    BITMAP_TARGET_AVX2 static __m256i match(__m256i v, __m256i key);
+#endif
+
+#if defined(BITMAP_SSSE3)
+    // Copies as many 24-bit pixels as possible with SSSE3 and returns the number copied
+    BITMAP_TARGET_SSSE3 static int copyRowSsse3(Pixel const * src, Pixel * dst, int count, Pixel const & key);
+#endif
+};
+
+//! @param  src     Source pixels
+//! @param  dst     Destination pixels
+//! @param  count   Number of pixels
+//! @param  key     Pixels in the source with this value are not copied
+template <typename Pixel>
+void ColorKeyCopier<Pixel>::copyRow(Pixel const * src, Pixel * dst, int count, Pixel const & key)
+{
+    int i = 0;
+
+    if constexpr (PIXEL_SIZE == 1 || PIXEL_SIZE == 2 || PIXEL_SIZE == 4)
+    {
+        uint32_t k = 0;
+        memcpy(&k, &key, PIXEL_SIZE);
+        for (size_t size = PIXEL_SIZE; size < sizeof(k); size *= 2)
+        {
+            k |= k << (size * 8);
+        }
+
+#if defined(BITMAP_AVX2)
+        if (simdLevel() == SimdLevel::AVX2)
+            i = copyRowAvx2(src, dst, count, k);
+#endif
+
+#if defined(__SSE2__)
+        int constexpr N4 = int(16 / PIXEL_SIZE);
+        char const *  s  = reinterpret_cast<char const *>(src);
+        char *        d  = reinterpret_cast<char *>(dst);
+        __m128i const k4 = _mm_set1_epi32(int(k));
+        for (; i + N4 <= count; i += N4)
+        {
+            __m128i v    = _mm_loadu_si128(reinterpret_cast<__m128i const *>(s + i * PIXEL_SIZE));
+            __m128i m    = match(v, k4);
+            int     bits = _mm_movemask_epi8(m);
+            if (bits == 0xffff)
+                continue;
+            if (bits != 0)
+            {
+                __m128i old = _mm_loadu_si128(reinterpret_cast<__m128i const *>(d + i * PIXEL_SIZE));
+                v = _mm_or_si128(_mm_andnot_si128(m, v), _mm_and_si128(m, old));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(d + i * PIXEL_SIZE), v);
+        }
+#endif
+    }
+#if defined(BITMAP_SSSE3)
+    else if constexpr (PIXEL_SIZE == 3)
+    {
+        if (simdLevel() >= SimdLevel::SSSE3)
+            i = copyRowSsse3(src, dst, count, key);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        if (!keyed(src[i], key))
+            dst[i] = src[i];
+    }
+}
+
+#if defined(__SSE2__)
+template <typename Pixel>
+__m128i ColorKeyCopier<Pixel>::match(__m128i v, __m128i key)
+{
+    if constexpr (PIXEL_SIZE == 1)
+        return _mm_cmpeq_epi8(v, key);
+    else if constexpr (PIXEL_SIZE == 2)
+        return _mm_cmpeq_epi16(v, key);
+    else
+        return _mm_cmpeq_epi32(v, key);
+}
+#endif
+
+#if defined(BITMAP_AVX2)
+template <typename Pixel>
+BITMAP_TARGET_AVX2 int ColorKeyCopier<Pixel>::copyRowAvx2(Pixel const * src, Pixel * dst, int count, uint32_t key)
+{
+    int constexpr N8 = int(32 / PIXEL_SIZE);
+
+    int           i  = 0;
+    char const *  s  = reinterpret_cast<char const *>(src);
+    char *        d  = reinterpret_cast<char *>(dst);
+    __m256i const k8 = _mm256_set1_epi32(int(key));
+    for (; i + N8 <= count; i += N8)
+    {
+        __m256i v    = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(s + i * PIXEL_SIZE));
+        __m256i m    = match(v, k8);
+        int     bits = _mm256_movemask_epi8(m);
+        if (bits == -1)
+            continue;
+        if (bits != 0)
+            v = _mm256_blendv_epi8(v, _mm256_loadu_si256(reinterpret_cast<__m256i const *>(d + i * PIXEL_SIZE)), m);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(d + i * PIXEL_SIZE), v);
+    }
+    return i;
+}
+
+template <typename Pixel>
+BITMAP_TARGET_AVX2 __m256i ColorKeyCopier<Pixel>::match(__m256i v, __m256i key)
+{
+    if constexpr (PIXEL_SIZE == 1)
+        return _mm256_cmpeq_epi8(v, key);
+    else if constexpr (PIXEL_SIZE == 2)
+        return _mm256_cmpeq_epi16(v, key);
+    else
+        return _mm256_cmpeq_epi32(v, key);
+}
+#endif
+
+#if defined(BITMAP_SSSE3)
+template <typename Pixel>
+BITMAP_TARGET_SSSE3 int ColorKeyCopier<Pixel>::copyRowSsse3(Pixel const * src,
+                                                             Pixel *       dst,
+                                                             int           count,
+                                                             Pixel const & key)
+{
+    // Each step loads 16 bytes and handles the 5 complete pixels in them. The 15 bytes are stored as two overlapping 8
+    // bytes, so that the next step never loads bytes that are still being stored. The loop stops early enough that
+    // the loads do not go past the end of the row.
+
+    int             i  = 0;
+    char const *    s  = reinterpret_cast<char const *>(src);
+    char *          d  = reinterpret_cast<char *>(dst);
+    uint8_t const * kb = reinterpret_cast<uint8_t const *>(&key);
+
+    __m128i const k      = _mm_setr_epi8(char(kb[0]), char(kb[1]), char(kb[2]), char(kb[0]), char(kb[1]), char(kb[2]),
+                                         char(kb[0]), char(kb[1]), char(kb[2]), char(kb[0]), char(kb[1]), char(kb[2]),
+                                         char(kb[0]), char(kb[1]), char(kb[2]), 0);
+    __m128i const spread = _mm_setr_epi8(0, 0, 0, 3, 3, 3, 6, 6, 6, 9, 9, 9, 12, 12, 12, -1);
+    for (; i + 6 <= count; i += 5)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(s + i * 3));
+        __m128i e = _mm_cmpeq_epi8(v, k);
+
+        // The first byte of each pixel is set if all three of its bytes match
+        __m128i all  = _mm_and_si128(e, _mm_and_si128(_mm_srli_si128(e, 1), _mm_srli_si128(e, 2)));
+        __m128i m    = _mm_shuffle_epi8(all, spread);
+        int     bits = _mm_movemask_epi8(m) & 0x7fff;
+        if (bits == 0x7fff)
+            continue;
+        if (bits != 0)
+        {
+            __m128i old = _mm_loadu_si128(reinterpret_cast<__m128i const *>(d + i * 3));
+            v = _mm_or_si128(_mm_andnot_si128(m, v), _mm_and_si128(m, old));
+        }
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(d + i * 3), v);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(d + i * 3 + 7), _mm_srli_si128(v, 7));
+    }
+    return i;
+}
+#endif
+
+#endif // !defined(BITMAP_COLORKEY_H)
@@ -0,0 +1,314 @@
+#if !defined(BITMAP_CONTAINER_H)
+#define BITMAP_CONTAINER_H
+
+#pragma once
+
+#include "Bitmap/Bitmap.h"
+#include "Bitmap/BitmapView.h"
+#include "Bitmap/Palette.h"
+#include "Bitmap/PalettizedBitmap.h"
+#include "Bitmap/Pixel.h"
+#include <cstddef>
+#include <cstdint>
+
+//! Header of a native bitmap container.
+//!
+//! A container holds an image exactly as it is laid out in memory, so that it can be used directly from a buffer or a
+//! mapped file without parsing or copying. It consists of:
+//!
+//! - this header, at offset 0,
+//! - the palette (if any), at paletteOffset,
+//! - Bitmap::BUFFER_HEADER_SIZE reserved bytes, immediately preceding the image data,
+//! - the rows of the image, starting at dataOffset. dataOffset and pitch are multiples of alignment.
+//!
+//! The reserved bytes allow a Bitmap to adopt the image data in place (see Bitmap::adopt()). Values are stored in the
+//! native byte order.
+struct ContainerHeader
+{
+    char     magic[4];          //!< Always "BTMP"
+    uint32_t version;           //!< Version of the format
+    uint32_t format;            //!< Pixel format (a PixelFormat value)
+    uint32_t pixelSize;         //!< Size of a pixel (in bytes)
+    int32_t  width;             //!< Width of the image (in pixels)
+    int32_t  height;            //!< Height of the image (in pixels)
+    uint64_t pitch;             //!< Distance between the starts of consecutive rows (in bytes)
+    uint64_t dataOffset;        //!< Offset of the first row from the start of the container (in bytes)
+    uint32_t alignment;         //!< Alignment of the rows relative to the start of the container (in bytes)
+    uint32_t paletteFormat;     //!< Pixel format of the palette entries (a PixelFormat value)
+    uint32_t paletteEntrySize;  //!< Size of a palette entry (in bytes)
+    uint32_t paletteSize;       //!< Number of palette entries, or 0 if there is no palette
+    uint64_t paletteOffset;     //!< Offset of the palette from the start of the container (in bytes)
+
+    static uint32_t constexpr VERSION = 1;  //!< Current version of the format
+
+    //! Returns a header describing the layout of a container for an image.
+    static ContainerHeader layout(PixelFormat format,
+                                  size_t      pixelSize,
+                                  int         width,
+                                  int         height,
+                                  size_t      pitch,
+                                  PixelFormat paletteFormat    = PixelFormat::UNKNOWN,
+                                  size_t      paletteEntrySize = 0,
+                                  size_t      paletteSize      = 0);
+
+    //! Reads and validates the header of a container.
+    static bool read(void const * buffer, size_t size, ContainerHeader * header);
+
+    //! Returns the total size of the container (in bytes).
+    size_t size() const { return size_t(dataOffset + pitch * uint64_t(height)); }
+
+    //! Returns true if the image data of the container can be adopted by a Bitmap.
+    bool adoptable(void const * buffer) const;
+
+    //! Writes a container to a buffer.
+    size_t write(void const * palette, void const * rows, size_t srcPitch, void * buffer, size_t size) const;
+
+    //! Writes a container to a file.
+    bool save(char const * path, void const * palette, void const * rows, size_t srcPitch) const;
+};
+
+//! Stores images in the native container format.
+//!
+//! Reading a container is nearly free. view() returns a view of the image in place, and alias() makes a Bitmap use the
+//! image data in place.
+template <typename Pixel>
+class BitmapContainer
+{
+public:
+
+    //! Read-only view of an image.
+    using ConstView = BitmapView<Pixel const>;
+
+    //! Returns the size of a container holding an image of the given size (in bytes).
+    static size_t size(int width, int height) { return layout(width, height).size(); }
+
+    //! Writes an image to a buffer.
+    static size_t write(ConstView const & src, void * buffer, size_t size);
+
+    //! Writes an image to a file.
+    static bool save(char const * path, ConstView const & src);
+
+    //! Returns a view of the image in a container.
+    static ConstView view(void const * buffer, size_t size);
+
+    //! Makes a bitmap use the image data in a container, without copying it.
+    static bool alias(void * buffer, size_t size, Bitmap<Pixel> * dst);
+
+    //! Reads the header of a container and checks that it holds an image of this pixel type.
+    static bool read(void const * buffer, size_t size, ContainerHeader * header);
+
+private:
+
+    // Returns the header of a container holding an image of the given size
+    static ContainerHeader layout(int width, int height)
+    {
+        return ContainerHeader::layout(PixelFormatOf<Pixel>::VALUE,
+                                       sizeof(Pixel),
+                                       width,
+                                       height,
+                                       Bitmap<Pixel>::alignedPitch(width));
+    }
+};
+
+//! @param  src     Image to write
+//! @param  buffer  Buffer to receive the container
+//! @param  size    Size of the buffer (in bytes)
+//!
+//! @return     size of the container, or 0 if the buffer is too small
+template <typename Pixel>
+size_t BitmapContainer<Pixel>::write(ConstView const & src, void * buffer, size_t size)
+{
+    return layout(src.width(), src.height()).write(nullptr, src.data(), src.pitch(), buffer, size);
+}
+
+//! @param  path    Path of the file
+//! @param  src     Image to write
+//!
+//! @return     true if the image was written
+template <typename Pixel>
+bool BitmapContainer<Pixel>::save(char const * path, ConstView const & src)
+{
+    return layout(src.width(), src.height()).save(path, nullptr, src.data(), src.pitch());
+}
+
+//! @param  buffer  Container
+//! @param  size    Size of the container (in bytes)
+//!
+//! @return     view of the image, or an empty view if the container is not valid or has a different pixel type
+template <typename Pixel>
+typename BitmapContainer<Pixel>::ConstView BitmapContainer<Pixel>::view(void const * buffer, size_t size)
+{
+    ContainerHeader h;
+    if (!read(buffer, size, &h) || h.width == 0 || h.height == 0)
+        return ConstView();
+    Pixel const * data = reinterpret_cast<Pixel const *>(static_cast<char const *>(buffer) + h.dataOffset);
+    return ConstView(h.width, h.height, size_t(h.pitch), data);
+}
+
+//! The bitmap modifies the reserved bytes in the container, so the buffer must be writable, even if the image is not
+//! modified. For a mapped file, map it copy-on-write. The buffer must remain valid while the bitmap (or any copy sharing
+//! its image data) uses it. See Bitmap::adopt().
+//!
+//! @param  buffer  Container. The image data must be aligned to Bitmap::ROW_ALIGNMENT.
+//! @param  size    Size of the container (in bytes)
+//! @param  dst     Bitmap to use the image data
+//!
+//! @return     false if the container is not valid, has a different pixel type, or cannot be adopted
+template <typename Pixel>
+bool BitmapContainer<Pixel>::alias(void * buffer, size_t size, Bitmap<Pixel> * dst)
+{
+    ContainerHeader h;
+    if (!read(buffer, size, &h) || !h.adoptable(buffer))
+        return false;
+
+    Pixel * data = reinterpret_cast<Pixel *>(static_cast<char *>(buffer) + h.dataOffset);
+    if (h.width == 0 || h.height == 0)
+        *dst = Bitmap<Pixel>(dst->resource());
+    else
+        dst->adopt(h.width, h.height, size_t(h.pitch), data);
+    return true;
+}
+
+//! @param  buffer  Container
+//! @param  size    Size of the container (in bytes)
+//! @param  header  Receives the header
+//!
+//! @return     true if the header is valid and the container holds an image of this pixel type
+template <typename Pixel>
+bool BitmapContainer<Pixel>::read(void const * buffer, size_t size, ContainerHeader * header)
+{
+    return ContainerHeader::read(buffer, size, header) &&
+           header->format == uint32_t(PixelFormatOf<Pixel>::VALUE) &&
+           header->pixelSize == sizeof(Pixel) &&
+           (reinterpret_cast<uintptr_t>(buffer) + header->dataOffset) % alignof(Pixel) == 0;
+}
+
+//! Stores palettized images in the native container format.
+//!
+//! The palette is stored with the image, and is the only part of the container that is copied when it is read.
+template <typename Color>
+class PalettizedContainer
+{
+public:
+
+    //! Read-only view of the palette indexes of an image.
+    using ConstView = BitmapView<uint8_t const>;
+
+    //! Returns the size of a container holding an image of the given size (in bytes).
+    static size_t size(int width, int height) { return layout(width, height).size(); }
+
+    //! Writes an image to a buffer.
+    static size_t write(PalettizedBitmap<Color> const & src, void * buffer, size_t size);
+
+    //! Writes an image to a file.
+    static bool save(char const * path, PalettizedBitmap<Color> const & src);
+
+    //! Returns a view of the image in a container and its palette.
+    static ConstView view(void const * buffer, size_t size, Palette<Color> * palette);
+
+    //! Makes a bitmap use the image data in a container, without copying it.
+    static bool alias(void * buffer, size_t size, PalettizedBitmap<Color> * dst);
+
+private:
+
+    // Returns the header of a container holding an image of the given size
+    static ContainerHeader layout(int width, int height)
+    {
+        return ContainerHeader::layout(PixelFormat::PIXEL8,
+                                       sizeof(uint8_t),
+                                       width,
+                                       height,
+                                       Bitmap<uint8_t>::alignedPitch(width),
+                                       PixelFormatOf<Color>::VALUE,
+                                       sizeof(Color),
+                                       Palette<Color>::PALETTE_SIZE);
+    }
+
+    // Reads the header of a container, checks that it holds an image with this type of palette, and reads the palette
+    static bool read(void const * buffer, size_t size, ContainerHeader * header, Palette<Color> * palette);
+};
+
+//! @param  src     Image to write
+//! @param  buffer  Buffer to receive the container
+//! @param  size    Size of the buffer (in bytes)
+//!
+//! @return     size of the container, or 0 if the buffer is too small
+template <typename Color>
+size_t PalettizedContainer<Color>::write(PalettizedBitmap<Color> const & src, void * buffer, size_t size)
+{
+    Palette<Color> palette = src.palette();
+    return layout(src.width(), src.height()).write(palette.entries(), src.data(), src.pitch(), buffer, size);
+}
+
+//! @param  path    Path of the file
+//! @param  src     Image to write
+//!
+//! @return     true if the image was written
+template <typename Color>
+bool PalettizedContainer<Color>::save(char const * path, PalettizedBitmap<Color> const & src)
+{
+    Palette<Color> palette = src.palette();
+    return layout(src.width(), src.height()).save(path, palette.entries(), src.data(), src.pitch());
+}
+
+//! @param  buffer  Container
+//! @param  size    Size of the container (in bytes)
+//! @param  palette Receives the palette
+//!
+//! @return     view of the image, or an empty view if the container is not valid or has a different palette type
+template <typename Color>
+typename PalettizedContainer<Color>::ConstView PalettizedContainer<Color>::view(void const *     buffer,
+                                                                                size_t           size,
+                                                                                Palette<Color> * palette)
+{
+    ContainerHeader h;
+    if (!read(buffer, size, &h, palette) || h.width == 0 || h.height == 0)
+        return ConstView();
+    uint8_t const * data = static_cast<uint8_t const *>(buffer) + h.dataOffset;
+    return ConstView(h.width, h.height, size_t(h.pitch), data);
+}
+
+//! The palette is copied into the bitmap. The requirements are the same as for BitmapContainer::alias().
+//!
+//! @param  buffer  Container. The image data must be aligned to Bitmap::ROW_ALIGNMENT.
+//! @param  size    Size of the container (in bytes)
+//! @param  dst     Bitmap to use the image data
+//!
+//! @return     false if the container is not valid, has a different palette type, or cannot be adopted
+template <typename Color>
+bool PalettizedContainer<Color>::alias(void * buffer, size_t size, PalettizedBitmap<Color> * dst)
+{
+    ContainerHeader h;
+    Palette<Color>  palette;
+    if (!read(buffer, size, &h, &palette) || !h.adoptable(buffer))
+        return false;
+
+    if (h.width == 0 || h.height == 0)
+        *dst = PalettizedBitmap<Color>(dst->resource());
+    else
+        dst->adopt(h.width, h.height, size_t(h.pitch), static_cast<uint8_t *>(buffer) + h.dataOffset);
+    dst->setPalette(palette);
+    return true;
+}
+
+template <typename Color>
+bool PalettizedContainer<Color>::read(void const *      buffer,
+                                      size_t            size,
+                                      ContainerHeader * header,
+                                      Palette<Color> *  palette)
+{
+    if (!ContainerHeader::read(buffer, size, header) ||
+        header->format != uint32_t(PixelFormat::PIXEL8) ||
+        header->pixelSize != sizeof(uint8_t) ||
+        header->paletteFormat != uint32_t(PixelFormatOf<Color>::VALUE) ||
+        header->paletteEntrySize != sizeof(Color) ||
+        header->paletteSize != Palette<Color>::PALETTE_SIZE)
+    {
+        return false;
+    }
+
+    *palette = Palette<Color>(reinterpret_cast<Color const *>(static_cast<char const *>(buffer) + header->paletteOffset));
+    return true;
+}
+
+#endif // !defined(BITMAP_CONTAINER_H)
@@ -0,0 +1,405 @@
+#if !defined(BITMAP_CONVERT_H)
+#define BITMAP_CONVERT_H
+
+#pragma once
+
+#include "Bitmap/Bitmap.h"
+#include "Bitmap/BitmapView.h"
+#include "Bitmap/Pixel.h"
+#include "Bitmap/Simd.h"
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//! Converts rows of pixels from one format to another.
+//!
+//! Conversions between identical formats are plain copies. Conversions between the 24 and 32-bit formats are byte
+//! shuffles, vectorized with SSSE3 (and AVX2 for 32-bit to 32-bit) when the processor supports them. All other
+//! conversions unpack each pixel to 8-bit channels and pack it again using integer arithmetic. Conversions between 16
+//! and 32-bit formats (and between the 16-bit formats) do this 8 pixels at a time with SSE2 shifts and masks.
+//!
+//! Channels that are not present in the source are set to their maximum value. Channels are scaled with rounding to
+//! nearest, matching the results of the floating point accessors.
+template <typename DstPixel, typename SrcPixel>
+class PixelConverter
+{
+public:
+
+    //! Converts a row of pixels.
+    static void convertRow(SrcPixel const * src, DstPixel * dst, int count);
+
+private:
+
+    static size_t constexpr SRC_SIZE = sizeof(SrcPixel);
+    static size_t constexpr DST_SIZE = sizeof(DstPixel);
+
+#if defined(BITMAP_SSSE3)
+    // Converts as many pixels as possible from the i-th with SSSE3 byte shuffles and returns the number converted
+    BITMAP_TARGET_SSSE3 static int shuffleRowSsse3(SrcPixel const * src, DstPixel * dst, int count, int i = 0);
+
+    // Builds the shuffle converting 4 pixels, and the mask of the bytes that have no source (which are set to 0xff)
+    static void shuffleMasks(int8_t * shuffle, int8_t * fill);
+
+    // Returns the offset in the source pixel of the given byte in the destination pixel, or -1 if there is none
+    static int sourceByte(int dstByte);
+#endif
+
+#if defined(BITMAP_AVX2)
+    // Converts as many pixels as possible with AVX2 (and SSSE3) byte shuffles and returns the number converted
+    BITMAP_TARGET_AVX2 static int shuffleRowAvx2(SrcPixel const * src, DstPixel * dst, int count);
+#endif
+
+#if defined(__SSE2__)
+    // Converts as many pixels as possible 8 at a time and returns the number converted. Neither format is 24-bit.
+    static int channelRow(SrcPixel const * src, DstPixel * dst, int count);
+
+    // Loads 8 pixels as 8-bit channels in 16-bit lanes
+    template <typename Pixel>
+    static void load8(Pixel const * p, __m128i & r, __m128i & g, __m128i & b, __m128i & a);
+
+    // Stores 8 pixels from 8-bit channels in 16-bit lanes
+    template <typename Pixel>
+    static void store8(Pixel * p, __m128i r, __m128i g, __m128i b, __m128i a);
+
+    // Returns a field of 16-bit pixels scaled to 8 bits, rounding to nearest
+    template <unsigned MAX, int SHIFT>
+    static __m128i expand(__m128i v);
+
+    // Returns 8-bit channels scaled to MAX, rounding to nearest, and shifted into a field of 16-bit pixels
+    template <unsigned MAX, int SHIFT>
+    static __m128i reduce(__m128i c);
+
+    // Returns the byte of 32-bit pixels that holds each of the 4 channels
+    template <typename Pixel>
+    static __m128i byteOf(int byte, __m128i r, __m128i g, __m128i b, __m128i a);
+
+    // Returns the shift s for which t / max == (t * ceil(2^(16+s) / max)) >> (16 + s) for every t up to max * 255 +
+    // max / 2 with a 16-bit multiplier, or -1 if there is none
+    static constexpr int divisionShift(unsigned max);
+#endif
+};
+
+//! Converts a row of pixels.
+//!
+//! @param  src     Source pixels
+//! @param  dst     Destination pixels
+//! @param  count   Number of pixels
+template <typename DstPixel, typename SrcPixel>
+void PixelConverter<DstPixel, SrcPixel>::convertRow(SrcPixel const * src, DstPixel * dst, int count)
+{
+    // Identical formats are copied, which also allows formats that cannot be converted (such as palette indexes)
+    if constexpr (std::is_same<DstPixel, SrcPixel>::value)
+    {
+        memcpy(dst, src, count * DST_SIZE);
+    }
+    else
+    {
+        int i = 0;
+        if constexpr (SrcPixel::BYTE_CHANNELS && DstPixel::BYTE_CHANNELS)
+        {
+#if defined(BITMAP_AVX2)
+            if (simdLevel() == SimdLevel::AVX2)
+                i = shuffleRowAvx2(src, dst, count);
+#endif
+#if defined(BITMAP_SSSE3)
+            if (simdLevel() == SimdLevel::SSSE3)
+                i = shuffleRowSsse3(src, dst, count);
+#endif
+        }
+#if defined(__SSE2__)
+        else if constexpr (SRC_SIZE != 3 && DST_SIZE != 3)
+        {
+            i = channelRow(src, dst, count);
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            SrcPixel const & s = src[i];
+            dst[i].set8(s.red8(), s.green8(), s.blue8(), s.alpha8());
+        }
+    }
+}
+
+#if defined(BITMAP_SSSE3)
+template <typename DstPixel, typename SrcPixel>
+BITMAP_TARGET_SSSE3 int PixelConverter<DstPixel, SrcPixel>::shuffleRowSsse3(SrcPixel const * src,
+                                                                            DstPixel *       dst,
+                                                                            int              count,
+                                                                            int              i /*= 0*/)
+{
+    // Each step converts 4 pixels with a 16-byte load and a 16-byte store. Since 4 24-bit pixels are only 12 bytes, the
+    // loop stops early enough that neither the load nor the store goes past the end of the row.
+
+    alignas(16) int8_t shuffle[16];
+    alignas(16) int8_t fill[16];
+    shuffleMasks(shuffle, fill);
+
+    char const *  s        = reinterpret_cast<char const *>(src);
+    char *        d        = reinterpret_cast<char *>(dst);
+    int const     reserve  = int(std::max((16 + SRC_SIZE - 1) / SRC_SIZE, (16 + DST_SIZE - 1) / DST_SIZE));
+    __m128i const shuffle4 = _mm_load_si128(reinterpret_cast<__m128i const *>(shuffle));
+    __m128i const fill4    = _mm_load_si128(reinterpret_cast<__m128i const *>(fill));
+    for (; i + reserve <= count; i += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(s + i * SRC_SIZE));
+        v = _mm_or_si128(_mm_shuffle_epi8(v, shuffle4), fill4);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(d + i * DST_SIZE), v);
+    }
+    return i;
+}
+
+template <typename DstPixel, typename SrcPixel>
+void PixelConverter<DstPixel, SrcPixel>::shuffleMasks(int8_t * shuffle, int8_t * fill)
+{
+    for (int i = 0; i < 16; ++i)
+    {
+        int pixel = i / int(DST_SIZE);
+        int byte  = i % int(DST_SIZE);
+        int s     = sourceByte(byte);
+        bool used = pixel < 4;
+        shuffle[i] = (used && s >= 0) ? int8_t(pixel * SRC_SIZE + s) : int8_t(-1);
+        fill[i]    = (used && s < 0) ? int8_t(-1) : int8_t(0);
+    }
+}
+
+template <typename DstPixel, typename SrcPixel>
+int PixelConverter<DstPixel, SrcPixel>::sourceByte(int dstByte)
+{
+    if (dstByte == DstPixel::RED_BYTE)
+        return SrcPixel::RED_BYTE;
+    if (dstByte == DstPixel::GREEN_BYTE)
+        return SrcPixel::GREEN_BYTE;
+    if (dstByte == DstPixel::BLUE_BYTE)
+        return SrcPixel::BLUE_BYTE;
+    if (dstByte == DstPixel::ALPHA_BYTE)
+        return SrcPixel::ALPHA_BYTE;
+    return -1;
+}
+#endif // defined(BITMAP_SSSE3)
+
+#if defined(BITMAP_AVX2)
+template <typename DstPixel, typename SrcPixel>
+BITMAP_TARGET_AVX2 int PixelConverter<DstPixel, SrcPixel>::shuffleRowAvx2(SrcPixel const * src,
+                                                                          DstPixel *       dst,
+                                                                          int              count)
+{
+    // 32-bit pixels are converted 8 at a time, and the rest with SSSE3
+
+    int i = 0;
+    if (SRC_SIZE == 4 && DST_SIZE == 4)
+    {
+        alignas(16) int8_t shuffle[16];
+        alignas(16) int8_t fill[16];
+        shuffleMasks(shuffle, fill);
+
+        char const *  s        = reinterpret_cast<char const *>(src);
+        char *        d        = reinterpret_cast<char *>(dst);
+        __m256i const shuffle8 = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<__m128i const *>(shuffle)));
+        __m256i const fill8    = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<__m128i const *>(fill)));
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(s + i * 4));
+            v = _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle8), fill8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(d + i * 4), v);
+        }
+    }
+    return shuffleRowSsse3(src, dst, count, i);
+}
+#endif // defined(BITMAP_AVX2)
+
+#if defined(__SSE2__)
+template <typename DstPixel, typename SrcPixel>
+int PixelConverter<DstPixel, SrcPixel>::channelRow(SrcPixel const * src, DstPixel * dst, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i r, g, b, a;
+        load8(src + i, r, g, b, a);
+        store8(dst + i, r, g, b, a);
+    }
+    return i;
+}
+
+template <typename DstPixel, typename SrcPixel>
+template <typename Pixel>
+void PixelConverter<DstPixel, SrcPixel>::load8(Pixel const * p, __m128i & r, __m128i & g, __m128i & b, __m128i & a)
+{
+    if constexpr (sizeof(Pixel) == 2)
+    {
+        __m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+        r = expand<Pixel::RED_MAX, Pixel::RED_SHIFT>(v);
+        g = expand<Pixel::GREEN_MAX, Pixel::GREEN_SHIFT>(v);
+        b = expand<Pixel::BLUE_MAX, Pixel::BLUE_SHIFT>(v);
+        if constexpr (Pixel::HAS_ALPHA)
+            a = expand<Pixel::ALPHA_MAX, Pixel::ALPHA_SHIFT>(v);
+        else
+            a = _mm_set1_epi16(0xff);
+    }
+    else
+    {
+        // Each channel is extracted from the 4 pixels of each half and the halves are packed into 16-bit lanes
+
+        static_assert(sizeof(Pixel) == 4, "24-bit pixels are not supported");
+        __m128i const v0   = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+        __m128i const v1   = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p + 4));
+        __m128i const mask = _mm_set1_epi32(0xff);
+        auto const    channel = [&] (int byte) {
+            __m128i const c0 = _mm_and_si128(_mm_srl_epi32(v0, _mm_cvtsi32_si128(byte * 8)), mask);
+            __m128i const c1 = _mm_and_si128(_mm_srl_epi32(v1, _mm_cvtsi32_si128(byte * 8)), mask);
+            return _mm_packs_epi32(c0, c1);
+        };
+        r = channel(Pixel::RED_BYTE);
+        g = channel(Pixel::GREEN_BYTE);
+        b = channel(Pixel::BLUE_BYTE);
+        a = channel(Pixel::ALPHA_BYTE);
+    }
+}
+
+template <typename DstPixel, typename SrcPixel>
+template <typename Pixel>
+void PixelConverter<DstPixel, SrcPixel>::store8(Pixel * p, __m128i r, __m128i g, __m128i b, __m128i a)
+{
+    if constexpr (sizeof(Pixel) == 2)
+    {
+        __m128i v = _mm_or_si128(_mm_or_si128(reduce<Pixel::RED_MAX, Pixel::RED_SHIFT>(r),
+                                              reduce<Pixel::GREEN_MAX, Pixel::GREEN_SHIFT>(g)),
+                                 reduce<Pixel::BLUE_MAX, Pixel::BLUE_SHIFT>(b));
+        if constexpr (Pixel::HAS_ALPHA)
+            v = _mm_or_si128(v, reduce<Pixel::ALPHA_MAX, Pixel::ALPHA_SHIFT>(a));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+    }
+    else
+    {
+        // Bytes 0 and 1 of each pixel are combined in one 16-bit lane and bytes 2 and 3 in another, and the lanes are
+        // interleaved into 32-bit pixels
+
+        static_assert(sizeof(Pixel) == 4, "24-bit pixels are not supported");
+        __m128i const w0 = _mm_or_si128(byteOf<Pixel>(0, r, g, b, a), _mm_slli_epi16(byteOf<Pixel>(1, r, g, b, a), 8));
+        __m128i const w1 = _mm_or_si128(byteOf<Pixel>(2, r, g, b, a), _mm_slli_epi16(byteOf<Pixel>(3, r, g, b, a), 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_unpacklo_epi16(w0, w1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 4), _mm_unpackhi_epi16(w0, w1));
+    }
+}
+
+template <typename DstPixel, typename SrcPixel>
+template <unsigned MAX, int SHIFT>
+__m128i PixelConverter<DstPixel, SrcPixel>::expand(__m128i v)
+{
+    // The result is (c * 255 + MAX / 2) / MAX, where the division is a multiplication by a reciprocal that is exact
+    // for every possible dividend
+
+    __m128i const c = _mm_and_si128(_mm_srli_epi16(v, SHIFT), _mm_set1_epi16(short(MAX)));
+    if constexpr (MAX == 1)
+    {
+        return _mm_mullo_epi16(c, _mm_set1_epi16(0xff));
+    }
+    else
+    {
+        int constexpr      S = divisionShift(MAX);
+        unsigned constexpr M = ((1u << (16 + S)) + MAX - 1) / MAX;
+        static_assert(S >= 0, "There is no exact reciprocal for the channel size");
+
+        __m128i const t = _mm_add_epi16(_mm_mullo_epi16(c, _mm_set1_epi16(0xff)), _mm_set1_epi16(short(MAX / 2)));
+        return _mm_srli_epi16(_mm_mulhi_epu16(t, _mm_set1_epi16(short(M))), S);
+    }
+}
+
+template <typename DstPixel, typename SrcPixel>
+template <unsigned MAX, int SHIFT>
+__m128i PixelConverter<DstPixel, SrcPixel>::reduce(__m128i c)
+{
+    // The result is (c * MAX + 127) / 255, using t / 255 == (t + 1 + (t >> 8)) >> 8, which holds for t < 16449
+
+    static_assert(MAX * 0xff + 0x7f < 16449, "The channel is too large");
+    __m128i const t = _mm_add_epi16(_mm_mullo_epi16(c, _mm_set1_epi16(short(MAX))), _mm_set1_epi16(0x7f));
+    __m128i const q = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(t, _mm_set1_epi16(1)), _mm_srli_epi16(t, 8)), 8);
+    return _mm_slli_epi16(q, SHIFT);
+}
+
+template <typename DstPixel, typename SrcPixel>
+template <typename Pixel>
+__m128i PixelConverter<DstPixel, SrcPixel>::byteOf(int byte, __m128i r, __m128i g, __m128i b, __m128i a)
+{
+    if (byte == Pixel::RED_BYTE)
+        return r;
+    if (byte == Pixel::GREEN_BYTE)
+        return g;
+    if (byte == Pixel::BLUE_BYTE)
+        return b;
+    return a;
+}
+
+template <typename DstPixel, typename SrcPixel>
+constexpr int PixelConverter<DstPixel, SrcPixel>::divisionShift(unsigned max)
+{
+    for (int s = 0; s < 16; ++s)
+    {
+        unsigned const m = ((1u << (16 + s)) + max - 1) / max;
+        if (m > 0xffff)
+            break;
+        bool exact = true;
+        for (unsigned t = 0; exact && t <= max * 0xff + max / 2; ++t)
+        {
+            exact = (t * m) >> (16 + s) == t / max;
+        }
+        if (exact)
+            return s;
+    }
+    return -1;
+}
+#endif // defined(__SSE2__)
+
+//! Converts an image from one pixel format to another.
+//!
+//! If the two images differ in size, only the overlapping area (from the top left) is converted.
+//!
+//! @param  src     Source image
+//! @param  dst     Destination image
+template <typename DstPixel, typename SrcPixel>
+void convert(BitmapView<SrcPixel> const & src, BitmapView<DstPixel> const & dst)
+{
+    using Src = std::remove_const_t<SrcPixel>;
+    static_assert(!std::is_const<DstPixel>::value, "The destination must be mutable");
+
+    int const width  = std::min(src.width(), dst.width());
+    int const height = std::min(src.height(), dst.height());
+    if (width <= 0 || height <= 0)
+        return;
+
+    // If both images are contiguous, consecutive rows can be converted as a single row, as long as the number of pixels
+    // fits in an int
+    int rows = 1;
+    if (src.pitch() == width * sizeof(Src) && dst.pitch() == width * sizeof(DstPixel))
+        rows = std::min(height, INT_MAX / width);
+
+    for (int y = 0; y < height; y += rows)
+    {
+        int const count = std::min(rows, height - y) * width;
+        PixelConverter<DstPixel, Src>::convertRow(src.row(y), dst.row(y), count);
+    }
+}
+
+//! Returns a copy of a bitmap converted to a different pixel format.
+//!
+//! @param  src     Source bitmap
+//! @param  pitch   Pitch of the resulting bitmap, or 0 if determined by the width
+//!
+//! @return     converted bitmap
+template <typename DstPixel, typename SrcPixel>
+Bitmap<DstPixel> convert(Bitmap<SrcPixel> const & src, size_t pitch = 0)
+{
+    Bitmap<DstPixel> dst(src.width(), src.height(), pitch);
+    convert(src.view(), dst.view());
+    return dst;
+}
+
+#endif // !defined(BITMAP_CONVERT_H)
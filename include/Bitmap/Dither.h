@@ -0,0 +1,446 @@
+#if !defined(BITMAP_DITHER_H)
+#define BITMAP_DITHER_H
+
+#pragma once
+
+#include "Bitmap/BitmapView.h"
+#include "Bitmap/Palette.h"
+#include "Bitmap/PalettizedBitmap.h"
+#include "Bitmap/Parallel.h"
+#include "Bitmap/Quantize.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+//! How the error of reducing colors is spread.
+enum class DitherMethod
+{
+    BAYER,              //!< Ordered, with an 8 x 8 Bayer matrix. Fast, but with a visible cross-hatch pattern.
+    BLUE_NOISE,         //!< Ordered, with a 32 x 32 blue-noise matrix. Fast, with fine, unstructured grain.
+    FLOYD_STEINBERG     //!< Error diffusion. The best quality, processed as a wavefront of rows.
+};
+
+//! A tiled matrix of thresholds for ordered dithering.
+struct ThresholdMatrix
+{
+    int              size;      //!< Width and height (a power of 2)
+    int              levels;    //!< Number of distinct thresholds (size * size)
+    uint16_t const * values;    //!< Thresholds (0 - levels-1), in row-major order
+
+    //! Returns the threshold for the pixel at (x, y).
+    int at(int x, int y) const { return values[(y & (size - 1)) * size + (x & (size - 1))]; }
+
+    //! Returns the 8 x 8 Bayer matrix.
+    static ThresholdMatrix const & bayer();
+
+    //! Returns a 32 x 32 blue-noise matrix, generated by the void-and-cluster method on first use.
+    static ThresholdMatrix const & blueNoise();
+};
+
+//! Reduces colors to a 16-bit pixel format.
+//!
+//! Alpha is rounded but not dithered.
+template <typename Dst>
+class FormatReducer
+{
+public:
+
+    static_assert(!Dst::BYTE_CHANNELS, "Only formats with fewer than 8 bits per channel need dithering");
+
+    //! Reduced pixel type.
+    using Output = Dst;
+
+    //! Constructor.
+    FormatReducer();
+
+    //! Returns the nearest pixel to a color, and its actual 8-bit channel values.
+    Dst reduce(int r, int g, int b, int a, int * actual) const
+    {
+        unsigned const rl  = nearest<Dst::RED_MAX>(r, &actual[0]);
+        unsigned const gl  = nearest<Dst::GREEN_MAX>(g, &actual[1]);
+        unsigned const bl  = nearest<Dst::BLUE_MAX>(b, &actual[2]);
+        unsigned       raw = (rl << Dst::RED_SHIFT) | (gl << Dst::GREEN_SHIFT) | (bl << Dst::BLUE_SHIFT);
+        if constexpr (Dst::HAS_ALPHA)
+        {
+            int unused;
+            raw |= nearest<Dst::ALPHA_MAX>(a, &unused) << Dst::ALPHA_SHIFT;
+        }
+        return Dst(raw);
+    }
+
+    //! Returns one of the two pixels bracketing a color, choosing the upper level of a channel if the color's position
+    //! between the two levels exceeds a threshold (0 - 65535).
+    Dst reduce(int r, int g, int b, int a, unsigned threshold) const
+    {
+        unsigned raw = (level(0, r, threshold) << Dst::RED_SHIFT) |
+                       (level(1, g, threshold) << Dst::GREEN_SHIFT) |
+                       (level(2, b, threshold) << Dst::BLUE_SHIFT);
+        if constexpr (Dst::HAS_ALPHA)
+        {
+            int unused;
+            raw |= nearest<Dst::ALPHA_MAX>(a, &unused) << Dst::ALPHA_SHIFT;
+        }
+        return Dst(raw);
+    }
+
+private:
+
+    // Returns the nearest level of an 8-bit value and the 8-bit value of that level
+    template <unsigned MAX>
+    static unsigned nearest(int v, int * actual)
+    {
+        unsigned l = (unsigned(v) * MAX + 127) / 255;
+        *actual    = int((l * 255 + MAX / 2) / MAX);
+        return l;
+    }
+
+    // Returns the level of a channel for a threshold
+    unsigned level(int channel, int v, unsigned threshold) const
+    {
+        return lower_[channel][v] + (fraction_[channel][v] > threshold);
+    }
+
+    uint8_t  lower_[3][256];        // Highest level at or below each 8-bit value
+    uint16_t fraction_[3][256];     // Position of each 8-bit value between its lower level and the next (0 - 65535)
+};
+
+//! Reduces colors to the indexes of the nearest palette entries.
+template <typename Color>
+class PaletteReducer
+{
+public:
+
+    //! Reduced pixel type.
+    using Output = uint8_t;
+
+    //! Constructor.
+    explicit PaletteReducer(Palette<Color> const & palette, int count = int(Palette<Color>::PALETTE_SIZE));
+
+    //! Returns the index of the nearest entry to a color, and its actual 8-bit channel values.
+    uint8_t reduce(int r, int g, int b, int /*a*/, int * actual) const
+    {
+        uint8_t const i = map_(uint8_t(r), uint8_t(g), uint8_t(b));
+        actual[0]       = colors_[i][0];
+        actual[1]       = colors_[i][1];
+        actual[2]       = colors_[i][2];
+        return i;
+    }
+
+    //! Returns the index of the nearest entry to a color offset according to a threshold (0 - 65535).
+    uint8_t reduce(int r, int g, int b, int /*a*/, unsigned threshold) const
+    {
+        int const offset = (int(threshold) - 32768) * spread_ / 65536;
+        return map_(clamp8(r + offset), clamp8(g + offset), clamp8(b + offset));
+    }
+
+private:
+
+    // Limits a value to 0 - 255
+    static uint8_t clamp8(int v) { return uint8_t(std::clamp(v, 0, 255)); }
+
+    InverseColormap map_;                                           // Nearest entries
+    uint8_t         colors_[Palette<Color>::PALETTE_SIZE][3] = {};  // Entries (red, green, blue)
+    int             spread_ = 0;                                    // Typical distance between entries
+};
+
+// Each channel's two bracketing levels are found in advance for every 8-bit value
+template <typename Dst>
+FormatReducer<Dst>::FormatReducer()
+{
+    unsigned const max[3] = { Dst::RED_MAX, Dst::GREEN_MAX, Dst::BLUE_MAX };
+    for (int c = 0; c < 3; ++c)
+    {
+        unsigned const m = max[c];
+        for (unsigned v = 0; v < 256; ++v)
+        {
+            unsigned l = v * m / 255;
+            while (l > 0 && (l * 255 + m / 2) / m > v)
+                --l;
+            while (l < m && ((l + 1) * 255 + m / 2) / m <= v)
+                ++l;
+            unsigned const lo = (l * 255 + m / 2) / m;
+            unsigned const hi = (l < m) ? ((l + 1) * 255 + m / 2) / m : lo + 1;
+            lower_[c][v]      = uint8_t(l);
+            fraction_[c][v]   = (l < m) ? uint16_t((v - lo) * 65535 / (hi - lo)) : 0;
+        }
+    }
+}
+
+//! @param  palette     Palette
+//! @param  count       Number of entries to use, starting with the first
+template <typename Color>
+PaletteReducer<Color>::PaletteReducer(Palette<Color> const & palette,
+                                      int                    count /*= int(Palette<Color>::PALETTE_SIZE)*/)
+    : map_(palette, count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        Color const c = palette.entries()[i];
+        colors_[i][0] = c.red8();
+        colors_[i][1] = c.green8();
+        colors_[i][2] = c.blue8();
+    }
+
+    // Ordered dithering offsets colors by up to half the typical distance between an entry and its nearest neighbor.
+    // The median is used so that outlying entries (such as unused entries left black) do not distort it.
+    std::vector<int> distances;
+    for (int i = 0; i < count; ++i)
+    {
+        int  nearest   = INT32_MAX;
+        bool duplicate = false;
+        for (int j = 0; j < count && !duplicate; ++j)
+        {
+            int const dr = colors_[i][0] - colors_[j][0];
+            int const dg = colors_[i][1] - colors_[j][1];
+            int const db = colors_[i][2] - colors_[j][2];
+            int const d  = dr * dr + dg * dg + db * db;
+            duplicate    = (d == 0 && j < i);
+            if (d > 0)
+                nearest = std::min(nearest, d);
+        }
+        if (!duplicate && nearest < INT32_MAX)
+            distances.push_back(nearest);
+    }
+    if (!distances.empty())
+    {
+        std::nth_element(distances.begin(), distances.begin() + distances.size() / 2, distances.end());
+        spread_ = int(std::sqrt(double(distances[distances.size() / 2])) + 0.5);
+    }
+}
+
+//! Reduces the colors of an image with dithering.
+//!
+//! Ordered dithering adds a threshold from a tiled matrix to each pixel before it is rounded, so every pixel is
+//! independent and the rows are processed in parallel bands.
+//!
+//! Floyd-Steinberg diffusion passes the rounding error of each pixel to its unprocessed neighbors. A pixel depends on
+//! the pixel to its left and the three pixels above it, so a row can be processed as soon as the row above is at least
+//! one pixel further along. With PARALLEL execution, each thread takes the next unprocessed row and follows the row
+//! above it in chunks of columns, so many rows are processed at once, each lagging slightly behind the one above. The
+//! result is identical to processing the rows sequentially.
+class Dither
+{
+public:
+
+    //! Number of columns processed by a row before it reports progress to the row below
+    static int constexpr WAVEFRONT_CHUNK = 64;
+
+    //! Reduces an image using a reducer.
+    template <typename Reducer, typename Src>
+    static void reduce(BitmapView<Src> const &                      src,
+                       BitmapView<typename Reducer::Output> const & dst,
+                       Reducer const &                              reducer,
+                       DitherMethod                                 method,
+                       Execution                                    execution);
+
+private:
+
+    template <typename Reducer, typename Src>
+    static void ordered(BitmapView<Src> const &                      src,
+                        BitmapView<typename Reducer::Output> const & dst,
+                        Reducer const &                              reducer,
+                        ThresholdMatrix const &                      matrix,
+                        Execution                                    execution);
+
+    template <typename Reducer, typename Src>
+    static void floydSteinberg(BitmapView<Src> const &                      src,
+                               BitmapView<typename Reducer::Output> const & dst,
+                               Reducer const &                              reducer,
+                               Execution                                    execution);
+
+    // Returns a value scaled by 1/16, rounded to nearest
+    static int sixteenth(int v) { return (v >= 0) ? (v + 8) / 16 : -((8 - v) / 16); }
+
+    // Limits a value to 0 - 255
+    static int clamp8(int v) { return std::clamp(v, 0, 255); }
+};
+
+//! If the destination differs in size, only the overlapping area (from the top left) is reduced.
+//!
+//! @param  src         Image
+//! @param  dst         Receives the reduced image
+//! @param  reducer     Chooses the reduced value of a color (FormatReducer or PaletteReducer)
+//! @param  method      How to dither
+//! @param  execution   How to process the rows
+template <typename Reducer, typename Src>
+void Dither::reduce(BitmapView<Src> const &                      src,
+                    BitmapView<typename Reducer::Output> const & dst,
+                    Reducer const &                              reducer,
+                    DitherMethod                                 method,
+                    Execution                                    execution)
+{
+    switch (method)
+    {
+    case DitherMethod::BAYER:
+        ordered(src, dst, reducer, ThresholdMatrix::bayer(), execution);
+        break;
+    case DitherMethod::BLUE_NOISE:
+        ordered(src, dst, reducer, ThresholdMatrix::blueNoise(), execution);
+        break;
+    case DitherMethod::FLOYD_STEINBERG:
+        floydSteinberg(src, dst, reducer, execution);
+        break;
+    }
+}
+
+// The thresholds are spread evenly over 0 - 65535
+template <typename Reducer, typename Src>
+void Dither::ordered(BitmapView<Src> const &                      src,
+                     BitmapView<typename Reducer::Output> const & dst,
+                     Reducer const &                              reducer,
+                     ThresholdMatrix const &                      matrix,
+                     Execution                                    execution)
+{
+    int const width  = std::min(src.width(), dst.width());
+    int const height = std::min(src.height(), dst.height());
+    if (width <= 0 || height <= 0)
+        return;
+
+    forEachBand(execution, height, width * sizeof(Src), [&] (int begin, int end) {
+        for (int y = begin; y < end; ++y)
+        {
+            auto const * s = src.row(y);
+            auto *       d = dst.row(y);
+            for (int x = 0; x < width; ++x)
+            {
+                unsigned const threshold = unsigned(2 * matrix.at(x, y) + 1) * 32768 / matrix.levels;
+                d[x] = reducer.reduce(s[x].red8(), s[x].green8(), s[x].blue8(), s[x].alpha8(), threshold);
+            }
+        }
+    });
+}
+
+// The errors passed down to a row are accumulated in one of two buffers, alternating between rows. A row clears each
+// entry of its buffer as it reads it, and the row below (which fills the other buffer) writes to the buffer two rows
+// down only where this row has already read, so the buffers can be shared by rows in progress.
+template <typename Reducer, typename Src>
+void Dither::floydSteinberg(BitmapView<Src> const &                      src,
+                            BitmapView<typename Reducer::Output> const & dst,
+                            Reducer const &                              reducer,
+                            Execution                                    execution)
+{
+    int const width  = std::min(src.width(), dst.width());
+    int const height = std::min(src.height(), dst.height());
+    if (width <= 0 || height <= 0)
+        return;
+
+    size_t const                        stride = size_t(width) * 3;
+    std::vector<int>                    errors(2 * stride, 0);                      // Errors * 16, by row parity
+    std::unique_ptr<std::atomic<int>[]> progress(new std::atomic<int>[height]);     // Columns finished in each row
+    for (int y = 0; y < height; ++y)
+    {
+        progress[y].store(0, std::memory_order_relaxed);
+    }
+
+    auto processRow = [&] (int y) {
+        auto const * s       = src.row(y);
+        auto *       d       = dst.row(y);
+        int *        in      = errors.data() + (y & 1) * stride;
+        int *        out     = errors.data() + ((y + 1) & 1) * stride;
+        bool const   last    = y == height - 1;
+        int          next[3] = { 0, 0, 0 };   // Error passed to the right * 16
+        for (int x0 = 0; x0 < width; x0 += WAVEFRONT_CHUNK)
+        {
+            int const x1 = std::min(x0 + WAVEFRONT_CHUNK, width);
+            if (y > 0)
+            {
+                int const needed = std::min(x1 + 1, width);
+                while (progress[y - 1].load(std::memory_order_acquire) < needed)
+                    std::this_thread::yield();
+            }
+
+            for (int x = x0; x < x1; ++x)
+            {
+                int * e = in + x * 3;
+                int   v[3];
+                v[0] = clamp8(s[x].red8() + sixteenth(e[0] + next[0]));
+                v[1] = clamp8(s[x].green8() + sixteenth(e[1] + next[1]));
+                v[2] = clamp8(s[x].blue8() + sixteenth(e[2] + next[2]));
+                e[0] = e[1] = e[2] = 0;
+
+                int actual[3];
+                d[x] = reducer.reduce(v[0], v[1], v[2], s[x].alpha8(), actual);
+                for (int c = 0; c < 3; ++c)
+                {
+                    int const error = v[c] - actual[c];
+                    next[c] = error * 7;
+                    if (last)
+                        continue;
+                    if (x > 0)
+                        out[(x - 1) * 3 + c] += error * 3;
+                    out[x * 3 + c] += error * 5;
+                    if (x + 1 < width)
+                        out[(x + 1) * 3 + c] += error;
+                }
+            }
+            progress[y].store(x1, std::memory_order_release);
+        }
+    };
+
+    int workers = 1;
+    if (execution == Execution::PARALLEL)
+    {
+        workers = int(std::min({ size_t(ThreadPool::shared().size()),
+                                 size_t(height) * width * sizeof(Src) / PARALLEL_MIN_BAND_SIZE,
+                                 size_t(height) }));
+    }
+
+    if (workers <= 1)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            processRow(y);
+        }
+        return;
+    }
+
+    // Rows are claimed in order by running tasks only, so the row above a claimed row is always being processed
+    std::atomic<int> nextRow(0);
+    ThreadPool::shared().run(workers, [&] (int) {
+        for (int y = nextRow++; y < height; y = nextRow++)
+        {
+            processRow(y);
+        }
+    });
+}
+
+//! Reduces an image to a 16-bit pixel format (such as Pixel565 or Pixel1555) with dithering.
+//!
+//! @param  src         Image
+//! @param  dst         Receives the reduced image. If it differs in size, only the overlapping area is reduced.
+//! @param  method      How to dither
+//! @param  execution   How to process the rows
+template <typename Dst, typename Src>
+void dither(BitmapView<Src> const & src,
+            BitmapView<Dst> const & dst,
+            DitherMethod            method    = DitherMethod::FLOYD_STEINBERG,
+            Execution               execution = Execution::SEQUENTIAL)
+{
+    Dither::reduce(src, dst, FormatReducer<Dst>(), method, execution);
+}
+
+//! Reduces an image to the palette of a palettized image with dithering.
+//!
+//! Use quantize() to create a palettized image with a palette chosen for the source.
+//!
+//! @param  src         Image
+//! @param  dst         Palettized image whose palette is used and whose indexes receive the reduced image. If it
+//!                     differs in size, only the overlapping area is reduced.
+//! @param  method      How to dither
+//! @param  execution   How to process the rows
+template <typename Color, typename Src>
+void dither(BitmapView<Src> const &   src,
+            PalettizedBitmap<Color> * dst,
+            DitherMethod              method    = DitherMethod::FLOYD_STEINBERG,
+            Execution                 execution = Execution::SEQUENTIAL)
+{
+    PaletteReducer<Color> const reducer(static_cast<PalettizedBitmap<Color> const *>(dst)->palette());
+    Dither::reduce(src, dst->view(), reducer, method, execution);
+}
+
+#endif // !defined(BITMAP_DITHER_H)
@@ -0,0 +1,96 @@
+#if !defined(BITMAP_FILL_H)
+#define BITMAP_FILL_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//! Fills rows of pixels with a value.
+//!
+//! The row is filled with 16-byte SSE2 stores of a 48-byte pattern, which holds a whole number of pixels of every size
+//! up to 4 bytes (including 24-bit pixels). Streaming fills use non-temporal stores, which bypass the cache. They are
+//! faster for fills much larger than the cache, but much slower for data that is about to be read.
+template <typename Pixel>
+class PixelFiller
+{
+public:
+
+    //! Fills a row of pixels.
+    static void fillRow(Pixel * dst, size_t count, Pixel const & value, bool streaming = false);
+
+private:
+
+    static size_t constexpr PIXEL_SIZE   = sizeof(Pixel);
+    static size_t constexpr PATTERN_SIZE = 48;
+    static_assert(PATTERN_SIZE % PIXEL_SIZE == 0, "The pattern must hold a whole number of pixels");
+};
+
+//! @param  dst         Destination pixels
+//! @param  count       Number of pixels
+//! @param  value       Value to store
+//! @param  streaming   If true, non-temporal stores are used
+template <typename Pixel>
+void PixelFiller<Pixel>::fillRow(Pixel * dst, size_t count, Pixel const & value, bool streaming /*= false*/)
+{
+#if defined(__SSE2__)
+    uint8_t * d    = reinterpret_cast<uint8_t *>(dst);
+    size_t    size = count * PIXEL_SIZE;
+
+    // The pattern is 16 bytes longer than necessary so that it can be loaded starting at any of the first 16 bytes
+    alignas(16) uint8_t pattern[PATTERN_SIZE + 16];
+    for (size_t i = 0; i < sizeof pattern; i += PIXEL_SIZE)
+    {
+        memcpy(pattern + i, &value, (sizeof pattern - i < PIXEL_SIZE) ? sizeof pattern - i : PIXEL_SIZE);
+    }
+
+    // Fill the bytes up to the first aligned address individually. The pattern is then loaded starting at that offset
+    // so that it lines up with the pixels.
+    size_t head = (16 - reinterpret_cast<uintptr_t>(d) % 16) % 16;
+    if (head > size)
+        head = size;
+    memcpy(d, pattern, head);
+
+    __m128i p0 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(pattern + head));
+    __m128i p1 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(pattern + head + 16));
+    __m128i p2 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(pattern + head + 32));
+
+    size_t i = head;
+    if (streaming)
+    {
+        for (; i + PATTERN_SIZE <= size; i += PATTERN_SIZE)
+        {
+            _mm_stream_si128(reinterpret_cast<__m128i *>(d + i), p0);
+            _mm_stream_si128(reinterpret_cast<__m128i *>(d + i + 16), p1);
+            _mm_stream_si128(reinterpret_cast<__m128i *>(d + i + 32), p2);
+        }
+        _mm_sfence();
+    }
+    else
+    {
+        for (; i + PATTERN_SIZE <= size; i += PATTERN_SIZE)
+        {
+            _mm_store_si128(reinterpret_cast<__m128i *>(d + i), p0);
+            _mm_store_si128(reinterpret_cast<__m128i *>(d + i + 16), p1);
+            _mm_store_si128(reinterpret_cast<__m128i *>(d + i + 32), p2);
+        }
+    }
+
+    // Fill the remainder (less than a full pattern)
+    if (i < size)
+        memcpy(d + i, pattern + head, size - i);
+#else
+    (void)streaming;
+    for (size_t i = 0; i < count; ++i)
+    {
+        dst[i] = value;
+    }
+#endif
+}
+
+#endif // !defined(BITMAP_FILL_H)
@@ -0,0 +1,205 @@
+#if !defined(BITMAP_MAPPEDBITMAP_H)
+#define BITMAP_MAPPEDBITMAP_H
+
+#pragma once
+
+#include "Bitmap/Bitmap.h"
+#include "Bitmap/BitmapView.h"
+#include "Bitmap/Container.h"
+#include "Bitmap/MappedFile.h"
+#include "Bitmap/Pixel.h"
+#include <cassert>
+#include <cstddef>
+
+//! An image stored in a memory-mapped file.
+//!
+//! The file is a native container (see ContainerHeader). It is mapped rather than read, so opening an image is nearly
+//! instant regardless of its size, and rows are read from the file only when they are accessed. The image is accessed
+//! through views, so anything that accepts a BitmapView (such as Bitmap::copy() or resize()) works directly on the
+//! file.
+//!
+//! A copy-on-write mapping can be modified through writableView(), but the changes are private and are discarded when
+//! the file is closed. Use save() to write an image in this format.
+template <typename Pixel>
+class MappedBitmap
+{
+public:
+
+    //! Pixel type.
+    using PixelType = Pixel;
+
+    //! Read-only view of the image.
+    using ConstView = BitmapView<Pixel const>;
+
+    //! View of the image.
+    using View = BitmapView<Pixel>;
+
+    //! How the file is mapped.
+    using Mode = MappedFile::Mode;
+
+    //! Expected pattern of access.
+    using Access = MappedFile::Access;
+
+    //! Constructor.
+    MappedBitmap() = default;
+
+    //! Constructor.
+    explicit MappedBitmap(char const * path, Mode mode = Mode::READ_ONLY);
+
+    //! Maps an image file, replacing the current image.
+    bool open(char const * path, Mode mode = Mode::READ_ONLY);
+
+    //! Unmaps the image file.
+    void close();
+
+    //! Returns true if an image is mapped.
+    bool isOpen() const { return file_.isOpen(); }
+
+    //! Returns the width of the image (in pixels).
+    int width() const { return width_; }
+
+    //! Returns the height of the image (in pixels).
+    int height() const { return height_; }
+
+    //! Returns the distance between the starts of consecutive rows (in bytes).
+    size_t pitch() const { return pitch_; }
+
+    //! Returns a pointer to a row.
+    Pixel const * row(int y) const { return view().row(y); }
+
+    //! Returns a read-only view of the image.
+    ConstView view() const;
+
+    //! Returns a view of the image for modification. The mode must be COPY_ON_WRITE.
+    View writableView();
+
+    //! Tells the system how a band of rows will be accessed.
+    void advise(Access access, int y = 0, int rows = 0) const;
+
+    //! Starts reading a band of rows in the background.
+    void prefetch(int y, int rows) const;
+
+    //! Writes an image to a file that can be mapped.
+    static bool save(char const * path, ConstView const & src);
+
+private:
+
+    // Returns the offset of a row from the start of the file
+    size_t offsetOf(int y) const { return dataOffset_ + y * pitch_; }
+
+    MappedFile file_;               // Mapped file
+    int        width_      = 0;     // Width (in pixels)
+    int        height_     = 0;     // Height (in pixels)
+    size_t     pitch_      = 0;     // Pitch (in bytes)
+    size_t     dataOffset_ = 0;     // Offset of the first row in the file (in bytes)
+};
+
+//! @param  path    Path of the file
+//! @param  mode    How to map the file
+template <typename Pixel>
+MappedBitmap<Pixel>::MappedBitmap(char const * path, Mode mode /*= Mode::READ_ONLY*/)
+{
+    open(path, mode);
+}
+
+//! The file must contain a valid container, and its pixel format must match this pixel type. If the pixel type does not
+//! have a PixelFormat, then only the sizes must match.
+//!
+//! @param  path    Path of the file
+//! @param  mode    How to map the file
+//!
+//! @return     true if the image was mapped
+template <typename Pixel>
+bool MappedBitmap<Pixel>::open(char const * path, Mode mode /*= Mode::READ_ONLY*/)
+{
+    close();
+    if (!file_.open(path, mode))
+        return false;
+
+    ContainerHeader header;
+    if (!BitmapContainer<Pixel>::read(file_.data(), file_.size(), &header))
+    {
+        file_.close();
+        return false;
+    }
+
+    width_      = header.width;
+    height_     = header.height;
+    pitch_      = size_t(header.pitch);
+    dataOffset_ = size_t(header.dataOffset);
+    if (width_ == 0 || height_ == 0)
+    {
+        width_  = 0;
+        height_ = 0;
+    }
+    return true;
+}
+
+template <typename Pixel>
+void MappedBitmap<Pixel>::close()
+{
+    file_.close();
+    width_      = 0;
+    height_     = 0;
+    pitch_      = 0;
+    dataOffset_ = 0;
+}
+
+template <typename Pixel>
+typename MappedBitmap<Pixel>::ConstView MappedBitmap<Pixel>::view() const
+{
+    if (!file_.isOpen())
+        return ConstView();
+    char const * data = static_cast<char const *>(file_.data()) + dataOffset_;
+    return ConstView(width_, height_, pitch_, reinterpret_cast<Pixel const *>(data));
+}
+
+template <typename Pixel>
+typename MappedBitmap<Pixel>::View MappedBitmap<Pixel>::writableView()
+{
+    if (!file_.isOpen())
+        return View();
+    char * data = static_cast<char *>(file_.writableData()) + dataOffset_;
+    return View(width_, height_, pitch_, reinterpret_cast<Pixel *>(data));
+}
+
+//! @param  access  Expected pattern of access
+//! @param  y       First row of the band
+//! @param  rows    Number of rows in the band, or 0 for the rest of the image
+template <typename Pixel>
+void MappedBitmap<Pixel>::advise(Access access, int y /*= 0*/, int rows /*= 0*/) const
+{
+    assert(y >= 0 && y <= height_);
+    assert(rows >= 0);
+    if (rows == 0 || y + rows > height_)
+        rows = height_ - y;
+    if (rows > 0)
+        file_.advise(access, offsetOf(y), rows * pitch_);
+}
+
+//! @param  y       First row of the band
+//! @param  rows    Number of rows in the band
+template <typename Pixel>
+void MappedBitmap<Pixel>::prefetch(int y, int rows) const
+{
+    assert(y >= 0 && y <= height_);
+    assert(rows >= 0);
+    if (y + rows > height_)
+        rows = height_ - y;
+    if (rows > 0)
+        file_.prefetch(offsetOf(y), rows * pitch_);
+}
+
+//! The image is written as a native container, with every row aligned to Bitmap::ROW_ALIGNMENT.
+//!
+//! @param  path    Path of the file
+//! @param  src     Image to write
+//!
+//! @return     true if the image was written
+template <typename Pixel>
+bool MappedBitmap<Pixel>::save(char const * path, ConstView const & src)
+{
+    return BitmapContainer<Pixel>::save(path, src);
+}
+
+#endif // !defined(BITMAP_MAPPEDBITMAP_H)
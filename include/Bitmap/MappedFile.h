@@ -0,0 +1,87 @@
+#if !defined(BITMAP_MAPPEDFILE_H)
+#define BITMAP_MAPPEDFILE_H
+
+#pragma once
+
+#include <cstddef>
+
+//! A file mapped into memory.
+//!
+//! The pages of the file are read on demand when they are first accessed, so opening even a very large file is fast
+//! and only the parts that are used become resident. Memory mapping requires POSIX mmap(). On other platforms,
+//! isSupported() returns false and open() always fails.
+class MappedFile
+{
+public:
+
+    //! How the file is mapped.
+    enum class Mode
+    {
+        READ_ONLY,      //!< The contents can only be read
+        COPY_ON_WRITE   //!< The contents can be changed, but the changes are private and never written to the file
+    };
+
+    //! Expected pattern of access, used to tune reading ahead.
+    enum class Access
+    {
+        NORMAL,         //!< No particular pattern
+        SEQUENTIAL,     //!< Mostly in increasing order of address. Pages are read ahead aggressively.
+        RANDOM          //!< In no particular order. Pages are not read ahead.
+    };
+
+    //! Constructor.
+    MappedFile() = default;
+
+    //! Destructor.
+    ~MappedFile();
+
+    MappedFile(MappedFile const &) = delete;
+    MappedFile & operator =(MappedFile const &) = delete;
+
+    //! Move constructor.
+    MappedFile(MappedFile && rhs);
+
+    //! Move assignment operator.
+    MappedFile & operator =(MappedFile && rhs);
+
+    //! Maps a file, replacing the current mapping.
+    bool open(char const * path, Mode mode = Mode::READ_ONLY);
+
+    //! Unmaps the file.
+    void close();
+
+    //! Returns true if a file is mapped.
+    bool isOpen() const { return data_ != nullptr; }
+
+    //! Returns the mode of the mapping.
+    Mode mode() const { return mode_; }
+
+    //! Returns the mapped contents.
+    void const * data() const { return data_; }
+
+    //! Returns the mapped contents for modification. The mode must be COPY_ON_WRITE.
+    void * writableData();
+
+    //! Returns the size of the mapped contents (in bytes).
+    size_t size() const { return size_; }
+
+    //! Tells the system how a range of the contents will be accessed.
+    void advise(Access access, size_t offset = 0, size_t size = 0) const;
+
+    //! Starts reading a range of the contents in the background.
+    void prefetch(size_t offset, size_t size) const;
+
+    //! Returns true if files can be mapped on this platform.
+    static bool isSupported();
+
+private:
+
+    // Rounds a range out to whole pages, returning the start address and setting *pSize to the size of the result
+    void * pages(size_t offset, size_t * pSize) const;
+
+    void * data_ = nullptr;         // Mapped contents
+    size_t size_ = 0;               // Size of the mapped contents (in bytes)
+    Mode   mode_ = Mode::READ_ONLY; // Mode of the mapping
+};
+
+#endif // !defined(BITMAP_MAPPEDFILE_H)
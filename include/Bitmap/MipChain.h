@@ -0,0 +1,373 @@
+#if !defined(BITMAP_MIPCHAIN_H)
+#define BITMAP_MIPCHAIN_H
+
+#pragma once
+
+#include "Bitmap/Bitmap.h"
+#include "Bitmap/BitmapView.h"
+#include "Bitmap/Pixel.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//! Filters used to reduce one mip level to the next.
+enum class MipFilter
+{
+    BOX,    //!< Average of each 2x2 block
+    GAMMA   //!< Average of each 2x2 block, computed in linear space for sRGB-encoded color channels
+};
+
+//! A bitmap and all of its mip levels.
+//!
+//! Each level is half the size of the previous level (rounded down, but at least 1) in each dimension, down to 1x1.
+//! All of the levels are stored in a single allocation. The rows of every level are aligned to
+//! Bitmap::ROW_ALIGNMENT.
+//!
+//! The levels are built in a single pass over the base image. As soon as two rows of a level are complete, they are
+//! reduced to a row of the next level, so every row is read exactly once, while it is still in the cache.
+//!
+//! Only Pixel8 and the Pixel16, Pixel24 and Pixel32 formats are supported. Alpha is always averaged linearly.
+template <typename Pixel>
+class MipChain
+{
+public:
+
+    //! View of a level.
+    using View = BitmapView<Pixel>;
+
+    //! Read-only view of a level.
+    using ConstView = BitmapView<Pixel const>;
+
+    //! Constructor.
+    MipChain() = default;
+
+    //! Constructor.
+    explicit MipChain(std::pmr::memory_resource * resource);
+
+    //! Constructor.
+    MipChain(ConstView const &           base,
+             MipFilter                   filter   = MipFilter::BOX,
+             std::pmr::memory_resource * resource = nullptr);
+
+    //! Replaces all levels with those of a new base image.
+    void build(ConstView const & base, MipFilter filter = MipFilter::BOX);
+
+    //! Returns the number of levels (0 if empty).
+    int levels() const { return int(levels_.size()); }
+
+    //! Returns a read-only view of a level (level 0 is the base image).
+    ConstView level(int i) const;
+
+    //! Returns a view of a level (level 0 is the base image).
+    View level(int i);
+
+    //! Returns the total size of the levels (in bytes).
+    size_t size() const
+    {
+        return levels_.empty() ? 0 : levels_.back().offset + levels_.back().pitch * levels_.back().height;
+    }
+
+    //! Returns the memory resource that provides the storage.
+    std::pmr::memory_resource * resource() const { return storage_.resource(); }
+
+private:
+
+    static size_t constexpr STORAGE_ROW = size_t(1) << 30;  // Maximum width of the storage (in bytes)
+
+    // Location and size of a level in the storage
+    struct Level
+    {
+        int width;      // Width (in pixels)
+        int height;     // Height (in pixels)
+        size_t pitch;   // Pitch (in bytes)
+        size_t offset;  // Offset of the first row in the storage (in bytes)
+    };
+
+    // Returns the number of channels of a pixel, as stored
+    static int constexpr channels()
+    {
+        if constexpr (std::is_same<Pixel, Pixel8>::value)
+            return 1;
+        else if constexpr (Pixel::BYTE_CHANNELS)
+            return int(sizeof(Pixel));
+        else
+            return 0;
+    }
+
+    // Returns the offset of the alpha byte in a pixel, or -1 if there is none
+    static int constexpr alphaByte()
+    {
+        if constexpr (std::is_same<Pixel, Pixel8>::value)
+            return -1;
+        else
+            return Pixel::ALPHA_BYTE;
+    }
+
+    // Reduces the two rows of a level that complete a row of the next level, and continues down the chain
+    void reduce(int i, int y);
+
+    // Reduces two rows to a row half the width
+    static void reduceRow(Pixel const * row0, Pixel const * row1, int width, Pixel * dst, MipFilter filter);
+
+    // Returns the average of four 8-bit channels, averaged in linear space if gamma is true
+    static uint8_t average(unsigned a, unsigned b, unsigned c, unsigned d, bool gamma);
+
+    // Converts an 8-bit sRGB value to a 16-bit linear value
+    static uint16_t toLinear(unsigned value);
+
+    // Converts a 16-bit linear value to an 8-bit sRGB value
+    static uint8_t fromLinear(unsigned value);
+
+    std::vector<Level> levels_;             // Location and size of each level
+    Bitmap<uint8_t>    storage_;            // Storage for all levels
+    MipFilter          filter_ = MipFilter::BOX;
+};
+
+//! @param  resource    Source of storage, or nullptr for the default resource
+template <typename Pixel>
+MipChain<Pixel>::MipChain(std::pmr::memory_resource * resource)
+    : storage_(resource)
+{
+}
+
+//! @param  base        Base image
+//! @param  filter      Filter used to reduce each level to the next
+//! @param  resource    Source of storage, or nullptr for the default resource
+template <typename Pixel>
+MipChain<Pixel>::MipChain(ConstView const &           base,
+                          MipFilter                   filter /*= MipFilter::BOX*/,
+                          std::pmr::memory_resource * resource /*= nullptr*/)
+    : storage_(resource)
+{
+    build(base, filter);
+}
+
+//! The current storage is reused if it is large enough.
+//!
+//! @param  base        Base image
+//! @param  filter      Filter used to reduce each level to the next
+template <typename Pixel>
+void MipChain<Pixel>::build(ConstView const & base, MipFilter filter /*= MipFilter::BOX*/)
+{
+    levels_.clear();
+    filter_ = filter;
+    if (base.empty())
+        return;
+
+    // Lay out the levels
+
+    int    width  = base.width();
+    int    height = base.height();
+    size_t offset = 0;
+    for (;;)
+    {
+        size_t pitch = Bitmap<Pixel>::alignedPitch(width);
+        levels_.push_back(Level{ width, height, pitch, offset });
+        offset += pitch * height;
+        if (width == 1 && height == 1)
+            break;
+        width  = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+
+    // The storage is a contiguous bitmap of bytes. It is split into rows of at most STORAGE_ROW bytes because a width
+    // is limited to an int.
+
+    if (size_t(storage_.width()) * storage_.height() < offset)
+    {
+        size_t const rows  = (offset + STORAGE_ROW - 1) / STORAGE_ROW;
+        size_t const align = Bitmap<uint8_t>::ROW_ALIGNMENT;
+        size_t const width = ((offset + rows - 1) / rows + align - 1) / align * align;
+        storage_ = Bitmap<uint8_t>(int(width), int(rows), 0, nullptr, storage_.resource());
+    }
+
+    // Copy each row of the base image and reduce the levels below it as soon as possible
+
+    View   level0 = level(0);
+    size_t size   = base.width() * sizeof(Pixel);
+    for (int y = 0; y < base.height(); ++y)
+    {
+        memcpy(level0.row(y), base.row(y), size);
+        reduce(0, y);
+    }
+}
+
+//! @param  i   Level
+//!
+//! @return     view of the level
+template <typename Pixel>
+typename MipChain<Pixel>::ConstView MipChain<Pixel>::level(int i) const
+{
+    assert(i >= 0 && i < levels());
+    Level const & l = levels_[i];
+    return ConstView(l.width, l.height, l.pitch, reinterpret_cast<Pixel const *>(storage_.data() + l.offset));
+}
+
+//! @param  i   Level
+//!
+//! @return     view of the level
+template <typename Pixel>
+typename MipChain<Pixel>::View MipChain<Pixel>::level(int i)
+{
+    assert(i >= 0 && i < levels());
+    Level const & l = levels_[i];
+    return View(l.width, l.height, l.pitch, reinterpret_cast<Pixel *>(storage_.data() + l.offset));
+}
+
+template <typename Pixel>
+void MipChain<Pixel>::reduce(int i, int y)
+{
+    // Row j of the next level is made from rows 2j and 2j + 1 of this level (or just row 0 if this level has only one
+    // row). It can be made once the second of those rows is complete.
+
+    while (i + 1 < levels())
+    {
+        Level const & src = levels_[i];
+        Level const & dst = levels_[i + 1];
+        int           j   = y / 2;
+        if (j >= dst.height || y != std::min(2 * j + 1, src.height - 1))
+            return;
+
+        View from = level(i);
+        View to   = level(i + 1);
+        reduceRow(from.row(2 * j), from.row(std::min(2 * j + 1, src.height - 1)), src.width, to.row(j), filter_);
+
+        ++i;
+        y = j;
+    }
+}
+
+template <typename Pixel>
+void MipChain<Pixel>::reduceRow(Pixel const * row0, Pixel const * row1, int width, Pixel * dst, MipFilter filter)
+{
+    int constexpr C     = channels();
+    bool const    gamma = filter == MipFilter::GAMMA;
+    int const     count = std::max(width / 2, 1);
+    int           x     = 0;
+
+    if constexpr (C == 0)
+    {
+        // Formats without byte channels are averaged using 8-bit channels
+        for (; x < count; ++x)
+        {
+            int           x1 = std::min(2 * x + 1, width - 1);
+            Pixel const & a  = row0[2 * x];
+            Pixel const & b  = row0[x1];
+            Pixel const & c  = row1[2 * x];
+            Pixel const & d  = row1[x1];
+            dst[x].set8(average(a.red8(), b.red8(), c.red8(), d.red8(), gamma),
+                        average(a.green8(), b.green8(), c.green8(), d.green8(), gamma),
+                        average(a.blue8(), b.blue8(), c.blue8(), d.blue8(), gamma),
+                        average(a.alpha8(), b.alpha8(), c.alpha8(), d.alpha8(), false));
+        }
+    }
+    else
+    {
+        uint8_t const * s0 = reinterpret_cast<uint8_t const *>(row0);
+        uint8_t const * s1 = reinterpret_cast<uint8_t const *>(row1);
+        uint8_t *       d  = reinterpret_cast<uint8_t *>(dst);
+
+#if defined(__SSE2__)
+        if (!gamma)
+        {
+            __m128i const zero = _mm_setzero_si128();
+            __m128i const two  = _mm_set1_epi16(2);
+            if constexpr (C == 4)
+            {
+                // Each step reduces 8 pixels from each row to 4 pixels
+                for (; (x + 4) * 2 <= width; x += 4)
+                {
+                    __m128i pairs[2];
+                    for (int h = 0; h < 2; ++h)
+                    {
+                        __m128i a  = _mm_loadu_si128(reinterpret_cast<__m128i const *>(s0 + x * 8 + h * 16));
+                        __m128i b  = _mm_loadu_si128(reinterpret_cast<__m128i const *>(s1 + x * 8 + h * 16));
+                        __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                        __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                        __m128i s  = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+                        pairs[h] = _mm_srli_epi16(_mm_add_epi16(s, two), 2);
+                    }
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(d + x * 4), _mm_packus_epi16(pairs[0], pairs[1]));
+                }
+            }
+            else if constexpr (C == 1)
+            {
+                // Each step reduces 16 pixels from each row to 8 pixels
+                __m128i const ones = _mm_set1_epi16(1);
+                for (; (x + 8) * 2 <= width; x += 8)
+                {
+                    __m128i a  = _mm_loadu_si128(reinterpret_cast<__m128i const *>(s0 + x * 2));
+                    __m128i b  = _mm_loadu_si128(reinterpret_cast<__m128i const *>(s1 + x * 2));
+                    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                    __m128i s  = _mm_packs_epi32(_mm_madd_epi16(lo, ones), _mm_madd_epi16(hi, ones));
+                    s = _mm_srli_epi16(_mm_add_epi16(s, two), 2);
+                    _mm_storel_epi64(reinterpret_cast<__m128i *>(d + x), _mm_packus_epi16(s, zero));
+                }
+            }
+        }
+#endif
+
+        for (; x < count; ++x)
+        {
+            int x0 = 2 * x * C;
+            int x1 = std::min(2 * x + 1, width - 1) * C;
+            for (int c = 0; c < C; ++c)
+            {
+                d[x * C + c] = average(s0[x0 + c], s0[x1 + c], s1[x0 + c], s1[x1 + c], gamma && c != alphaByte());
+            }
+        }
+    }
+}
+
+template <typename Pixel>
+uint8_t MipChain<Pixel>::average(unsigned a, unsigned b, unsigned c, unsigned d, bool gamma)
+{
+    if (!gamma)
+        return uint8_t((a + b + c + d + 2) >> 2);
+    return fromLinear((toLinear(a) + toLinear(b) + toLinear(c) + toLinear(d) + 2) >> 2);
+}
+
+template <typename Pixel>
+uint16_t MipChain<Pixel>::toLinear(unsigned value)
+{
+    static uint16_t const * const TABLE = [] {
+        static uint16_t table[256];
+        for (int i = 0; i < 256; ++i)
+        {
+            double v = i / 255.0;
+            v = (v <= 0.04045) ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4);
+            table[i] = uint16_t(std::lround(v * 65535.0));
+        }
+        return table;
+    }();
+    return TABLE[value];
+}
+
+template <typename Pixel>
+uint8_t MipChain<Pixel>::fromLinear(unsigned value)
+{
+    static uint8_t const * const TABLE = [] {
+        static uint8_t table[65536];
+        for (int i = 0; i < 65536; ++i)
+        {
+            double v = i / 65535.0;
+            v = (v <= 0.0031308) ? v * 12.92 : 1.055 * std::pow(v, 1.0 / 2.4) - 0.055;
+            table[i] = uint8_t(std::lround(v * 255.0));
+        }
+        return table;
+    }();
+    return TABLE[value];
+}
+
+#endif // !defined(BITMAP_MIPCHAIN_H)
@@ -4,10 +4,94 @@
 #pragma once
 
 #include "Pixel.h"
+#include "Simd.h"
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+//! An index of palette entries for finding entries by color.
+//!
+//! Exact matches are found with a hash of the entries' raw values. Nearest matches are found with a grid of cells over
+//! RGB space, each listing only the entries that could be nearest to a color in the cell, so a search typically checks
+//! a few entries rather than all of them.
+class PaletteIndex
+{
+public:
+
+    static int constexpr MAX_ENTRIES = 256;     //!< Maximum number of entries in an index
+
+    //! Constructor.
+    PaletteIndex(uint32_t const * keys, uint8_t const (*colors)[3], int count);
+
+    //! Returns the index of the first entry with a raw value, or -1 if there is none.
+    int find(uint32_t key) const
+    {
+        for (int slot = slotOf(key); slots_[slot] >= 0; slot = (slot + 1) & (HASH_SIZE - 1))
+        {
+            if (keys_[slots_[slot]] == key)
+                return slots_[slot];
+        }
+        return -1;
+    }
+
+    //! Returns the index of the first of the entries nearest to a color.
+    uint8_t nearest(uint8_t r, uint8_t g, uint8_t b) const
+    {
+        int const cell         = ((r >> CELL_SHIFT) << (2 * GRID_BITS)) |
+                                 ((g >> CELL_SHIFT) << GRID_BITS) |
+                                 (b >> CELL_SHIFT);
+        int       best         = 0;
+        int       bestDistance = INT32_MAX;
+        for (uint32_t i = starts_[cell]; i < starts_[cell + 1] && candidates_[i].distance <= bestDistance; ++i)
+        {
+            int const entry    = candidates_[i].entry;
+            int const dr       = r - colors_[entry][0];
+            int const dg       = g - colors_[entry][1];
+            int const db       = b - colors_[entry][2];
+            int const distance = dr * dr + dg * dg + db * db;
+            if (distance < bestDistance || (distance == bestDistance && entry < best))
+            {
+                best         = entry;
+                bestDistance = distance;
+            }
+        }
+        return uint8_t(best);
+    }
+
+private:
+
+    static int constexpr HASH_BITS  = 9;                            // Number of bits in a hash
+    static int constexpr HASH_SIZE  = 1 << HASH_BITS;               // Number of slots in the hash table
+    static int constexpr GRID_BITS  = 3;                            // Number of bits of each channel that select a cell
+    static int constexpr GRID_CELLS = 1 << (3 * GRID_BITS);         // Number of cells in the grid
+    static int constexpr CELL_SHIFT = 8 - GRID_BITS;                // Number of bits of each channel within a cell
+
+    // Returns the first slot to search for a raw value
+    static int slotOf(uint32_t key) { return int((key * 2654435761u) >> (32 - HASH_BITS)); }
+
+    // An entry that could be nearest to a color in a cell
+    struct Candidate
+    {
+        int distance;   // Square of the distance from the entry to the nearest point in the cell
+        int entry;      // Index of the entry
+    };
+
+    int16_t                slots_[HASH_SIZE];       // Hash table of entries, or -1 if a slot is empty
+    uint32_t               keys_[MAX_ENTRIES];      // Raw values of the entries
+    uint8_t                colors_[MAX_ENTRIES][3]; // Entries (red, green, blue)
+    uint32_t               starts_[GRID_CELLS + 1]; // Start of each cell's candidates
+    std::vector<Candidate> candidates_;             // Entries that could be nearest in each cell, nearest first
+};
 
 //! A palette type.
+//!
+//! Looking up entries by color uses a PaletteIndex, which is built on demand and discarded by any non-const access
+//! to the entries. The index is discarded when the access is made, not when an entry is written, so pointers and
+//! references returned by entries() and operator [] must not be kept across lookups. Copies of a palette share its
+//! index.
 template <class Entry>
 class Palette
 {
@@ -29,16 +113,42 @@ public:
         memcpy(entries_, pData, sizeof entries_);
     }
 
+    //! Copy constructor.
+    Palette(Palette const & rhs)
+        : index_(std::atomic_load(&rhs.index_))
+    {
+        memcpy(entries_, rhs.entries_, sizeof entries_);
+    }
+
+    //! Assignment operator
+    Palette & operator =(Palette const & rhs)
+    {
+        if (this != &rhs)
+        {
+            memcpy(entries_, rhs.entries_, sizeof entries_);
+            index_ = std::atomic_load(&rhs.index_);
+        }
+        return *this;
+    }
+
     //! Returns a pointer to the palette data
     Entry const * entries() const { return entries_; }
 
     //! Returns a pointer to the palette data
-    Entry * entries() { return entries_; }
+    //!
+    //! @note   The index is discarded, since the entries may be changed through the pointer. It is discarded only by
+    //!         this call, so the pointer must not be kept to change entries after a lookup (find() or nearest()), or
+    //!         the lookups will use the old entries. Call entries() again instead.
+    Entry * entries() { index_.reset(); return entries_; }
 
     //! Operator []
+    //!
+    //! @note   The index is discarded, since the entry may be changed through the reference. As with entries(), the
+    //!         reference must not be kept to change the entry after a lookup.
     Entry & operator [](int entry)
     {
         assert(entry >= 0 && entry < PALETTE_SIZE);
+        index_.reset();
         return entries_[entry];
     }
 
@@ -49,15 +159,275 @@ public:
         return entries_[entry];
     }
 
+    //! Replaces indexes with their palette entries.
+    void expand(int width, int height, uint8_t const * src, size_t srcPitch, Entry * dst, size_t dstPitch) const;
+
+    //! Returns the index of the first entry equal to a color, or -1 if there is none.
+    int find(Entry const & color) const { return index()->find(uint32_t(color.raw())); }
+
+    //! Returns the index of the first entry equal to a color, or else the first of the nearest entries.
+    uint8_t nearest(Entry const & color) const;
+
+    //! Returns the index of the first of the entries nearest to a color.
+    uint8_t nearest(uint8_t r, uint8_t g, uint8_t b) const { return index()->nearest(r, g, b); }
+
+    //! Returns the index of the entries, building it if necessary.
+    std::shared_ptr<PaletteIndex const> index() const;
+
 private:
 
-    Entry entries_[PALETTE_SIZE];      // Palette data
+#if defined(BITMAP_SSSE3)
+    // Expands a row using byte shuffles for runs of 16 indexes below 16, and returns the number of pixels expanded
+    BITMAP_TARGET_SSSE3 int expandRowSsse3(int width, uint8_t const * src, Entry * dst, __m128i const * planes) const;
+
+    // Expands 16 indexes below 16 using the bytes of the first 16 entries
+    BITMAP_TARGET_SSSE3 static void lookup16(__m128i indexes, Entry * dst, __m128i const * planes);
+#endif
+
+#if defined(BITMAP_AVX2)
+    // Expands a row using byte shuffles for runs of 16 indexes below 16 and gathers for the rest, and returns the
+    // number of pixels expanded
+    BITMAP_TARGET_AVX2 static int expandRowAvx2(int             width,
+                                                uint8_t const * src,
+                                                Entry *         dst,
+                                                int32_t const * table,
+                                                __m128i const * planes);
+#endif
+
+    Entry                                       entries_[PALETTE_SIZE]; // Palette data
+    mutable std::shared_ptr<PaletteIndex const> index_;                 // Index of the entries, or null if not built
 };
 
+//! Nearest entries are found by red, green and blue only, but an exact match must also match alpha.
+//!
+//! @param  color   Color to find
+template <class Entry>
+uint8_t Palette<Entry>::nearest(Entry const & color) const
+{
+    std::shared_ptr<PaletteIndex const> const index = this->index();
+    int const                                 exact = index->find(uint32_t(color.raw()));
+    return (exact >= 0) ? uint8_t(exact) : index->nearest(color.red8(), color.green8(), color.blue8());
+}
+
+//! The index is built on the first call after the palette is created or changed. It may be built by several threads
+//! at once, but all of them build the same index. Callers making many lookups should keep the returned index rather
+//! than calling find() or nearest() for each one.
+template <class Entry>
+std::shared_ptr<PaletteIndex const> Palette<Entry>::index() const
+{
+    std::shared_ptr<PaletteIndex const> index = std::atomic_load(&index_);
+    if (!index)
+    {
+        uint32_t keys[PALETTE_SIZE];
+        uint8_t  colors[PALETTE_SIZE][3];
+        for (size_t i = 0; i < PALETTE_SIZE; ++i)
+        {
+            keys[i]      = uint32_t(entries_[i].raw());
+            colors[i][0] = entries_[i].red8();
+            colors[i][1] = entries_[i].green8();
+            colors[i][2] = entries_[i].blue8();
+        }
+        index = std::make_shared<PaletteIndex const>(keys, colors, int(PALETTE_SIZE));
+        std::atomic_store(&index_, index);
+    }
+    return index;
+}
+
+//! The expansion is vectorized for 2, 3 and 4-byte entries with SSSE3 or AVX2, when the processor supports them. Runs
+//! of 16 indexes below 16 (as in images converted from 4-bit formats) are looked up with byte shuffles of the first 16
+//! entries. With AVX2, other indexes are looked up with gathers. The 2 and 3-byte entries are first widened into a
+//! 32-bit table, so that every gather stays within the table.
+//!
+//! @param  width       Width of the image (in pixels)
+//! @param  height      Height of the image (in pixels)
+//! @param  src         Indexes
+//! @param  srcPitch    Pitch of the indexes (in bytes)
+//! @param  dst         Where to put the expanded pixels
+//! @param  dstPitch    Pitch of the expanded pixels (in bytes)
+template <class Entry>
+void Palette<Entry>::expand(int width, int height, uint8_t const * src, size_t srcPitch, Entry * dst, size_t dstPitch) const
+{
+    assert(width >= 0);
+    assert(height >= 0);
+
+#if defined(BITMAP_SSSE3)
+    SimdLevel const level = (ENTRY_SIZE >= 2 && ENTRY_SIZE <= 4) ? simdLevel() : SimdLevel::SCALAR;
+
+    // Byte b of each of the first 16 entries
+    alignas(16) uint8_t planes[4][16] = {};
+    if (level != SimdLevel::SCALAR)
+    {
+        for (size_t i = 0; i < 16; ++i)
+        {
+            uint8_t const * entry = reinterpret_cast<uint8_t const *>(&entries_[i]);
+            for (size_t b = 0; b < ENTRY_SIZE && b < 4; ++b)
+            {
+                planes[b][i] = entry[b];
+            }
+        }
+    }
+#endif
+
+#if defined(BITMAP_AVX2)
+    int32_t const * table = reinterpret_cast<int32_t const *>(entries_);
+    alignas(32) int32_t widened[PALETTE_SIZE];
+    if (level == SimdLevel::AVX2 && ENTRY_SIZE != 4)
+    {
+        for (size_t i = 0; i < PALETTE_SIZE; ++i)
+        {
+            widened[i] = 0;
+            memcpy(&widened[i], &entries_[i], ENTRY_SIZE);
+        }
+        table = widened;
+    }
+#endif
+
+    for (int i = 0; i < height; ++i)
+    {
+        int j = 0;
+#if defined(BITMAP_AVX2)
+        if (level == SimdLevel::AVX2)
+            j = expandRowAvx2(width, src, dst, table, reinterpret_cast<__m128i const *>(planes));
+#endif
+#if defined(BITMAP_SSSE3)
+        if (level == SimdLevel::SSSE3)
+            j = expandRowSsse3(width, src, dst, reinterpret_cast<__m128i const *>(planes));
+#endif
+        for (; j < width; ++j)
+        {
+            dst[j] = entries_[src[j]];
+        }
+        src += srcPitch;
+        dst  = reinterpret_cast<Entry *>(reinterpret_cast<char *>(dst) + dstPitch);
+    }
+}
+
+#if defined(BITMAP_SSSE3)
+template <class Entry>
+BITMAP_TARGET_SSSE3 int Palette<Entry>::expandRowSsse3(int             width,
+                                                       uint8_t const * src,
+                                                       Entry *         dst,
+                                                       __m128i const * planes) const
+{
+    // The 3-byte stores overlap the following pixels, so there must be at least 2 more pixels after each group of 16
+
+    int const     reserve = (ENTRY_SIZE == 3) ? 18 : 16;
+    __m128i const high    = _mm_set1_epi8(char(0xf0));
+    int           j       = 0;
+    for (; j + reserve <= width; j += 16)
+    {
+        __m128i const indexes = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + j));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(indexes, high), _mm_setzero_si128())) == 0xffff)
+        {
+            lookup16(indexes, dst + j, planes);
+            continue;
+        }
+        for (int k = 0; k < 16; ++k)
+        {
+            dst[j + k] = entries_[src[j + k]];
+        }
+    }
+    return j;
+}
+
+template <class Entry>
+BITMAP_TARGET_SSSE3 void Palette<Entry>::lookup16(__m128i indexes, Entry * dst, __m128i const * planes)
+{
+    // Each byte of the 16 entries is looked up separately, and the bytes are interleaved into pixels
+
+    __m128i * const d  = reinterpret_cast<__m128i *>(dst);
+    __m128i const   b0 = _mm_shuffle_epi8(_mm_load_si128(planes), indexes);
+    __m128i const   b1 = _mm_shuffle_epi8(_mm_load_si128(planes + 1), indexes);
+    if (ENTRY_SIZE == 2)
+    {
+        _mm_storeu_si128(d, _mm_unpacklo_epi8(b0, b1));
+        _mm_storeu_si128(d + 1, _mm_unpackhi_epi8(b0, b1));
+        return;
+    }
+
+    __m128i const b2 = _mm_shuffle_epi8(_mm_load_si128(planes + 2), indexes);
+    __m128i const b3 = _mm_shuffle_epi8(_mm_load_si128(planes + 3), indexes);
+    __m128i const lo = _mm_unpacklo_epi8(b0, b1);
+    __m128i const hi = _mm_unpackhi_epi8(b0, b1);
+    __m128i const p0 = _mm_unpacklo_epi16(lo, _mm_unpacklo_epi8(b2, b3));
+    __m128i const p1 = _mm_unpackhi_epi16(lo, _mm_unpacklo_epi8(b2, b3));
+    __m128i const p2 = _mm_unpacklo_epi16(hi, _mm_unpackhi_epi8(b2, b3));
+    __m128i const p3 = _mm_unpackhi_epi16(hi, _mm_unpackhi_epi8(b2, b3));
+    if (ENTRY_SIZE == 4)
+    {
+        _mm_storeu_si128(d, p0);
+        _mm_storeu_si128(d + 1, p1);
+        _mm_storeu_si128(d + 2, p2);
+        _mm_storeu_si128(d + 3, p3);
+        return;
+    }
+
+    // Each group of 4 pixels is packed into the low 12 bytes, and the 16-byte stores overlap the next group
+    __m128i const pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    char * const  c    = reinterpret_cast<char *>(dst);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(c), _mm_shuffle_epi8(p0, pack));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(c + 12), _mm_shuffle_epi8(p1, pack));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(c + 24), _mm_shuffle_epi8(p2, pack));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(c + 36), _mm_shuffle_epi8(p3, pack));
+}
+#endif // defined(BITMAP_SSSE3)
+
+#if defined(BITMAP_AVX2)
+template <class Entry>
+BITMAP_TARGET_AVX2 int Palette<Entry>::expandRowAvx2(int             width,
+                                                     uint8_t const * src,
+                                                     Entry *         dst,
+                                                     int32_t const * table,
+                                                     __m128i const * planes)
+{
+    // The 3-byte stores overlap the following pixels, so there must be at least 2 more pixels after each group of 16
+
+    int const     reserve = (ENTRY_SIZE == 3) ? 18 : 16;
+    __m128i const high    = _mm_set1_epi8(char(0xf0));
+    __m256i const pack    = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                             0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    int           j       = 0;
+    for (; j + reserve <= width; j += 16)
+    {
+        __m128i const indexes = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + j));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(indexes, high), _mm_setzero_si128())) == 0xffff)
+        {
+            lookup16(indexes, dst + j, planes);
+            continue;
+        }
+
+        __m256i const lo = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(indexes), 4);
+        __m256i const hi = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(_mm_srli_si128(indexes, 8)), 4);
+        if (ENTRY_SIZE == 4)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + j), lo);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + j + 8), hi);
+        }
+        else if (ENTRY_SIZE == 2)
+        {
+            __m256i const pixels = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xd8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + j), pixels);
+        }
+        else
+        {
+            // Each 128-bit lane packs 4 pixels into its low 12 bytes, and the 16-byte stores overlap the next group
+            char * const  d  = reinterpret_cast<char *>(dst + j);
+            __m256i const p0 = _mm256_shuffle_epi8(lo, pack);
+            __m256i const p1 = _mm256_shuffle_epi8(hi, pack);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(d), _mm256_castsi256_si128(p0));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(d + 12), _mm256_extracti128_si256(p0, 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(d + 24), _mm256_castsi256_si128(p1));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(d + 36), _mm256_extracti128_si256(p1, 1));
+        }
+    }
+    return j;
+}
+#endif // defined(BITMAP_AVX2)
+
 // Types defined for convenience
 
 using Palette1555 = Palette<Pixel1555>;
-using Palette565  = Palette<Pixel1555>;
+using Palette565  = Palette<Pixel565>;
 using PaletteRGB  = Palette<PixelRGB>;
 using PaletteBGR  = Palette<PixelBGR>;
 using PaletteARGB = Palette<PixelARGB>;
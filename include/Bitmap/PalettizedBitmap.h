@@ -4,10 +4,19 @@
 #pragma once
 
 #include "Bitmap.h"
+#include "BitmapView.h"
 #include "Palette.h"
+#include <atomic>
+#include <cassert>
 #include <cstdint>
+#include <memory>
+#include <utility>
 
 //! A bitmap with a palette.
+//!
+//! The bitmap has a palette version, which changes whenever the palette or the whole image may have changed, so that
+//! copies of its pixels in other colors (see TileCache) can tell when they are out of date. Versions are never reused
+//! by another bitmap of the same type.
 template <class Color>
 class PalettizedBitmap : public Bitmap<uint8_t>
 {
@@ -19,51 +28,100 @@ public:
     PalettizedBitmap() = default;
 
     //! Constructor.
-    PalettizedBitmap(int w, int h);
+    explicit PalettizedBitmap(std::pmr::memory_resource * resource);
+
+    //! Constructor.
+    PalettizedBitmap(int w, int h, std::pmr::memory_resource * resource = nullptr);
 
     //! Constructor.
-    PalettizedBitmap(int w, int h, Palette<Color> const & palette);
+    PalettizedBitmap(int w, int h, Palette<Color> const & palette, std::pmr::memory_resource * resource = nullptr);
 
     //! Constructor.
-    PalettizedBitmap(int w, int h, uint8_t * data, Palette<Color> const & palette);
+    PalettizedBitmap(int                         w,
+                     int                         h,
+                     uint8_t *                   data,
+                     Palette<Color> const &      palette,
+                     std::pmr::memory_resource * resource = nullptr);
+
+    //! Copy constructor.
+    PalettizedBitmap(PalettizedBitmap const & rhs);
+
+    //! Move constructor.
+    PalettizedBitmap(PalettizedBitmap && rhs);
+
+    //! Assignment operator
+    PalettizedBitmap & operator =(PalettizedBitmap const & rhs);
+
+    //! Move assignment operator
+    PalettizedBitmap & operator =(PalettizedBitmap && rhs);
 
     //! Loads a bitmap
     void load(int w, int h, uint8_t const * data, Palette<Color> const & palette);
 
-    //! References a memory buffer
-    void reference(int w, int h, uint8_t * data, Palette<Color> const & palette);
-
     //! Returns the palette
     Palette<Color> palette() const { return palette_; }
 
     //! Returns the palette
-    Palette<Color> & palette() { return palette_; }
+    //!
+    //! @note   The palette version is changed, since the palette may be changed through the reference.
+    Palette<Color> & palette() { paletteVersion_ = nextVersion(); return palette_; }
 
     //! Sets the palette
-    void setPalette(Palette<Color> const & palette) { palette_ = palette; }
+    void setPalette(Palette<Color> const & palette) { palette_ = palette; paletteVersion_ = nextVersion(); }
+
+    //! Returns the palette version
+    uint64_t paletteVersion() const { return paletteVersion_; }
 
     //! Creates a non-palettized bitmap from a region of this bitmap.
     Bitmap<Color> decompressedRegion(int x, int y, int width, int height, int pitch = 0) const;
 
+    //! Sets a pixel to the palette entry equal to a color, or else the nearest entry.
+    void setColor(int x, int y, Color const & color);
+
+    //! Sets a region of pixels to the palette entries equal to the colors of an image, or else the nearest entries.
+    void setColors(int x, int y, BitmapView<Color const> const & src);
+
 private:
 
-    Palette<Color> palette_;        // The palette
+    using BaseClass = Bitmap<uint8_t>;
+
+    // Returns a palette version that has not been used before
+    static uint64_t nextVersion()
+    {
+        static std::atomic<uint64_t> counter{ 0 };
+        return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    Palette<Color> palette_;                        // The palette
+    uint64_t       paletteVersion_ = nextVersion(); // Changes whenever the palette may have changed
 };
 
+//! @param 	resource    Source of image data, or nullptr for the default resource
+template <class Color>
+PalettizedBitmap<Color>::PalettizedBitmap(std::pmr::memory_resource * resource)
+    : BaseClass(resource)
+{
+}
+
 //! @param 	w
 //! @param 	h
+//! @param 	resource    Source of image data, or nullptr for the default resource
 template <class Color>
-PalettizedBitmap<Color>::PalettizedBitmap(int w, int h)
-    : BaseClass(w, h)
+PalettizedBitmap<Color>::PalettizedBitmap(int w, int h, std::pmr::memory_resource * resource /*= nullptr*/)
+    : BaseClass(w, h, 0, nullptr, resource)
 {
 }
 
 //! @param 	w
 //! @param 	h
 //! @param 	palette
+//! @param 	resource    Source of image data, or nullptr for the default resource
 template <class Color>
-PalettizedBitmap<Color>::PalettizedBitmap(int w, int h, Palette<Color> const & palette)
-    : BaseClass(w, h)
+PalettizedBitmap<Color>::PalettizedBitmap(int                         w,
+                                          int                         h,
+                                          Palette<Color> const &      palette,
+                                          std::pmr::memory_resource * resource /*= nullptr*/)
+    : BaseClass(w, h, 0, nullptr, resource)
     , palette_(palette)
 {
 }
@@ -72,13 +130,68 @@ PalettizedBitmap<Color>::PalettizedBitmap(int w, int h, Palette<Color> const & p
 //! @param 	h
 //! @param 	data
 //! @param 	palette
+//! @param 	resource    Source of image data, or nullptr for the default resource
 template <class Color>
-PalettizedBitmap<Color>::PalettizedBitmap(int w, int h, uint8_t * data, Palette<Color> const & palette)
-    : BaseClass(w, h, 0, data)
+PalettizedBitmap<Color>::PalettizedBitmap(int                         w,
+                                          int                         h,
+                                          uint8_t *                   data,
+                                          Palette<Color> const &      palette,
+                                          std::pmr::memory_resource * resource /*= nullptr*/)
+    : BaseClass(w, h, 0, data, resource)
     , palette_(palette)
 {
 }
 
+//! The copy has its own palette version, since it may be changed independently of the original.
+//!
+//! @param  rhs         Bitmap to copy
+template <class Color>
+PalettizedBitmap<Color>::PalettizedBitmap(PalettizedBitmap const & rhs)
+    : BaseClass(rhs)
+    , palette_(rhs.palette_)
+{
+}
+
+//! Both bitmaps are given new palette versions, since the contents of both have changed.
+//!
+//! @param  rhs         Bitmap to move
+template <class Color>
+PalettizedBitmap<Color>::PalettizedBitmap(PalettizedBitmap && rhs)
+    : BaseClass(std::move(rhs))
+    , palette_(std::move(rhs.palette_))
+{
+    rhs.paletteVersion_ = nextVersion();
+}
+
+//! The bitmap is given a new palette version rather than that of rhs, so that copies of its pixels made before the
+//! assignment are out of date, even if rhs was itself copied from this bitmap.
+//!
+//! @param  rhs         Bitmap to copy
+template <class Color>
+PalettizedBitmap<Color> & PalettizedBitmap<Color>::operator =(PalettizedBitmap const & rhs)
+{
+    BaseClass::operator =(rhs);
+    palette_        = rhs.palette_;
+    paletteVersion_ = nextVersion();
+    return *this;
+}
+
+//! Both bitmaps are given new palette versions, since the contents of both have changed.
+//!
+//! @param  rhs         Bitmap to move
+template <class Color>
+PalettizedBitmap<Color> & PalettizedBitmap<Color>::operator =(PalettizedBitmap && rhs)
+{
+    if (this == &rhs)
+        return *this;
+
+    BaseClass::operator =(std::move(rhs));
+    palette_            = std::move(rhs.palette_);
+    paletteVersion_     = nextVersion();
+    rhs.paletteVersion_ = nextVersion();
+    return *this;
+}
+
 //! @param 	w
 //! @param 	h
 //! @param 	data
@@ -87,18 +200,12 @@ template <class Color>
 void PalettizedBitmap<Color>::load(int w, int h, uint8_t const * data, Palette<Color> const & palette)
 {
     BaseClass::load(w, h, 0, data);
-    palette_ = palette;
-}
-
-#if 0
-template <class Color>
-void PalettizedBitmap<Color>::reference(int w, int h, uint8_t * data, Palette<Color> const & palette)
-{
-    BaseClass::reference(w, h, 0, data);
-    palette_ = palette;
+    palette_        = palette;
+    paletteVersion_ = nextVersion();
 }
-#endif
 
+//! The region is clipped to the bounds of the bitmap.
+//!
 //! @param 	x       Location of the region
 //! @param 	y       Location of the region
 //! @param 	width   Width of the region
@@ -109,19 +216,63 @@ void PalettizedBitmap<Color>::reference(int w, int h, uint8_t * data, Palette<Co
 template <class Color>
 Bitmap<Color> PalettizedBitmap<Color>::decompressedRegion(int x, int y, int width, int height, int pitch /*= 0*/) const
 {
-    Rect clipped(0, 0, width_, height_);
-    clipped.clip(x, y, width, height);
-    Bitmap<Color>  region(clipped.width, clipped.height, pitch);
-    uint8_t const * src = data(clipped.x, clipped.y);
-    Color *        dst = region.data();
-    for (int i = 0; i < height; ++i)
+    Rect clipped{ 0, 0, width_, height_ };
+    clipped.clip(Rect{ x, y, width, height });
+    if (clipped.width <= 0 || clipped.height <= 0)
+        return Bitmap<Color>();
+
+    Bitmap<Color> region(clipped.width, clipped.height, pitch);
+    palette_.expand(clipped.width, clipped.height, data(clipped.x, clipped.y), pitch_, region.data(), region.pitch());
+    return region;
+}
+
+//! @param 	x       Location of the pixel
+//! @param 	y       Location of the pixel
+//! @param 	color   Color of the pixel
+template <class Color>
+void PalettizedBitmap<Color>::setColor(int x, int y, Color const & color)
+{
+    assert(x >= 0 && x < width_);
+    assert(y >= 0 && y < height_);
+    *data(x, y) = palette_.nearest(color);
+}
+
+//! The image is clipped to the bounds of the bitmap. Each pixel is looked up in the palette's index, except for pixels
+//! equal to the one before.
+//!
+//! @param 	x       Location of the image in this bitmap
+//! @param 	y       Location of the image in this bitmap
+//! @param 	src     True-color image
+template <class Color>
+void PalettizedBitmap<Color>::setColors(int x, int y, BitmapView<Color const> const & src)
+{
+    Rect clipped{ 0, 0, width_, height_ };
+    clipped.clip(Rect{ x, y, src.width(), src.height() });
+    if (clipped.width <= 0 || clipped.height <= 0)
+        return;
+
+    std::shared_ptr<PaletteIndex const> const index  = palette_.index();
+    auto const                                lookup = [&index] (Color const & color) {
+        int const exact = index->find(uint32_t(color.raw()));
+        return (exact >= 0) ? uint8_t(exact) : index->nearest(color.red8(), color.green8(), color.blue8());
+    };
+
+    for (int i = 0; i < clipped.height; ++i)
     {
-        for (int j = 0; j < width; ++j)
+        Color const * s        = src.data(clipped.x - x, clipped.y - y + i);
+        uint8_t *     d        = data(clipped.x, clipped.y + i);
+        uint32_t      previous = uint32_t(s[0].raw());
+        uint8_t       entry    = lookup(s[0]);
+        for (int j = 0; j < clipped.width; ++j)
         {
-            dst[j] = palette_[src[j]];
+            uint32_t const key = uint32_t(s[j].raw());
+            if (key != previous)
+            {
+                entry    = lookup(s[j]);
+                previous = key;
+            }
+            d[j] = entry;
         }
-        dst  = reinterpret_cast<Color *>(reinterpret_cast<char *>(dst) + region.pitch());
-        src += pitch_;
     }
 }
 
@@ -0,0 +1,78 @@
+#if !defined(BITMAP_PARALLEL_H)
+#define BITMAP_PARALLEL_H
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//! How an operation on a bitmap is executed.
+enum class Execution
+{
+    SEQUENTIAL,     //!< On the calling thread
+    PARALLEL        //!< Split into row bands processed by the shared thread pool, if the operation is large enough
+};
+
+//! A fixed set of worker threads that run tasks on behalf of callers.
+//!
+//! The calling thread takes part in the work, so tasks may themselves call run() without deadlocking.
+class ThreadPool
+{
+public:
+
+    //! Constructor.
+    explicit ThreadPool(int threads = 0);
+
+    //! Destructor.
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const &) = delete;
+    ThreadPool & operator =(ThreadPool const &) = delete;
+
+    //! Returns the number of threads doing work, including the calling thread.
+    int size() const { return int(workers_.size()) + 1; }
+
+    //! Calls task(i) for each i in [0, count) and returns when all calls have completed.
+    void run(int count, std::function<void(int)> const & task);
+
+    //! Returns the thread pool shared by all bitmaps.
+    static ThreadPool & shared();
+
+private:
+
+    // A call to run() in progress
+    struct Job
+    {
+        std::function<void(int)> const * task;  // Task to run
+        int count;                              // Number of calls to make
+        int next;                               // Index of the next call to start
+        int finished;                           // Number of calls that have completed
+    };
+
+    // Runs the tasks of queued jobs until the pool is stopped
+    void work();
+
+    // Returns the index of the next call to make for a job and removes the job from the queue once all calls have
+    // started. The mutex must be held.
+    int claim(Job * job);
+
+    std::vector<std::thread> workers_;  // Worker threads
+    std::deque<Job *> jobs_;            // Jobs with calls that have not started
+    std::mutex mutex_;                  // Guards jobs_, stop_ and the progress of every job
+    std::condition_variable queued_;    // Signaled when a job is queued or the pool is stopped
+    std::condition_variable finished_;  // Signaled when a job completes
+    bool stop_ = false;                 // If true, the workers exit
+};
+
+//! Smallest amount of image data (in bytes) worth processing on a separate thread.
+size_t constexpr PARALLEL_MIN_BAND_SIZE = 256 * 1024;
+
+//! Divides rows into contiguous bands and calls f(begin, end) for each band.
+void forEachBand(Execution execution, int rows, size_t rowSize, std::function<void(int begin, int end)> const & f);
+
+#endif // !defined(BITMAP_PARALLEL_H)
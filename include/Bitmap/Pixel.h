@@ -8,6 +8,20 @@
 //! 8-bit pixel.
 using Pixel8 = uint8_t;
 
+//! Number of bits set in a mask.
+template <unsigned MASK>
+struct MaskBits
+{
+    static int constexpr VALUE = int(MASK & 1) + MaskBits<(MASK >> 1)>::VALUE; //!< Number of bits set
+};
+
+//! Number of bits set in a mask.
+template <>
+struct MaskBits<0>
+{
+    static int constexpr VALUE = 0; //!< Number of bits set
+};
+
 //! 16-bit pixel.
 template <int ALPHA_MASK, int RED_MASK, int GREEN_MASK, int BLUE_MASK,
           int ALPHA_OFF, int RED_OFF, int GREEN_OFF, int BLUE_OFF>
@@ -15,6 +29,31 @@ class Pixel16
 {
 public:
 
+    // Format descriptors
+
+    static bool constexpr BYTE_CHANNELS = false;                            //!< True if every channel is a separate byte
+    static bool constexpr HAS_ALPHA     = ALPHA_MASK != 0;                  //!< True if the format has an alpha channel
+
+    static unsigned constexpr RED_MAX   = RED_MASK;                         //!< Maximum red value
+    static unsigned constexpr GREEN_MAX = GREEN_MASK;                       //!< Maximum green value
+    static unsigned constexpr BLUE_MAX  = BLUE_MASK;                        //!< Maximum blue value
+    static unsigned constexpr ALPHA_MAX = ALPHA_MASK;                       //!< Maximum alpha value (0 if not supported)
+
+    static int constexpr RED_BITS   = MaskBits<RED_MASK>::VALUE;            //!< Width of the red field (in bits)
+    static int constexpr GREEN_BITS = MaskBits<GREEN_MASK>::VALUE;          //!< Width of the green field (in bits)
+    static int constexpr BLUE_BITS  = MaskBits<BLUE_MASK>::VALUE;           //!< Width of the blue field (in bits)
+    static int constexpr ALPHA_BITS = MaskBits<ALPHA_MASK>::VALUE;          //!< Width of the alpha field (in bits)
+
+    static int constexpr RED_SHIFT   = RED_OFF;                             //!< Offset of the red field (in bits)
+    static int constexpr GREEN_SHIFT = GREEN_OFF;                           //!< Offset of the green field (in bits)
+    static int constexpr BLUE_SHIFT  = BLUE_OFF;                            //!< Offset of the blue field (in bits)
+    static int constexpr ALPHA_SHIFT = ALPHA_OFF;                           //!< Offset of the alpha field (in bits)
+
+    static unsigned constexpr RED_FIELD   = unsigned(RED_MASK) << RED_OFF;      //!< Red field in the raw value
+    static unsigned constexpr GREEN_FIELD = unsigned(GREEN_MASK) << GREEN_OFF;  //!< Green field in the raw value
+    static unsigned constexpr BLUE_FIELD  = unsigned(BLUE_MASK) << BLUE_OFF;    //!< Blue field in the raw value
+    static unsigned constexpr ALPHA_FIELD = unsigned(ALPHA_MASK) << ALPHA_OFF;  //!< Alpha field in the raw value
+
     //! Constructor.
     Pixel16() = default;
 
@@ -39,38 +78,93 @@ public:
     //! Sets the pixel value.
     void set(float r, float g, float b, float a = 1.0f)
     {
-        value_ =   (uint16_t(r * RED_MASK + .5f) << RED_OFF)
-                 | (uint16_t(r * GREEN_MASK + .5f) << GREEN_OFF)
-                 | (uint16_t(r * BLUE_MASK + .5f) << BLUE_OFF)
-                 | (uint16_t(r * ALPHA_MASK + .5f) << ALPHA_OFF);
+        value_ = uint16_t(  (unsigned(r * RED_MASK + .5f) << RED_OFF)
+                          | (unsigned(g * GREEN_MASK + .5f) << GREEN_OFF)
+                          | (unsigned(b * BLUE_MASK + .5f) << BLUE_OFF)
+                          | (unsigned(a * ALPHA_MASK + .5f) << ALPHA_OFF));
     }
 
     //! Returns the red value.
-    float red() const { return float((value_ >> RED_OFF) & RED_MASK) / float(RED_MASK); }
+    float red() const { return float(redValue()) / float(RED_MASK); }
 
     //! Sets the red value.
-    void setRed(float r) { value_ = (value_ & ~RED_MASK) | (uint16_t(r * RED_MASK + .5f) << RED_OFF); }
+    void setRed(float r) { setRedValue(unsigned(r * RED_MASK + .5f)); }
 
     //! Returns the green value.
-    float green() const { return float((value_ >> GREEN_OFF) & GREEN_MASK) / float(GREEN_MASK); }
+    float green() const { return float(greenValue()) / float(GREEN_MASK); }
 
     //! Sets the green value.
-    void setGreen(float g) { value_ = (value_ & ~GREEN_MASK) | (uint16_t(g * GREEN_MASK + .5f) << GREEN_OFF); }
+    void setGreen(float g) { setGreenValue(unsigned(g * GREEN_MASK + .5f)); }
 
     //! Returns the blue value.
-    float blue() const { return float((value_ >> BLUE_OFF) & BLUE_MASK) / float(BLUE_MASK); }
+    float blue() const { return float(blueValue()) / float(BLUE_MASK); }
 
     //! Sets the blue value.
-    void setBlue(float b) { value_ = (value_ & ~BLUE_MASK) | (uint16_t(b * BLUE_MASK + .5f) << BLUE_OFF); }
+    void setBlue(float b) { setBlueValue(unsigned(b * BLUE_MASK + .5f)); }
 
     //! Returns the alpha value, or 0 if not supported.
-    float alpha() const { return float((value_ >> ALPHA_OFF) & ALPHA_MASK) / float(ALPHA_MASK); }
+    float alpha() const { return HAS_ALPHA ? float(alphaValue()) / float(ALPHA_MASK) : 0.0f; }
 
     //! Sets the alpha value if it is supported.
-    void setAlpha(float a) { value_ = (value_ & ~ALPHA_MASK) | (uint16_t(a * ALPHA_MASK + .5f) << ALPHA_OFF); }
+    void setAlpha(float a) { setAlphaValue(unsigned(a * ALPHA_MASK + .5f)); }
+
+    // Integer access
+
+    //! Returns the red value (0 - RED_MAX).
+    unsigned redValue() const { return (value_ >> RED_OFF) & RED_MASK; }
+
+    //! Sets the red value (0 - RED_MAX).
+    void setRedValue(unsigned r) { value_ = uint16_t((value_ & ~RED_FIELD) | ((r & RED_MASK) << RED_OFF)); }
+
+    //! Returns the green value (0 - GREEN_MAX).
+    unsigned greenValue() const { return (value_ >> GREEN_OFF) & GREEN_MASK; }
+
+    //! Sets the green value (0 - GREEN_MAX).
+    void setGreenValue(unsigned g) { value_ = uint16_t((value_ & ~GREEN_FIELD) | ((g & GREEN_MASK) << GREEN_OFF)); }
+
+    //! Returns the blue value (0 - BLUE_MAX).
+    unsigned blueValue() const { return (value_ >> BLUE_OFF) & BLUE_MASK; }
+
+    //! Sets the blue value (0 - BLUE_MAX).
+    void setBlueValue(unsigned b) { value_ = uint16_t((value_ & ~BLUE_FIELD) | ((b & BLUE_MASK) << BLUE_OFF)); }
+
+    //! Returns the alpha value (0 - ALPHA_MAX), or 0 if not supported.
+    unsigned alphaValue() const { return (value_ >> ALPHA_OFF) & ALPHA_MASK; }
+
+    //! Sets the alpha value (0 - ALPHA_MAX) if it is supported.
+    void setAlphaValue(unsigned a) { value_ = uint16_t((value_ & ~ALPHA_FIELD) | ((a & ALPHA_MASK) << ALPHA_OFF)); }
+
+    //! Returns the red value scaled to 8 bits.
+    uint8_t red8() const { return to8<RED_MASK>(redValue()); }
+
+    //! Returns the green value scaled to 8 bits.
+    uint8_t green8() const { return to8<GREEN_MASK>(greenValue()); }
+
+    //! Returns the blue value scaled to 8 bits.
+    uint8_t blue8() const { return to8<BLUE_MASK>(blueValue()); }
+
+    //! Returns the alpha value scaled to 8 bits, or 0xff if not supported.
+    uint8_t alpha8() const { return HAS_ALPHA ? to8<ALPHA_MASK>(alphaValue()) : uint8_t(0xff); }
+
+    //! Sets the value from 8-bit channels.
+    void set8(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 0xff)
+    {
+        value_ = uint16_t(  (from8<RED_MASK>(r) << RED_OFF)
+                          | (from8<GREEN_MASK>(g) << GREEN_OFF)
+                          | (from8<BLUE_MASK>(b) << BLUE_OFF)
+                          | (from8<ALPHA_MASK>(a) << ALPHA_OFF));
+    }
 
 private:
 
+    // Scales a channel value to 8 bits, rounding to nearest
+    template <unsigned MAX>
+    static uint8_t to8(unsigned v) { return uint8_t((v * 0xff + MAX / 2) / (MAX ? MAX : 1)); }
+
+    // Scales an 8-bit value to a channel value, rounding to nearest
+    template <unsigned MAX>
+    static unsigned from8(uint8_t v) { return (unsigned(v) * MAX + 0x7f) / 0xff; }
+
     uint16_t value_;   // The raw value of the pixel
 };
 
@@ -89,6 +183,26 @@ class Pixel24
 {
 public:
 
+    // Format descriptors
+
+    static bool constexpr BYTE_CHANNELS = true;     //!< True if every channel is a separate byte
+    static bool constexpr HAS_ALPHA     = false;    //!< True if the format has an alpha channel
+
+    static unsigned constexpr RED_MAX   = 0xff;     //!< Maximum red value
+    static unsigned constexpr GREEN_MAX = 0xff;     //!< Maximum green value
+    static unsigned constexpr BLUE_MAX  = 0xff;     //!< Maximum blue value
+    static unsigned constexpr ALPHA_MAX = 0;        //!< Maximum alpha value (0 if not supported)
+
+    static int constexpr RED_BITS   = 8;            //!< Width of the red channel (in bits)
+    static int constexpr GREEN_BITS = 8;            //!< Width of the green channel (in bits)
+    static int constexpr BLUE_BITS  = 8;            //!< Width of the blue channel (in bits)
+    static int constexpr ALPHA_BITS = 0;            //!< Width of the alpha channel (in bits)
+
+    static int constexpr RED_BYTE   = RED_OFF;      //!< Offset of the red channel (in bytes)
+    static int constexpr GREEN_BYTE = GREEN_OFF;    //!< Offset of the green channel (in bytes)
+    static int constexpr BLUE_BYTE  = BLUE_OFF;     //!< Offset of the blue channel (in bytes)
+    static int constexpr ALPHA_BYTE = -1;           //!< Offset of the alpha channel (in bytes), or -1 if not supported
+
     //! Constructor.
     Pixel24() = default;
 
@@ -162,6 +276,52 @@ public:
         value_[BLUE_OFF] = uint8_t(b * 0xff + .5f);
     }
 
+    // Integer access
+
+    //! Returns the red value (0 - RED_MAX).
+    unsigned redValue() const { return value_[RED_OFF]; }
+
+    //! Sets the red value (0 - RED_MAX).
+    void setRedValue(unsigned r) { value_[RED_OFF] = uint8_t(r); }
+
+    //! Returns the green value (0 - GREEN_MAX).
+    unsigned greenValue() const { return value_[GREEN_OFF]; }
+
+    //! Sets the green value (0 - GREEN_MAX).
+    void setGreenValue(unsigned g) { value_[GREEN_OFF] = uint8_t(g); }
+
+    //! Returns the blue value (0 - BLUE_MAX).
+    unsigned blueValue() const { return value_[BLUE_OFF]; }
+
+    //! Sets the blue value (0 - BLUE_MAX).
+    void setBlueValue(unsigned b) { value_[BLUE_OFF] = uint8_t(b); }
+
+    //! Returns 0, since alpha is not supported.
+    unsigned alphaValue() const { return 0; }
+
+    //! Does nothing, since alpha is not supported.
+    void setAlphaValue(unsigned /*a*/) {}
+
+    //! Returns the red value scaled to 8 bits.
+    uint8_t red8() const { return value_[RED_OFF]; }
+
+    //! Returns the green value scaled to 8 bits.
+    uint8_t green8() const { return value_[GREEN_OFF]; }
+
+    //! Returns the blue value scaled to 8 bits.
+    uint8_t blue8() const { return value_[BLUE_OFF]; }
+
+    //! Returns 0xff, since alpha is not supported.
+    uint8_t alpha8() const { return 0xff; }
+
+    //! Sets the value from 8-bit channels.
+    void set8(uint8_t r, uint8_t g, uint8_t b, uint8_t /*a*/ = 0xff)
+    {
+        value_[RED_OFF]   = r;
+        value_[GREEN_OFF] = g;
+        value_[BLUE_OFF]  = b;
+    }
+
 private:
     uint8_t value_[3]; // Component colors
 };
@@ -182,6 +342,29 @@ class Pixel32
 {
 public:
 
+    // Format descriptors
+
+    static bool constexpr BYTE_CHANNELS = true;     //!< True if every channel is a separate byte
+    static bool constexpr HAS_ALPHA     = true;     //!< True if the format has an alpha channel
+
+    static unsigned constexpr RED_MAX   = 0xff;     //!< Maximum red value
+    static unsigned constexpr GREEN_MAX = 0xff;     //!< Maximum green value
+    static unsigned constexpr BLUE_MAX  = 0xff;     //!< Maximum blue value
+    static unsigned constexpr ALPHA_MAX = 0xff;     //!< Maximum alpha value
+
+    static int constexpr RED_BITS   = 8;            //!< Width of the red channel (in bits)
+    static int constexpr GREEN_BITS = 8;            //!< Width of the green channel (in bits)
+    static int constexpr BLUE_BITS  = 8;            //!< Width of the blue channel (in bits)
+    static int constexpr ALPHA_BITS = 8;            //!< Width of the alpha channel (in bits)
+
+    static int constexpr RED_BYTE   = RED_OFF;      //!< Offset of the red channel (in bytes)
+    static int constexpr GREEN_BYTE = GREEN_OFF;    //!< Offset of the green channel (in bytes)
+    static int constexpr BLUE_BYTE  = BLUE_OFF;     //!< Offset of the blue channel (in bytes)
+    static int constexpr ALPHA_BYTE = ALPHA_OFF;    //!< Offset of the alpha channel (in bytes)
+
+    //! Constructor.
+    Pixel32() = default;
+
     //! Constructor.
     //!
     //! @param 	r
@@ -279,6 +462,53 @@ public:
         value_[BLUE_OFF] = uint8_t(b * 0xff + .5f);
     }
 
+    // Integer access
+
+    //! Returns the alpha value (0 - ALPHA_MAX).
+    unsigned alphaValue() const { return value_[ALPHA_OFF]; }
+
+    //! Sets the alpha value (0 - ALPHA_MAX).
+    void setAlphaValue(unsigned a) { value_[ALPHA_OFF] = uint8_t(a); }
+
+    //! Returns the red value (0 - RED_MAX).
+    unsigned redValue() const { return value_[RED_OFF]; }
+
+    //! Sets the red value (0 - RED_MAX).
+    void setRedValue(unsigned r) { value_[RED_OFF] = uint8_t(r); }
+
+    //! Returns the green value (0 - GREEN_MAX).
+    unsigned greenValue() const { return value_[GREEN_OFF]; }
+
+    //! Sets the green value (0 - GREEN_MAX).
+    void setGreenValue(unsigned g) { value_[GREEN_OFF] = uint8_t(g); }
+
+    //! Returns the blue value (0 - BLUE_MAX).
+    unsigned blueValue() const { return value_[BLUE_OFF]; }
+
+    //! Sets the blue value (0 - BLUE_MAX).
+    void setBlueValue(unsigned b) { value_[BLUE_OFF] = uint8_t(b); }
+
+    //! Returns the alpha value scaled to 8 bits.
+    uint8_t alpha8() const { return value_[ALPHA_OFF]; }
+
+    //! Returns the red value scaled to 8 bits.
+    uint8_t red8() const { return value_[RED_OFF]; }
+
+    //! Returns the green value scaled to 8 bits.
+    uint8_t green8() const { return value_[GREEN_OFF]; }
+
+    //! Returns the blue value scaled to 8 bits.
+    uint8_t blue8() const { return value_[BLUE_OFF]; }
+
+    //! Sets the value from 8-bit channels.
+    void set8(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 0xff)
+    {
+        value_[RED_OFF]   = r;
+        value_[GREEN_OFF] = g;
+        value_[BLUE_OFF]  = b;
+        value_[ALPHA_OFF] = a;
+    }
+
 private:
     uint8_t value_[4]; // Component colors
 };
@@ -301,4 +531,38 @@ extern template class Pixel32<3, 2, 1, 0>;
 using PixelABGR = Pixel32<0, 3, 2, 1>;
 extern template class Pixel32<0, 3, 2, 1>;
 
+//! Identifies a pixel format in stored images.
+//!
+//! The values are stored in files, so they must not change.
+enum class PixelFormat : uint32_t
+{
+    UNKNOWN   = 0,  //!< A format not listed here
+    PIXEL8    = 1,  //!< Pixel8 (an 8-bit value or palette index)
+    PIXEL565  = 2,  //!< Pixel565
+    PIXEL1555 = 3,  //!< Pixel1555
+    RGB       = 4,  //!< PixelRGB
+    BGR       = 5,  //!< PixelBGR
+    ARGB      = 6,  //!< PixelARGB
+    RGBA      = 7,  //!< PixelRGBA
+    BGRA      = 8,  //!< PixelBGRA
+    ABGR      = 9   //!< PixelABGR
+};
+
+//! The stored pixel format of a pixel type.
+template <typename Pixel>
+struct PixelFormatOf
+{
+    static PixelFormat constexpr VALUE = PixelFormat::UNKNOWN; //!< Pixel format
+};
+
+template <> struct PixelFormatOf<Pixel8>    { static PixelFormat constexpr VALUE = PixelFormat::PIXEL8; };
+template <> struct PixelFormatOf<Pixel565>  { static PixelFormat constexpr VALUE = PixelFormat::PIXEL565; };
+template <> struct PixelFormatOf<Pixel1555> { static PixelFormat constexpr VALUE = PixelFormat::PIXEL1555; };
+template <> struct PixelFormatOf<PixelRGB>  { static PixelFormat constexpr VALUE = PixelFormat::RGB; };
+template <> struct PixelFormatOf<PixelBGR>  { static PixelFormat constexpr VALUE = PixelFormat::BGR; };
+template <> struct PixelFormatOf<PixelARGB> { static PixelFormat constexpr VALUE = PixelFormat::ARGB; };
+template <> struct PixelFormatOf<PixelRGBA> { static PixelFormat constexpr VALUE = PixelFormat::RGBA; };
+template <> struct PixelFormatOf<PixelBGRA> { static PixelFormat constexpr VALUE = PixelFormat::BGRA; };
+template <> struct PixelFormatOf<PixelABGR> { static PixelFormat constexpr VALUE = PixelFormat::ABGR; };
+
 #endif // !defined(BITMAP_PIXEL_H)
@@ -0,0 +1,259 @@
+#if !defined(BITMAP_QUANTIZE_H)
+#define BITMAP_QUANTIZE_H
+
+#pragma once
+
+#include "Bitmap/Bitmap.h"
+#include "Bitmap/BitmapView.h"
+#include "Bitmap/Palette.h"
+#include "Bitmap/PalettizedBitmap.h"
+#include "Bitmap/Parallel.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
+
+//! How a palette is chosen for an image.
+enum class QuantizeMethod
+{
+    OCTREE,         //!< Merge the least used branches of an octree of the colors
+    MEDIAN_CUT      //!< Repeatedly split the most used box of colors at the median of its longest side
+};
+
+//! Chooses a palette for a set of colors.
+//!
+//! Colors are accumulated in a histogram with 5 bits per channel. Each cell of the histogram also holds the sum of the
+//! colors added to it, so the palette entries are the true averages of the colors they represent. Only the red, green
+//! and blue channels are considered. Alpha is ignored, and palette entries are opaque.
+//!
+//! Example:
+//!
+//!     ColorQuantizer quantizer;
+//!     quantizer.add(image.view());
+//!     Palette<PixelRGB> palette;
+//!     int count = quantizer.build(QuantizeMethod::MEDIAN_CUT, &palette);
+class ColorQuantizer
+{
+public:
+
+    //! Number of bits per channel in the histogram
+    static int constexpr HISTOGRAM_BITS = 5;
+
+    //! Number of cells in the histogram
+    static int constexpr HISTOGRAM_SIZE = 1 << (3 * HISTOGRAM_BITS);
+
+    //! Maximum number of colors in a palette
+    static int constexpr MAX_COLORS = 256;
+
+    //! Constructor.
+    ColorQuantizer();
+
+    //! Adds a color to the histogram.
+    void add(uint8_t r, uint8_t g, uint8_t b, uint32_t count = 1);
+
+    //! Adds the pixels of an image to the histogram.
+    template <typename Pixel>
+    void add(BitmapView<Pixel> const & src);
+
+    //! Empties the histogram.
+    void clear();
+
+    //! Returns the number of cells of the histogram that are used.
+    int cells() const;
+
+    //! Chooses up to maxColors colors, returning the number chosen.
+    int build(QuantizeMethod method, uint8_t (*colors)[3], int maxColors = MAX_COLORS) const;
+
+    //! Chooses up to maxColors colors for a palette, returning the number chosen.
+    template <typename Color>
+    int build(QuantizeMethod method, Palette<Color> * palette, int maxColors = MAX_COLORS) const;
+
+    //! Returns the index of the histogram cell containing a color.
+    static int cellOf(uint8_t r, uint8_t g, uint8_t b)
+    {
+        int constexpr SHIFT = 8 - HISTOGRAM_BITS;
+        return ((r >> SHIFT) << (2 * HISTOGRAM_BITS)) | ((g >> SHIFT) << HISTOGRAM_BITS) | (b >> SHIFT);
+    }
+
+private:
+
+    // A cell of the histogram
+    struct Cell
+    {
+        uint64_t count;     // Number of colors
+        uint64_t r;         // Sum of red values
+        uint64_t g;         // Sum of green values
+        uint64_t b;         // Sum of blue values
+    };
+
+    // Chooses colors by reducing an octree
+    int octree(uint8_t (*colors)[3], int maxColors) const;
+
+    // Chooses colors by median cut
+    int medianCut(uint8_t (*colors)[3], int maxColors) const;
+
+    std::vector<Cell> cells_;   // Histogram
+};
+
+//! Maps colors to the nearest entry of a palette.
+//!
+//! The color space is divided into a grid of 32 x 32 x 32 cells (the same cells as ColorQuantizer's histogram), and
+//! the entry nearest to the center of each cell is found in advance, so mapping a color is a single table lookup.
+class InverseColormap
+{
+public:
+
+    //! Number of bits per channel in the table
+    static int constexpr BITS = ColorQuantizer::HISTOGRAM_BITS;
+
+    //! Constructor.
+    InverseColormap() = default;
+
+    //! Constructor.
+    InverseColormap(uint8_t const (*colors)[3], int count, Execution execution = Execution::SEQUENTIAL);
+
+    //! Constructor.
+    template <typename Color>
+    explicit InverseColormap(Palette<Color> const & palette,
+                             int                    count     = int(Palette<Color>::PALETTE_SIZE),
+                             Execution              execution = Execution::SEQUENTIAL);
+
+    //! Returns the index of the entry nearest to a color.
+    uint8_t operator ()(uint8_t r, uint8_t g, uint8_t b) const
+    {
+        assert(!table_.empty());
+        return table_[ColorQuantizer::cellOf(r, g, b)];
+    }
+
+    //! Maps the pixels of an image to palette indexes.
+    template <typename Pixel>
+    void map(BitmapView<Pixel> const &   src,
+             BitmapView<uint8_t> const & dst,
+             Execution                   execution = Execution::SEQUENTIAL) const;
+
+private:
+
+    // Builds the table
+    void build(uint8_t const (*colors)[3], int count, Execution execution);
+
+    std::vector<uint8_t> table_;    // Index of the nearest entry for each cell
+};
+
+//! @param  src     Image
+template <typename Pixel>
+void ColorQuantizer::add(BitmapView<Pixel> const & src)
+{
+    for (int y = 0; y < src.height(); ++y)
+    {
+        Pixel const * row = src.row(y);
+        for (int x = 0; x < src.width(); ++x)
+        {
+            add(row[x].red8(), row[x].green8(), row[x].blue8());
+        }
+    }
+}
+
+//! Entries that are not chosen are set to black.
+//!
+//! @param  method      How to choose the colors
+//! @param  palette     Receives the colors
+//! @param  maxColors   Maximum number of colors to choose (1 - 256)
+//!
+//! @return     number of colors chosen
+template <typename Color>
+int ColorQuantizer::build(QuantizeMethod method, Palette<Color> * palette, int maxColors /*= MAX_COLORS*/) const
+{
+    uint8_t colors[MAX_COLORS][3] = {};
+    int     count = build(method, colors, maxColors);
+    for (int i = 0; i < int(Palette<Color>::PALETTE_SIZE); ++i)
+    {
+        Color c;
+        c.set8(colors[i][0], colors[i][1], colors[i][2]);
+        (*palette)[i] = c;
+    }
+    return count;
+}
+
+//! @param  palette     Palette
+//! @param  count       Number of entries to consider, starting with the first
+//! @param  execution   How to build the table
+template <typename Color>
+InverseColormap::InverseColormap(Palette<Color> const & palette,
+                                 int                    count /*= int(Palette<Color>::PALETTE_SIZE)*/,
+                                 Execution              execution /*= Execution::SEQUENTIAL*/)
+{
+    assert(count > 0 && count <= int(Palette<Color>::PALETTE_SIZE));
+    uint8_t colors[ColorQuantizer::MAX_COLORS][3];
+    for (int i = 0; i < count; ++i)
+    {
+        Color const c = palette.entries()[i];
+        colors[i][0]  = c.red8();
+        colors[i][1]  = c.green8();
+        colors[i][2]  = c.blue8();
+    }
+    build(colors, count, execution);
+}
+
+//! If the destination differs in size, only the overlapping area (from the top left) is mapped.
+//!
+//! @param  src         Image
+//! @param  dst         Receives the palette indexes
+//! @param  execution   How to map the rows
+template <typename Pixel>
+void InverseColormap::map(BitmapView<Pixel> const &   src,
+                          BitmapView<uint8_t> const & dst,
+                          Execution                   execution /*= Execution::SEQUENTIAL*/) const
+{
+    int const width  = std::min(src.width(), dst.width());
+    int const height = std::min(src.height(), dst.height());
+    if (width <= 0 || height <= 0)
+        return;
+
+    uint8_t const * table = table_.data();
+    forEachBand(execution, height, width * sizeof(Pixel), [&] (int begin, int end) {
+        for (int y = begin; y < end; ++y)
+        {
+            Pixel const * s = src.row(y);
+            uint8_t *     d = dst.row(y);
+            for (int x = 0; x < width; ++x)
+            {
+                d[x] = table[ColorQuantizer::cellOf(s[x].red8(), s[x].green8(), s[x].blue8())];
+            }
+        }
+    });
+}
+
+//! Creates a palettized image from a true-color image.
+//!
+//! A palette is chosen for the image, and then each pixel is mapped to the nearest entry through an InverseColormap.
+//!
+//! @param  src         Image
+//! @param  method      How to choose the palette
+//! @param  maxColors   Maximum number of colors in the palette (1 - 256)
+//! @param  execution   How to map the pixels
+//! @param  resource    Source of the image data, or nullptr for the default resource
+//!
+//! @return     palettized image
+template <typename Color, typename Pixel>
+PalettizedBitmap<Color> quantize(BitmapView<Pixel> const &   src,
+                                 QuantizeMethod              method    = QuantizeMethod::OCTREE,
+                                 int                         maxColors = ColorQuantizer::MAX_COLORS,
+                                 Execution                   execution = Execution::SEQUENTIAL,
+                                 std::pmr::memory_resource * resource  = nullptr)
+{
+    ColorQuantizer quantizer;
+    quantizer.add(src);
+
+    Palette<Color> palette;
+    int            count = quantizer.build(method, &palette, maxColors);
+
+    PalettizedBitmap<Color> result(src.width(), src.height(), palette, resource);
+    if (count > 0)
+        InverseColormap(palette, count, execution).map(src, result.view(), execution);
+    return result;
+}
+
+#endif // !defined(BITMAP_QUANTIZE_H)
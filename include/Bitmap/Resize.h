@@ -0,0 +1,508 @@
+#if !defined(BITMAP_RESIZE_H)
+#define BITMAP_RESIZE_H
+
+#pragma once
+
+#include "Bitmap/Bitmap.h"
+#include "Bitmap/BitmapView.h"
+#include "Bitmap/Parallel.h"
+#include "Bitmap/Pixel.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//! Resampling filters.
+enum class ResizeFilter
+{
+    NEAREST,    //!< Nearest pixel
+    BILINEAR,   //!< Linear interpolation (a triangle filter)
+    BOX,        //!< Average of the covered area when reducing, nearest pixel when enlarging
+    LANCZOS     //!< Lanczos filter with 3 lobes
+};
+
+//! Resamples images.
+//!
+//! Except for NEAREST, which copies whole pixels, the images are filtered separably: first each row, into an
+//! intermediate image with the final width, and then each column. The filter weights for every output column and row
+//! are computed once, as 14-bit fixed point coefficients, and the channels are filtered as 8-bit integers. Rows of
+//! 32-bit pixels and all columns are filtered with SSE2.
+//!
+//! Filtering is supported for Pixel8 and the Pixel16, Pixel24 and Pixel32 formats. The channels of a Pixel16 are
+//! scaled to 8 bits while they are filtered. Alpha is filtered like any other channel, so images with alpha should be
+//! premultiplied.
+template <typename Pixel>
+class Resampler
+{
+public:
+
+    //! Resamples an image to the size of the destination.
+    static void resize(BitmapView<Pixel const> const & src,
+                       BitmapView<Pixel> const &       dst,
+                       ResizeFilter                    filter,
+                       Execution                       execution);
+
+private:
+
+    // Returns true if the channels of the pixels can be filtered
+    static bool constexpr filterable()
+    {
+        if constexpr (std::is_same<Pixel, Pixel8>::value)
+            return true;
+        else if constexpr (std::is_class<Pixel>::value)
+            return true;
+        else
+            return false;
+    }
+
+    // Returns the number of channels filtered per pixel
+    static int constexpr channels()
+    {
+        if constexpr (std::is_same<Pixel, Pixel8>::value)
+            return 1;
+        else if constexpr (Pixel::BYTE_CHANNELS)
+            return int(sizeof(Pixel));
+        else
+            return 4;
+    }
+
+    // Returns true if the pixels are stored as their filtered channels
+    static bool constexpr native()
+    {
+        if constexpr (std::is_same<Pixel, Pixel8>::value)
+            return true;
+        else
+            return Pixel::BYTE_CHANNELS;
+    }
+
+    static int constexpr PRECISION = 14;    // Number of fractional bits in a coefficient
+
+    // Filter coefficients for every output pixel along one axis
+    struct Coefficients
+    {
+        int taps = 0;                   // Number of source pixels contributing to each output pixel
+        std::vector<int> first;         // First contributing source pixel of each output pixel
+        std::vector<int16_t> weights;   // Weight of each contributing source pixel, in fixed point
+    };
+
+    // Computes the filter coefficients for resampling from one size to another
+    static Coefficients coefficients(int inSize, int outSize, ResizeFilter filter);
+
+    // Returns the radius of a filter
+    static double support(ResizeFilter filter);
+
+    // Returns the value of a filter at x
+    static double weight(ResizeFilter filter, double x);
+
+    // Resamples by copying the nearest pixels
+    static void nearest(BitmapView<Pixel const> const & src, BitmapView<Pixel> const & dst, Execution execution);
+
+    // Resamples by filtering
+    static void filterImage(BitmapView<Pixel const> const & src,
+                            BitmapView<Pixel> const &       dst,
+                            ResizeFilter                    filter,
+                            Execution                       execution);
+
+    // Filters a row of channels
+    static void filterRow(uint8_t const * src, uint8_t * dst, int width, Coefficients const & c);
+
+    // Filters a column of rows of channels
+    static void filterColumn(uint8_t const * const * rows, uint8_t * dst, int size, int16_t const * weights, int taps);
+
+#if defined(__SSE2__)
+    // Returns a pair of weights replicated for a multiply-add of interleaved channels
+    static __m128i weightPair(int16_t w0, int16_t w1)
+    {
+        return _mm_set1_epi32(int(uint32_t(uint16_t(w0)) | (uint32_t(uint16_t(w1)) << 16)));
+    }
+#endif
+
+    // Returns a fixed point sum of channels, rounded and clamped to 8 bits
+    static uint8_t clamp(int sum)
+    {
+        sum = (sum + (1 << (PRECISION - 1))) >> PRECISION;
+        return uint8_t(std::min(std::max(sum, 0), 255));
+    }
+};
+
+//! @param  src         Source image
+//! @param  dst         Destination image
+//! @param  filter      Resampling filter
+//! @param  execution   How to perform the operation
+template <typename Pixel>
+void Resampler<Pixel>::resize(BitmapView<Pixel const> const & src,
+                              BitmapView<Pixel> const &       dst,
+                              ResizeFilter                    filter,
+                              Execution                       execution)
+{
+    if (src.empty() || dst.empty())
+        return;
+
+    if constexpr (filterable())
+    {
+        if (filter != ResizeFilter::NEAREST)
+        {
+            filterImage(src, dst, filter, execution);
+            return;
+        }
+    }
+
+    assert(filter == ResizeFilter::NEAREST);
+    nearest(src, dst, execution);
+}
+
+template <typename Pixel>
+typename Resampler<Pixel>::Coefficients Resampler<Pixel>::coefficients(int inSize, int outSize, ResizeFilter filter)
+{
+    // When reducing, the filter is stretched to cover the source pixels contributing to each output pixel. A reducing
+    // box filter weights each source pixel by the fraction of it covered by the output pixel, so the pixels that are
+    // only partly covered at each end contribute too.
+
+    double scale       = double(inSize) / double(outSize);
+    double filterScale = std::max(scale, 1.0);
+    double radius      = support(filter) * filterScale;
+    bool   area        = filter == ResizeFilter::BOX && scale > 1.0;
+
+    std::vector<int> lo(outSize);
+    std::vector<int> hi(outSize);
+    Coefficients     c;
+    for (int i = 0; i < outSize; ++i)
+    {
+        double center = (i + 0.5) * scale;
+        if (area)
+        {
+            lo[i] = std::max(int(std::floor(center - radius)), 0);
+            hi[i] = std::max(std::min(int(std::ceil(center + radius)), inSize), lo[i] + 1);
+        }
+        else
+        {
+            lo[i] = std::max(int(center - radius + 0.5), 0);
+            hi[i] = std::max(std::min(int(center + radius + 0.5), inSize), lo[i] + 1);
+        }
+        c.taps = std::max(c.taps, hi[i] - lo[i]);
+    }
+
+    c.first.resize(outSize);
+    c.weights.assign(size_t(outSize) * c.taps, 0);
+    std::vector<double> w(c.taps);
+    for (int i = 0; i < outSize; ++i)
+    {
+        double center = (i + 0.5) * scale;
+        int    count  = hi[i] - lo[i];
+        double total  = 0.0;
+        for (int k = 0; k < count; ++k)
+        {
+            if (area)
+            {
+                double left    = std::max(double(lo[i] + k), center - radius);
+                double right   = std::min(double(lo[i] + k + 1), center + radius);
+                w[k] = std::min(std::max(right - left, 0.0), 1.0);
+            }
+            else
+            {
+                w[k] = weight(filter, (lo[i] + k - center + 0.5) / filterScale);
+            }
+            total += w[k];
+        }
+
+        // Every output pixel uses the same number of taps, so the taps are shifted back from the end of the source
+        c.first[i] = std::min(lo[i], inSize - c.taps);
+        int16_t * weights = &c.weights[size_t(i) * c.taps + (lo[i] - c.first[i])];
+
+        // Convert to fixed point, adding any rounding error to the largest weight so that the weights sum to 1
+        int sum     = 0;
+        int largest = 0;
+        for (int k = 0; k < count; ++k)
+        {
+            double normalized = (total != 0.0) ? w[k] / total : ((k == 0) ? 1.0 : 0.0);
+            weights[k] = int16_t(std::lround(normalized * (1 << PRECISION)));
+            sum       += weights[k];
+            if (weights[k] > weights[largest])
+                largest = k;
+        }
+        weights[largest] = int16_t(weights[largest] + (1 << PRECISION) - sum);
+    }
+    return c;
+}
+
+template <typename Pixel>
+double Resampler<Pixel>::support(ResizeFilter filter)
+{
+    switch (filter)
+    {
+        case ResizeFilter::BOX:      return 0.5;
+        case ResizeFilter::BILINEAR: return 1.0;
+        case ResizeFilter::LANCZOS:  return 3.0;
+        default:                     return 0.5;
+    }
+}
+
+template <typename Pixel>
+double Resampler<Pixel>::weight(ResizeFilter filter, double x)
+{
+    double const PI = 3.14159265358979323846;
+
+    switch (filter)
+    {
+        case ResizeFilter::BILINEAR:
+            x = std::abs(x);
+            return (x < 1.0) ? 1.0 - x : 0.0;
+
+        case ResizeFilter::LANCZOS:
+            if (x == 0.0)
+                return 1.0;
+            if (x <= -3.0 || x >= 3.0)
+                return 0.0;
+            return 3.0 * std::sin(PI * x) * std::sin(PI * x / 3.0) / (PI * PI * x * x);
+
+        default:
+            return (x > -0.5 && x <= 0.5) ? 1.0 : 0.0;
+    }
+}
+
+template <typename Pixel>
+void Resampler<Pixel>::nearest(BitmapView<Pixel const> const & src, BitmapView<Pixel> const & dst, Execution execution)
+{
+    std::vector<int> columns(dst.width());
+    for (int x = 0; x < dst.width(); ++x)
+    {
+        columns[x] = std::min(int((x + 0.5) * src.width() / dst.width()), src.width() - 1);
+    }
+
+    forEachBand(execution, dst.height(), dst.width() * sizeof(Pixel), [&] (int begin, int end) {
+        for (int y = begin; y < end; ++y)
+        {
+            Pixel const * s = src.row(std::min(int((y + 0.5) * src.height() / dst.height()), src.height() - 1));
+            Pixel *       d = dst.row(y);
+            for (int x = 0; x < dst.width(); ++x)
+            {
+                d[x] = s[columns[x]];
+            }
+        }
+    });
+}
+
+template <typename Pixel>
+void Resampler<Pixel>::filterImage(BitmapView<Pixel const> const & src,
+                                   BitmapView<Pixel> const &       dst,
+                                   ResizeFilter                    filter,
+                                   Execution                       execution)
+{
+    int constexpr C = channels();
+
+    Coefficients const horizontal = coefficients(src.width(), dst.width(), filter);
+    Coefficients const vertical   = coefficients(src.height(), dst.height(), filter);
+
+    // Filter the rows into an intermediate image with the destination's width
+
+    size_t const         stride = size_t(dst.width()) * C;
+    std::vector<uint8_t> intermediate(stride * src.height());
+
+    forEachBand(execution, src.height(), src.width() * sizeof(Pixel), [&] (int begin, int end) {
+        std::vector<uint8_t> unpacked;
+        if constexpr (!native())
+            unpacked.resize(size_t(src.width()) * C);
+
+        for (int y = begin; y < end; ++y)
+        {
+            uint8_t const * row;
+            if constexpr (native())
+            {
+                row = reinterpret_cast<uint8_t const *>(src.row(y));
+            }
+            else
+            {
+                Pixel const * s = src.row(y);
+                for (int x = 0; x < src.width(); ++x)
+                {
+                    unpacked[x * 4 + 0] = s[x].red8();
+                    unpacked[x * 4 + 1] = s[x].green8();
+                    unpacked[x * 4 + 2] = s[x].blue8();
+                    unpacked[x * 4 + 3] = s[x].alpha8();
+                }
+                row = unpacked.data();
+            }
+            filterRow(row, &intermediate[y * stride], dst.width(), horizontal);
+        }
+    });
+
+    // Filter the columns of the intermediate image into the destination
+
+    forEachBand(execution, dst.height(), stride * vertical.taps, [&] (int begin, int end) {
+        std::vector<uint8_t const *> rows(vertical.taps);
+        std::vector<uint8_t>         packed;
+        if constexpr (!native())
+            packed.resize(stride);
+
+        for (int y = begin; y < end; ++y)
+        {
+            for (int k = 0; k < vertical.taps; ++k)
+            {
+                rows[k] = &intermediate[(vertical.first[y] + k) * stride];
+            }
+            int16_t const * weights = &vertical.weights[size_t(y) * vertical.taps];
+
+            if constexpr (native())
+            {
+                filterColumn(rows.data(), reinterpret_cast<uint8_t *>(dst.row(y)), int(stride), weights, vertical.taps);
+            }
+            else
+            {
+                filterColumn(rows.data(), packed.data(), int(stride), weights, vertical.taps);
+                Pixel * d = dst.row(y);
+                for (int x = 0; x < dst.width(); ++x)
+                {
+                    d[x].set8(packed[x * 4 + 0], packed[x * 4 + 1], packed[x * 4 + 2], packed[x * 4 + 3]);
+                }
+            }
+        }
+    });
+}
+
+template <typename Pixel>
+void Resampler<Pixel>::filterRow(uint8_t const * src, uint8_t * dst, int width, Coefficients const & c)
+{
+    int constexpr C    = channels();
+    int const     taps = c.taps;
+
+#if defined(__SSE2__)
+    if constexpr (C == 4)
+    {
+        // The channels of two source pixels are interleaved so that each multiply-add applies two taps
+        __m128i const zero  = _mm_setzero_si128();
+        __m128i const round = _mm_set1_epi32(1 << (PRECISION - 1));
+        for (int x = 0; x < width; ++x)
+        {
+            uint8_t const * s   = src + c.first[x] * 4;
+            int16_t const * w   = &c.weights[size_t(x) * taps];
+            __m128i         sum = round;
+            int             k   = 0;
+            for (; k + 2 <= taps; k += 2)
+            {
+                __m128i p  = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<__m128i const *>(s + k * 4)), zero);
+                __m128i pp = _mm_unpacklo_epi16(p, _mm_unpackhi_epi64(p, p));
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(pp, weightPair(w[k], w[k + 1])));
+            }
+            if (k < taps)
+            {
+                int32_t last;
+                memcpy(&last, s + k * 4, 4);
+                __m128i p = _mm_unpacklo_epi8(_mm_cvtsi32_si128(last), zero);
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(p, zero), weightPair(w[k], 0)));
+            }
+            sum = _mm_srai_epi32(sum, PRECISION);
+            sum = _mm_packus_epi16(_mm_packs_epi32(sum, sum), zero);
+            int32_t result = _mm_cvtsi128_si32(sum);
+            memcpy(dst + x * 4, &result, 4);
+        }
+        return;
+    }
+#endif
+
+    for (int x = 0; x < width; ++x)
+    {
+        uint8_t const * s = src + c.first[x] * C;
+        int16_t const * w = &c.weights[size_t(x) * taps];
+        for (int ch = 0; ch < C; ++ch)
+        {
+            int sum = 0;
+            for (int k = 0; k < taps; ++k)
+            {
+                sum += w[k] * s[k * C + ch];
+            }
+            dst[x * C + ch] = clamp(sum);
+        }
+    }
+}
+
+template <typename Pixel>
+void Resampler<Pixel>::filterColumn(uint8_t const * const * rows, uint8_t * dst, int size, int16_t const * weights, int taps)
+{
+    int i = 0;
+
+#if defined(__SSE2__)
+    // Each step filters 8 channels. The channels of two rows are interleaved so that each multiply-add applies two taps.
+    __m128i const zero  = _mm_setzero_si128();
+    __m128i const round = _mm_set1_epi32(1 << (PRECISION - 1));
+    for (; i + 8 <= size; i += 8)
+    {
+        __m128i lo = round;
+        __m128i hi = round;
+        for (int k = 0; k < taps; k += 2)
+        {
+            __m128i a  = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<__m128i const *>(rows[k] + i)), zero);
+            __m128i b  = zero;
+            int16_t w1 = 0;
+            if (k + 1 < taps)
+            {
+                b  = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<__m128i const *>(rows[k + 1] + i)), zero);
+                w1 = weights[k + 1];
+            }
+            __m128i ww = weightPair(weights[k], w1);
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), ww));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), ww));
+        }
+        lo = _mm_srai_epi32(lo, PRECISION);
+        hi = _mm_srai_epi32(hi, PRECISION);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(_mm_packs_epi32(lo, hi), zero));
+    }
+#endif
+
+    for (; i < size; ++i)
+    {
+        int sum = 0;
+        for (int k = 0; k < taps; ++k)
+        {
+            sum += weights[k] * rows[k][i];
+        }
+        dst[i] = clamp(sum);
+    }
+}
+
+//! Resamples an image to the size of another image.
+//!
+//! @param  src         Source image
+//! @param  dst         Destination image
+//! @param  filter      Resampling filter
+//! @param  execution   How to perform the operation
+template <typename SrcPixel, typename DstPixel>
+void resize(BitmapView<SrcPixel> const & src,
+            BitmapView<DstPixel> const & dst,
+            ResizeFilter                 filter,
+            Execution                    execution = Execution::SEQUENTIAL)
+{
+    static_assert(std::is_same<std::remove_const_t<SrcPixel>, DstPixel>::value,
+                  "The source and destination must have the same mutable pixel type");
+    Resampler<DstPixel>::resize(src, dst, filter, execution);
+}
+
+//! Returns a copy of a bitmap resampled to a different size.
+//!
+//! @param  src         Source bitmap
+//! @param  width       Width of the result
+//! @param  height      Height of the result
+//! @param  filter      Resampling filter
+//! @param  execution   How to perform the operation
+//!
+//! @return     resampled bitmap
+template <typename Pixel>
+Bitmap<Pixel> resize(Bitmap<Pixel> const & src,
+                     int                   width,
+                     int                   height,
+                     ResizeFilter          filter,
+                     Execution             execution = Execution::SEQUENTIAL)
+{
+    Bitmap<Pixel> dst(width, height);
+    resize(src.view(), dst.view(), filter, execution);
+    return dst;
+}
+
+#endif // !defined(BITMAP_RESIZE_H)
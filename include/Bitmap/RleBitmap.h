@@ -0,0 +1,328 @@
+#if !defined(BITMAP_RLEBITMAP_H)
+#define BITMAP_RLEBITMAP_H
+
+#pragma once
+
+#include "Bitmap/Bitmap.h"
+#include "Bitmap/BitmapView.h"
+#include "Bitmap/Palette.h"
+#include "Bitmap/PalettizedBitmap.h"
+#include "Bitmap/Parallel.h"
+#include "Rect/Rect.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <vector>
+
+//! A palettized bitmap whose indexes are run-length encoded.
+//!
+//! Images with large flat areas (such as UI elements and sprites) take a fraction of the memory of a PalettizedBitmap.
+//! Each row is encoded separately and a table holds the start of each row, so any row can be decoded without decoding
+//! the rows above it. Rows are decoded directly to colors, applying the palette as each run or literal is decoded, so
+//! there is no intermediate buffer of indexes. A run is expanded to a single color, which is then filled.
+//!
+//! Each row is a sequence of packets. A packet starts with a byte n. If the high bit is set, the next byte is an index
+//! that is repeated (n & 0x7f) + 1 times. Otherwise, n + 1 literal indexes follow. Packets do not span rows.
+template <class Color>
+class RleBitmap
+{
+public:
+
+    using ColorType = Color;    //!< Color template parameter type
+
+    //! View of the decompressed image.
+    using View = BitmapView<Color>;
+
+    //! Maximum number of pixels in a packet
+    static int constexpr MAX_PACKET = 128;
+
+    //! Constructor.
+    RleBitmap() = default;
+
+    //! Constructor.
+    explicit RleBitmap(std::pmr::memory_resource * resource);
+
+    //! Constructor.
+    explicit RleBitmap(PalettizedBitmap<Color> const & src, std::pmr::memory_resource * resource = nullptr);
+
+    //! Constructor.
+    RleBitmap(int                         w,
+              int                         h,
+              uint8_t const *             indexes,
+              size_t                      pitch,
+              Palette<Color> const &      palette,
+              std::pmr::memory_resource * resource = nullptr);
+
+    //! Replaces the image with compressed indexes.
+    void compress(int w, int h, uint8_t const * indexes, size_t pitch);
+
+    //! Returns the width of the image (in pixels).
+    int width() const { return width_; }
+
+    //! Returns the height of the image (in pixels).
+    int height() const { return height_; }
+
+    //! Returns the palette
+    Palette<Color> palette() const { return palette_; }
+
+    //! Returns the palette
+    Palette<Color> & palette() { return palette_; }
+
+    //! Sets the palette
+    void setPalette(Palette<Color> const & palette) { palette_ = palette; }
+
+    //! Returns the size of the compressed indexes, including the row table (in bytes).
+    size_t compressedSize() const { return codes_.size() + rows_.size() * sizeof(size_t); }
+
+    //! Decodes a row to colors.
+    void expandRow(int y, Color * dst) const { expandRow(y, 0, width_, dst); }
+
+    //! Decodes part of a row to colors.
+    void expandRow(int y, int x, int count, Color * dst) const;
+
+    //! Decodes a row to indexes.
+    void indexRow(int y, uint8_t * dst) const;
+
+    //! Decodes the image to colors.
+    void decompress(View const & dst, Execution execution = Execution::SEQUENTIAL) const;
+
+    //! Creates a non-palettized bitmap from a region of this bitmap.
+    Bitmap<Color> decompressedRegion(int x, int y, int width, int height, int pitch = 0) const;
+
+    //! Creates an uncompressed palettized bitmap.
+    PalettizedBitmap<Color> palettized() const;
+
+    //! Returns the memory resource that provides the compressed indexes.
+    std::pmr::memory_resource * resource() const { return codes_.get_allocator().resource(); }
+
+private:
+
+    // Encodes a row, appending the packets to the codes
+    void encodeRow(uint8_t const * row);
+
+    // Decodes count pixels of row y starting at x, passing each index through map
+    template <typename Out, typename Map>
+    void decodeRow(int y, int x, int count, Out * dst, Map const & map) const;
+
+    int                        width_  = 0;     // Width (in pixels)
+    int                        height_ = 0;     // Height (in pixels)
+    std::pmr::vector<uint8_t>  codes_;          // Packets of all rows
+    std::pmr::vector<size_t>   rows_;           // Offset of each row's packets, plus the end of the last row
+    Palette<Color>             palette_;        // The palette
+};
+
+//! @param  resource    Source of the compressed indexes, or nullptr for the default resource
+template <class Color>
+RleBitmap<Color>::RleBitmap(std::pmr::memory_resource * resource)
+    : codes_(resource ? resource : std::pmr::get_default_resource())
+    , rows_(resource ? resource : std::pmr::get_default_resource())
+{
+}
+
+//! @param  src         Image to compress
+//! @param  resource    Source of the compressed indexes, or nullptr for the default resource
+template <class Color>
+RleBitmap<Color>::RleBitmap(PalettizedBitmap<Color> const & src, std::pmr::memory_resource * resource /*= nullptr*/)
+    : RleBitmap(resource)
+{
+    compress(src.width(), src.height(), src.data(), src.pitch());
+    palette_ = src.palette();
+}
+
+//! @param  w           Width
+//! @param  h           Height
+//! @param  indexes     First row of indexes
+//! @param  pitch       Distance between the starts of consecutive rows of indexes (in bytes)
+//! @param  palette     Palette
+//! @param  resource    Source of the compressed indexes, or nullptr for the default resource
+template <class Color>
+RleBitmap<Color>::RleBitmap(int                         w,
+                            int                         h,
+                            uint8_t const *             indexes,
+                            size_t                      pitch,
+                            Palette<Color> const &      palette,
+                            std::pmr::memory_resource * resource /*= nullptr*/)
+    : RleBitmap(resource)
+{
+    compress(w, h, indexes, pitch);
+    palette_ = palette;
+}
+
+//! The palette is not changed.
+//!
+//! @param  w           Width
+//! @param  h           Height
+//! @param  indexes     First row of indexes
+//! @param  pitch       Distance between the starts of consecutive rows of indexes (in bytes)
+template <class Color>
+void RleBitmap<Color>::compress(int w, int h, uint8_t const * indexes, size_t pitch)
+{
+    assert(w >= 0 && h >= 0);
+    assert(indexes || w == 0 || h == 0);
+
+    width_  = (h > 0) ? w : 0;
+    height_ = (w > 0) ? h : 0;
+    codes_.clear();
+    rows_.clear();
+    rows_.reserve(height_ + 1);
+    for (int y = 0; y < height_; ++y)
+    {
+        rows_.push_back(codes_.size());
+        encodeRow(indexes + y * pitch);
+    }
+    rows_.push_back(codes_.size());
+    codes_.shrink_to_fit();
+}
+
+//! @param  y       Row
+//! @param  x       First pixel
+//! @param  count   Number of pixels
+//! @param  dst     Receives the colors
+template <class Color>
+void RleBitmap<Color>::expandRow(int y, int x, int count, Color * dst) const
+{
+    Color const * entries = palette_.entries();
+    decodeRow(y, x, count, dst, [entries] (uint8_t i) { return entries[i]; });
+}
+
+//! @param  y       Row
+//! @param  dst     Receives the indexes
+template <class Color>
+void RleBitmap<Color>::indexRow(int y, uint8_t * dst) const
+{
+    decodeRow(y, 0, width_, dst, [] (uint8_t i) { return i; });
+}
+
+//! If the destination differs in size, only the overlapping area (from the top left) is decoded.
+//!
+//! @param  dst         Destination
+//! @param  execution   How to decode the rows
+template <class Color>
+void RleBitmap<Color>::decompress(View const & dst, Execution execution /*= Execution::SEQUENTIAL*/) const
+{
+    int const width  = std::min(width_, dst.width());
+    int const height = std::min(height_, dst.height());
+    if (width <= 0 || height <= 0)
+        return;
+
+    forEachBand(execution, height, width * sizeof(Color), [&] (int begin, int end) {
+        for (int y = begin; y < end; ++y)
+        {
+            expandRow(y, 0, width, dst.row(y));
+        }
+    });
+}
+
+//! The region is clipped to the bounds of the bitmap.
+//!
+//! @param  x       Location of the region
+//! @param  y       Location of the region
+//! @param  width   Width of the region
+//! @param  height  Height of the region
+//! @param  pitch   Pitch of the resulting bitmap
+//!
+//! @return un-palettized bitmap
+template <class Color>
+Bitmap<Color> RleBitmap<Color>::decompressedRegion(int x, int y, int width, int height, int pitch /*= 0*/) const
+{
+    Rect clipped{ 0, 0, width_, height_ };
+    clipped.clip(Rect{ x, y, width, height });
+    if (clipped.width <= 0 || clipped.height <= 0)
+        return Bitmap<Color>();
+
+    Bitmap<Color> region(clipped.width, clipped.height, pitch);
+    for (int row = 0; row < clipped.height; ++row)
+    {
+        expandRow(clipped.y + row, clipped.x, clipped.width, region.data(0, row));
+    }
+    return region;
+}
+
+//! @return     bitmap with the same indexes and palette
+template <class Color>
+PalettizedBitmap<Color> RleBitmap<Color>::palettized() const
+{
+    PalettizedBitmap<Color> bitmap(width_, height_, palette_);
+    for (int y = 0; y < height_; ++y)
+    {
+        indexRow(y, bitmap.data(0, y));
+    }
+    return bitmap;
+}
+
+// Runs of 3 or more are encoded as run packets. Shorter runs are left in literal packets, since splitting a literal
+// packet for them would not save anything.
+template <class Color>
+void RleBitmap<Color>::encodeRow(uint8_t const * row)
+{
+    int x = 0;
+    while (x < width_)
+    {
+        int run = 1;
+        while (x + run < width_ && run < MAX_PACKET && row[x + run] == row[x])
+            ++run;
+        if (run >= 3)
+        {
+            codes_.push_back(uint8_t(0x80 | (run - 1)));
+            codes_.push_back(row[x]);
+            x += run;
+            continue;
+        }
+
+        // Collect literals up to the next run of 3 or more
+        int end = x + 1;
+        while (end < width_ && end - x < MAX_PACKET &&
+               !(end + 2 < width_ && row[end] == row[end + 1] && row[end] == row[end + 2]))
+        {
+            ++end;
+        }
+        codes_.push_back(uint8_t(end - x - 1));
+        codes_.insert(codes_.end(), row + x, row + end);
+        x = end;
+    }
+}
+
+template <class Color>
+template <typename Out, typename Map>
+void RleBitmap<Color>::decodeRow(int y, int x, int count, Out * dst, Map const & map) const
+{
+    assert(y >= 0 && y < height_);
+    assert(x >= 0 && count >= 0 && x + count <= width_);
+
+    uint8_t const * src  = codes_.data() + rows_[y];
+    int             skip = x;
+    while (count > 0)
+    {
+        int const n = (*src & 0x7f) + 1;
+        if (skip >= n)
+        {
+            src  += (*src & 0x80) ? 2 : 1 + n;
+            skip -= n;
+            continue;
+        }
+
+        int const m = std::min(n - skip, count);
+        if (*src & 0x80)
+        {
+            std::fill_n(dst, m, map(src[1]));
+            src += 2;
+        }
+        else
+        {
+            uint8_t const * literals = src + 1 + skip;
+            for (int i = 0; i < m; ++i)
+            {
+                dst[i] = map(literals[i]);
+            }
+            src += 1 + n;
+        }
+        dst   += m;
+        count -= m;
+        skip   = 0;
+    }
+}
+
+#endif // !defined(BITMAP_RLEBITMAP_H)
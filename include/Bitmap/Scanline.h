@@ -0,0 +1,324 @@
+#if !defined(BITMAP_SCANLINE_H)
+#define BITMAP_SCANLINE_H
+
+#pragma once
+
+#include "Bitmap/Bitmap.h"
+#include "Bitmap/BitmapView.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory_resource>
+
+//! Reads an image as a sequence of bands of rows, without holding the entire image in memory.
+//!
+//! The rows are provided by a source, one row at a time and in order from the top. The reader holds a window of up to
+//! a fixed number of rows. Each call to next() slides the window down the image. Consecutive windows overlap by a fixed
+//! number of rows, so that operations needing neighboring rows (such as filters) can be applied to each band. The
+//! overlapping rows are moved within the window rather than read again.
+//!
+//! Example:
+//!
+//!     ScanlineReader<PixelRGB> reader(width, height, 64, 2, ScanlineReader<PixelRGB>::fileSource(fp, width));
+//!     while (reader.next())
+//!         process(reader.band(), reader.y());
+template <typename Pixel>
+class ScanlineReader
+{
+public:
+
+    //! Pixel type.
+    using PixelType = Pixel;
+
+    //! Read-only view of a band.
+    using ConstView = BitmapView<Pixel const>;
+
+    //! Provides row y of the image, returning false if it could not. Rows are requested in order, starting with row 0.
+    using Source = std::function<bool(int y, Pixel * row)>;
+
+    //! Constructor.
+    ScanlineReader(int                         width,
+                   int                         height,
+                   int                         rows,
+                   int                         overlap,
+                   Source                      source,
+                   std::pmr::memory_resource * resource = nullptr);
+
+    //! Moves the window to the next band of rows.
+    bool next();
+
+    //! Returns the rows in the window.
+    ConstView band() const { return ConstView(width_, count_, window_.pitch(), window_.data()); }
+
+    //! Returns the row of the image at the top of the window.
+    int y() const { return y_; }
+
+    //! Returns the width of the image (in pixels).
+    int width() const { return width_; }
+
+    //! Returns the height of the image (in pixels).
+    int height() const { return height_; }
+
+    //! Returns true if the source failed to provide a row.
+    bool failed() const { return failed_; }
+
+    //! Returns a source that reads consecutive rows from a file.
+    static Source fileSource(FILE * fp, int width, size_t pitch = 0);
+
+    //! Returns a source that reads the rows of a view.
+    static Source viewSource(ConstView const & src);
+
+private:
+
+    int           width_;           // Width of the image (in pixels)
+    int           height_;          // Height of the image (in pixels)
+    int           rows_;            // Maximum number of rows in the window
+    int           overlap_;         // Number of rows shared by consecutive windows
+    Source        source_;          // Source of the rows
+    Bitmap<Pixel> window_;          // Rows in the window
+    int           y_       = 0;     // Row of the image at the top of the window
+    int           count_   = 0;     // Number of rows in the window
+    int           next_    = 0;     // Next row of the image to read
+    bool          failed_  = false; // True if the source failed
+};
+
+//! @param  width       Width of the image
+//! @param  height      Height of the image
+//! @param  rows        Maximum number of rows in the window
+//! @param  overlap     Number of rows at the bottom of a window that are also at the top of the next window
+//! @param  source      Source of the rows
+//! @param  resource    Source of the memory for the window, or nullptr for the default resource
+template <typename Pixel>
+ScanlineReader<Pixel>::ScanlineReader(int                         width,
+                                      int                         height,
+                                      int                         rows,
+                                      int                         overlap,
+                                      Source                      source,
+                                      std::pmr::memory_resource * resource /*= nullptr*/)
+    : width_(width)
+    , height_(height)
+    , rows_(rows)
+    , overlap_(overlap)
+    , source_(std::move(source))
+    , window_(width, rows, Bitmap<Pixel>::alignedPitch(width), nullptr, resource)
+{
+    assert(width >= 0);
+    assert(height >= 0);
+    assert(overlap >= 0 && overlap < rows);
+    assert(source_);
+}
+
+//! The first call reads the first band. Each later call keeps the last rows of the window (as many as the overlap),
+//! and reads enough rows to fill the rest of the window. The last window may be smaller.
+//!
+//! @return     false if there are no more rows or the source failed
+template <typename Pixel>
+bool ScanlineReader<Pixel>::next()
+{
+    if (failed_ || width_ == 0 || next_ >= height_)
+        return false;
+
+    // Move the overlapping rows to the top of the window. The rows are contiguous, so this is a single move.
+    int keep = std::min(overlap_, count_);
+    if (keep > 0)
+        memmove(window_.data(), window_.data(0, count_ - keep), keep * window_.pitch());
+
+    y_     = next_ - keep;
+    count_ = keep;
+    int end = std::min(next_ + rows_ - keep, height_);
+    for (; next_ < end; ++next_)
+    {
+        if (!source_(next_, window_.data(0, count_)))
+        {
+            failed_ = true;
+            return false;
+        }
+        ++count_;
+    }
+    return true;
+}
+
+//! The source must be used by only one reader.
+//!
+//! @param  fp      File positioned at the start of the first row
+//! @param  width   Width of a row (in pixels)
+//! @param  pitch   Distance between the starts of consecutive rows in the file, or 0 if the rows are not padded
+template <typename Pixel>
+typename ScanlineReader<Pixel>::Source ScanlineReader<Pixel>::fileSource(FILE * fp, int width, size_t pitch /*= 0*/)
+{
+    size_t const rowSize = width * sizeof(Pixel);
+    size_t const skip    = (pitch > rowSize) ? pitch - rowSize : 0;
+    return [fp, width, skip] (int, Pixel * row) {
+        bool ok = fread(row, sizeof(Pixel), width, fp) == size_t(width);
+        if (ok && skip > 0)
+            ok = fseek(fp, long(skip), SEEK_CUR) == 0;
+        return ok;
+    };
+}
+
+//! Any view can be read, including a view of a MappedBitmap.
+//!
+//! @param  src     Image to read. It must remain valid while the source is in use.
+template <typename Pixel>
+typename ScanlineReader<Pixel>::Source ScanlineReader<Pixel>::viewSource(ConstView const & src)
+{
+    return [src] (int y, Pixel * row) {
+        if (y >= src.height())
+            return false;
+        memcpy(row, src.row(y), src.width() * sizeof(Pixel));
+        return true;
+    };
+}
+
+//! Writes an image as a sequence of bands of rows, without holding the entire image in memory.
+//!
+//! Each band is filled in place and then committed, which passes its rows to a sink, one row at a time and in order
+//! from the top.
+//!
+//! Example:
+//!
+//!     ScanlineWriter<PixelRGB> writer(width, height, 64, ScanlineWriter<PixelRGB>::fileSink(fp, width));
+//!     while (!writer.done())
+//!     {
+//!         generate(writer.band(), writer.y());
+//!         writer.commit();
+//!     }
+template <typename Pixel>
+class ScanlineWriter
+{
+public:
+
+    //! Pixel type.
+    using PixelType = Pixel;
+
+    //! View of a band.
+    using View = BitmapView<Pixel>;
+
+    //! Consumes row y of the image, returning false if it could not. Rows are passed in order, starting with row 0.
+    using Sink = std::function<bool(int y, Pixel const * row)>;
+
+    //! Constructor.
+    ScanlineWriter(int width, int height, int rows, Sink sink, std::pmr::memory_resource * resource = nullptr);
+
+    //! Returns the band to be filled before the next call to commit().
+    View band();
+
+    //! Passes the rows of the band to the sink and moves to the next band.
+    bool commit();
+
+    //! Returns the row of the image at the top of the band.
+    int y() const { return y_; }
+
+    //! Returns true if all rows have been committed.
+    bool done() const { return y_ >= height_ || failed_; }
+
+    //! Returns true if the sink failed to consume a row.
+    bool failed() const { return failed_; }
+
+    //! Returns a sink that writes consecutive rows to a file.
+    static Sink fileSink(FILE * fp, int width, size_t pitch = 0);
+
+    //! Returns a sink that writes the rows to a view.
+    static Sink viewSink(View const & dst);
+
+private:
+
+    // Returns the number of rows in the current band
+    int count() const { return std::min(rows_, height_ - y_); }
+
+    int           width_;           // Width of the image (in pixels)
+    int           height_;          // Height of the image (in pixels)
+    int           rows_;            // Maximum number of rows in a band
+    Sink          sink_;            // Consumer of the rows
+    Bitmap<Pixel> band_;            // Rows in the band
+    int           y_      = 0;      // Row of the image at the top of the band
+    bool          failed_ = false;  // True if the sink failed
+};
+
+//! @param  width       Width of the image
+//! @param  height      Height of the image
+//! @param  rows        Maximum number of rows in a band
+//! @param  sink        Consumer of the rows
+//! @param  resource    Source of the memory for the band, or nullptr for the default resource
+template <typename Pixel>
+ScanlineWriter<Pixel>::ScanlineWriter(int                         width,
+                                      int                         height,
+                                      int                         rows,
+                                      Sink                        sink,
+                                      std::pmr::memory_resource * resource /*= nullptr*/)
+    : width_(width)
+    , height_((width > 0) ? height : 0)
+    , rows_(rows)
+    , sink_(std::move(sink))
+    , band_(width, rows, Bitmap<Pixel>::alignedPitch(width), nullptr, resource)
+{
+    assert(width >= 0);
+    assert(height >= 0);
+    assert(rows > 0);
+    assert(sink_);
+}
+
+//! The last band may be smaller. The contents of the band are undefined until they are written.
+template <typename Pixel>
+typename ScanlineWriter<Pixel>::View ScanlineWriter<Pixel>::band()
+{
+    if (done())
+        return View();
+    return View(width_, count(), band_.pitch(), band_.data());
+}
+
+//! @return     false if there are no more rows or the sink failed
+template <typename Pixel>
+bool ScanlineWriter<Pixel>::commit()
+{
+    if (done())
+        return false;
+
+    int end = y_ + count();
+    for (int row = 0; y_ < end; ++y_, ++row)
+    {
+        if (!sink_(y_, band_.data(0, row)))
+        {
+            failed_ = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+//! The padding after each row, if any, is written as zeros. The sink must be used by only one writer.
+//!
+//! @param  fp      File positioned where the first row is to be written
+//! @param  width   Width of a row (in pixels)
+//! @param  pitch   Distance between the starts of consecutive rows in the file, or 0 if the rows are not padded
+template <typename Pixel>
+typename ScanlineWriter<Pixel>::Sink ScanlineWriter<Pixel>::fileSink(FILE * fp, int width, size_t pitch /*= 0*/)
+{
+    size_t const rowSize = width * sizeof(Pixel);
+    size_t const padding = (pitch > rowSize) ? pitch - rowSize : 0;
+    return [fp, width, padding] (int, Pixel const * row) {
+        bool ok = fwrite(row, sizeof(Pixel), width, fp) == size_t(width);
+        for (size_t i = 0; ok && i < padding; ++i)
+        {
+            ok = fputc(0, fp) != EOF;
+        }
+        return ok;
+    };
+}
+
+//! @param  dst     Image to receive the rows. It must remain valid while the sink is in use.
+template <typename Pixel>
+typename ScanlineWriter<Pixel>::Sink ScanlineWriter<Pixel>::viewSink(View const & dst)
+{
+    return [dst] (int y, Pixel const * row) {
+        if (y >= dst.height())
+            return false;
+        memcpy(dst.row(y), row, dst.width() * sizeof(Pixel));
+        return true;
+    };
+}
+
+#endif // !defined(BITMAP_SCANLINE_H)
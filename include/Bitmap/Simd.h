@@ -0,0 +1,84 @@
+#if !defined(BITMAP_SIMD_H)
+#define BITMAP_SIMD_H
+
+#pragma once
+
+#include <atomic>
+
+// Selection of vectorized kernels at run time.
+//
+// With GCC and Clang on x86, the SSSE3 and AVX2 kernels are always compiled, using the target attribute, and are called
+// only if the processor supports them. Otherwise, they are compiled only if the compiler is allowed to use the
+// instruction set everywhere (e.g. with -mavx2 or /arch:AVX2).
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BITMAP_SIMD_DISPATCH 1
+#endif
+
+#if defined(__SSSE3__) || defined(__AVX2__) || defined(BITMAP_SIMD_DISPATCH)
+#include <immintrin.h>
+#endif
+
+#if defined(__SSSE3__) || defined(__AVX2__) || defined(BITMAP_SIMD_DISPATCH)
+#define BITMAP_SSSE3 1      //!< Defined if SSSE3 kernels are compiled
+#endif
+
+#if defined(__AVX2__) || defined(BITMAP_SIMD_DISPATCH)
+#define BITMAP_AVX2 1       //!< Defined if AVX2 kernels are compiled
+#endif
+
+#if defined(BITMAP_SIMD_DISPATCH)
+#define BITMAP_TARGET_SSSE3 __attribute__((target("ssse3")))    //!< Allows a function to use SSSE3
+#define BITMAP_TARGET_AVX2  __attribute__((target("avx2")))     //!< Allows a function to use AVX2
+#else
+#define BITMAP_TARGET_SSSE3
+#define BITMAP_TARGET_AVX2
+#endif
+
+//! Instruction sets used by the kernels selected at run time, from the least to the most capable.
+enum class SimdLevel
+{
+    SCALAR, //!< No kernels selected at run time (SSE2 is always used where available)
+    SSSE3,  //!< SSSE3 kernels
+    AVX2    //!< SSSE3 and AVX2 kernels
+};
+
+//! Returns the most capable instruction set supported by the processor.
+inline SimdLevel supportedSimdLevel()
+{
+#if defined(__AVX2__)
+    return SimdLevel::AVX2;
+#elif defined(BITMAP_SIMD_DISPATCH)
+    static SimdLevel const level = __builtin_cpu_supports("avx2")    ? SimdLevel::AVX2
+                                   : __builtin_cpu_supports("ssse3") ? SimdLevel::SSSE3
+                                                                     : SimdLevel::SCALAR;
+    return level;
+#elif defined(__SSSE3__)
+    return SimdLevel::SSSE3;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+// The most capable instruction set that may be used
+inline std::atomic<SimdLevel> & simdLimit()
+{
+    static std::atomic<SimdLevel> limit{ SimdLevel::AVX2 };
+    return limit;
+}
+
+//! Returns the most capable instruction set that kernels may use.
+inline SimdLevel simdLevel()
+{
+    SimdLevel const supported = supportedSimdLevel();
+    SimdLevel const limit     = simdLimit().load(std::memory_order_relaxed);
+    return (limit < supported) ? limit : supported;
+}
+
+//! Limits the instruction sets that kernels may use (so that each kernel can be tested), and returns the old limit.
+inline SimdLevel setSimdLimit(SimdLevel level)
+{
+    return simdLimit().exchange(level);
+}
+
+#endif // !defined(BITMAP_SIMD_H)
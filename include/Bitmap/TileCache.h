@@ -0,0 +1,316 @@
+#if !defined(BITMAP_TILECACHE_H)
+#define BITMAP_TILECACHE_H
+
+#pragma once
+
+#include "Bitmap/Bitmap.h"
+#include "Bitmap/BitmapView.h"
+#include "Bitmap/PalettizedBitmap.h"
+#include "Rect/Rect.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+//! A cache of the expanded tiles of a palettized bitmap.
+//!
+//! Regions of the bitmap are expanded into its colors one TILE_SIZE x TILE_SIZE tile at a time, and the most recently
+//! used tiles are kept, so requests for overlapping regions (such as a scrolling viewport) only expand the tiles that
+//! they have not already expanded. A tile is expanded again if the bitmap's palette version has changed since it was
+//! cached.
+//!
+//! @note   Changes to the pixels of the bitmap are not detected. Call invalidate() for the changed region.
+//! @note   The bitmap must outlive the cache.
+template <class Color, int TILE_SIZE = 64>
+class TileCache
+{
+public:
+
+    static_assert(TILE_SIZE > 0 && (TILE_SIZE & (TILE_SIZE - 1)) == 0, "The tile size must be a power of 2");
+
+    //! Color type.
+    using ColorType = Color;
+
+    //! Width and height of a tile (in pixels)
+    static int constexpr TILE = TILE_SIZE;
+
+    //! View of an expanded image.
+    using View = BitmapView<Color>;
+
+    //! Constructor.
+    TileCache(PalettizedBitmap<Color> const & bitmap, int capacity, std::pmr::memory_resource * resource = nullptr);
+
+    //! Creates a non-palettized bitmap from a region of the bitmap.
+    Bitmap<Color> region(int x, int y, int width, int height, int pitch = 0);
+
+    //! Copies a region of the bitmap, expanded, into a view.
+    void copy(int x, int y, View const & dst);
+
+    //! Discards the cached tiles that overlap a region of the bitmap.
+    void invalidate(Rect const & rect);
+
+    //! Discards all cached tiles.
+    void clear();
+
+    //! Returns the maximum number of cached tiles.
+    int capacity() const { return capacity_; }
+
+    //! Returns the number of cached tiles, including any made out of date by a palette change.
+    int size() const { return int(lookup_.size()); }
+
+    //! Returns true if the tile in column tx and row ty is cached and up to date.
+    bool contains(int tx, int ty) const;
+
+private:
+
+    static int constexpr MASK      = TILE - 1;
+    static int constexpr TILE_AREA = TILE * TILE;
+
+    // A cached tile. The slots are also a doubly-linked list from the most to the least recently used.
+    struct Slot
+    {
+        int      tx;        // Column of the tile
+        int      ty;        // Row of the tile
+        uint64_t version;   // Palette version of the bitmap when the tile was expanded
+        int      newer;     // Next more recently used slot, or -1
+        int      older;     // Next less recently used slot, or -1
+    };
+
+    // Returns the key of the tile in column tx and row ty
+    static uint64_t keyOf(int tx, int ty) { return (uint64_t(uint32_t(ty)) << 32) | uint32_t(tx); }
+
+    // Returns the slot containing the up-to-date expansion of a tile, expanding it if necessary
+    int acquire(int tx, int ty, Palette<Color> const & palette);
+
+    // Removes a slot from the list
+    void unlink(int slot);
+
+    // Puts a slot at the most recently used end of the list
+    void pushNewest(int slot);
+
+    // Puts a slot at the least recently used end of the list
+    void pushOldest(int slot);
+
+    PalettizedBitmap<Color> const *        bitmap_;         // Source of the tiles
+    int                                    capacity_;       // Maximum number of tiles
+    int                                    used_   = 0;     // Number of slots that have ever held a tile
+    int                                    newest_ = -1;    // Most recently used slot, or -1
+    int                                    oldest_ = -1;    // Least recently used slot, or -1
+    std::pmr::vector<Color>                pixels_;         // Expanded tiles, one per slot
+    std::pmr::vector<Slot>                 slots_;          // The cached tiles
+    std::pmr::unordered_map<uint64_t, int> lookup_;         // Slot of each cached tile
+};
+
+//! The tiles are allocated on construction, so that requests never allocate except to create a bitmap.
+//!
+//! @param  bitmap      Bitmap whose tiles are cached
+//! @param  capacity    Maximum number of tiles to cache
+//! @param  resource    Source of the tiles, or nullptr for the default resource
+template <class Color, int TILE_SIZE>
+TileCache<Color, TILE_SIZE>::TileCache(PalettizedBitmap<Color> const & bitmap,
+                                       int                             capacity,
+                                       std::pmr::memory_resource *     resource /*= nullptr*/)
+    : bitmap_(&bitmap)
+    , capacity_(capacity)
+    , pixels_(size_t(capacity) * TILE_AREA, resource ? resource : std::pmr::get_default_resource())
+    , slots_(size_t(capacity), resource ? resource : std::pmr::get_default_resource())
+    , lookup_(resource ? resource : std::pmr::get_default_resource())
+{
+    assert(capacity > 0);
+    lookup_.reserve(size_t(capacity));
+}
+
+//! The region is clipped to the bounds of the bitmap.
+//!
+//! @param  x       Location of the region
+//! @param  y       Location of the region
+//! @param  width   Width of the region
+//! @param  height  Height of the region
+//! @param  pitch   Pitch of the resulting bitmap
+//!
+//! @return un-palettized bitmap
+template <class Color, int TILE_SIZE>
+Bitmap<Color> TileCache<Color, TILE_SIZE>::region(int x, int y, int width, int height, int pitch /*= 0*/)
+{
+    Rect clipped{ 0, 0, bitmap_->width(), bitmap_->height() };
+    clipped.clip(Rect{ x, y, width, height });
+    if (clipped.width <= 0 || clipped.height <= 0)
+        return Bitmap<Color>();
+
+    Bitmap<Color> result(clipped.width, clipped.height, pitch);
+    copy(clipped.x, clipped.y, result.view());
+    return result;
+}
+
+//! The region is the size of the view, and is clipped to the bounds of the bitmap. Pixels of the view outside the
+//! bitmap are not changed. Each tile overlapping the region is expanded only if it is not cached or out of date.
+//!
+//! @param  x       Location of the region
+//! @param  y       Location of the region
+//! @param  dst     Where to put the expanded pixels
+template <class Color, int TILE_SIZE>
+void TileCache<Color, TILE_SIZE>::copy(int x, int y, View const & dst)
+{
+    Rect clipped{ 0, 0, bitmap_->width(), bitmap_->height() };
+    clipped.clip(Rect{ x, y, dst.width(), dst.height() });
+    if (clipped.width <= 0 || clipped.height <= 0)
+        return;
+
+    Palette<Color> const palette = bitmap_->palette();
+    int const            right   = clipped.x + clipped.width;
+    int const            bottom  = clipped.y + clipped.height;
+    for (int ty = clipped.y / TILE; ty * TILE < bottom; ++ty)
+    {
+        int const top = std::max(ty * TILE, clipped.y);
+        int const end = std::min(ty * TILE + TILE, bottom);
+        for (int tx = clipped.x / TILE; tx * TILE < right; ++tx)
+        {
+            int const           left    = std::max(tx * TILE, clipped.x);
+            int const           columns = std::min(tx * TILE + TILE, right) - left;
+            Color const * const tile    = pixels_.data() + size_t(acquire(tx, ty, palette)) * TILE_AREA + (left & MASK);
+            for (int row = top; row < end; ++row)
+            {
+                memcpy(dst.data(left - x, row - y), tile + (row & MASK) * TILE, columns * sizeof(Color));
+            }
+        }
+    }
+}
+
+//! @param  rect    Region of the bitmap that has changed
+template <class Color, int TILE_SIZE>
+void TileCache<Color, TILE_SIZE>::invalidate(Rect const & rect)
+{
+    if (rect.width <= 0 || rect.height <= 0)
+        return;
+
+    // A discarded slot becomes the least recently used, so it is reused first
+
+    int const right  = rect.x + rect.width;
+    int const bottom = rect.y + rect.height;
+    for (auto i = lookup_.begin(); i != lookup_.end();)
+    {
+        Slot const & slot = slots_[i->second];
+        if (slot.tx * TILE < right && slot.tx * TILE + TILE > rect.x && slot.ty * TILE < bottom &&
+            slot.ty * TILE + TILE > rect.y)
+        {
+            unlink(i->second);
+            pushOldest(i->second);
+            i = lookup_.erase(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+template <class Color, int TILE_SIZE>
+void TileCache<Color, TILE_SIZE>::clear()
+{
+    lookup_.clear();
+    used_   = 0;
+    newest_ = -1;
+    oldest_ = -1;
+}
+
+//! @param  tx  Column of the tile
+//! @param  ty  Row of the tile
+template <class Color, int TILE_SIZE>
+bool TileCache<Color, TILE_SIZE>::contains(int tx, int ty) const
+{
+    auto const i = lookup_.find(keyOf(tx, ty));
+    return i != lookup_.end() && slots_[i->second].version == bitmap_->paletteVersion();
+}
+
+// If the tile is not cached, an unused slot is taken, or else the least recently used one. A slot discarded by
+// invalidate() may still be in the list, but its tile is no longer in the lookup table.
+template <class Color, int TILE_SIZE>
+int TileCache<Color, TILE_SIZE>::acquire(int tx, int ty, Palette<Color> const & palette)
+{
+    uint64_t const version = bitmap_->paletteVersion();
+    uint64_t const key     = keyOf(tx, ty);
+    auto const     i       = lookup_.find(key);
+    int            slot;
+    if (i != lookup_.end())
+    {
+        slot = i->second;
+        unlink(slot);
+        pushNewest(slot);
+        if (slots_[slot].version == version)
+            return slot;
+    }
+    else
+    {
+        if (used_ < capacity_)
+        {
+            slot = used_++;
+        }
+        else
+        {
+            slot = oldest_;
+            unlink(slot);
+            auto const evicted = lookup_.find(keyOf(slots_[slot].tx, slots_[slot].ty));
+            if (evicted != lookup_.end() && evicted->second == slot)
+                lookup_.erase(evicted);
+        }
+        pushNewest(slot);
+        lookup_.emplace(key, slot);
+    }
+
+    int const columns = std::min(TILE, bitmap_->width() - tx * TILE);
+    int const rows    = std::min(TILE, bitmap_->height() - ty * TILE);
+    palette.expand(columns,
+                   rows,
+                   bitmap_->data(tx * TILE, ty * TILE),
+                   bitmap_->pitch(),
+                   pixels_.data() + size_t(slot) * TILE_AREA,
+                   TILE * sizeof(Color));
+    slots_[slot].tx      = tx;
+    slots_[slot].ty      = ty;
+    slots_[slot].version = version;
+    return slot;
+}
+
+template <class Color, int TILE_SIZE>
+void TileCache<Color, TILE_SIZE>::unlink(int slot)
+{
+    Slot & s = slots_[slot];
+    if (s.newer >= 0)
+        slots_[s.newer].older = s.older;
+    else
+        newest_ = s.older;
+    if (s.older >= 0)
+        slots_[s.older].newer = s.newer;
+    else
+        oldest_ = s.newer;
+}
+
+template <class Color, int TILE_SIZE>
+void TileCache<Color, TILE_SIZE>::pushNewest(int slot)
+{
+    slots_[slot].newer = -1;
+    slots_[slot].older = newest_;
+    if (newest_ >= 0)
+        slots_[newest_].newer = slot;
+    else
+        oldest_ = slot;
+    newest_ = slot;
+}
+
+template <class Color, int TILE_SIZE>
+void TileCache<Color, TILE_SIZE>::pushOldest(int slot)
+{
+    slots_[slot].older = -1;
+    slots_[slot].newer = oldest_;
+    if (oldest_ >= 0)
+        slots_[oldest_].older = slot;
+    else
+        newest_ = slot;
+    oldest_ = slot;
+}
+
+#endif // !defined(BITMAP_TILECACHE_H)
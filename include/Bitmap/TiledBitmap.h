@@ -0,0 +1,354 @@
+#if !defined(BITMAP_TILEDBITMAP_H)
+#define BITMAP_TILEDBITMAP_H
+
+#pragma once
+
+#include "Bitmap/Bitmap.h"
+#include "Bitmap/BitmapView.h"
+#include "Bitmap/Parallel.h"
+#include "Rect/Rect.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+
+//! An image stored as square tiles.
+//!
+//! The image is divided into TILE_SIZE x TILE_SIZE tiles, and each tile is stored contiguously, so pixels that are near
+//! each other vertically are also near each other in memory. This suits operations that access 2D neighborhoods, such
+//! as filters, rotations and reads of tall regions, much better than row-major storage.
+//!
+//! The tiles are stored in row-major order, and the pixels within a tile are also in row-major order, so each row of a
+//! tile can be copied as a unit. The image is padded to a whole number of tiles.
+template <typename Pixel, int TILE_SIZE = 8>
+class TiledBitmap
+{
+public:
+
+    static_assert(TILE_SIZE > 0 && (TILE_SIZE & (TILE_SIZE - 1)) == 0, "The tile size must be a power of 2");
+
+    //! Pixel type.
+    using PixelType = Pixel;
+
+    //! Size of a pixel in bytes
+    static size_t constexpr PIXEL_SIZE = sizeof(Pixel);
+
+    //! Width and height of a tile (in pixels)
+    static int constexpr TILE = TILE_SIZE;
+
+    //! Read-only view of a linear image.
+    using ConstView = BitmapView<Pixel const>;
+
+    //! View of a linear image.
+    using View = BitmapView<Pixel>;
+
+    //! Constructor.
+    TiledBitmap() = default;
+
+    //! Constructor.
+    explicit TiledBitmap(std::pmr::memory_resource * resource);
+
+    //! Constructor.
+    TiledBitmap(int width, int height, std::pmr::memory_resource * resource = nullptr);
+
+    //! Constructor.
+    explicit TiledBitmap(ConstView const &           src,
+                         Execution                   execution = Execution::SEQUENTIAL,
+                         std::pmr::memory_resource * resource  = nullptr);
+
+    //! Replaces the image with a linear image.
+    void load(ConstView const & src, Execution execution = Execution::SEQUENTIAL);
+
+    //! Copies the image into a linear image.
+    void store(View const & dst, Execution execution = Execution::SEQUENTIAL) const;
+
+    //! Returns the pixel at (x, y)
+    Pixel pixel(int x, int y) const { return tiles_.data()[offsetOf(x, y)]; }
+
+    //! Sets the pixel at (x, y)
+    void setPixel(int x, int y, Pixel const & value) { tiles_.data()[offsetOf(x, y)] = value; }
+
+    //! Returns the width of the image (in pixels).
+    int width() const { return width_; }
+
+    //! Returns the height of the image (in pixels).
+    int height() const { return height_; }
+
+    //! Returns the number of columns of tiles.
+    int tilesX() const { return tilesX_; }
+
+    //! Returns the number of rows of tiles.
+    int tilesY() const { return tilesY_; }
+
+    //! Returns a pointer to the pixels of the tile in column tx and row ty.
+    Pixel const * tile(int tx, int ty) const { return tiles_.data(0, tileIndex(tx, ty)); }
+
+    //! Returns a pointer to the pixels of the tile in column tx and row ty.
+    Pixel * tile(int tx, int ty) { return tiles_.data(0, tileIndex(tx, ty)); }
+
+    //! Creates a linear bitmap from a region of this image.
+    Bitmap<Pixel> region(int x, int y, int width, int height, size_t pitch = 0) const;
+
+    //! Copies a section of another tiled image into this image
+    void copy(TiledBitmap const & src, Rect const & srcRect, int dstX, int dstY);
+
+    //! Copies a section of a linear image into this image
+    void copy(ConstView const & src, Rect const & srcRect, int dstX, int dstY);
+
+    //! Returns the memory resource that provides the tiles.
+    std::pmr::memory_resource * resource() const { return tiles_.resource(); }
+
+private:
+
+    static int constexpr MASK      = TILE - 1;
+    static int constexpr TILE_AREA = TILE * TILE;
+
+    // Returns the index of a tile
+    int tileIndex(int tx, int ty) const
+    {
+        assert(tx >= 0 && tx < tilesX_);
+        assert(ty >= 0 && ty < tilesY_);
+        return ty * tilesX_ + tx;
+    }
+
+    // Returns the offset of the pixel at (x, y) from the start of the first tile
+    size_t offsetOf(int x, int y) const
+    {
+        assert(x >= 0 && x < width_);
+        assert(y >= 0 && y < height_);
+        size_t tile = tileIndex(int(unsigned(x) / TILE), int(unsigned(y) / TILE));
+        return tile * TILE_AREA + (y & MASK) * TILE + (x & MASK);
+    }
+
+    // Allocates tiles for an image of the given size
+    void resize(int width, int height);
+
+    int width_  = 0;            // Width (in pixels)
+    int height_ = 0;            // Height (in pixels)
+    int tilesX_ = 0;            // Number of columns of tiles
+    int tilesY_ = 0;            // Number of rows of tiles
+    Bitmap<Pixel> tiles_;       // One tile per row
+};
+
+//! @param  resource    Source of the tiles, or nullptr for the default resource
+template <typename Pixel, int TILE_SIZE>
+TiledBitmap<Pixel, TILE_SIZE>::TiledBitmap(std::pmr::memory_resource * resource)
+    : tiles_(resource)
+{
+}
+
+//! The contents of the image are undefined.
+//!
+//! @param  width       Width
+//! @param  height      Height
+//! @param  resource    Source of the tiles, or nullptr for the default resource
+template <typename Pixel, int TILE_SIZE>
+TiledBitmap<Pixel, TILE_SIZE>::TiledBitmap(int width, int height, std::pmr::memory_resource * resource /*= nullptr*/)
+    : tiles_(resource)
+{
+    resize(width, height);
+}
+
+//! @param  src         Linear image to convert
+//! @param  execution   How to perform the conversion
+//! @param  resource    Source of the tiles, or nullptr for the default resource
+template <typename Pixel, int TILE_SIZE>
+TiledBitmap<Pixel, TILE_SIZE>::TiledBitmap(ConstView const &           src,
+                                           Execution                   execution /*= Execution::SEQUENTIAL*/,
+                                           std::pmr::memory_resource * resource /*= nullptr*/)
+    : tiles_(resource)
+{
+    load(src, execution);
+}
+
+//! The image takes the size of the source. The current tiles are reused if there are enough of them.
+//!
+//! @param  src         Linear image to convert
+//! @param  execution   How to perform the conversion
+template <typename Pixel, int TILE_SIZE>
+void TiledBitmap<Pixel, TILE_SIZE>::load(ConstView const & src, Execution execution /*= Execution::SEQUENTIAL*/)
+{
+    resize(src.width(), src.height());
+    if (width_ == 0)
+        return;
+
+    // Each row of tiles is converted separately. Every row of a tile is a single copy of TILE pixels, except in the
+    // last column of tiles.
+
+    Pixel * const tiles = tiles_.data();
+    forEachBand(execution, tilesY_, TILE * width_ * PIXEL_SIZE, [&] (int begin, int end) {
+        for (int ty = begin; ty < end; ++ty)
+        {
+            int rows = std::min(TILE, height_ - ty * TILE);
+            for (int tx = 0; tx < tilesX_; ++tx)
+            {
+                Pixel * t       = tiles + size_t(ty * tilesX_ + tx) * TILE_AREA;
+                int     columns = std::min(TILE, width_ - tx * TILE);
+                for (int r = 0; r < rows; ++r)
+                {
+                    Pixel const * s = src.data(tx * TILE, ty * TILE + r);
+                    if (columns == TILE)
+                        memcpy(t + r * TILE, s, TILE * PIXEL_SIZE);
+                    else
+                        memcpy(t + r * TILE, s, columns * PIXEL_SIZE);
+                }
+            }
+        }
+    });
+}
+
+//! If the destination differs in size, only the overlapping area (from the top left) is copied.
+//!
+//! @param  dst         Linear image to receive the pixels
+//! @param  execution   How to perform the conversion
+template <typename Pixel, int TILE_SIZE>
+void TiledBitmap<Pixel, TILE_SIZE>::store(View const & dst, Execution execution /*= Execution::SEQUENTIAL*/) const
+{
+    int const width  = std::min(width_, dst.width());
+    int const height = std::min(height_, dst.height());
+    if (width <= 0 || height <= 0)
+        return;
+
+    Pixel const * const tiles = tiles_.data();
+    int const           bands = (height + TILE - 1) / TILE;
+    forEachBand(execution, bands, TILE * width * PIXEL_SIZE, [&] (int begin, int end) {
+        for (int ty = begin; ty < end; ++ty)
+        {
+            int rows = std::min(TILE, height - ty * TILE);
+            for (int tx = 0; tx * TILE < width; ++tx)
+            {
+                Pixel const * t       = tiles + size_t(ty * tilesX_ + tx) * TILE_AREA;
+                int           columns = std::min(TILE, width - tx * TILE);
+                for (int r = 0; r < rows; ++r)
+                {
+                    Pixel * d = dst.data(tx * TILE, ty * TILE + r);
+                    if (columns == TILE)
+                        memcpy(d, t + r * TILE, TILE * PIXEL_SIZE);
+                    else
+                        memcpy(d, t + r * TILE, columns * PIXEL_SIZE);
+                }
+            }
+        }
+    });
+}
+
+//! The region is clipped to the bounds of the image.
+//!
+//! @param  x           Left of the region
+//! @param  y           Top of the region
+//! @param  width       Width of the region
+//! @param  height      Height of the region
+//! @param  pitch       Pitch of the resulting bitmap, or 0 if determined by width
+//!
+//! @return     resulting bitmap
+template <typename Pixel, int TILE_SIZE>
+Bitmap<Pixel> TiledBitmap<Pixel, TILE_SIZE>::region(int x, int y, int width, int height, size_t pitch /*= 0*/) const
+{
+    Rect rect{ 0, 0, width_, height_ };
+    rect.clip(Rect{ x, y, width, height });
+    if (rect.width <= 0 || rect.height <= 0)
+        return Bitmap<Pixel>();
+
+    Bitmap<Pixel> r(rect.width, rect.height, pitch);
+    Pixel const * tiles = tiles_.data();
+    for (int row = 0; row < rect.height; ++row)
+    {
+        Pixel * d = r.data(0, row);
+        for (int column = 0; column < rect.width;)
+        {
+            int sx = rect.x + column;
+            int n  = std::min(TILE - (sx & MASK), rect.width - column);
+            memcpy(d + column, tiles + offsetOf(sx, rect.y + row), n * PIXEL_SIZE);
+            column += n;
+        }
+    }
+    return r;
+}
+
+//! @param  src         Source image
+//! @param  srcRect     Region of the source image to copy
+//! @param  dstX        Where to place the copy
+//! @param  dstY        Where to place the copy
+//!
+//! @warning    The source must not be this image.
+template <typename Pixel, int TILE_SIZE>
+void TiledBitmap<Pixel, TILE_SIZE>::copy(TiledBitmap const & src, Rect const & srcRect, int dstX, int dstY)
+{
+    assert(&src != this);
+
+    Rect rect = srcRect;
+    clipCopy(&rect, src.width_, src.height_, &dstX, &dstY, width_, height_);
+    if (rect.width <= 0 || rect.height <= 0)
+        return;
+
+    // Each row is copied in pieces that lie within a single tile of both images
+    Pixel const * s = src.tiles_.data();
+    Pixel *       d = tiles_.data();
+    for (int row = 0; row < rect.height; ++row)
+    {
+        int sy = rect.y + row;
+        int dy = dstY + row;
+        for (int column = 0; column < rect.width;)
+        {
+            int sx = rect.x + column;
+            int dx = dstX + column;
+            int n  = std::min({ TILE - (sx & MASK), TILE - (dx & MASK), rect.width - column });
+            memcpy(d + offsetOf(dx, dy), s + src.offsetOf(sx, sy), n * PIXEL_SIZE);
+            column += n;
+        }
+    }
+}
+
+//! @param  src         Source image
+//! @param  srcRect     Region of the source image to copy
+//! @param  dstX        Where to place the copy
+//! @param  dstY        Where to place the copy
+template <typename Pixel, int TILE_SIZE>
+void TiledBitmap<Pixel, TILE_SIZE>::copy(ConstView const & src, Rect const & srcRect, int dstX, int dstY)
+{
+    Rect rect = srcRect;
+    clipCopy(&rect, src.width(), src.height(), &dstX, &dstY, width_, height_);
+    if (rect.width <= 0 || rect.height <= 0)
+        return;
+
+    Pixel * d = tiles_.data();
+    for (int row = 0; row < rect.height; ++row)
+    {
+        Pixel const * s  = src.data(rect.x, rect.y + row);
+        int           dy = dstY + row;
+        for (int column = 0; column < rect.width;)
+        {
+            int dx = dstX + column;
+            int n  = std::min(TILE - (dx & MASK), rect.width - column);
+            memcpy(d + offsetOf(dx, dy), s + column, n * PIXEL_SIZE);
+            column += n;
+        }
+    }
+}
+
+template <typename Pixel, int TILE_SIZE>
+void TiledBitmap<Pixel, TILE_SIZE>::resize(int width, int height)
+{
+    assert(width >= 0);
+    assert(height >= 0);
+
+    if (width == 0 || height == 0)
+    {
+        width  = 0;
+        height = 0;
+    }
+
+    width_  = width;
+    height_ = height;
+    tilesX_ = (width + TILE - 1) / TILE;
+    tilesY_ = (height + TILE - 1) / TILE;
+
+    int count = tilesX_ * tilesY_;
+    if (count == 0)
+        tiles_ = Bitmap<Pixel>(tiles_.resource());
+    else if (tiles_.height() < count)
+        tiles_ = Bitmap<Pixel>(TILE_AREA, count, 0, nullptr, tiles_.resource());
+}
+
+#endif // !defined(BITMAP_TILEDBITMAP_H)
@@ -0,0 +1,75 @@
+#if !defined(BITMAP_TESTUTIL_H)
+#define BITMAP_TESTUTIL_H
+
+#pragma once
+
+#include "Bitmap/Bitmap.h"
+#include "Bitmap/Palette.h"
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+// Returns a bitmap filled with pseudo-random bytes. Different seeds give different images.
+template <class Pixel>
+Bitmap<Pixel> testImage(int width, int height, unsigned seed = 1)
+{
+    Bitmap<Pixel> image(width, height);
+    for (int y = 0; y < height; ++y)
+    {
+        uint8_t * row = reinterpret_cast<uint8_t *>(image.data(0, y));
+        for (size_t i = 0; i < width * sizeof(Pixel); ++i)
+        {
+            seed   = seed * 1664525u + 1013904223u;
+            row[i] = uint8_t(seed >> 24);
+        }
+    }
+    return image;
+}
+
+// Returns a palette of distinct colors. Different seeds give different palettes.
+template <class Color>
+Palette<Color> makePalette(uint32_t seed = 0x10203040u)
+{
+    Palette<Color> palette;
+    for (int i = 0; i < int(Palette<Color>::PALETTE_SIZE); ++i)
+    {
+        palette[i] = Color(uint32_t(i * 0x01020305u + seed));
+    }
+    return palette;
+}
+
+// A temporary file named after the current test, so that the tests can run in parallel. The file is removed when the
+// object is destroyed.
+class TemporaryFile
+{
+public:
+
+    TemporaryFile()
+    {
+        ::testing::TestInfo const * test = ::testing::UnitTest::GetInstance()->current_test_info();
+        std::string const name = std::string("Bitmap-") + test->test_suite_name() + "-" + test->name() + ".tmp";
+        path_ = (std::filesystem::temp_directory_path() / name).string();
+    }
+
+    ~TemporaryFile()
+    {
+        std::error_code error;
+        std::filesystem::remove(path_, error);
+    }
+
+    TemporaryFile(TemporaryFile const &) = delete;
+    TemporaryFile & operator =(TemporaryFile const &) = delete;
+
+    // Returns the path of the file
+    char const * path() const { return path_.c_str(); }
+
+private:
+
+    std::string path_;
+};
+
+#endif // !defined(BITMAP_TESTUTIL_H)
@@ -2,6 +2,7 @@
 
 #include "gtest/gtest.h"
 
+#include <memory_resource>
 #include <numeric>
 #include <vector>
 
@@ -17,6 +18,32 @@ static bool imageIsSame(void const * a, void const * b, int width, int height, s
     return true;
 }
 
+// A memory resource that counts the allocations made through it.
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    int allocations   = 0;
+    int deallocations = 0;
+    size_t outstanding = 0;
+
+private:
+    void * do_allocate(size_t bytes, size_t alignment) override
+    {
+        ++allocations;
+        outstanding += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void * p, size_t bytes, size_t alignment) override
+    {
+        ++deallocations;
+        outstanding -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(std::pmr::memory_resource const & other) const noexcept override { return this == &other; }
+};
+
 TEST(BitmapTest, EmptyConstructor)
 {
     Bitmap<uint32_t> const empty_constructed;
@@ -1324,6 +1351,392 @@ TEST(BitmapTest, Pixel)
     }
 }
 
+TEST(BitmapTest, MemoryResource)
+{
+    std::vector<uint16_t> data(128 * 256);
+    std::iota(data.begin(), data.end(), 0);
+
+    {
+        CountingResource resource;
+        {
+            Bitmap<uint16_t> constructed(128, 200, 0, &data[0], &resource);
+            EXPECT_EQ(constructed.resource(), &resource);
+            EXPECT_EQ(resource.allocations, 1);
+            EXPECT_GE(resource.outstanding, 128 * 200 * sizeof(uint16_t));
+
+            // A copy uses the default resource unless one is specified
+            Bitmap<uint16_t> const copy(constructed);
+            EXPECT_EQ(copy.resource(), std::pmr::get_default_resource());
+            EXPECT_EQ(resource.allocations, 1);
+
+            Bitmap<uint16_t> const resource_copy(constructed, &resource);
+            EXPECT_EQ(resource_copy.resource(), &resource);
+            EXPECT_EQ(resource.allocations, 2);
+            EXPECT_EQ(memcmp(resource_copy.data(), &data[0], 128 * 200 * sizeof(uint16_t)), 0);
+
+            // Assignment and load keep the resource
+            Bitmap<uint16_t> assigned(&resource);
+            assigned = copy;
+            EXPECT_EQ(assigned.resource(), &resource);
+            EXPECT_EQ(resource.allocations, 3);
+            assigned.load(99, 201, 128 * sizeof(uint16_t), &data[0]);
+            EXPECT_EQ(resource.allocations, 4);
+
+            // Moving between bitmaps with the same resource does not allocate
+            Bitmap<uint16_t> moved(std::move(constructed));
+            EXPECT_EQ(moved.resource(), &resource);
+            moved = std::move(assigned);
+            EXPECT_EQ(resource.allocations, 4);
+
+            // Moving between bitmaps with different resources copies (into the existing allocation)
+            moved = Bitmap<uint16_t>(copy);
+            EXPECT_EQ(moved.resource(), &resource);
+            EXPECT_EQ(resource.allocations, 4);
+            EXPECT_EQ(memcmp(moved.data(), &data[0], 128 * 200 * sizeof(uint16_t)), 0);
+        }
+        EXPECT_EQ(resource.deallocations, resource.allocations);
+        EXPECT_EQ(resource.outstanding, 0);
+    }
+
+    {
+        std::pmr::monotonic_buffer_resource arena;
+        Bitmap<uint32_t> const arena_bitmap(64, 64, 0, nullptr, &arena);
+        EXPECT_EQ(arena_bitmap.resource(), &arena);
+        EXPECT_NE(arena_bitmap.data(), nullptr);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(arena_bitmap.data()) % Bitmap<uint32_t>::ROW_ALIGNMENT, 0);
+    }
+}
+
+TEST(BitmapTest, CopyOnWrite)
+{
+    Bitmap<uint16_t> original(255, 127, 256 * sizeof(uint16_t));
+    std::iota(original.data(), original.data() + 127 * 256, 0);
+    EXPECT_FALSE(original.copyOnWrite());
+    EXPECT_FALSE(original.shared());
+
+    // Without copy-on-write, copies are never shared
+
+    {
+        Bitmap<uint16_t> const copy(original);
+        EXPECT_FALSE(copy.shared());
+        EXPECT_FALSE(original.shared());
+    }
+
+    original.setCopyOnWrite(true);
+    EXPECT_TRUE(original.copyOnWrite());
+    Bitmap<uint16_t> const & const_original = original;
+
+    // Copies share the data until one of them is modified
+
+    {
+        Bitmap<uint16_t> copy(original);
+        EXPECT_TRUE(copy.copyOnWrite());
+        EXPECT_TRUE(copy.shared());
+        EXPECT_TRUE(original.shared());
+        EXPECT_EQ(static_cast<Bitmap<uint16_t> const &>(copy).data(), const_original.data());
+
+        Bitmap<uint16_t> assigned;
+        assigned = copy;
+        EXPECT_EQ(static_cast<Bitmap<uint16_t> const &>(assigned).data(), const_original.data());
+
+        *copy.data(2, 1) = 0xffff;
+        EXPECT_FALSE(copy.shared());
+        EXPECT_NE(static_cast<Bitmap<uint16_t> const &>(copy).data(), const_original.data());
+        EXPECT_EQ(copy.pixel(2, 1), 0xffff);
+        EXPECT_EQ(original.pixel(2, 1), 258);
+        EXPECT_EQ(assigned.pixel(2, 1), 258);
+        EXPECT_TRUE(original.shared());
+
+        assigned.copy(copy, Rect{ 0, 0, 4, 4 }, 0, 0);
+        EXPECT_FALSE(assigned.shared());
+        EXPECT_EQ(assigned.pixel(2, 1), 0xffff);
+        EXPECT_EQ(original.pixel(2, 1), 258);
+        EXPECT_FALSE(original.shared());
+    }
+
+    // A moved bitmap keeps sharing
+
+    {
+        Bitmap<uint16_t> copy(original);
+        Bitmap<uint16_t> moved(std::move(copy));
+        EXPECT_TRUE(moved.shared());
+        EXPECT_EQ(static_cast<Bitmap<uint16_t> const &>(moved).data(), const_original.data());
+
+        moved.load(4, 4, 0, const_original.data());
+        EXPECT_FALSE(moved.shared());
+        EXPECT_FALSE(original.shared());
+    }
+
+    // Mutable views detach
+
+    {
+        Bitmap<uint16_t> copy(original);
+        Bitmap<uint16_t>::View view = copy.view(1, 1, 2, 2);
+        *view.data() = 1;
+        EXPECT_FALSE(copy.shared());
+        EXPECT_EQ(copy.pixel(1, 1), 1);
+        EXPECT_EQ(original.pixel(1, 1), 257);
+    }
+
+    // Disabling copy-on-write detaches
+
+    {
+        Bitmap<uint16_t> copy(original);
+        copy.setCopyOnWrite(false);
+        EXPECT_FALSE(copy.shared());
+        EXPECT_FALSE(original.shared());
+        EXPECT_TRUE(imageIsSame(copy.data(), const_original.data(), 255 * sizeof(uint16_t), 127, copy.pitch(), original.pitch()));
+    }
+}
+
+TEST(BitmapTest, Adopt)
+{
+    size_t const HEADER = Bitmap<uint16_t>::BUFFER_HEADER_SIZE;
+
+    // The memory is provided by another bitmap so that it is aligned
+    Bitmap<uint8_t> storage(int(HEADER + 128 * 20), 1);
+    uint16_t *      data = reinterpret_cast<uint16_t *>(storage.data() + HEADER);
+    std::iota(data, data + 64 * 20, 0);
+
+    {
+        Bitmap<uint16_t> bitmap;
+        bitmap.adopt(60, 20, 128, data);
+        EXPECT_EQ(bitmap.width(), 60);
+        EXPECT_EQ(bitmap.height(), 20);
+        EXPECT_EQ(bitmap.pitch(), 128);
+        EXPECT_EQ(static_cast<Bitmap<uint16_t> const &>(bitmap).data(), data);
+        EXPECT_EQ(bitmap.pixel(3, 2), 131);
+
+        // Changes are made in place
+        *bitmap.data(1, 1) = 0xffff;
+        EXPECT_EQ(data[65], 0xffff);
+
+        // Copies share the memory if copy-on-write is enabled, and detach when they are modified
+        bitmap.setCopyOnWrite(true);
+        Bitmap<uint16_t> copy(bitmap);
+        EXPECT_TRUE(copy.shared());
+        *copy.data(0, 0) = 1;
+        EXPECT_FALSE(copy.shared());
+        EXPECT_EQ(data[0], 0);
+
+        // Loading an image that fits reuses the memory
+        uint16_t const small[4] = { 9, 8, 7, 6 };
+        bitmap.setCopyOnWrite(false);
+        bitmap.load(2, 2, 0, small);
+        EXPECT_EQ(static_cast<Bitmap<uint16_t> const &>(bitmap).data(), data);
+        EXPECT_EQ(data[3], 6);
+    }
+
+    // The memory is not freed by the bitmap
+    EXPECT_EQ(data[2], 7);
+}
+
+TEST(BitmapTest, Capacity)
+{
+    std::vector<uint16_t> data(128 * 256);
+    std::iota(data.begin(), data.end(), 0);
+
+    CountingResource resource;
+    {
+        Bitmap<uint16_t> bitmap(&resource);
+        EXPECT_EQ(bitmap.capacity(), 0);
+
+        bitmap.load(128, 200, 0, &data[0]);
+        EXPECT_EQ(bitmap.capacity(), 128 * 200 * sizeof(uint16_t));
+        EXPECT_EQ(resource.allocations, 1);
+
+        // Loading an image of the same size or smaller reuses the allocation
+
+        bitmap.load(128, 200, 0, &data[0]);
+        EXPECT_EQ(resource.allocations, 1);
+
+        bitmap.load(99, 100, 128 * sizeof(uint16_t), &data[0]);
+        EXPECT_EQ(resource.allocations, 1);
+        EXPECT_EQ(bitmap.width(), 99);
+        EXPECT_EQ(bitmap.height(), 100);
+        EXPECT_EQ(bitmap.capacity(), 128 * 200 * sizeof(uint16_t));
+        EXPECT_EQ(memcmp(bitmap.data(), &data[0], 128 * 100 * sizeof(uint16_t)), 0);
+
+        // Loading from the bitmap's own data
+
+        bitmap.load(64, 100, 0, bitmap.data(1, 0));
+        EXPECT_EQ(resource.allocations, 1);
+        EXPECT_EQ(bitmap.pixel(0, 0), 1);
+        EXPECT_EQ(bitmap.pixel(0, 1), 65);
+
+        // Assignment reuses the allocation too
+
+        Bitmap<uint16_t> const small(16, 16, 0, &data[0]);
+        bitmap = small;
+        EXPECT_EQ(resource.allocations, 1);
+        EXPECT_EQ(bitmap.width(), 16);
+        EXPECT_EQ(bitmap.height(), 16);
+        EXPECT_EQ(memcmp(bitmap.data(), &data[0], 16 * 16 * sizeof(uint16_t)), 0);
+
+        // Loading a larger image allocates
+
+        bitmap.load(128, 201, 0, &data[0]);
+        EXPECT_EQ(resource.allocations, 2);
+        EXPECT_EQ(resource.deallocations, 1);
+
+        // Shrinking
+
+        bitmap.load(16, 16, 0, &data[0]);
+        EXPECT_EQ(resource.allocations, 2);
+        bitmap.shrinkToFit();
+        EXPECT_EQ(resource.allocations, 3);
+        EXPECT_EQ(bitmap.capacity(), 16 * 16 * sizeof(uint16_t));
+        EXPECT_EQ(memcmp(bitmap.data(), &data[0], 16 * 16 * sizeof(uint16_t)), 0);
+        bitmap.shrinkToFit();
+        EXPECT_EQ(resource.allocations, 3);
+
+        // A shared allocation is not reused
+
+        bitmap.setCopyOnWrite(true);
+        Bitmap<uint16_t> const copy(bitmap);
+        bitmap.load(8, 8, 0, &data[0]);
+        EXPECT_EQ(resource.allocations, 4);
+        EXPECT_EQ(memcmp(copy.data(), &data[0], 16 * 16 * sizeof(uint16_t)), 0);
+    }
+    EXPECT_EQ(resource.deallocations, resource.allocations);
+}
+
+TEST(BitmapTest, AlignedPitch)
+{
+    EXPECT_EQ(Bitmap<uint8_t>::alignedPitch(0), 0);
+    EXPECT_EQ(Bitmap<uint8_t>::alignedPitch(1), 64);
+    EXPECT_EQ(Bitmap<uint8_t>::alignedPitch(64), 64);
+    EXPECT_EQ(Bitmap<uint8_t>::alignedPitch(65), 128);
+    EXPECT_EQ(Bitmap<uint16_t>::alignedPitch(33), 128);
+    EXPECT_EQ(Bitmap<uint32_t>::alignedPitch(17, 16), 80);
+    EXPECT_EQ(Bitmap<PixelRGB>::alignedPitch(1), 192);
+    EXPECT_EQ(Bitmap<PixelRGB>::alignedPitch(65), 384);
+
+    {
+        int const    WIDTH  = 99;
+        int const    HEIGHT = 17;
+        size_t const PITCH  = Bitmap<uint16_t>::alignedPitch(WIDTH);
+
+        Bitmap<uint16_t> const aligned(WIDTH, HEIGHT, PITCH);
+
+        EXPECT_EQ(aligned.pitch(), PITCH);
+        for (int y = 0; y < HEIGHT; ++y)
+        {
+            EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned.data(0, y)) % Bitmap<uint16_t>::ROW_ALIGNMENT, 0);
+        }
+    }
+
+    {
+        Bitmap<uint8_t> const unaligned_pitch(3, 3);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(unaligned_pitch.data()) % Bitmap<uint8_t>::ROW_ALIGNMENT, 0);
+    }
+}
+
+TEST(BitmapTest, ParallelCopy)
+{
+    int const    WIDTH      = 2048;
+    int const    HEIGHT     = 1024;
+    size_t const SRC_PITCH  = (WIDTH + 16) * sizeof(uint32_t);
+
+    std::vector<uint32_t> data(SRC_PITCH / sizeof(uint32_t) * HEIGHT);
+    std::iota(data.begin(), data.end(), 0);
+    Bitmap<uint32_t> source(WIDTH, HEIGHT, SRC_PITCH, data.data());
+
+    for (Execution execution : { Execution::SEQUENTIAL, Execution::PARALLEL })
+    {
+        // Entire bitmap, contiguous destination
+
+        {
+            Bitmap<uint32_t> dst(WIDTH, HEIGHT);
+            Bitmap<uint32_t> packed(WIDTH, HEIGHT);
+            packed.copy(source, Rect{ 0, 0, WIDTH, HEIGHT }, 0, 0);
+            dst.copy(packed, Rect{ 0, 0, WIDTH, HEIGHT }, 0, 0, execution);
+            EXPECT_TRUE(imageIsSame(dst.data(), source.data(), WIDTH * sizeof(uint32_t), HEIGHT, dst.pitch(), SRC_PITCH));
+        }
+
+        // Clipped region with different pitches
+
+        {
+            Bitmap<uint32_t> dst(WIDTH, HEIGHT, Bitmap<uint32_t>::alignedPitch(WIDTH + 1));
+            memset(dst.data(), 0, dst.pitch() * HEIGHT);
+            dst.copy(source, Rect{ 5, 7, WIDTH, HEIGHT }, -3, 11, execution);
+
+            int const COPY_WIDTH  = WIDTH - 5 - 3;
+            int const COPY_HEIGHT = HEIGHT - 11;
+            EXPECT_TRUE(imageIsSame(dst.data(0, 11),
+                                    source.data(8, 7),
+                                    COPY_WIDTH * sizeof(uint32_t),
+                                    COPY_HEIGHT,
+                                    dst.pitch(),
+                                    SRC_PITCH));
+            for (int y = 0; y < 11; ++y)
+            {
+                EXPECT_EQ(dst.pixel(0, y), 0u);
+            }
+            for (int y = 11; y < HEIGHT; ++y)
+            {
+                EXPECT_EQ(dst.pixel(WIDTH - 1, y), 0u);
+            }
+        }
+    }
+}
+
+TEST(BitmapTest, BatchCopy)
+{
+    int const ATLAS_WIDTH  = 256;
+    int const ATLAS_HEIGHT = 256;
+    int const WIDTH        = 1024;
+    int const HEIGHT       = 1024;
+    int const SPRITE_SIZE  = 48;
+    int const SPRITES      = 4000;
+
+    Bitmap<uint32_t> atlas(ATLAS_WIDTH, ATLAS_HEIGHT, Bitmap<uint32_t>::alignedPitch(ATLAS_WIDTH + 1));
+    for (int y = 0; y < ATLAS_HEIGHT; ++y)
+    {
+        std::iota(atlas.data(0, y), atlas.data(0, y) + ATLAS_WIDTH, uint32_t(y * ATLAS_WIDTH));
+    }
+
+    // Overlapping operations, including some that are clipped or entirely outside either image
+
+    std::vector<Bitmap<uint32_t>::Blit> blits;
+    uint32_t random = 1;
+    auto next = [&random] (int range) {
+        random = random * 1664525u + 1013904223u;
+        return int((random >> 8) % range);
+    };
+    for (int i = 0; i < SPRITES; ++i)
+    {
+        Rect srcRect{ next(ATLAS_WIDTH + 32) - 16, next(ATLAS_HEIGHT + 32) - 16, SPRITE_SIZE, SPRITE_SIZE };
+        blits.push_back({ atlas.view(), srcRect, next(WIDTH + 128) - 64, next(HEIGHT + 128) - 64 });
+    }
+    blits.push_back({ atlas.view(), Rect{ 0, 0, SPRITE_SIZE, SPRITE_SIZE }, WIDTH, 0 });
+    blits.push_back({ atlas.view(), Rect{ 0, 0, 0, SPRITE_SIZE }, 0, 0 });
+
+    Bitmap<uint32_t> expected(WIDTH, HEIGHT);
+    memset(expected.data(), 0, expected.pitch() * HEIGHT);
+    for (auto const & blit : blits)
+    {
+        expected.copy(blit.src, blit.srcRect, blit.dstX, blit.dstY);
+    }
+
+    for (Execution execution : { Execution::SEQUENTIAL, Execution::PARALLEL })
+    {
+        Bitmap<uint32_t> dst(WIDTH, HEIGHT);
+        memset(dst.data(), 0, dst.pitch() * HEIGHT);
+        dst.copy(blits.data(), blits.size(), execution);
+        EXPECT_TRUE(imageIsSame(dst.data(), expected.data(), WIDTH * sizeof(uint32_t), HEIGHT, dst.pitch(), expected.pitch()));
+    }
+
+    // Empty batch
+
+    {
+        Bitmap<uint32_t> dst(16, 16);
+        memset(dst.data(), 0, dst.pitch() * 16);
+        dst.copy(nullptr, 0);
+        EXPECT_EQ(dst.pixel(0, 0), 0u);
+    }
+}
+
 #if 0
 
 //! Copies a section of another bitmap into this bitmap
@@ -0,0 +1,152 @@
+#include "Bitmap/Bitmap.h"
+#include "Bitmap/BitmapView.h"
+
+#include "gtest/gtest.h"
+
+#include <numeric>
+#include <vector>
+
+TEST(BitmapViewTest, EmptyConstructor)
+{
+    BitmapView<uint16_t> const empty_constructed;
+    EXPECT_EQ(empty_constructed.width(), 0);
+    EXPECT_EQ(empty_constructed.height(), 0);
+    EXPECT_EQ(empty_constructed.pitch(), 0);
+    EXPECT_TRUE(empty_constructed.empty());
+    EXPECT_EQ(empty_constructed.data(), nullptr);
+    EXPECT_EQ(empty_constructed.pixel(0, 0), 0);
+}
+
+TEST(BitmapViewTest, ExternalBuffer)
+{
+    std::vector<uint16_t> data(128 * 200);
+    std::iota(data.begin(), data.end(), 0);
+
+    {
+        int const    WIDTH  = 99;
+        int const    HEIGHT = 200;
+        size_t const PITCH  = 128 * sizeof(uint16_t);
+
+        BitmapView<uint16_t> const view(WIDTH, HEIGHT, PITCH, &data[0]);
+
+        EXPECT_EQ(view.width(), WIDTH);
+        EXPECT_EQ(view.height(), HEIGHT);
+        EXPECT_EQ(view.pitch(), PITCH);
+        EXPECT_EQ(view.data(), &data[0]);
+        EXPECT_EQ(view.data(2, 1), &data[130]);
+        EXPECT_EQ(view.row(3), &data[384]);
+        EXPECT_EQ(view.pixel(2, 1), 130);
+
+        *view.data(2, 1) = 7;
+        EXPECT_EQ(data[130], 7);
+        data[130] = 130;
+    }
+
+    {
+        BitmapView<uint16_t const> const view(128, 200, 0, &data[0]);
+
+        EXPECT_EQ(view.pitch(), 128 * sizeof(uint16_t));
+        EXPECT_EQ(view.data(2, 1), &data[130]);
+    }
+
+    {
+        BitmapView<uint16_t> const mutable_view(128, 200, 0, &data[0]);
+        BitmapView<uint16_t const> const const_view = mutable_view;
+
+        EXPECT_EQ(const_view.width(), mutable_view.width());
+        EXPECT_EQ(const_view.height(), mutable_view.height());
+        EXPECT_EQ(const_view.pitch(), mutable_view.pitch());
+        EXPECT_EQ(const_view.data(), mutable_view.data());
+    }
+}
+
+TEST(BitmapViewTest, Subview)
+{
+    std::vector<uint16_t> data(128 * 200);
+    std::iota(data.begin(), data.end(), 0);
+    BitmapView<uint16_t> const view(99, 200, 128 * sizeof(uint16_t), &data[0]);
+
+    {
+        BitmapView<uint16_t> const subview = view.subview(31, 63, 33, 65);
+
+        EXPECT_EQ(subview.width(), 33);
+        EXPECT_EQ(subview.height(), 65);
+        EXPECT_EQ(subview.pitch(), view.pitch());
+        EXPECT_EQ(subview.data(), view.data(31, 63));
+        EXPECT_EQ(subview.pixel(1, 2), view.pixel(32, 65));
+    }
+
+    {
+        BitmapView<uint16_t> const subview = view.subview(-10, 190, 20, 20);
+
+        EXPECT_EQ(subview.width(), 10);
+        EXPECT_EQ(subview.height(), 10);
+        EXPECT_EQ(subview.data(), view.data(0, 190));
+    }
+
+    {
+        BitmapView<uint16_t> const subview = view.subview(200, 0, 20, 20);
+
+        EXPECT_TRUE(subview.empty());
+        EXPECT_EQ(subview.width(), 0);
+        EXPECT_EQ(subview.height(), 0);
+    }
+}
+
+TEST(BitmapViewTest, BitmapView)
+{
+    Bitmap<uint16_t> source(127, 256, 256 * sizeof(uint16_t));
+    std::iota(source.data(), source.data() + 256 * 256, 0);
+
+    {
+        Bitmap<uint16_t>::ConstView const view = static_cast<Bitmap<uint16_t> const &>(source).view();
+
+        EXPECT_EQ(view.width(), source.width());
+        EXPECT_EQ(view.height(), source.height());
+        EXPECT_EQ(view.pitch(), source.pitch());
+        EXPECT_EQ(view.data(), source.data());
+    }
+
+    {
+        Bitmap<uint16_t>::View const view = source.view(31, 63, 33, 65);
+
+        EXPECT_EQ(view.width(), 33);
+        EXPECT_EQ(view.height(), 65);
+        EXPECT_EQ(view.pitch(), source.pitch());
+        EXPECT_EQ(view.data(), source.data(31, 63));
+
+        *view.data(0, 0) = 1;
+        EXPECT_EQ(source.pixel(31, 63), 1);
+    }
+
+    {
+        Bitmap<uint16_t> empty;
+        EXPECT_TRUE(empty.view().empty());
+        EXPECT_TRUE(empty.view(0, 0, 64, 64).empty());
+    }
+}
+
+TEST(BitmapViewTest, CopyFromView)
+{
+    std::vector<uint16_t> data(64 * 64);
+    std::iota(data.begin(), data.end(), 0);
+    BitmapView<uint16_t const> const source(64, 64, 0, &data[0]);
+
+    Bitmap<uint16_t> destination(32, 32);
+    memset(destination.data(), 0, destination.pitch() * destination.height());
+    destination.copy(source, Rect{ 8, 4, 16, 8 }, 10, 20);
+
+    EXPECT_EQ(destination.pixel(9, 20), 0);
+    EXPECT_EQ(destination.pixel(10, 19), 0);
+    EXPECT_EQ(destination.pixel(10, 20), source.pixel(8, 4));
+    EXPECT_EQ(destination.pixel(25, 27), source.pixel(23, 11));
+    EXPECT_EQ(destination.pixel(26, 27), 0);
+    EXPECT_EQ(destination.pixel(25, 28), 0);
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
@@ -0,0 +1,182 @@
+#include "Bitmap/Bitmap.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+static BlendMode const MODES[] =
+{
+    BlendMode::SRC_OVER, BlendMode::SRC_IN, BlendMode::DST_OVER, BlendMode::ADD, BlendMode::MULTIPLY
+};
+
+// Returns a * b / 255, rounded to nearest
+static int product(int a, int b)
+{
+    return int(std::lround(double(a) * double(b) / 255.0));
+}
+
+// Returns the expected result of blending a channel
+static int expected(BlendMode mode, int s, int d, int sa, int da)
+{
+    int r = 0;
+    switch (mode)
+    {
+        case BlendMode::SRC_OVER: r = s + product(d, 255 - sa);                                 break;
+        case BlendMode::SRC_IN:   r = product(s, da);                                           break;
+        case BlendMode::DST_OVER: r = d + product(s, 255 - da);                                 break;
+        case BlendMode::ADD:      r = s + d;                                                    break;
+        case BlendMode::MULTIPLY: r = product(s, d) + product(s, 255 - da) + product(d, 255 - sa); break;
+    }
+    return std::min(r, 255);
+}
+
+// Fills pixels with premultiplied values
+template <class Pixel>
+static void fillPremultiplied(Pixel * pixels, int count, unsigned seed)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        unsigned a = (seed >> 24) & 0xff;
+        if (i % 7 == 0)
+            a = 0xff;
+        else if (i % 7 == 1)
+            a = 0;
+        unsigned r = a ? (seed >> 16) % (a + 1) : 0;
+        unsigned g = a ? (seed >> 8) % (a + 1) : 0;
+        unsigned b = a ? seed % (a + 1) : 0;
+        pixels[i].set8(uint8_t(r), uint8_t(g), uint8_t(b), uint8_t(a));
+    }
+}
+
+template <class Pixel>
+static void testBlendRow()
+{
+    int const WIDTH = 37;
+
+    std::vector<Pixel> src(WIDTH);
+    std::vector<Pixel> dst(WIDTH);
+    fillPremultiplied(src.data(), WIDTH, 1);
+    fillPremultiplied(dst.data(), WIDTH, 2);
+
+    for (BlendMode mode : MODES)
+    {
+        std::vector<Pixel> result = dst;
+        PixelBlender<Pixel>::blendRow(mode, src.data(), result.data(), WIDTH);
+        for (int i = 0; i < WIDTH; ++i)
+        {
+            Pixel const & s  = src[i];
+            Pixel const & d  = dst[i];
+            int           sa = s.alpha8();
+            int           da = d.alpha8();
+            EXPECT_EQ(result[i].red8(), expected(mode, s.red8(), d.red8(), sa, da));
+            EXPECT_EQ(result[i].green8(), expected(mode, s.green8(), d.green8(), sa, da));
+            EXPECT_EQ(result[i].blue8(), expected(mode, s.blue8(), d.blue8(), sa, da));
+            EXPECT_EQ(result[i].alpha8(), expected(mode, sa, da, sa, da));
+        }
+    }
+}
+
+TEST(BlendTest, BlendRow)
+{
+    testBlendRow<PixelARGB>();
+    testBlendRow<PixelRGBA>();
+    testBlendRow<PixelBGRA>();
+    testBlendRow<PixelABGR>();
+}
+
+TEST(BlendTest, SrcOver)
+{
+    PixelRGBA src[5];
+    PixelRGBA dst[5];
+    for (auto & p : dst)
+    {
+        p.set8(10, 20, 30, 255);
+    }
+
+    // Opaque source replaces the destination, transparent source leaves it unchanged
+
+    src[0].set8(200, 100, 50, 255);
+    src[1].set8(0, 0, 0, 0);
+    src[2].set8(200, 100, 50, 255);
+    src[3].set8(0, 0, 0, 0);
+    src[4].set8(128, 64, 32, 128);
+
+    PixelBlender<PixelRGBA>::blendRow(BlendMode::SRC_OVER, src, dst, 5);
+    for (int i : { 0, 2 })
+    {
+        EXPECT_EQ(dst[i].red8(), 200);
+        EXPECT_EQ(dst[i].green8(), 100);
+        EXPECT_EQ(dst[i].blue8(), 50);
+        EXPECT_EQ(dst[i].alpha8(), 255);
+    }
+    for (int i : { 1, 3 })
+    {
+        EXPECT_EQ(dst[i].red8(), 10);
+        EXPECT_EQ(dst[i].green8(), 20);
+        EXPECT_EQ(dst[i].blue8(), 30);
+        EXPECT_EQ(dst[i].alpha8(), 255);
+    }
+    EXPECT_EQ(dst[4].red8(), 128 + 5);
+    EXPECT_EQ(dst[4].alpha8(), 255);
+}
+
+TEST(BlendTest, Bitmap)
+{
+    int const WIDTH  = 300;
+    int const HEIGHT = 200;
+
+    Bitmap<PixelBGRA> src(WIDTH, HEIGHT);
+    Bitmap<PixelBGRA> dst(WIDTH, HEIGHT, Bitmap<PixelBGRA>::alignedPitch(WIDTH));
+    fillPremultiplied(src.data(), WIDTH * HEIGHT, 3);
+    for (int y = 0; y < HEIGHT; ++y)
+    {
+        fillPremultiplied(dst.data(0, y), WIDTH, 4 + y);
+    }
+
+    // Clipped region
+
+    int const SRC_X = 10;
+    int const SRC_Y = 20;
+    int const DST_X = -5;
+    int const DST_Y = 50;
+
+    for (BlendMode mode : MODES)
+    {
+        for (Execution execution : { Execution::SEQUENTIAL, Execution::PARALLEL })
+        {
+            Bitmap<PixelBGRA> result(dst);
+            result.blend(src, Rect{ SRC_X, SRC_Y, WIDTH, HEIGHT }, DST_X, DST_Y, mode, execution);
+            for (int y = 0; y < HEIGHT; ++y)
+            {
+                for (int x = 0; x < WIDTH; ++x)
+                {
+                    int sx = x - DST_X + SRC_X;
+                    int sy = y - DST_Y + SRC_Y;
+                    PixelBGRA e = dst.pixel(x, y);
+                    if (y >= DST_Y && sx < WIDTH && sy < HEIGHT)
+                        PixelBlender<PixelBGRA>::blendRow(mode, src.data(sx, sy), &e, 1);
+                    ASSERT_EQ(memcmp(&e, result.data(x, y), sizeof e), 0) << "at (" << x << ", " << y << ")";
+                }
+            }
+        }
+    }
+
+    // Entirely clipped
+
+    {
+        Bitmap<PixelBGRA> result(dst);
+        result.blend(src, Rect{ 0, 0, WIDTH, HEIGHT }, WIDTH, 0, BlendMode::ADD);
+        EXPECT_EQ(memcmp(result.data(), dst.data(), dst.pitch() * HEIGHT), 0);
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
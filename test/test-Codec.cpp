@@ -0,0 +1,334 @@
+#include "Bitmap/Codec.h"
+
+#include "TestUtil.h"
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Returns a bitmap with runs of identical pixels mixed with pseudo-random pixels
+template <class Pixel>
+static Bitmap<Pixel> runImage(int width, int height)
+{
+    Bitmap<Pixel> image = testImage<Pixel>(width, height);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            if ((x / 5 + y) % 3 != 0)
+                *image.data(x, y) = *image.data(0, y / 4 * 4);
+        }
+    }
+    return image;
+}
+
+// Reads a file
+static std::vector<uint8_t> readFile(char const * path)
+{
+    std::vector<uint8_t> data;
+    FILE *               fp = fopen(path, "rb");
+    if (!fp)
+        return data;
+    int c;
+    while ((c = fgetc(fp)) != EOF)
+    {
+        data.push_back(uint8_t(c));
+    }
+    fclose(fp);
+    return data;
+}
+
+template <class Pixel>
+static bool sameImage(Bitmap<Pixel> const & a, Bitmap<Pixel> const & b)
+{
+    if (a.width() != b.width() || a.height() != b.height())
+        return false;
+    for (int y = 0; y < a.height(); ++y)
+    {
+        if (memcmp(a.data(0, y), b.data(0, y), a.width() * sizeof(Pixel)) != 0)
+            return false;
+    }
+    return true;
+}
+
+// Saves an image with the given writer and decodes it
+template <class Pixel, class Save>
+static void testRoundTrip(Bitmap<Pixel> const & image, ImageFormat format, Save save)
+{
+    TemporaryFile const file;
+
+    FILE * fp = fopen(file.path(), "wb");
+    ASSERT_NE(fp, nullptr);
+    ASSERT_TRUE(save(fp, image.view()));
+    fclose(fp);
+
+    std::vector<uint8_t> data = readFile(file.path());
+    ImageInfo            info;
+    ASSERT_TRUE(readImageInfo(data.data(), data.size(), &info));
+    EXPECT_EQ(info.format, format);
+    EXPECT_EQ(info.width, image.width());
+    EXPECT_EQ(info.height, image.height());
+
+    Bitmap<Pixel> decoded;
+    ASSERT_TRUE(decodeImage(data.data(), data.size(), &decoded));
+    EXPECT_TRUE(sameImage(decoded, image));
+
+    Bitmap<Pixel> parallel;
+    ASSERT_TRUE(decodeImage(data.data(), data.size(), &parallel, Execution::PARALLEL));
+    EXPECT_TRUE(sameImage(parallel, image));
+}
+
+TEST(CodecTest, Bmp)
+{
+    auto save = [] (FILE * fp, auto const & view) { return saveBmp(fp, view); };
+    testRoundTrip(testImage<uint8_t>(1, 1), ImageFormat::BMP, save);
+    testRoundTrip(testImage<uint8_t>(101, 37), ImageFormat::BMP, save);
+    testRoundTrip(testImage<PixelRGB>(101, 37), ImageFormat::BMP, save);
+    testRoundTrip(testImage<PixelBGR>(64, 3), ImageFormat::BMP, save);
+    testRoundTrip(testImage<PixelRGBA>(101, 37), ImageFormat::BMP, save);
+    testRoundTrip(testImage<PixelBGRA>(3, 64), ImageFormat::BMP, save);
+}
+
+// Returns a 2x1 32-bit BMP file with the given info header size, compression and alpha mask. The fourth byte of the
+// pixels is 0.
+static std::vector<uint8_t> bmp32(uint32_t dibSize, uint32_t compression, uint32_t alphaMask)
+{
+    uint32_t const masks    = (compression == 3 && dibSize == 40) ? 12 : 0;
+    uint32_t const offset   = 14 + dibSize + masks;
+    uint32_t const fields[] = { offset + 8, 0, offset, dibSize, 2, 1, 0x00200001, compression };
+
+    std::vector<uint8_t> data(offset + 8, 0);
+    data[0] = 'B';
+    data[1] = 'M';
+    memcpy(&data[2], &fields[0], 4);
+    memcpy(&data[10], &fields[2], 4 * 6);
+    if (compression == 3)
+    {
+        uint32_t const bgra[] = { 0x00ff0000, 0x0000ff00, 0x000000ff, alphaMask };
+        memcpy(&data[14 + 40], bgra, (dibSize >= 56) ? 16 : 12);
+    }
+    uint8_t const pixels[] = { 1, 2, 3, 0, 4, 5, 6, 0 };
+    memcpy(&data[offset], pixels, sizeof(pixels));
+    return data;
+}
+
+TEST(CodecTest, BmpAlpha)
+{
+    // The fourth byte of 32-bit pixels is alpha only if an alpha mask says so
+
+    struct
+    {
+        uint32_t dibSize, compression, alphaMask;
+        int      alpha;
+    } const files[] =
+    {
+        { 40, 0, 0, 0xff },
+        { 108, 0, 0xff000000, 0xff },
+        { 40, 3, 0, 0xff },
+        { 108, 3, 0, 0xff },
+        { 108, 3, 0xff000000, 0 },
+        { 56, 3, 0xff000000, 0 },
+    };
+
+    for (auto const & f : files)
+    {
+        std::vector<uint8_t> const data = bmp32(f.dibSize, f.compression, f.alphaMask);
+        Bitmap<PixelARGB>          decoded;
+        ASSERT_TRUE(decodeImage(data.data(), data.size(), &decoded)) << f.dibSize << " " << f.compression;
+        EXPECT_EQ(decoded.pixel(1, 0).alpha8(), f.alpha) << f.dibSize << " " << f.compression;
+        EXPECT_EQ(decoded.pixel(1, 0).red8(), 6);
+        EXPECT_EQ(decoded.pixel(1, 0).blue8(), 4);
+    }
+
+    // Other masks are not supported
+    std::vector<uint8_t> const data = bmp32(108, 3, 0x00ff0000);
+    ImageInfo                  info;
+    EXPECT_FALSE(readImageInfo(data.data(), data.size(), &info));
+}
+
+TEST(CodecTest, Tga)
+{
+    auto save = [] (FILE * fp, auto const & view) { return saveTga(fp, view); };
+    testRoundTrip(testImage<uint8_t>(101, 37), ImageFormat::TGA, save);
+    testRoundTrip(testImage<PixelRGB>(101, 37), ImageFormat::TGA, save);
+    testRoundTrip(testImage<PixelARGB>(101, 37), ImageFormat::TGA, save);
+}
+
+TEST(CodecTest, TgaRle)
+{
+    auto save = [] (FILE * fp, auto const & view) { return saveTga(fp, view, true); };
+    testRoundTrip(testImage<uint8_t>(1, 1), ImageFormat::TGA, save);
+    testRoundTrip(runImage<uint8_t>(300, 37), ImageFormat::TGA, save);
+    testRoundTrip(runImage<PixelRGB>(300, 37), ImageFormat::TGA, save);
+    testRoundTrip(runImage<PixelBGRA>(300, 200), ImageFormat::TGA, save);
+    testRoundTrip(testImage<PixelBGRA>(129, 2), ImageFormat::TGA, save);
+}
+
+TEST(CodecTest, Pnm)
+{
+    auto save = [] (FILE * fp, auto const & view) { return savePnm(fp, view); };
+    testRoundTrip(testImage<uint8_t>(101, 37), ImageFormat::PNM, save);
+    testRoundTrip(testImage<PixelRGB>(101, 37), ImageFormat::PNM, save);
+    testRoundTrip(testImage<PixelBGR>(7, 1), ImageFormat::PNM, save);
+
+    // Comments are allowed in the header
+    char const text[] = "P5\n# comment\n3 # another\n1\n255\nabc";
+    Bitmap<uint8_t> gray;
+    ASSERT_TRUE(decodeImage(text, sizeof(text) - 1, &gray));
+    EXPECT_EQ(gray.width(), 3);
+    EXPECT_EQ(memcmp(gray.data(), "abc", 3), 0);
+}
+
+TEST(CodecTest, Conversion)
+{
+    TemporaryFile const file;
+
+    Bitmap<PixelRGB> image = testImage<PixelRGB>(45, 17);
+    FILE *           fp    = fopen(file.path(), "wb");
+    ASSERT_NE(fp, nullptr);
+    ASSERT_TRUE(savePnm(fp, image.view()));
+    fclose(fp);
+    std::vector<uint8_t> data = readFile(file.path());
+
+    // The rows are converted as they are decoded
+    Bitmap<PixelARGB> argb;
+    ASSERT_TRUE(decodeImage(data.data(), data.size(), &argb));
+    Bitmap<PixelARGB> expected(45, 17);
+    convert(image.view(), expected.view());
+    EXPECT_TRUE(sameImage(argb, expected));
+
+    // Color images cannot be decoded as 8-bit values
+    Bitmap<uint8_t> gray;
+    EXPECT_FALSE(decodeImage(data.data(), data.size(), &gray));
+
+    // A bitmap of the right size is reused
+    Bitmap<PixelARGB> reused(45, 17);
+    PixelARGB const * pixels = reused.data();
+    ASSERT_TRUE(decodeImage(data.data(), data.size(), &reused));
+    EXPECT_EQ(reused.data(), pixels);
+    EXPECT_TRUE(sameImage(reused, expected));
+}
+
+TEST(CodecTest, BottomUp)
+{
+    TemporaryFile const file;
+
+    Bitmap<PixelRGB> image = testImage<PixelRGB>(13, 11);
+    FILE *           fp    = fopen(file.path(), "wb");
+    ASSERT_NE(fp, nullptr);
+    ASSERT_TRUE(saveBmp(fp, image.view()));
+    fclose(fp);
+    std::vector<uint8_t> data = readFile(file.path());
+
+    // Making the height positive turns the image upside down
+    int32_t height = 11;
+    memcpy(data.data() + 22, &height, sizeof(height));
+    ImageInfo info;
+    ASSERT_TRUE(readImageInfo(data.data(), data.size(), &info));
+    EXPECT_TRUE(info.bottomUp);
+
+    Bitmap<PixelRGB> decoded;
+    ASSERT_TRUE(decodeImage(data.data(), data.size(), &decoded));
+    for (int y = 0; y < 11; ++y)
+    {
+        EXPECT_EQ(memcmp(decoded.data(0, y), image.data(0, 10 - y), 13 * sizeof(PixelRGB)), 0);
+    }
+
+    // A bottom-up 3x2 grayscale RLE TGA, with a run spanning both rows
+    uint8_t const tga[] = { 0, 0, 11, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 0, 2, 0, 8, 0, 0x83, 7, 0x01, 1, 2 };
+    Bitmap<uint8_t> gray;
+    ASSERT_TRUE(decodeImage(tga, sizeof(tga), &gray, Execution::PARALLEL));
+    uint8_t const top[]    = { 7, 1, 2 };
+    uint8_t const bottom[] = { 7, 7, 7 };
+    EXPECT_EQ(memcmp(gray.data(0, 0), top, 3), 0);
+    EXPECT_EQ(memcmp(gray.data(0, 1), bottom, 3), 0);
+}
+
+template <class Color, class Save>
+static void testPalettized(Save save)
+{
+    TemporaryFile const file;
+
+    PalettizedBitmap<Color> image(77, 23, makePalette<Color>());
+    Bitmap<uint8_t>         indexes = testImage<uint8_t>(77, 23);
+    for (int y = 0; y < 23; ++y)
+    {
+        memcpy(image.data(0, y), indexes.data(0, y), 77);
+    }
+
+    FILE * fp = fopen(file.path(), "wb");
+    ASSERT_NE(fp, nullptr);
+    ASSERT_TRUE(save(fp, image));
+    fclose(fp);
+    std::vector<uint8_t> data = readFile(file.path());
+
+    // The indexes and the palette are preserved
+    PalettizedBitmap<Color> decoded;
+    ASSERT_TRUE(decodeImage(data.data(), data.size(), &decoded, Execution::PARALLEL));
+    EXPECT_TRUE(sameImage<uint8_t>(decoded, image));
+    Palette<Color> const expected = image.palette();
+    Palette<Color> const palette  = decoded.palette();
+    for (int i = 0; i < int(Palette<Color>::PALETTE_SIZE); ++i)
+    {
+        EXPECT_EQ(memcmp(palette.entries() + i, expected.entries() + i, sizeof(Color)), 0);
+    }
+
+    // The palette is applied when decoding to a color format
+    Bitmap<Color> expanded;
+    ASSERT_TRUE(decodeImage(data.data(), data.size(), &expanded));
+    for (int y = 0; y < 23; ++y)
+    {
+        for (int x = 0; x < 77; ++x)
+        {
+            ASSERT_EQ(memcmp(expanded.data(x, y), expected.entries() + *indexes.data(x, y), sizeof(Color)), 0);
+        }
+    }
+
+    // The indexes can be decoded alone
+    Bitmap<uint8_t> raw;
+    ASSERT_TRUE(decodeImage(data.data(), data.size(), &raw));
+    EXPECT_TRUE(sameImage(raw, indexes));
+}
+
+TEST(CodecTest, Palettized)
+{
+    testPalettized<PixelRGB>([] (FILE * fp, auto const & image) { return saveBmp(fp, image); });
+    testPalettized<PixelRGB>([] (FILE * fp, auto const & image) { return saveTga(fp, image); });
+    testPalettized<PixelBGRA>([] (FILE * fp, auto const & image) { return saveTga(fp, image, true); });
+}
+
+TEST(CodecTest, Invalid)
+{
+    TemporaryFile const file;
+
+    Bitmap<PixelRGB> image = testImage<PixelRGB>(40, 30);
+    FILE *           fp    = fopen(file.path(), "wb");
+    ASSERT_NE(fp, nullptr);
+    ASSERT_TRUE(saveTga(fp, image.view(), true));
+    fclose(fp);
+    std::vector<uint8_t> data = readFile(file.path());
+
+    // Truncated files are rejected
+    Bitmap<PixelRGB> decoded;
+    ImageInfo        info;
+    EXPECT_FALSE(decodeImage(data.data(), data.size() - 1, &decoded));
+    EXPECT_FALSE(readImageInfo(data.data(), 10, &info));
+
+    char const garbage[] = "P6\n10 10\n65535\n";
+    EXPECT_FALSE(readImageInfo(garbage, sizeof(garbage) - 1, &info));
+    char const truncated[] = "P5\n10 10\n255\nabc";
+    EXPECT_FALSE(readImageInfo(truncated, sizeof(truncated) - 1, &info));
+
+    // A destination of the wrong size is rejected
+    Bitmap<PixelRGB> small(39, 30);
+    EXPECT_FALSE(decodeImage(data.data(), data.size(), small.view()));
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
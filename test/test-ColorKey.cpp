@@ -0,0 +1,166 @@
+#include "Bitmap/Bitmap.h"
+#include "Bitmap/PalettizedBitmap.h"
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <vector>
+
+// Fills pixels with random values, with runs of keyed pixels
+template <class Pixel>
+static void fillWithRuns(Pixel * pixels, int count, Pixel const & key, unsigned seed)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        if ((i / 13) % 3 == 0 || ((seed >> 28) & 1))
+        {
+            pixels[i] = key;
+        }
+        else
+        {
+            uint8_t bytes[sizeof(Pixel)];
+            for (size_t b = 0; b < sizeof(Pixel); ++b)
+            {
+                bytes[b] = uint8_t(seed >> (b * 8));
+            }
+            memcpy(&pixels[i], bytes, sizeof(Pixel));
+        }
+    }
+}
+
+template <class Pixel>
+static void testCopyRow()
+{
+    Pixel key;
+    memset(static_cast<void *>(&key), 0x5a, sizeof key);
+
+    for (int width = 1; width < 100; ++width)
+    {
+        std::vector<Pixel> src(width);
+        std::vector<Pixel> dst(width);
+        fillWithRuns(src.data(), width, key, width + 1);
+        memset(static_cast<void *>(dst.data()), 0x11, width * sizeof(Pixel));
+
+        std::vector<Pixel> result = dst;
+        ColorKeyCopier<Pixel>::copyRow(src.data(), result.data(), width, key);
+        for (int i = 0; i < width; ++i)
+        {
+            bool         keyed    = memcmp(&src[i], &key, sizeof key) == 0;
+            Pixel const & expected = keyed ? dst[i] : src[i];
+            ASSERT_EQ(memcmp(&result[i], &expected, sizeof(Pixel)), 0) << "width " << width << ", pixel " << i;
+        }
+    }
+
+    // Keys that differ from a pixel in only one byte
+
+    for (size_t b = 0; b < sizeof(Pixel); ++b)
+    {
+        std::vector<Pixel> src(40, key);
+        std::vector<Pixel> dst(40);
+        memset(dst.data(), 0, dst.size() * sizeof(Pixel));
+        reinterpret_cast<uint8_t *>(&src[17])[b] ^= 1;
+        ColorKeyCopier<Pixel>::copyRow(src.data(), dst.data(), 40, key);
+        for (int i = 0; i < 40; ++i)
+        {
+            uint8_t const * p = reinterpret_cast<uint8_t const *>(&dst[i]);
+            if (i == 17)
+                EXPECT_EQ(memcmp(&dst[i], &src[i], sizeof(Pixel)), 0);
+            else
+                EXPECT_EQ(p[0], 0);
+        }
+    }
+}
+
+TEST(ColorKeyTest, CopyRow)
+{
+    // Every kernel supported by the processor is tested
+
+    for (SimdLevel level : { SimdLevel::SCALAR, SimdLevel::SSSE3, SimdLevel::AVX2 })
+    {
+        SimdLevel const previous = setSimdLimit(level);
+        testCopyRow<Pixel8>();
+        testCopyRow<Pixel565>();
+        testCopyRow<Pixel1555>();
+        testCopyRow<PixelRGB>();
+        testCopyRow<PixelBGR>();
+        testCopyRow<PixelARGB>();
+        testCopyRow<PixelBGRA>();
+        testCopyRow<uint32_t>();
+        setSimdLimit(previous);
+    }
+}
+
+TEST(ColorKeyTest, Bitmap)
+{
+    int const WIDTH  = 300;
+    int const HEIGHT = 200;
+
+    PixelRGB key;
+    key.set8(255, 0, 255);
+
+    Bitmap<PixelRGB> src(WIDTH, HEIGHT);
+    for (int y = 0; y < HEIGHT; ++y)
+    {
+        fillWithRuns(src.data(0, y), WIDTH, key, y + 1);
+    }
+    Bitmap<PixelRGB> dst(WIDTH, HEIGHT, Bitmap<PixelRGB>::alignedPitch(WIDTH));
+    memset(static_cast<void *>(dst.data()), 0x33, dst.pitch() * HEIGHT);
+
+    int const SRC_X = 7;
+    int const SRC_Y = 3;
+    int const DST_X = 20;
+    int const DST_Y = -10;
+
+    for (Execution execution : { Execution::SEQUENTIAL, Execution::PARALLEL })
+    {
+        Bitmap<PixelRGB> result(dst);
+        result.copyKeyed(src, Rect{ SRC_X, SRC_Y, WIDTH, HEIGHT }, DST_X, DST_Y, key, execution);
+        for (int y = 0; y < HEIGHT; ++y)
+        {
+            for (int x = 0; x < WIDTH; ++x)
+            {
+                int      sx       = x - DST_X + SRC_X;
+                int      sy       = y - DST_Y + SRC_Y;
+                PixelRGB expected = dst.pixel(x, y);
+                if (x >= DST_X && sx < WIDTH && sy < HEIGHT)
+                {
+                    PixelRGB s = src.pixel(sx, sy);
+                    if (memcmp(&s, &key, sizeof key) != 0)
+                        expected = s;
+                }
+                ASSERT_EQ(memcmp(result.data(x, y), &expected, sizeof expected), 0) << "at (" << x << ", " << y << ")";
+            }
+        }
+    }
+}
+
+TEST(ColorKeyTest, PalettizedBitmap)
+{
+    int const     WIDTH  = 64;
+    int const     HEIGHT = 16;
+    uint8_t const KEY    = 0;
+
+    std::vector<uint8_t> indexes(WIDTH * HEIGHT);
+    for (int i = 0; i < WIDTH * HEIGHT; ++i)
+    {
+        indexes[i] = uint8_t((i % 5 == 0) ? KEY : 1 + i % 255);
+    }
+
+    PalettizedBitmap<PixelRGB> sprite(WIDTH, HEIGHT, indexes.data(), Palette<PixelRGB>());
+    PalettizedBitmap<PixelRGB> canvas(WIDTH, HEIGHT);
+    memset(canvas.data(), 200, canvas.pitch() * HEIGHT);
+
+    canvas.copyKeyed(sprite, Rect{ 0, 0, WIDTH, HEIGHT }, 0, 0, KEY);
+    for (int i = 0; i < WIDTH * HEIGHT; ++i)
+    {
+        EXPECT_EQ(canvas.pixel(i % WIDTH, i / WIDTH), (i % 5 == 0) ? 200 : 1 + i % 255);
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
@@ -0,0 +1,156 @@
+#include "Bitmap/Container.h"
+
+#include "Bitmap/MappedFile.h"
+#include "TestUtil.h"
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+template <class Pixel>
+static void testRoundTrip(int width, int height)
+{
+    Bitmap<Pixel> image = testImage<Pixel>(width, height);
+    size_t const  size  = BitmapContainer<Pixel>::size(width, height);
+
+    // A bitmap provides an aligned buffer
+    Bitmap<uint8_t> buffer(int(size), 1);
+    ASSERT_EQ(BitmapContainer<Pixel>::write(image.view(), buffer.data(), size), size);
+    ASSERT_EQ(BitmapContainer<Pixel>::write(image.view(), buffer.data(), size - 1), 0u);
+
+    // The view refers to the buffer
+    auto view = BitmapContainer<Pixel>::view(buffer.data(), size);
+    ASSERT_EQ(view.width(), width);
+    ASSERT_EQ(view.height(), height);
+    ASSERT_GE(reinterpret_cast<uint8_t const *>(view.data()), buffer.data());
+    ASSERT_LT(reinterpret_cast<uint8_t const *>(view.data()), buffer.data() + size);
+    for (int y = 0; y < height; ++y)
+    {
+        ASSERT_EQ(memcmp(view.row(y), image.data(0, y), width * sizeof(Pixel)), 0);
+    }
+
+    // The bitmap uses the buffer
+    Bitmap<Pixel> aliased;
+    ASSERT_TRUE(BitmapContainer<Pixel>::alias(buffer.data(), size, &aliased));
+    ASSERT_EQ(aliased.width(), width);
+    ASSERT_EQ(aliased.height(), height);
+    ASSERT_EQ(static_cast<Bitmap<Pixel> const &>(aliased).data(), view.data());
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(view.data()) % Bitmap<Pixel>::ROW_ALIGNMENT, 0u);
+    for (int y = 0; y < height; ++y)
+    {
+        ASSERT_EQ(memcmp(aliased.data(0, y), image.data(0, y), width * sizeof(Pixel)), 0);
+    }
+}
+
+TEST(ContainerTest, RoundTrip)
+{
+    testRoundTrip<uint8_t>(1, 1);
+    testRoundTrip<uint8_t>(100, 7);
+    testRoundTrip<Pixel1555>(33, 33);
+    testRoundTrip<PixelBGR>(45, 12);
+    testRoundTrip<PixelRGBA>(64, 64);
+}
+
+TEST(ContainerTest, Empty)
+{
+    size_t const    size = BitmapContainer<uint32_t>::size(0, 0);
+    Bitmap<uint8_t> buffer(int(size), 1);
+    ASSERT_EQ(BitmapContainer<uint32_t>::write(Bitmap<uint32_t>().view(), buffer.data(), size), size);
+    EXPECT_EQ(BitmapContainer<uint32_t>::view(buffer.data(), size).width(), 0);
+
+    Bitmap<uint32_t> aliased(4, 4);
+    EXPECT_TRUE(BitmapContainer<uint32_t>::alias(buffer.data(), size, &aliased));
+    EXPECT_EQ(aliased.width(), 0);
+}
+
+TEST(ContainerTest, Palettized)
+{
+    Bitmap<uint8_t> indexes = testImage<uint8_t>(50, 20);
+    PalettizedBitmap<PixelRGB> image(50, 20, indexes.data(), makePalette<PixelRGB>());
+    size_t const               size = PalettizedContainer<PixelRGB>::size(50, 20);
+
+    Bitmap<uint8_t> buffer(int(size), 1);
+    ASSERT_EQ(PalettizedContainer<PixelRGB>::write(image, buffer.data(), size), size);
+
+    Palette<PixelRGB> palette;
+    auto              view = PalettizedContainer<PixelRGB>::view(buffer.data(), size, &palette);
+    ASSERT_EQ(view.width(), 50);
+    ASSERT_EQ(view.height(), 20);
+    EXPECT_EQ(memcmp(palette.entries(), image.palette().entries(), sizeof(PixelRGB) * 256), 0);
+    EXPECT_EQ(memcmp(view.row(19), indexes.data(0, 19), 50), 0);
+
+    PalettizedBitmap<PixelRGB> aliased;
+    ASSERT_TRUE(PalettizedContainer<PixelRGB>::alias(buffer.data(), size, &aliased));
+    EXPECT_EQ(static_cast<PalettizedBitmap<PixelRGB> const &>(aliased).data(), view.data());
+    EXPECT_EQ(memcmp(aliased.palette().entries(), image.palette().entries(), sizeof(PixelRGB) * 256), 0);
+    EXPECT_EQ(aliased.decompressedRegion(3, 4, 1, 1).pixel(0, 0).raw(), palette[*indexes.data(3, 4)].raw());
+
+    // The indexes can be read without the palette, but the palette type must match
+    EXPECT_EQ(BitmapContainer<uint8_t>::view(buffer.data(), size).width(), 50);
+    Palette<PixelARGB> argbPalette;
+    EXPECT_EQ(PalettizedContainer<PixelARGB>::view(buffer.data(), size, &argbPalette).width(), 0);
+
+    // An image without a palette is not a palettized image
+    size_t const    plainSize = BitmapContainer<uint8_t>::size(50, 20);
+    Bitmap<uint8_t> plain(int(plainSize), 1);
+    BitmapContainer<uint8_t>::write(indexes.view(), plain.data(), plainSize);
+    EXPECT_EQ(PalettizedContainer<PixelRGB>::view(plain.data(), plainSize, &palette).width(), 0);
+}
+
+TEST(ContainerTest, Invalid)
+{
+    Bitmap<uint16_t> image = testImage<uint16_t>(30, 10);
+    size_t const     size  = BitmapContainer<uint16_t>::size(30, 10);
+    Bitmap<uint8_t>  buffer(int(size + 64), 1);
+    ASSERT_EQ(BitmapContainer<uint16_t>::write(image.view(), buffer.data(), size), size);
+
+    // Different pixel type, truncated buffer
+    EXPECT_EQ(BitmapContainer<Pixel565>::view(buffer.data(), size).width(), 0);
+    EXPECT_EQ(BitmapContainer<uint16_t>::view(buffer.data(), size - 1).width(), 0);
+    EXPECT_EQ(BitmapContainer<uint16_t>::view(buffer.data(), 10).width(), 0);
+
+    // A misaligned container can be viewed but not aliased
+    memmove(buffer.data() + 2, buffer.data(), size);
+    EXPECT_EQ(BitmapContainer<uint16_t>::view(buffer.data() + 2, size).width(), 30);
+    Bitmap<uint16_t> aliased;
+    EXPECT_FALSE(BitmapContainer<uint16_t>::alias(buffer.data() + 2, size, &aliased));
+    EXPECT_EQ(aliased.width(), 0);
+
+    // Corrupted header
+    ContainerHeader header;
+    memcpy(&header, buffer.data() + 2, sizeof(header));
+    header.pitch = 30;
+    memcpy(buffer.data() + 2, &header, sizeof(header));
+    EXPECT_EQ(BitmapContainer<uint16_t>::view(buffer.data() + 2, size).width(), 0);
+}
+
+TEST(ContainerTest, MappedFile)
+{
+    if (!MappedFile::isSupported())
+        GTEST_SKIP() << "Memory-mapped files are not supported on this platform";
+
+    // A container file mapped copy-on-write can be aliased without reading or copying the image
+    TemporaryFile const file;
+    Bitmap<PixelARGB>   image = testImage<PixelARGB>(70, 40);
+    ASSERT_TRUE(BitmapContainer<PixelARGB>::save(file.path(), image.view()));
+    {
+        MappedFile mapped;
+        ASSERT_TRUE(mapped.open(file.path(), MappedFile::Mode::COPY_ON_WRITE));
+        ASSERT_EQ(mapped.size(), BitmapContainer<PixelARGB>::size(70, 40));
+
+        Bitmap<PixelARGB> aliased;
+        ASSERT_TRUE(BitmapContainer<PixelARGB>::alias(mapped.writableData(), mapped.size(), &aliased));
+        for (int y = 0; y < 40; ++y)
+        {
+            ASSERT_EQ(memcmp(aliased.data(0, y), image.data(0, y), 70 * sizeof(PixelARGB)), 0);
+        }
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
@@ -0,0 +1,189 @@
+#include "Bitmap/Convert.h"
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// Maximum channel values of each format (alpha is 0 if not present)
+template <class Pixel>
+struct ChannelMax
+{
+    static int constexpr R = 255, G = 255, B = 255, A = 255;
+};
+template <>
+struct ChannelMax<Pixel565>
+{
+    static int constexpr R = 31, G = 63, B = 31, A = 0;
+};
+template <>
+struct ChannelMax<Pixel1555>
+{
+    static int constexpr R = 31, G = 31, B = 31, A = 1;
+};
+template <>
+struct ChannelMax<PixelRGB>
+{
+    static int constexpr R = 255, G = 255, B = 255, A = 0;
+};
+template <>
+struct ChannelMax<PixelBGR>
+{
+    static int constexpr R = 255, G = 255, B = 255, A = 0;
+};
+
+// Returns the expected value of a destination channel, going through 8 bits and rounding at each step
+static int expected(float value, int srcMax, int dstMax)
+{
+    int v8 = (srcMax == 0) ? 255 : int(std::floor(value * 255.0f + 0.5f));
+    return int(std::floor(float(v8) / 255.0f * float(dstMax) + 0.5f));
+}
+
+static int actual(float value, int dstMax)
+{
+    return int(std::floor(value * float(dstMax) + 0.5f));
+}
+
+// Returns the alpha value of a pixel, or 1 if the format has no alpha
+template <class Pixel>
+static float alphaOf(Pixel const & p)
+{
+    if constexpr (ChannelMax<Pixel>::A != 0)
+        return p.alpha();
+    else
+        return 1.0f;
+}
+
+template <class Dst, class Src>
+static void testConvert()
+{
+    int const WIDTH  = 37;
+    int const HEIGHT = 5;
+
+    Bitmap<Src> src(WIDTH, HEIGHT);
+    uint32_t seed = 12345;
+    for (int y = 0; y < HEIGHT; ++y)
+    {
+        for (int x = 0; x < WIDTH; ++x)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            *src.data(x, y) = Src(seed >> 3);
+        }
+    }
+
+    using S = ChannelMax<Src>;
+    using D = ChannelMax<Dst>;
+
+    for (size_t pitch : { size_t(0), Bitmap<Dst>::alignedPitch(WIDTH) })
+    {
+        Bitmap<Dst> const dst = convert<Dst>(src, pitch);
+        ASSERT_EQ(dst.width(), WIDTH);
+        ASSERT_EQ(dst.height(), HEIGHT);
+        for (int y = 0; y < HEIGHT; ++y)
+        {
+            for (int x = 0; x < WIDTH; ++x)
+            {
+                Src s = src.pixel(x, y);
+                Dst d = dst.pixel(x, y);
+                EXPECT_EQ(actual(d.red(), D::R), expected(s.red(), S::R, D::R)) << x << "," << y;
+                EXPECT_EQ(actual(d.green(), D::G), expected(s.green(), S::G, D::G)) << x << "," << y;
+                EXPECT_EQ(actual(d.blue(), D::B), expected(s.blue(), S::B, D::B)) << x << "," << y;
+                if (D::A != 0)
+                {
+                    EXPECT_EQ(actual(alphaOf(d), D::A), expected(alphaOf(s), S::A, D::A)) << x << "," << y;
+                }
+            }
+        }
+    }
+}
+
+template <class Src>
+static void testConvertFrom()
+{
+    // Every kernel supported by the processor is tested
+
+    for (SimdLevel level : { SimdLevel::SCALAR, SimdLevel::SSSE3, SimdLevel::AVX2 })
+    {
+        SimdLevel const previous = setSimdLimit(level);
+        testConvert<Pixel565, Src>();
+        testConvert<Pixel1555, Src>();
+        testConvert<PixelRGB, Src>();
+        testConvert<PixelBGR, Src>();
+        testConvert<PixelARGB, Src>();
+        testConvert<PixelRGBA, Src>();
+        testConvert<PixelBGRA, Src>();
+        testConvert<PixelABGR, Src>();
+        setSimdLimit(previous);
+    }
+}
+
+TEST(ConvertTest, Pixel565) { testConvertFrom<Pixel565>(); }
+TEST(ConvertTest, Pixel1555) { testConvertFrom<Pixel1555>(); }
+TEST(ConvertTest, PixelRGB) { testConvertFrom<PixelRGB>(); }
+TEST(ConvertTest, PixelBGR) { testConvertFrom<PixelBGR>(); }
+TEST(ConvertTest, PixelARGB) { testConvertFrom<PixelARGB>(); }
+TEST(ConvertTest, PixelRGBA) { testConvertFrom<PixelRGBA>(); }
+TEST(ConvertTest, PixelBGRA) { testConvertFrom<PixelBGRA>(); }
+TEST(ConvertTest, PixelABGR) { testConvertFrom<PixelABGR>(); }
+
+TEST(ConvertTest, Views)
+{
+    std::vector<uint32_t> data(64 * 16);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = uint32_t(i * 0x01030507u);
+    }
+    BitmapView<PixelARGB const> const src(64, 16, 0, reinterpret_cast<PixelARGB const *>(&data[0]));
+
+    Bitmap<PixelBGRA> dst(32, 8);
+    memset(dst.data(), 0, dst.pitch() * dst.height());
+    convert(src.subview(16, 4, 48, 12), dst.view(8, 2, 16, 4));
+
+    EXPECT_EQ(dst.pixel(7, 2).raw(), 0);
+    EXPECT_EQ(dst.pixel(8, 1).raw(), 0);
+    EXPECT_EQ(dst.pixel(24, 2).raw(), 0);
+    EXPECT_EQ(dst.pixel(8, 6).raw(), 0);
+    for (int y = 0; y < 4; ++y)
+    {
+        for (int x = 0; x < 16; ++x)
+        {
+            PixelARGB const s = src.pixel(16 + x, 4 + y);
+            PixelBGRA const d = dst.pixel(8 + x, 2 + y);
+            EXPECT_EQ(d.red(), s.red());
+            EXPECT_EQ(d.green(), s.green());
+            EXPECT_EQ(d.blue(), s.blue());
+            EXPECT_EQ(d.alpha(), s.alpha());
+        }
+    }
+}
+
+// Needs 4 GiB of memory, so it is run only with --gtest_also_run_disabled_tests
+TEST(ConvertTest, DISABLED_MorePixelsThanAnInt)
+{
+    // The images are contiguous, so rows are merged, but all of them together have more pixels than an int can count
+
+    int const WIDTH  = 65536;
+    int const HEIGHT = 32769;
+
+    Bitmap<Pixel8> src(WIDTH, HEIGHT);
+    Bitmap<Pixel8> dst(WIDTH, HEIGHT);
+    ASSERT_EQ(src.pitch(), size_t(WIDTH));
+    ASSERT_EQ(dst.pitch(), size_t(WIDTH));
+    memset(src.data(), 1, src.pitch() * HEIGHT);
+    memset(dst.data(), 0, dst.pitch() * HEIGHT);
+
+    convert(src.view(), dst.view());
+    for (int y : { 0, HEIGHT / 2, HEIGHT - 2, HEIGHT - 1 })
+    {
+        EXPECT_EQ(dst.pixel(0, y), 1) << y;
+        EXPECT_EQ(dst.pixel(WIDTH - 1, y), 1) << y;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
@@ -0,0 +1,199 @@
+#include "Bitmap/Dither.h"
+
+#include "Bitmap/Convert.h"
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Returns a shallow gradient, which bands badly when reduced without dithering
+template <class Pixel>
+static Bitmap<Pixel> gradientImage(int width, int height)
+{
+    Bitmap<Pixel> image(width, height);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            Pixel p;
+            p.set8(uint8_t(x * 40 / width), uint8_t(64 + y * 20 / height), uint8_t(200 - x * 30 / width));
+            *image.data(x, y) = p;
+        }
+    }
+    return image;
+}
+
+// Returns the mean difference between the averages of 8 x 8 blocks of two images
+template <class A, class B>
+static double blockError(BitmapView<A> const & a, BitmapView<B> const & b)
+{
+    double error  = 0.0;
+    int    blocks = 0;
+    for (int by = 0; by + 8 <= a.height(); by += 8)
+    {
+        for (int bx = 0; bx + 8 <= a.width(); bx += 8)
+        {
+            double sum[3] = { 0.0, 0.0, 0.0 };
+            for (int y = by; y < by + 8; ++y)
+            {
+                for (int x = bx; x < bx + 8; ++x)
+                {
+                    A const pa = a.row(y)[x];
+                    B const pb = b.row(y)[x];
+                    sum[0] += double(pa.red8()) - pb.red8();
+                    sum[1] += double(pa.green8()) - pb.green8();
+                    sum[2] += double(pa.blue8()) - pb.blue8();
+                }
+            }
+            error += (std::fabs(sum[0]) + std::fabs(sum[1]) + std::fabs(sum[2])) / 64.0;
+            ++blocks;
+        }
+    }
+    return error / blocks;
+}
+
+static DitherMethod const METHODS[] = { DitherMethod::BAYER, DitherMethod::BLUE_NOISE, DitherMethod::FLOYD_STEINBERG };
+
+TEST(DitherTest, ThresholdMatrix)
+{
+    for (ThresholdMatrix const * matrix : { &ThresholdMatrix::bayer(), &ThresholdMatrix::blueNoise() })
+    {
+        ASSERT_EQ(matrix->levels, matrix->size * matrix->size);
+        std::vector<int> counts(matrix->levels, 0);
+        for (int i = 0; i < matrix->levels; ++i)
+        {
+            ASSERT_LT(matrix->values[i], matrix->levels);
+            ++counts[matrix->values[i]];
+        }
+        for (int count : counts)
+        {
+            ASSERT_EQ(count, 1);
+        }
+        EXPECT_EQ(matrix->at(matrix->size + 1, 2 * matrix->size), matrix->at(1, 0));
+    }
+    EXPECT_EQ(ThresholdMatrix::bayer().size, 8);
+    EXPECT_EQ(ThresholdMatrix::blueNoise().size, 32);
+
+    // Neighboring blue-noise thresholds are rarely close
+    ThresholdMatrix const & noise = ThresholdMatrix::blueNoise();
+    int                     close = 0;
+    for (int y = 0; y < noise.size; ++y)
+    {
+        for (int x = 0; x < noise.size; ++x)
+        {
+            if (std::abs(noise.at(x, y) - noise.at(x + 1, y)) < noise.levels / 32)
+                ++close;
+        }
+    }
+    EXPECT_LT(close, noise.levels / 32);
+}
+
+template <class Dst>
+static void testFormat()
+{
+    Bitmap<PixelRGB> const image = gradientImage<PixelRGB>(256, 64);
+
+    Bitmap<Dst> plain(256, 64);
+    convert(image.view(), plain.view());
+    double const banded = blockError(image.view(), plain.view());
+
+    for (DitherMethod method : METHODS)
+    {
+        Bitmap<Dst> dithered(256, 64);
+        dither(image.view(), dithered.view(), method);
+        EXPECT_LT(blockError(image.view(), dithered.view()), banded / 2);
+    }
+}
+
+TEST(DitherTest, Format)
+{
+    testFormat<Pixel565>();
+    testFormat<Pixel1555>();
+}
+
+TEST(DitherTest, Exact)
+{
+    // Colors that can be represented exactly are not changed
+    Bitmap<Pixel565> exact(40, 30);
+    for (int y = 0; y < 30; ++y)
+    {
+        for (int x = 0; x < 40; ++x)
+        {
+            *exact.data(x, y) = Pixel565(unsigned(x * 1637 + y * 91));
+        }
+    }
+    Bitmap<PixelRGB> image(40, 30);
+    convert(exact.view(), image.view());
+
+    for (DitherMethod method : METHODS)
+    {
+        Bitmap<Pixel565> reduced(40, 30);
+        dither(image.view(), reduced.view(), method);
+        for (int y = 0; y < 30; ++y)
+        {
+            ASSERT_EQ(memcmp(reduced.data(0, y), exact.data(0, y), 40 * sizeof(Pixel565)), 0);
+        }
+    }
+}
+
+TEST(DitherTest, Alpha)
+{
+    Bitmap<PixelARGB> image(2, 1);
+    image.data()[0].set8(255, 255, 255, 200);
+    image.data()[1].set8(255, 255, 255, 50);
+    Bitmap<Pixel1555> reduced(2, 1);
+    dither(image.view(), reduced.view(), DitherMethod::BLUE_NOISE);
+    EXPECT_EQ(reduced.data()[0].alphaValue(), 1u);
+    EXPECT_EQ(reduced.data()[1].alphaValue(), 0u);
+}
+
+TEST(DitherTest, Palettized)
+{
+    Bitmap<PixelRGB> const image = gradientImage<PixelRGB>(256, 64);
+
+    PalettizedBitmap<PixelRGB> plain = quantize<PixelRGB>(image.view(), QuantizeMethod::MEDIAN_CUT, 8);
+    Bitmap<PixelRGB> const     plainColors = plain.decompressedRegion(0, 0, 256, 64);
+    double const               banded      = blockError(image.view(), plainColors.view());
+
+    for (DitherMethod method : METHODS)
+    {
+        PalettizedBitmap<PixelRGB> dithered = plain;
+        dither(image.view(), &dithered, method);
+        Bitmap<PixelRGB> const colors = dithered.decompressedRegion(0, 0, 256, 64);
+        EXPECT_LT(blockError(image.view(), colors.view()), banded);
+    }
+}
+
+TEST(DitherTest, Parallel)
+{
+    Bitmap<PixelARGB> const image = gradientImage<PixelARGB>(1000, 700);
+    for (DitherMethod method : METHODS)
+    {
+        Bitmap<Pixel565> sequential(1000, 700);
+        Bitmap<Pixel565> parallel(1000, 700);
+        dither(image.view(), sequential.view(), method, Execution::SEQUENTIAL);
+        dither(image.view(), parallel.view(), method, Execution::PARALLEL);
+        for (int y = 0; y < 700; ++y)
+        {
+            ASSERT_EQ(memcmp(sequential.data(0, y), parallel.data(0, y), 1000 * sizeof(Pixel565)), 0) << y;
+        }
+    }
+
+    PalettizedBitmap<PixelRGB> sequential = quantize<PixelRGB>(image.view(), QuantizeMethod::OCTREE, 64);
+    PalettizedBitmap<PixelRGB> parallel   = sequential;
+    dither(image.view(), &sequential, DitherMethod::FLOYD_STEINBERG, Execution::SEQUENTIAL);
+    dither(image.view(), &parallel, DitherMethod::FLOYD_STEINBERG, Execution::PARALLEL);
+    for (int y = 0; y < 700; ++y)
+    {
+        ASSERT_EQ(memcmp(sequential.data(0, y), parallel.data(0, y), 1000), 0) << y;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
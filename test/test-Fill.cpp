@@ -0,0 +1,171 @@
+#include "Bitmap/Bitmap.h"
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <vector>
+
+// Returns a value whose bytes all differ
+template <class Pixel>
+static Pixel testValue()
+{
+    Pixel value;
+    uint8_t bytes[sizeof(Pixel)];
+    for (size_t b = 0; b < sizeof(Pixel); ++b)
+    {
+        bytes[b] = uint8_t(0xa0 + b);
+    }
+    memcpy(&value, bytes, sizeof value);
+    return value;
+}
+
+template <class Pixel>
+static void testFillRow()
+{
+    int const MAX_COUNT = 80;
+    int const GUARD     = 32;
+
+    Pixel const value = testValue<Pixel>();
+
+    // Every alignment and length, with and without streaming
+
+    std::vector<uint8_t> buffer(GUARD + MAX_COUNT * sizeof(Pixel) + GUARD);
+    for (int offset = 0; offset < 16; ++offset)
+    {
+        for (int count = 0; count <= MAX_COUNT; ++count)
+        {
+            for (bool streaming : { false, true })
+            {
+                memset(buffer.data(), 0x55, buffer.size());
+                uint8_t * start = buffer.data() + offset;
+                PixelFiller<Pixel>::fillRow(reinterpret_cast<Pixel *>(start), count, value, streaming);
+                for (int i = 0; i < count; ++i)
+                {
+                    ASSERT_EQ(memcmp(start + i * sizeof(Pixel), &value, sizeof(Pixel)), 0) << "count " << count;
+                }
+                for (uint8_t * p = start + count * sizeof(Pixel); p < buffer.data() + buffer.size(); ++p)
+                {
+                    ASSERT_EQ(*p, 0x55);
+                }
+                for (uint8_t * p = buffer.data(); p < start; ++p)
+                {
+                    ASSERT_EQ(*p, 0x55);
+                }
+            }
+        }
+    }
+}
+
+TEST(FillTest, FillRow)
+{
+    testFillRow<Pixel8>();
+    testFillRow<Pixel565>();
+    testFillRow<PixelRGB>();
+    testFillRow<PixelBGR>();
+    testFillRow<PixelRGBA>();
+}
+
+template <class Pixel>
+static void testFill(int width, int height, Execution execution)
+{
+    Pixel const value = testValue<Pixel>();
+    size_t const pitch = Bitmap<Pixel>::alignedPitch(width + 1);
+
+    Bitmap<Pixel> bitmap(width, height, pitch);
+    memset(bitmap.data(), 0, pitch * height);
+
+    Rect const rect{ 3, -2, width - 5, height };
+    bitmap.fill(rect, value, execution);
+
+    char const * row = reinterpret_cast<char const *>(bitmap.data());
+    for (int y = 0; y < height; ++y)
+    {
+        for (size_t x = 0; x < pitch / sizeof(Pixel); ++x)
+        {
+            bool inside = int(x) >= 3 && int(x) < width - 2 && y < height - 2;
+            Pixel const * p = reinterpret_cast<Pixel const *>(row) + x;
+            if (inside)
+                ASSERT_EQ(memcmp(p, &value, sizeof value), 0) << "at (" << x << ", " << y << ")";
+            else
+                ASSERT_EQ(reinterpret_cast<uint8_t const *>(p)[0], 0) << "at (" << x << ", " << y << ")";
+        }
+        row += pitch;
+    }
+}
+
+TEST(FillTest, Fill)
+{
+    for (Execution execution : { Execution::SEQUENTIAL, Execution::PARALLEL })
+    {
+        testFill<Pixel8>(101, 37, execution);
+        testFill<Pixel1555>(101, 37, execution);
+        testFill<PixelBGR>(101, 37, execution);
+        testFill<PixelARGB>(101, 37, execution);
+
+        // Large enough to use non-temporal stores
+        testFill<PixelRGB>(2000, 1600, execution);
+    }
+
+    // Contiguous rows
+
+    {
+        Bitmap<PixelRGB> bitmap(33, 20);
+        PixelRGB const value = testValue<PixelRGB>();
+        bitmap.fill(Rect{ 0, 0, 33, 20 }, value);
+        for (int y = 0; y < 20; ++y)
+        {
+            for (int x = 0; x < 33; ++x)
+            {
+                ASSERT_EQ(memcmp(bitmap.data(x, y), &value, sizeof value), 0);
+            }
+        }
+    }
+
+    // Entirely outside
+
+    {
+        Bitmap<uint32_t> bitmap(8, 8);
+        memset(bitmap.data(), 0, bitmap.pitch() * 8);
+        bitmap.fill(Rect{ 8, 0, 4, 4 }, 1u);
+        bitmap.fill(Rect{ 0, -4, 4, 4 }, 1u);
+        for (int y = 0; y < 8; ++y)
+        {
+            for (int x = 0; x < 8; ++x)
+            {
+                EXPECT_EQ(bitmap.pixel(x, y), 0u);
+            }
+        }
+    }
+}
+
+TEST(FillTest, Clear)
+{
+    for (Execution execution : { Execution::SEQUENTIAL, Execution::PARALLEL })
+    {
+        for (int height : { 1, 17, 1500 })
+        {
+            Bitmap<PixelRGB> bitmap(2001, height, Bitmap<PixelRGB>::alignedPitch(2001));
+            memset(static_cast<void *>(bitmap.data()), 0xff, bitmap.pitch() * height);
+            bitmap.clear(execution);
+
+            uint8_t const * data = reinterpret_cast<uint8_t const *>(bitmap.data());
+            for (size_t i = 0; i < bitmap.pitch() * height; ++i)
+            {
+                ASSERT_EQ(data[i], 0);
+            }
+        }
+    }
+
+    // Empty bitmap
+
+    Bitmap<uint32_t> empty;
+    empty.clear();
+    EXPECT_EQ(empty.data(), nullptr);
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
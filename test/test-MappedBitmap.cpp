@@ -0,0 +1,141 @@
+#include "Bitmap/MappedBitmap.h"
+
+#include "TestUtil.h"
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+template <class Pixel>
+static void testSaveAndOpen(int width, int height)
+{
+    TemporaryFile const file;
+
+    Bitmap<Pixel> image = testImage<Pixel>(width, height);
+    ASSERT_TRUE(MappedBitmap<Pixel>::save(file.path(), image.view()));
+
+    MappedBitmap<Pixel> mapped(file.path());
+    ASSERT_TRUE(mapped.isOpen());
+    ASSERT_EQ(mapped.width(), width);
+    ASSERT_EQ(mapped.height(), height);
+    ASSERT_EQ(mapped.pitch() % Bitmap<Pixel>::ROW_ALIGNMENT, 0u);
+    for (int y = 0; y < height; ++y)
+    {
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(mapped.row(y)) % Bitmap<Pixel>::ROW_ALIGNMENT, 0u);
+        ASSERT_EQ(memcmp(mapped.row(y), image.data(0, y), width * sizeof(Pixel)), 0);
+    }
+}
+
+class MappedBitmapTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        if (!MappedFile::isSupported())
+            GTEST_SKIP() << "Memory-mapped files are not supported on this platform";
+    }
+};
+
+TEST_F(MappedBitmapTest, SaveAndOpen)
+{
+    testSaveAndOpen<uint8_t>(1, 1);
+    testSaveAndOpen<uint8_t>(77, 13);
+    testSaveAndOpen<Pixel565>(64, 9);
+    testSaveAndOpen<PixelRGB>(33, 20);
+    testSaveAndOpen<PixelARGB>(100, 100);
+}
+
+TEST_F(MappedBitmapTest, Empty)
+{
+    TemporaryFile const file;
+
+    ASSERT_TRUE(MappedBitmap<uint32_t>::save(file.path(), Bitmap<uint32_t>().view()));
+    MappedBitmap<uint32_t> mapped(file.path());
+    ASSERT_TRUE(mapped.isOpen());
+    EXPECT_EQ(mapped.width(), 0);
+    EXPECT_EQ(mapped.height(), 0);
+}
+
+TEST_F(MappedBitmapTest, CopyOnWrite)
+{
+    TemporaryFile const file;
+
+    Bitmap<PixelRGBA> image = testImage<PixelRGBA>(20, 10);
+    ASSERT_TRUE(MappedBitmap<PixelRGBA>::save(file.path(), image.view()));
+
+    // Changes to a copy-on-write mapping are not written to the file
+    {
+        MappedBitmap<PixelRGBA> mapped(file.path(), MappedBitmap<PixelRGBA>::Mode::COPY_ON_WRITE);
+        ASSERT_TRUE(mapped.isOpen());
+        auto view = mapped.writableView();
+        memset(view.row(3), 0, 20 * sizeof(PixelRGBA));
+        EXPECT_EQ(mapped.row(3)[7].alpha(), 0);
+    }
+
+    MappedBitmap<PixelRGBA> mapped(file.path());
+    ASSERT_TRUE(mapped.isOpen());
+    EXPECT_EQ(memcmp(mapped.row(3), image.data(0, 3), 20 * sizeof(PixelRGBA)), 0);
+
+    // The mapped image can be used anywhere a view is accepted
+    Bitmap<PixelRGBA> copy(20, 10);
+    copy.copy(mapped.view(), Rect{ 0, 0, 20, 10 }, 0, 0);
+    EXPECT_EQ(memcmp(copy.data(0, 9), image.data(0, 9), 20 * sizeof(PixelRGBA)), 0);
+}
+
+TEST_F(MappedBitmapTest, Advice)
+{
+    TemporaryFile const file;
+
+    Bitmap<uint16_t> image = testImage<uint16_t>(300, 200);
+    ASSERT_TRUE(MappedBitmap<uint16_t>::save(file.path(), image.view()));
+
+    MappedBitmap<uint16_t> mapped(file.path());
+    ASSERT_TRUE(mapped.isOpen());
+    mapped.advise(MappedBitmap<uint16_t>::Access::SEQUENTIAL);
+    mapped.advise(MappedBitmap<uint16_t>::Access::RANDOM, 50, 20);
+    mapped.prefetch(190, 100);
+    mapped.advise(MappedBitmap<uint16_t>::Access::NORMAL);
+    EXPECT_EQ(memcmp(mapped.row(199), image.data(0, 199), 300 * sizeof(uint16_t)), 0);
+}
+
+TEST_F(MappedBitmapTest, Invalid)
+{
+    TemporaryFile const file;
+
+    // Missing file
+    MappedBitmap<uint8_t> mapped;
+    EXPECT_FALSE(mapped.open("no such file"));
+    EXPECT_FALSE(mapped.isOpen());
+
+    // Mismatched pixel format
+    Bitmap<uint8_t> image = testImage<uint8_t>(16, 16);
+    ASSERT_TRUE(MappedBitmap<uint8_t>::save(file.path(), image.view()));
+    EXPECT_FALSE(MappedBitmap<Pixel565>(file.path()).isOpen());
+    EXPECT_TRUE(MappedBitmap<uint8_t>(file.path()).isOpen());
+
+    // Truncated file
+    FILE * fp = fopen(file.path(), "r+b");
+    ASSERT_NE(fp, nullptr);
+    ContainerHeader header;
+    ASSERT_EQ(fread(&header, sizeof(header), 1, fp), 1u);
+    header.height = 17;
+    fseek(fp, 0, SEEK_SET);
+    ASSERT_EQ(fwrite(&header, sizeof(header), 1, fp), 1u);
+    fclose(fp);
+    EXPECT_FALSE(MappedBitmap<uint8_t>(file.path()).isOpen());
+
+    // Not an image
+    fp = fopen(file.path(), "wb");
+    ASSERT_NE(fp, nullptr);
+    fputs("This is not an image", fp);
+    fclose(fp);
+    EXPECT_FALSE(MappedBitmap<uint8_t>(file.path()).isOpen());
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
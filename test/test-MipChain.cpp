@@ -0,0 +1,142 @@
+#include "Bitmap/MipChain.h"
+
+#include "TestUtil.h"
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Returns the expected value of a channel at (x, y) in the level below the given level
+template <class View>
+static int expectedChannel(View const & src, int x, int y, int c)
+{
+    int x1 = std::min(2 * x + 1, src.width() - 1);
+    int y1 = std::min(2 * y + 1, src.height() - 1);
+    auto channel = [&] (int px, int py) { return reinterpret_cast<uint8_t const *>(src.data(px, py))[c]; };
+    return (channel(2 * x, 2 * y) + channel(x1, 2 * y) + channel(2 * x, y1) + channel(x1, y1) + 2) / 4;
+}
+
+template <class Pixel>
+static void testBox(int width, int height)
+{
+    Bitmap<Pixel>   image = testImage<Pixel>(width, height);
+    MipChain<Pixel> chain(image.view());
+
+    // Level 0 is a copy of the base image
+
+    ASSERT_GT(chain.levels(), 0);
+    for (int y = 0; y < height; ++y)
+    {
+        ASSERT_EQ(memcmp(chain.level(0).row(y), image.data(0, y), width * sizeof(Pixel)), 0);
+    }
+
+    // Each level is a 2x2 reduction of the previous level
+
+    for (int i = 1; i < chain.levels(); ++i)
+    {
+        auto src = chain.level(i - 1);
+        auto dst = chain.level(i);
+        ASSERT_EQ(dst.width(), std::max(src.width() / 2, 1));
+        ASSERT_EQ(dst.height(), std::max(src.height() / 2, 1));
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(dst.data()) % Bitmap<Pixel>::ROW_ALIGNMENT, 0u);
+        for (int y = 0; y < dst.height(); ++y)
+        {
+            for (int x = 0; x < dst.width(); ++x)
+            {
+                for (size_t c = 0; c < sizeof(Pixel); ++c)
+                {
+                    ASSERT_EQ(reinterpret_cast<uint8_t const *>(dst.data(x, y))[c], expectedChannel(src, x, y, int(c)))
+                        << "level " << i << " at (" << x << ", " << y << ")";
+                }
+            }
+        }
+    }
+
+    auto last = chain.level(chain.levels() - 1);
+    EXPECT_EQ(last.width(), 1);
+    EXPECT_EQ(last.height(), 1);
+}
+
+TEST(MipChainTest, Box)
+{
+    testBox<PixelRGBA>(64, 64);
+    testBox<PixelRGBA>(100, 37);
+    testBox<PixelBGR>(67, 200);
+    testBox<Pixel8>(255, 33);
+    testBox<Pixel8>(1, 9);
+}
+
+TEST(MipChainTest, Levels)
+{
+    MipChain<PixelARGB> empty;
+    EXPECT_EQ(empty.levels(), 0);
+    EXPECT_EQ(empty.size(), 0u);
+
+    Bitmap<PixelARGB>   image = testImage<PixelARGB>(256, 64);
+    MipChain<PixelARGB> chain(image.view());
+    EXPECT_EQ(chain.levels(), 9);
+    EXPECT_EQ(chain.level(8).width(), 1);
+    EXPECT_EQ(chain.level(6).height(), 1);
+    EXPECT_EQ(chain.level(6).width(), 4);
+
+    // All levels are in one allocation, contiguous and in order
+
+    for (int i = 1; i < chain.levels(); ++i)
+    {
+        auto prev = chain.level(i - 1);
+        EXPECT_EQ(reinterpret_cast<char const *>(chain.level(i).data()),
+                  reinterpret_cast<char const *>(prev.data()) + prev.pitch() * prev.height());
+    }
+
+    // Rebuilding with a smaller image reuses the storage
+
+    void const * storage = chain.level(0).data();
+    chain.build(testImage<PixelARGB>(16, 16).view());
+    EXPECT_EQ(chain.levels(), 5);
+    EXPECT_EQ(chain.level(0).data(), storage);
+
+    chain.build(Bitmap<PixelARGB>().view());
+    EXPECT_EQ(chain.levels(), 0);
+}
+
+TEST(MipChainTest, Gamma)
+{
+    // A checkerboard of black and white averages to 50% linear intensity, which is 188 in sRGB. Alpha is averaged
+    // linearly.
+
+    Bitmap<PixelRGBA> image(4, 4);
+    for (int y = 0; y < 4; ++y)
+    {
+        for (int x = 0; x < 4; ++x)
+        {
+            uint8_t v = ((x + y) % 2) ? 255 : 0;
+            image.data(x, y)->set8(v, v, v, v);
+        }
+    }
+
+    MipChain<PixelRGBA> box(image.view(), MipFilter::BOX);
+    MipChain<PixelRGBA> gamma(image.view(), MipFilter::GAMMA);
+    EXPECT_EQ(box.level(1).pixel(0, 0).red8(), 128);
+    EXPECT_EQ(gamma.level(1).pixel(0, 0).red8(), 188);
+    EXPECT_EQ(gamma.level(1).pixel(0, 0).green8(), 188);
+    EXPECT_EQ(gamma.level(1).pixel(0, 0).alpha8(), 128);
+    EXPECT_EQ(gamma.level(2).pixel(0, 0).red8(), 188);
+
+    // Formats without byte channels
+
+    Bitmap<Pixel565> image565(2, 2);
+    image565.data(0, 0)->set8(0, 0, 0);
+    image565.data(1, 0)->set8(255, 255, 255);
+    image565.data(0, 1)->set8(255, 255, 255);
+    image565.data(1, 1)->set8(0, 0, 0);
+    MipChain<Pixel565> chain565(image565.view(), MipFilter::GAMMA);
+    EXPECT_EQ(chain565.level(1).pixel(0, 0).red8(), 189);
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
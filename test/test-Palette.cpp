@@ -0,0 +1,165 @@
+#include "Bitmap/Palette.h"
+
+#include "TestUtil.h"
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <cstring>
+
+// Returns the index of the first of the entries nearest to a color, by searching every entry
+template <class Color>
+static int nearestByScan(Palette<Color> const & palette, int r, int g, int b)
+{
+    int best         = 0;
+    int bestDistance = INT32_MAX;
+    for (int i = 0; i < int(Palette<Color>::PALETTE_SIZE); ++i)
+    {
+        Color const c        = palette.entries()[i];
+        int const   dr       = r - c.red8();
+        int const   dg       = g - c.green8();
+        int const   db       = b - c.blue8();
+        int const   distance = dr * dr + dg * dg + db * db;
+        if (distance < bestDistance)
+        {
+            best         = i;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+template <class Color>
+static void testFind()
+{
+    Palette<Color>         palette = makePalette<Color>();
+    Palette<Color> const & entries = palette;
+    for (int i = 0; i < int(Palette<Color>::PALETTE_SIZE); ++i)
+    {
+        int const found = entries.find(entries[i]);
+        ASSERT_GE(found, 0);
+        ASSERT_LE(found, i);
+        ASSERT_EQ(entries[found].raw(), entries[i].raw());
+    }
+
+    // The first of equal entries is found
+    palette[200] = palette[100];
+    EXPECT_LE(palette.find(palette[200]), 100);
+}
+
+TEST(PaletteTest, Find)
+{
+    testFind<Pixel565>();
+    testFind<Pixel1555>();
+    testFind<PixelRGB>();
+    testFind<PixelBGR>();
+    testFind<PixelARGB>();
+    testFind<PixelRGBA>();
+    testFind<PixelBGRA>();
+    testFind<PixelABGR>();
+
+    PaletteARGB palette = makePalette<PixelARGB>();
+    PixelARGB   color   = palette[5];
+    color.set8(color.red8(), color.green8(), color.blue8(), uint8_t(color.alpha8() ^ 0x80));
+    palette[5] = color;
+    EXPECT_EQ(palette.find(color), 5);
+
+    // An exact match includes alpha
+    color.set8(color.red8(), color.green8(), color.blue8(), uint8_t(color.alpha8() ^ 0x01));
+    EXPECT_EQ(palette.find(color), -1);
+}
+
+template <class Color>
+static void testNearest(Palette<Color> const & palette)
+{
+    unsigned seed = 7;
+    for (int i = 0; i < 20000; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        uint8_t const r = uint8_t(seed >> 24);
+        uint8_t const g = uint8_t(seed >> 16);
+        uint8_t const b = uint8_t(seed >> 8);
+        ASSERT_EQ(palette.nearest(r, g, b), nearestByScan(palette, r, g, b));
+    }
+    for (int v = 0; v < 256; ++v)
+    {
+        ASSERT_EQ(palette.nearest(uint8_t(v), uint8_t(v), uint8_t(v)), nearestByScan(palette, v, v, v));
+    }
+}
+
+TEST(PaletteTest, Nearest)
+{
+    testNearest(makePalette<PixelRGB>());
+    testNearest(makePalette<Pixel565>());
+
+    // A few colors, with the rest of the entries left black
+    PaletteRGB few;
+    memset(few.entries(), 0, sizeof(PixelRGB) * PaletteRGB::PALETTE_SIZE);
+    few[1].set8(255, 255, 255);
+    few[2].set8(255, 0, 0);
+    few[3].set8(0, 128, 0);
+    few[4].set8(0, 128, 0);
+    testNearest(few);
+    EXPECT_EQ(few.nearest(10, 10, 10), 0);
+    EXPECT_EQ(few.nearest(10, 120, 10), 3);
+    EXPECT_EQ(few.nearest(250, 30, 20), 2);
+
+    // A color in the palette is itself, and any other color is the nearest entry
+    PixelRGB color;
+    color.set8(255, 0, 0);
+    EXPECT_EQ(few.nearest(color), 2);
+    color.set8(200, 220, 240);
+    EXPECT_EQ(few.nearest(color), 1);
+
+    // Random colors
+    PaletteRGB random;
+    unsigned   seed = 99;
+    for (int i = 0; i < int(PaletteRGB::PALETTE_SIZE); ++i)
+    {
+        seed      = seed * 1103515245u + 12345u;
+        random[i] = PixelRGB(seed >> 4);
+    }
+    testNearest(random);
+
+    // Clustered colors
+    PaletteRGB clustered;
+    for (int i = 0; i < int(PaletteRGB::PALETTE_SIZE); ++i)
+    {
+        clustered[i].set8(uint8_t(100 + i % 7), uint8_t(50 + i / 7 % 6), uint8_t(200 + i / 42));
+    }
+    testNearest(clustered);
+}
+
+TEST(PaletteTest, Index)
+{
+    PaletteRGB palette = makePalette<PixelRGB>();
+    PixelRGB   color;
+    color.set8(1, 2, 3);
+    EXPECT_EQ(palette.find(color), -1);
+
+    // The index is shared by copies
+    PaletteRGB const copy = palette;
+    EXPECT_EQ(copy.index(), palette.index());
+
+    // Changing an entry discards the index
+    palette[9] = color;
+    EXPECT_EQ(palette.find(color), 9);
+    EXPECT_EQ(palette.nearest(1, 2, 4), 9);
+    EXPECT_NE(copy.index(), palette.index());
+    EXPECT_EQ(copy.find(color), -1);
+
+    palette.entries()[10].set8(4, 5, 6);
+    color.set8(4, 5, 6);
+    EXPECT_EQ(palette.find(color), 10);
+
+    PaletteRGB assigned;
+    assigned = copy;
+    EXPECT_EQ(assigned.find(color), -1);
+    EXPECT_EQ(assigned.find(copy[20]), 20);
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
@@ -0,0 +1,170 @@
+#include "Bitmap/PalettizedBitmap.h"
+
+#include "TestUtil.h"
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+template <class Color>
+static void testDecompressedRegion()
+{
+    int const WIDTH  = 77;
+    int const HEIGHT = 9;
+
+    // Runs of indexes below 16 alternate with runs of any index
+    std::vector<uint8_t> indexes(WIDTH * HEIGHT);
+    for (size_t i = 0; i < indexes.size(); ++i)
+    {
+        indexes[i] = uint8_t(i * 7 + (i >> 3));
+        if ((i / 48) % 2 != 0)
+            indexes[i] &= 0x0f;
+    }
+
+    Palette<Color> const palette = makePalette<Color>();
+    PalettizedBitmap<Color> const bitmap(WIDTH, HEIGHT, &indexes[0], palette);
+
+    struct
+    {
+        int x, y, width, height;
+    } const regions[] =
+    {
+        { 0, 0, WIDTH, HEIGHT },
+        { 1, 2, 1, 1 },
+        { 3, 1, 10, 2 },
+        { 5, 4, 33, 5 },
+        { 0, 0, 17, 3 },
+        { -10, -3, 2 * WIDTH, 2 * HEIGHT },
+    };
+
+    for (auto const & r : regions)
+    {
+        Bitmap<Color> const region = bitmap.decompressedRegion(r.x, r.y, r.width, r.height);
+        int const x0 = std::max(r.x, 0);
+        int const y0 = std::max(r.y, 0);
+        int const w  = std::min(r.x + r.width, WIDTH) - x0;
+        int const h  = std::min(r.y + r.height, HEIGHT) - y0;
+        ASSERT_EQ(region.width(), w);
+        ASSERT_EQ(region.height(), h);
+        for (int i = 0; i < h; ++i)
+        {
+            for (int j = 0; j < w; ++j)
+            {
+                EXPECT_EQ(region.pixel(j, i).raw(), palette[indexes[(y0 + i) * WIDTH + x0 + j]].raw());
+            }
+        }
+    }
+
+    {
+        size_t const PITCH = Bitmap<Color>::alignedPitch(WIDTH);
+        Bitmap<Color> const region = bitmap.decompressedRegion(0, 0, WIDTH, HEIGHT, int(PITCH));
+        EXPECT_EQ(region.pitch(), PITCH);
+        EXPECT_EQ(region.pixel(WIDTH - 1, HEIGHT - 1).raw(), palette[indexes[WIDTH * HEIGHT - 1]].raw());
+    }
+
+    {
+        Bitmap<Color> const region = bitmap.decompressedRegion(WIDTH, 0, 10, 10);
+        EXPECT_EQ(region.width(), 0);
+        EXPECT_EQ(region.height(), 0);
+        EXPECT_EQ(region.data(), nullptr);
+    }
+}
+
+TEST(PalettizedBitmapTest, Constructor)
+{
+    std::vector<uint8_t> indexes(64 * 32);
+    std::iota(indexes.begin(), indexes.end(), 0);
+    PaletteRGB const palette = makePalette<PixelRGB>();
+
+    {
+        PalettizedBitmap<PixelRGB> const constructed(64, 32);
+        EXPECT_EQ(constructed.width(), 64);
+        EXPECT_EQ(constructed.height(), 32);
+        EXPECT_EQ(constructed.pitch(), 64);
+    }
+
+    {
+        PalettizedBitmap<PixelRGB> const constructed(64, 32, &indexes[0], palette);
+        EXPECT_EQ(constructed.pixel(3, 2), indexes[131]);
+        EXPECT_EQ(constructed.palette()[7].raw(), palette[7].raw());
+    }
+
+    {
+        PalettizedBitmap<PixelRGB> loaded;
+        loaded.load(64, 32, &indexes[0], palette);
+        EXPECT_EQ(loaded.width(), 64);
+        EXPECT_EQ(loaded.pixel(3, 2), indexes[131]);
+        EXPECT_EQ(loaded.palette()[7].raw(), palette[7].raw());
+    }
+}
+
+TEST(PalettizedBitmapTest, DecompressedRegion)
+{
+    // Every kernel supported by the processor is tested
+
+    for (SimdLevel level : { SimdLevel::SCALAR, SimdLevel::SSSE3, SimdLevel::AVX2 })
+    {
+        SimdLevel const previous = setSimdLimit(level);
+        testDecompressedRegion<Pixel565>();
+        testDecompressedRegion<Pixel1555>();
+        testDecompressedRegion<PixelRGB>();
+        testDecompressedRegion<PixelBGR>();
+        testDecompressedRegion<PixelARGB>();
+        testDecompressedRegion<PixelRGBA>();
+        testDecompressedRegion<PixelBGRA>();
+        testDecompressedRegion<PixelABGR>();
+        setSimdLimit(previous);
+    }
+}
+
+TEST(PalettizedBitmapTest, SetColors)
+{
+    PaletteRGB const palette = makePalette<PixelRGB>();
+
+    Bitmap<PixelRGB> image(40, 20);
+    for (int y = 0; y < 20; ++y)
+    {
+        for (int x = 0; x < 40; ++x)
+        {
+            *image.data(x, y) = palette[(x / 3 + y * 7) % 256];
+        }
+    }
+    image.data(5, 5)->set8(1, 2, 3);
+
+    PalettizedBitmap<PixelRGB> bitmap(50, 30, palette);
+    memset(bitmap.data(), 0, bitmap.pitch() * 30);
+    bitmap.setColors(20, 15, image.view());
+    for (int y = 0; y < 15; ++y)
+    {
+        for (int x = 0; x < 30; ++x)
+        {
+            uint8_t const entry = *bitmap.data(20 + x, 15 + y);
+            if (x == 5 && y == 5)
+                EXPECT_EQ(entry, palette.nearest(1, 2, 3));
+            else
+                EXPECT_EQ(palette[entry].raw(), image.pixel(x, y).raw());
+        }
+    }
+    EXPECT_EQ(*bitmap.data(19, 15), 0);
+    EXPECT_EQ(*bitmap.data(20, 14), 0);
+
+    PixelRGB color;
+    color.set8(1, 2, 3);
+    bitmap.setColor(0, 0, color);
+    EXPECT_EQ(*bitmap.data(0, 0), palette.nearest(1, 2, 3));
+    bitmap.setColor(1, 0, palette[77]);
+    EXPECT_EQ(palette[*bitmap.data(1, 0)].raw(), palette[77].raw());
+
+    // Changing the palette changes the entries found
+    bitmap.palette()[200] = color;
+    bitmap.setColor(2, 0, color);
+    EXPECT_EQ(*bitmap.data(2, 0), 200);
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
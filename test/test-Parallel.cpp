@@ -0,0 +1,107 @@
+#include "Bitmap/Parallel.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+TEST(ParallelTest, ThreadPool)
+{
+    // Single-threaded pool
+
+    {
+        ThreadPool pool(1);
+        EXPECT_EQ(pool.size(), 1);
+
+        std::vector<int> calls(100, 0);
+        pool.run(int(calls.size()), [&calls] (int i) { ++calls[i]; });
+        for (int n : calls)
+        {
+            EXPECT_EQ(n, 1);
+        }
+    }
+
+    // Every call is made exactly once
+
+    {
+        ThreadPool pool(4);
+        EXPECT_EQ(pool.size(), 4);
+
+        std::vector<std::atomic<int>> calls(1000);
+        pool.run(int(calls.size()), [&calls] (int i) { calls[i].fetch_add(1); });
+        for (auto const & n : calls)
+        {
+            EXPECT_EQ(n.load(), 1);
+        }
+
+        // No calls
+
+        pool.run(0, [] (int) { FAIL(); });
+    }
+
+    // Nested runs
+
+    {
+        ThreadPool pool(3);
+        std::atomic<int> total{ 0 };
+        pool.run(8, [&pool, &total] (int) {
+            pool.run(8, [&total] (int) { total.fetch_add(1); });
+        });
+        EXPECT_EQ(total.load(), 64);
+    }
+}
+
+TEST(ParallelTest, ForEachBand)
+{
+    int const    ROWS     = 4096;
+    size_t const ROW_SIZE = 4096;
+
+    // The rows are split into bands of at least PARALLEL_MIN_BAND_SIZE bytes, and at most one band per thread
+    size_t const MAX_BANDS = ROWS * ROW_SIZE / PARALLEL_MIN_BAND_SIZE;
+
+    for (Execution execution : { Execution::SEQUENTIAL, Execution::PARALLEL })
+    {
+        std::vector<std::atomic<int>> rows(ROWS);
+        std::atomic<int> bands{ 0 };
+        forEachBand(execution, ROWS, ROW_SIZE, [&rows, &bands] (int begin, int end) {
+            EXPECT_LT(begin, end);
+            for (int i = begin; i < end; ++i)
+            {
+                rows[i].fetch_add(1);
+            }
+            bands.fetch_add(1);
+        });
+        for (auto const & n : rows)
+        {
+            EXPECT_EQ(n.load(), 1);
+        }
+        if (execution == Execution::SEQUENTIAL)
+            EXPECT_EQ(bands.load(), 1);
+        else
+            EXPECT_EQ(size_t(bands.load()), std::min(size_t(ThreadPool::shared().size()), MAX_BANDS));
+    }
+
+    // Too little data to split
+
+    {
+        int bands = 0;
+        forEachBand(Execution::PARALLEL, 16, 16, [&bands] (int begin, int end) {
+            EXPECT_EQ(begin, 0);
+            EXPECT_EQ(end, 16);
+            ++bands;
+        });
+        EXPECT_EQ(bands, 1);
+    }
+
+    // No rows
+
+    forEachBand(Execution::PARALLEL, 0, ROW_SIZE, [] (int, int) { FAIL(); });
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
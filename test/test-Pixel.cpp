@@ -0,0 +1,107 @@
+#include "Bitmap/Pixel.h"
+
+#include "gtest/gtest.h"
+
+TEST(PixelTest, Descriptors)
+{
+    static_assert(Pixel565::RED_BITS == 5 && Pixel565::GREEN_BITS == 6 && Pixel565::BLUE_BITS == 5, "");
+    static_assert(Pixel565::ALPHA_BITS == 0 && !Pixel565::HAS_ALPHA, "");
+    static_assert(Pixel565::RED_FIELD == 0xf800 && Pixel565::GREEN_FIELD == 0x07e0 && Pixel565::BLUE_FIELD == 0x001f, "");
+    static_assert(Pixel1555::ALPHA_BITS == 1 && Pixel1555::HAS_ALPHA && Pixel1555::ALPHA_FIELD == 0x8000, "");
+    static_assert(Pixel1555::GREEN_MAX == 0x1f && Pixel1555::GREEN_SHIFT == 5, "");
+    static_assert(!Pixel565::BYTE_CHANNELS && PixelRGB::BYTE_CHANNELS && PixelARGB::BYTE_CHANNELS, "");
+    static_assert(PixelRGB::RED_BYTE == 0 && PixelBGR::RED_BYTE == 2 && PixelBGR::ALPHA_BYTE == -1, "");
+    static_assert(PixelARGB::ALPHA_BYTE == 0 && PixelRGBA::ALPHA_BYTE == 3 && PixelBGRA::BLUE_BYTE == 0, "");
+    static_assert(PixelABGR::RED_BYTE == 3 && PixelABGR::ALPHA_MAX == 0xff, "");
+}
+
+TEST(PixelTest, Pixel16)
+{
+    {
+        Pixel565 p(0u);
+        p.setRedValue(0x1f);
+        p.setGreenValue(0x2a);
+        p.setBlueValue(0x05);
+        EXPECT_EQ(p.raw(), (0x1fu << 11) | (0x2au << 5) | 0x05u);
+        EXPECT_EQ(p.redValue(), 0x1f);
+        EXPECT_EQ(p.greenValue(), 0x2a);
+        EXPECT_EQ(p.blueValue(), 0x05);
+        EXPECT_EQ(p.alphaValue(), 0);
+        EXPECT_EQ(p.red8(), 0xff);
+        EXPECT_EQ(p.green8(), (0x2a * 255 + 31) / 63);
+        EXPECT_EQ(p.blue8(), (0x05 * 255 + 15) / 31);
+        EXPECT_EQ(p.alpha8(), 0xff);
+        EXPECT_EQ(p.alpha(), 0.0f);
+
+        p.setGreenValue(0);
+        EXPECT_EQ(p.raw(), (0x1fu << 11) | 0x05u);
+    }
+
+    {
+        Pixel1555 p(0u);
+        p.set8(0xff, 0x80, 0x00, 0xff);
+        EXPECT_EQ(p.redValue(), 0x1f);
+        EXPECT_EQ(p.greenValue(), 0x10);
+        EXPECT_EQ(p.blueValue(), 0);
+        EXPECT_EQ(p.alphaValue(), 1);
+        p.setAlphaValue(0);
+        EXPECT_EQ(p.raw(), (0x1fu << 10) | (0x10u << 5));
+    }
+
+    // The floating point setters set each channel independently
+
+    {
+        Pixel565 p(1.0f, 0.0f, 0.5f);
+        EXPECT_EQ(p.redValue(), 0x1f);
+        EXPECT_EQ(p.greenValue(), 0);
+        EXPECT_EQ(p.blueValue(), 0x10);
+
+        p.setRed(0.0f);
+        EXPECT_EQ(p.redValue(), 0);
+        EXPECT_EQ(p.blueValue(), 0x10);
+        p.setGreen(1.0f);
+        EXPECT_EQ(p.greenValue(), 0x3f);
+        EXPECT_EQ(p.redValue(), 0);
+        EXPECT_EQ(p.blueValue(), 0x10);
+    }
+}
+
+TEST(PixelTest, Pixel24)
+{
+    PixelBGR p(0u);
+    p.setRedValue(0x12);
+    p.setGreenValue(0x34);
+    p.setBlueValue(0x56);
+    EXPECT_EQ(p.raw(), 0x563412u);
+    EXPECT_EQ(p.red8(), 0x12);
+    EXPECT_EQ(p.green8(), 0x34);
+    EXPECT_EQ(p.blue8(), 0x56);
+    EXPECT_EQ(p.alpha8(), 0xff);
+
+    p.set8(0xab, 0xcd, 0xef, 0x00);
+    EXPECT_EQ(p.raw(), 0xefcdabu);
+    EXPECT_EQ(p.redValue(), 0xab);
+}
+
+TEST(PixelTest, Pixel32)
+{
+    PixelBGRA p(0u);
+    p.setRedValue(0x12);
+    p.setGreenValue(0x34);
+    p.setBlueValue(0x56);
+    p.setAlphaValue(0x78);
+    EXPECT_EQ(p.raw(), 0x56341278u);
+    EXPECT_EQ(p.alpha8(), 0x78);
+
+    p.set8(0xab, 0xcd, 0xef, 0x01);
+    EXPECT_EQ(p.raw(), 0xefcdab01u);
+    EXPECT_EQ(p.redValue(), 0xab);
+    EXPECT_EQ(p.alphaValue(), 0x01);
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
@@ -0,0 +1,175 @@
+#include "Bitmap/Quantize.h"
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <set>
+
+// Returns a smooth image with every hue and a range of brightness
+template <class Pixel>
+static Bitmap<Pixel> gradientImage(int width, int height)
+{
+    Bitmap<Pixel> image(width, height);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            Pixel p;
+            p.set8(uint8_t(x * 255 / (width - 1)),
+                   uint8_t(y * 255 / (height - 1)),
+                   uint8_t((x + y) * 255 / (width + height - 2)));
+            *image.data(x, y) = p;
+        }
+    }
+    return image;
+}
+
+// Returns an image with a few colors, each at the center of a different histogram cell
+template <class Pixel>
+static Bitmap<Pixel> fewColorImage(int width, int height, int colors)
+{
+    Bitmap<Pixel> image(width, height);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            int const i = (x / 3 + y) % colors;
+            Pixel     p;
+            p.set8(uint8_t((i % 4) * 64 + 4), uint8_t((i / 4 % 4) * 64 + 4), uint8_t((i / 16) * 64 + 4));
+            *image.data(x, y) = p;
+        }
+    }
+    return image;
+}
+
+// Returns the root mean square error of a palettized image
+template <class Color, class Pixel>
+static double error(PalettizedBitmap<Color> const & result, Bitmap<Pixel> const & image)
+{
+    Palette<Color> const palette = result.palette();
+    double               sum     = 0.0;
+    for (int y = 0; y < image.height(); ++y)
+    {
+        for (int x = 0; x < image.width(); ++x)
+        {
+            Pixel const p = *image.data(x, y);
+            Color const c = palette.entries()[*result.data(x, y)];
+            double dr = double(p.red8()) - c.red8();
+            double dg = double(p.green8()) - c.green8();
+            double db = double(p.blue8()) - c.blue8();
+            sum += dr * dr + dg * dg + db * db;
+        }
+    }
+    return std::sqrt(sum / (3.0 * image.width() * image.height()));
+}
+
+template <class Pixel, class Color>
+static void testExact(QuantizeMethod method)
+{
+    Bitmap<Pixel> image = fewColorImage<Pixel>(50, 40, 48);
+    auto          result = quantize<Color>(image.view(), method);
+    ASSERT_EQ(result.width(), 50);
+    ASSERT_EQ(result.height(), 40);
+    EXPECT_EQ(error(result, image), 0.0);
+
+    // Only the colors in the image are used
+    std::set<uint8_t> used;
+    for (int y = 0; y < 40; ++y)
+    {
+        used.insert(result.data(0, y), result.data(0, y) + 50);
+    }
+    EXPECT_EQ(used.size(), 48u);
+}
+
+TEST(QuantizeTest, Exact)
+{
+    testExact<PixelRGB, PixelRGB>(QuantizeMethod::OCTREE);
+    testExact<PixelRGB, PixelRGB>(QuantizeMethod::MEDIAN_CUT);
+    testExact<PixelRGBA, PixelARGB>(QuantizeMethod::OCTREE);
+    testExact<PixelRGBA, PixelARGB>(QuantizeMethod::MEDIAN_CUT);
+}
+
+TEST(QuantizeTest, Gradient)
+{
+    Bitmap<PixelRGB> image = gradientImage<PixelRGB>(256, 256);
+    for (QuantizeMethod method : { QuantizeMethod::OCTREE, QuantizeMethod::MEDIAN_CUT })
+    {
+        auto full = quantize<PixelRGB>(image.view(), method);
+        EXPECT_LT(error(full, image), 6.0);
+
+        auto reduced = quantize<PixelRGB>(image.view(), method, 16);
+        EXPECT_LT(error(reduced, image), 20.0);
+        EXPECT_GT(error(reduced, image), error(full, image));
+        for (int y = 0; y < 256; ++y)
+        {
+            for (int x = 0; x < 256; ++x)
+            {
+                ASSERT_LT(*reduced.data(x, y), 16);
+            }
+        }
+    }
+}
+
+TEST(QuantizeTest, Parallel)
+{
+    Bitmap<PixelARGB> image = gradientImage<PixelARGB>(600, 400);
+    for (QuantizeMethod method : { QuantizeMethod::OCTREE, QuantizeMethod::MEDIAN_CUT })
+    {
+        auto sequential = quantize<PixelRGB>(image.view(), method, 256, Execution::SEQUENTIAL);
+        auto parallel   = quantize<PixelRGB>(image.view(), method, 256, Execution::PARALLEL);
+        for (int y = 0; y < 400; ++y)
+        {
+            ASSERT_EQ(memcmp(sequential.data(0, y), parallel.data(0, y), 600), 0);
+        }
+    }
+}
+
+TEST(QuantizeTest, ColorQuantizer)
+{
+    ColorQuantizer quantizer;
+    uint8_t        colors[ColorQuantizer::MAX_COLORS][3];
+    EXPECT_EQ(quantizer.build(QuantizeMethod::OCTREE, colors), 0);
+    EXPECT_EQ(quantizer.build(QuantizeMethod::MEDIAN_CUT, colors), 0);
+
+    // Colors in the same cell are averaged
+    quantizer.add(0, 0, 0);
+    quantizer.add(6, 6, 6, 3);
+    EXPECT_EQ(quantizer.cells(), 1);
+    ASSERT_EQ(quantizer.build(QuantizeMethod::MEDIAN_CUT, colors), 1);
+    EXPECT_EQ(colors[0][0], 5);
+
+    // A single color is chosen for everything
+    quantizer.add(255, 0, 0);
+    quantizer.add(0, 0, 255);
+    EXPECT_EQ(quantizer.build(QuantizeMethod::OCTREE, colors, 1), 1);
+    EXPECT_EQ(quantizer.build(QuantizeMethod::MEDIAN_CUT, colors, 2), 2);
+
+    quantizer.clear();
+    EXPECT_EQ(quantizer.cells(), 0);
+}
+
+TEST(QuantizeTest, InverseColormap)
+{
+    uint8_t const   colors[3][3] = { { 0, 0, 0 }, { 255, 255, 255 }, { 255, 0, 0 } };
+    InverseColormap map(colors, 3);
+    EXPECT_EQ(map(10, 10, 10), 0);
+    EXPECT_EQ(map(200, 220, 240), 1);
+    EXPECT_EQ(map(250, 30, 20), 2);
+
+    Bitmap<PixelRGB> image(2, 1);
+    image.data()[0].set8(240, 10, 10);
+    image.data()[1].set8(20, 20, 20);
+    Bitmap<uint8_t> indexes(2, 1);
+    map.map(image.view(), indexes.view());
+    EXPECT_EQ(indexes.data()[0], 2);
+    EXPECT_EQ(indexes.data()[1], 0);
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
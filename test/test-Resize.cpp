@@ -0,0 +1,207 @@
+#include "Bitmap/Convert.h"
+#include "Bitmap/Resize.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static ResizeFilter const FILTERS[] =
+{
+    ResizeFilter::NEAREST, ResizeFilter::BILINEAR, ResizeFilter::BOX, ResizeFilter::LANCZOS
+};
+
+// Returns a bitmap with a smooth gradient and some noise
+template <class Pixel>
+static Bitmap<Pixel> testImage(int width, int height)
+{
+    Bitmap<Pixel> image(width, height);
+    unsigned      seed = 1;
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            uint8_t r = uint8_t(x * 255 / width);
+            uint8_t g = uint8_t(y * 255 / height);
+            uint8_t b = uint8_t(seed >> 24);
+            if constexpr (std::is_same<Pixel, Pixel8>::value)
+                *image.data(x, y) = b;
+            else
+                image.data(x, y)->set8(r, g, b, 0xff);
+        }
+    }
+    return image;
+}
+
+TEST(ResizeTest, Constant)
+{
+    // The weights always sum to 1, so a constant image remains constant
+
+    PixelRGBA value;
+    value.set8(12, 128, 255, 200);
+
+    Bitmap<PixelRGBA> image(37, 29);
+    for (int y = 0; y < image.height(); ++y)
+    {
+        for (int x = 0; x < image.width(); ++x)
+        {
+            *image.data(x, y) = value;
+        }
+    }
+
+    for (ResizeFilter filter : FILTERS)
+    {
+        for (int size : { 1, 5, 29, 37, 100 })
+        {
+            Bitmap<PixelRGBA> resized = resize(image, size, 101 - size, filter);
+            ASSERT_EQ(resized.width(), size);
+            ASSERT_EQ(resized.height(), 101 - size);
+            for (int y = 0; y < resized.height(); ++y)
+            {
+                for (int x = 0; x < resized.width(); ++x)
+                {
+                    ASSERT_EQ(memcmp(resized.data(x, y), &value, sizeof value), 0) << "at (" << x << ", " << y << ")";
+                }
+            }
+        }
+    }
+}
+
+TEST(ResizeTest, Identity)
+{
+    Bitmap<PixelBGR> image = testImage<PixelBGR>(45, 31);
+    for (ResizeFilter filter : FILTERS)
+    {
+        Bitmap<PixelBGR> resized = resize(image, 45, 31, filter);
+        EXPECT_EQ(memcmp(resized.data(), image.data(), image.pitch() * image.height()), 0);
+    }
+}
+
+TEST(ResizeTest, Nearest)
+{
+    Bitmap<uint32_t> image(3, 2);
+    for (int i = 0; i < 6; ++i)
+    {
+        image.data()[i] = uint32_t(i);
+    }
+
+    Bitmap<uint32_t> enlarged = resize(image, 6, 4, ResizeFilter::NEAREST);
+    for (int y = 0; y < 4; ++y)
+    {
+        for (int x = 0; x < 6; ++x)
+        {
+            EXPECT_EQ(enlarged.pixel(x, y), image.pixel(x / 2, y / 2));
+        }
+    }
+
+    Bitmap<uint32_t> reduced = resize(enlarged, 3, 2, ResizeFilter::NEAREST);
+    EXPECT_EQ(memcmp(reduced.data(), image.data(), 6 * sizeof(uint32_t)), 0);
+}
+
+TEST(ResizeTest, Box)
+{
+    // Reducing by 2 averages 2x2 blocks (within the rounding of the two passes)
+
+    Bitmap<Pixel8> image = testImage<Pixel8>(64, 48);
+    Bitmap<Pixel8> reduced = resize(image, 32, 24, ResizeFilter::BOX);
+    for (int y = 0; y < 24; ++y)
+    {
+        for (int x = 0; x < 32; ++x)
+        {
+            int sum = image.pixel(x * 2, y * 2) + image.pixel(x * 2 + 1, y * 2) +
+                      image.pixel(x * 2, y * 2 + 1) + image.pixel(x * 2 + 1, y * 2 + 1);
+            EXPECT_LE(std::abs(reduced.pixel(x, y) - (sum + 2) / 4), 1);
+        }
+    }
+
+    // Pixels partly covered by an output pixel contribute in proportion to the area covered
+
+    Bitmap<Pixel8> row(3, 1);
+    *row.data(0, 0) = 30;
+    *row.data(1, 0) = 90;
+    *row.data(2, 0) = 240;
+    Bitmap<Pixel8> narrowed = resize(row, 2, 1, ResizeFilter::BOX);
+    EXPECT_EQ(narrowed.pixel(0, 0), 50);    // (30 + 0.5 * 90) / 1.5
+    EXPECT_EQ(narrowed.pixel(1, 0), 190);   // (0.5 * 90 + 240) / 1.5
+}
+
+TEST(ResizeTest, Formats)
+{
+    // The 32-bit and 24-bit formats are filtered differently, but the results are the same
+
+    Bitmap<PixelRGBA> rgba = testImage<PixelRGBA>(203, 101);
+    Bitmap<PixelRGB>  rgb  = testImage<PixelRGB>(203, 101);
+
+    for (ResizeFilter filter : FILTERS)
+    {
+        for (int width : { 17, 300 })
+        {
+            Bitmap<PixelRGBA> a = resize(rgba, width, 77, filter);
+            Bitmap<PixelRGB>  b = resize(rgb, width, 77, filter);
+            for (int y = 0; y < 77; ++y)
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    ASSERT_EQ(a.pixel(x, y).red8(), b.pixel(x, y).red8());
+                    ASSERT_EQ(a.pixel(x, y).green8(), b.pixel(x, y).green8());
+                    ASSERT_EQ(a.pixel(x, y).blue8(), b.pixel(x, y).blue8());
+                }
+            }
+        }
+    }
+
+    // 16-bit pixels are filtered with 8-bit channels
+
+    Bitmap<Pixel565> image = convert<Pixel565>(rgb);
+    for (ResizeFilter filter : FILTERS)
+    {
+        Bitmap<Pixel565> resized = resize(image, 64, 64, filter);
+        EXPECT_EQ(resized.width(), 64);
+        EXPECT_EQ(resized.height(), 64);
+    }
+}
+
+TEST(ResizeTest, Parallel)
+{
+    Bitmap<PixelARGB> image = testImage<PixelARGB>(1500, 1000);
+    for (ResizeFilter filter : FILTERS)
+    {
+        Bitmap<PixelARGB> sequential = resize(image, 700, 900, filter, Execution::SEQUENTIAL);
+        Bitmap<PixelARGB> parallel   = resize(image, 700, 900, filter, Execution::PARALLEL);
+        EXPECT_EQ(memcmp(sequential.data(), parallel.data(), sequential.pitch() * sequential.height()), 0);
+    }
+}
+
+TEST(ResizeTest, Views)
+{
+    // Resizing a region into a region
+
+    Bitmap<PixelRGB> image = testImage<PixelRGB>(64, 64);
+    Bitmap<PixelRGB> dst(100, 100);
+    memset(dst.data(), 0, dst.pitch() * dst.height());
+
+    resize(image.view(16, 16, 32, 32), dst.view(10, 20, 64, 64), ResizeFilter::BILINEAR);
+    Bitmap<PixelRGB> expected = resize(image.region(16, 16, 32, 32), 64, 64, ResizeFilter::BILINEAR);
+    for (int y = 0; y < 64; ++y)
+    {
+        EXPECT_EQ(memcmp(dst.data(10, 20 + y), expected.data(0, y), 64 * sizeof(PixelRGB)), 0);
+    }
+    EXPECT_EQ(dst.pixel(9, 20).red8(), 0);
+    EXPECT_EQ(dst.pixel(74, 20).red8(), 0);
+
+    // Empty images
+
+    Bitmap<PixelRGB> empty;
+    resize(empty.view(), dst.view(), ResizeFilter::LANCZOS);
+    EXPECT_EQ(dst.pixel(0, 0).red8(), 0);
+    EXPECT_EQ(resize(image, 0, 10, ResizeFilter::LANCZOS).width(), 0);
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
@@ -0,0 +1,181 @@
+#include "Bitmap/RleBitmap.h"
+
+#include "TestUtil.h"
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <vector>
+
+// Returns indexes with flat areas, short runs and noise
+static std::vector<uint8_t> makeIndexes(int width, int height)
+{
+    std::vector<uint8_t> indexes(width * height);
+    unsigned             seed = 13;
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            uint8_t & i = indexes[y * width + x];
+            if (x < width / 2)
+                i = uint8_t(y / 8);                 // Flat
+            else if (x < width * 3 / 4)
+                i = uint8_t((x / 2) + (seed >> 31));  // Short runs
+            else
+                i = uint8_t(seed >> 24);            // Noise
+        }
+    }
+    return indexes;
+}
+
+template <class Color>
+static void testRoundTrip(int width, int height)
+{
+    std::vector<uint8_t> const    indexes = makeIndexes(width, height);
+    Palette<Color> const          palette = makePalette<Color>();
+    PalettizedBitmap<Color> const source(width, height, const_cast<uint8_t *>(indexes.data()), palette);
+    RleBitmap<Color> const        rle(source);
+    ASSERT_EQ(rle.width(), width);
+    ASSERT_EQ(rle.height(), height);
+
+    // Indexes
+    PalettizedBitmap<Color> const restored = rle.palettized();
+    std::vector<uint8_t>          row(width);
+    for (int y = 0; y < height; ++y)
+    {
+        rle.indexRow(y, row.data());
+        ASSERT_EQ(memcmp(row.data(), &indexes[y * width], width), 0);
+        ASSERT_EQ(memcmp(restored.data(0, y), &indexes[y * width], width), 0);
+    }
+
+    // Colors, sequentially and in parallel
+    Bitmap<Color> expected = source.decompressedRegion(0, 0, width, height);
+    for (Execution execution : { Execution::SEQUENTIAL, Execution::PARALLEL })
+    {
+        Bitmap<Color> colors(width, height);
+        rle.decompress(colors.view(), execution);
+        for (int y = 0; y < height; ++y)
+        {
+            ASSERT_EQ(memcmp(colors.data(0, y), expected.data(0, y), width * sizeof(Color)), 0);
+        }
+    }
+}
+
+TEST(RleBitmapTest, RoundTrip)
+{
+    testRoundTrip<PixelRGB>(1, 1);
+    testRoundTrip<PixelRGB>(3, 2);
+    testRoundTrip<PixelARGB>(300, 40);
+    testRoundTrip<Pixel565>(1000, 300);
+}
+
+TEST(RleBitmapTest, Packets)
+{
+    // A flat row longer than a packet, a run of 2 within literals, and a run of 3
+    uint8_t const row[] = { 1, 2, 2, 3, 4, 4, 4 };
+    std::vector<uint8_t> flat(300, 9);
+
+    Palette<PixelRGB> const palette = makePalette<PixelRGB>();
+    RleBitmap<PixelRGB>     rle(7, 1, row, 7, palette);
+    uint8_t                 decoded[7];
+    rle.indexRow(0, decoded);
+    EXPECT_EQ(memcmp(decoded, row, sizeof(row)), 0);
+
+    rle.compress(300, 1, flat.data(), 300);
+    std::vector<uint8_t> decodedFlat(300);
+    rle.indexRow(0, decodedFlat.data());
+    EXPECT_EQ(decodedFlat, flat);
+
+    // 3 run packets of 2 bytes each, plus the row table
+    EXPECT_EQ(rle.compressedSize(), 3 * 2 + 2 * sizeof(size_t));
+}
+
+TEST(RleBitmapTest, Compression)
+{
+    int const            WIDTH   = 640;
+    int const            HEIGHT  = 480;
+    std::vector<uint8_t> indexes = makeIndexes(WIDTH, HEIGHT);
+    RleBitmap<PixelARGB> rle(WIDTH, HEIGHT, indexes.data(), WIDTH, makePalette<PixelARGB>());
+
+    // Half of each row is flat, a quarter is noise
+    EXPECT_LT(rle.compressedSize(), size_t(WIDTH * HEIGHT) * 2 / 3);
+}
+
+TEST(RleBitmapTest, DecompressedRegion)
+{
+    int const                     WIDTH   = 200;
+    int const                     HEIGHT  = 30;
+    std::vector<uint8_t> const    indexes = makeIndexes(WIDTH, HEIGHT);
+    Palette<PixelARGB> const      palette = makePalette<PixelARGB>();
+    PalettizedBitmap<PixelARGB> const source(WIDTH, HEIGHT, const_cast<uint8_t *>(indexes.data()), palette);
+    RleBitmap<PixelARGB> const    rle(source);
+
+    struct
+    {
+        int x, y, width, height;
+    } const regions[] =
+    {
+        { 0, 0, WIDTH, HEIGHT },
+        { 1, 2, 1, 1 },
+        { 99, 1, 60, 2 },
+        { 150, 4, 50, 26 },
+        { -10, -3, 2 * WIDTH, 2 * HEIGHT },
+    };
+
+    for (auto const & r : regions)
+    {
+        Bitmap<PixelARGB> const region   = rle.decompressedRegion(r.x, r.y, r.width, r.height);
+        Bitmap<PixelARGB> const expected = source.decompressedRegion(r.x, r.y, r.width, r.height);
+        ASSERT_EQ(region.width(), expected.width());
+        ASSERT_EQ(region.height(), expected.height());
+        for (int y = 0; y < region.height(); ++y)
+        {
+            ASSERT_EQ(memcmp(region.data(0, y), expected.data(0, y), region.width() * sizeof(PixelARGB)), 0);
+        }
+    }
+
+    Bitmap<PixelARGB> const outside = rle.decompressedRegion(WIDTH, 0, 10, 10);
+    EXPECT_EQ(outside.width(), 0);
+    EXPECT_EQ(outside.data(), nullptr);
+}
+
+TEST(RleBitmapTest, Palette)
+{
+    uint8_t const       row[] = { 5, 5, 5, 5, 6 };
+    Palette<PixelRGB>   palette = makePalette<PixelRGB>();
+    RleBitmap<PixelRGB> rle(5, 1, row, 5, palette);
+
+    // Changing the palette changes the colors without recompressing
+    palette[5] = PixelRGB(0x123456);
+    rle.setPalette(palette);
+    PixelRGB colors[5];
+    rle.expandRow(0, colors);
+    EXPECT_EQ(colors[0].raw(), PixelRGB(0x123456).raw());
+    EXPECT_EQ(colors[4].raw(), palette[6].raw());
+
+    rle.palette()[6] = PixelRGB(0x654321);
+    rle.expandRow(0, 4, 1, colors);
+    EXPECT_EQ(colors[0].raw(), PixelRGB(0x654321).raw());
+}
+
+TEST(RleBitmapTest, Resource)
+{
+    std::pmr::monotonic_buffer_resource pool;
+    std::vector<uint8_t>                indexes = makeIndexes(64, 64);
+    RleBitmap<PixelRGB> rle(64, 64, indexes.data(), 64, makePalette<PixelRGB>(), &pool);
+    EXPECT_EQ(rle.resource(), &pool);
+
+    RleBitmap<PixelRGB> empty;
+    EXPECT_EQ(empty.width(), 0);
+    EXPECT_EQ(empty.height(), 0);
+    EXPECT_EQ(empty.palettized().width(), 0);
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
@@ -0,0 +1,182 @@
+#include "Bitmap/Scanline.h"
+
+#include "TestUtil.h"
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+template <class Pixel>
+static void testWindows(int width, int height, int rows, int overlap)
+{
+    Bitmap<Pixel>         image = testImage<Pixel>(width, height);
+    ScanlineReader<Pixel> reader(width, height, rows, overlap, ScanlineReader<Pixel>::viewSource(image.view()));
+
+    int expectedY = 0;
+    int covered   = 0;
+    while (reader.next())
+    {
+        auto band = reader.band();
+        ASSERT_EQ(reader.y(), expectedY);
+        ASSERT_EQ(band.width(), width);
+        ASSERT_EQ(band.height(), std::min(rows, height - expectedY));
+        ASSERT_GT(band.height(), overlap);
+        for (int y = 0; y < band.height(); ++y)
+        {
+            ASSERT_EQ(memcmp(band.row(y), image.data(0, reader.y() + y), width * sizeof(Pixel)), 0);
+        }
+        covered   = reader.y() + band.height();
+        expectedY = covered - overlap;
+    }
+    EXPECT_FALSE(reader.failed());
+    EXPECT_EQ(covered, height);
+}
+
+TEST(ScanlineReaderTest, Windows)
+{
+    testWindows<uint8_t>(1, 1, 1, 0);
+    testWindows<uint8_t>(17, 100, 10, 0);
+    testWindows<uint8_t>(17, 100, 10, 3);
+    testWindows<Pixel565>(40, 31, 8, 7);
+    testWindows<PixelRGB>(33, 64, 16, 2);
+    testWindows<uint32_t>(50, 5, 16, 4);
+}
+
+TEST(ScanlineReaderTest, Empty)
+{
+    ScanlineReader<uint32_t> reader(10, 0, 4, 1, [] (int, uint32_t *) { return true; });
+    EXPECT_FALSE(reader.next());
+    EXPECT_FALSE(reader.failed());
+    EXPECT_EQ(reader.band().height(), 0);
+}
+
+TEST(ScanlineReaderTest, SourceFailure)
+{
+    // The source fails at row 10
+    ScanlineReader<uint16_t> reader(8, 20, 6, 2, [] (int y, uint16_t * row) {
+        memset(row, 0, 8 * sizeof(uint16_t));
+        return y < 10;
+    });
+    EXPECT_TRUE(reader.next());
+    EXPECT_TRUE(reader.next());
+    EXPECT_FALSE(reader.next());
+    EXPECT_TRUE(reader.failed());
+    EXPECT_FALSE(reader.next());
+}
+
+TEST(ScanlineWriterTest, Bands)
+{
+    Bitmap<PixelRGB> image = testImage<PixelRGB>(23, 45);
+    Bitmap<PixelRGB> result(23, 45);
+
+    ScanlineWriter<PixelRGB> writer(23, 45, 10, ScanlineWriter<PixelRGB>::viewSink(result.view()));
+    int                      bands = 0;
+    while (!writer.done())
+    {
+        auto band = writer.band();
+        ASSERT_EQ(band.height(), std::min(10, 45 - writer.y()));
+        for (int y = 0; y < band.height(); ++y)
+        {
+            memcpy(band.row(y), image.data(0, writer.y() + y), 23 * sizeof(PixelRGB));
+        }
+        ASSERT_TRUE(writer.commit());
+        ++bands;
+    }
+    EXPECT_EQ(bands, 5);
+    EXPECT_FALSE(writer.commit());
+    EXPECT_EQ(writer.band().height(), 0);
+    for (int y = 0; y < 45; ++y)
+    {
+        ASSERT_EQ(memcmp(result.data(0, y), image.data(0, y), 23 * sizeof(PixelRGB)), 0);
+    }
+}
+
+TEST(ScanlineWriterTest, SinkFailure)
+{
+    ScanlineWriter<uint8_t> writer(4, 10, 4, [] (int y, uint8_t const *) { return y < 5; });
+    memset(writer.band().data(), 0, 4);
+    EXPECT_TRUE(writer.commit());
+    EXPECT_FALSE(writer.commit());
+    EXPECT_TRUE(writer.failed());
+    EXPECT_TRUE(writer.done());
+}
+
+TEST(ScanlineTest, File)
+{
+    // An image is written to a file with padded rows and read back
+    Bitmap<uint16_t> image = testImage<uint16_t>(37, 50);
+    size_t const     pitch = 80;
+    FILE *           fp    = tmpfile();
+    ASSERT_NE(fp, nullptr);
+
+    ScanlineWriter<uint16_t> writer(37, 50, 7, ScanlineWriter<uint16_t>::fileSink(fp, 37, pitch));
+    while (!writer.done())
+    {
+        auto band = writer.band();
+        for (int y = 0; y < band.height(); ++y)
+        {
+            memcpy(band.row(y), image.data(0, writer.y() + y), 37 * sizeof(uint16_t));
+        }
+        writer.commit();
+    }
+    EXPECT_FALSE(writer.failed());
+    EXPECT_EQ(ftell(fp), long(pitch * 50));
+
+    rewind(fp);
+    ScanlineReader<uint16_t> reader(37, 50, 9, 0, ScanlineReader<uint16_t>::fileSource(fp, 37, pitch));
+    while (reader.next())
+    {
+        auto band = reader.band();
+        for (int y = 0; y < band.height(); ++y)
+        {
+            ASSERT_EQ(memcmp(band.row(y), image.data(0, reader.y() + y), 37 * sizeof(uint16_t)), 0);
+        }
+    }
+    EXPECT_FALSE(reader.failed());
+    fclose(fp);
+}
+
+TEST(ScanlineTest, Filter)
+{
+    // A 3-row vertical box filter is streamed with an overlap of 2 rows and compared to filtering the whole image
+    int const       width  = 31;
+    int const       height = 57;
+    Bitmap<uint8_t> image  = testImage<uint8_t>(width, height);
+    Bitmap<uint8_t> result(width, height - 2);
+
+    ScanlineReader<uint8_t> reader(width, height, 8, 2, ScanlineReader<uint8_t>::viewSource(image.view()));
+    ScanlineWriter<uint8_t> writer(width, height - 2, 6, ScanlineWriter<uint8_t>::viewSink(result.view()));
+    while (reader.next())
+    {
+        auto src = reader.band();
+        auto dst = writer.band();
+        ASSERT_EQ(dst.height(), src.height() - 2);
+        ASSERT_EQ(writer.y(), reader.y());
+        for (int y = 0; y < dst.height(); ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                dst.row(y)[x] = uint8_t((src.row(y)[x] + src.row(y + 1)[x] + src.row(y + 2)[x]) / 3);
+            }
+        }
+        ASSERT_TRUE(writer.commit());
+    }
+    EXPECT_TRUE(writer.done());
+
+    for (int y = 0; y < height - 2; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            int expected = (*image.data(x, y) + *image.data(x, y + 1) + *image.data(x, y + 2)) / 3;
+            ASSERT_EQ(*result.data(x, y), expected);
+        }
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
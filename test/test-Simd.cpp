@@ -0,0 +1,33 @@
+#include "Bitmap/Simd.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+
+TEST(SimdTest, Limit)
+{
+    SimdLevel const supported = supportedSimdLevel();
+    EXPECT_EQ(simdLevel(), supported);
+
+    // The level is the lower of the supported level and the limit
+    for (SimdLevel limit : { SimdLevel::SCALAR, SimdLevel::SSSE3, SimdLevel::AVX2 })
+    {
+        SimdLevel const previous = setSimdLimit(limit);
+        EXPECT_EQ(simdLevel(), std::min(limit, supported));
+        EXPECT_EQ(setSimdLimit(previous), limit);
+    }
+    EXPECT_EQ(simdLevel(), supported);
+
+#if defined(__AVX2__)
+    EXPECT_EQ(supported, SimdLevel::AVX2);
+#elif defined(__SSSE3__)
+    EXPECT_GE(supported, SimdLevel::SSSE3);
+#endif
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
@@ -0,0 +1,212 @@
+#include "Bitmap/TileCache.h"
+
+#include "TestUtil.h"
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+// Returns a palettized bitmap with pseudo-random indexes
+template <class Color>
+static PalettizedBitmap<Color> palettizedImage(int width, int height)
+{
+    PalettizedBitmap<Color> image(width, height, makePalette<Color>());
+    unsigned                seed = 11;
+    for (int y = 0; y < height; ++y)
+    {
+        uint8_t * row = image.data(0, y);
+        for (int x = 0; x < width; ++x)
+        {
+            seed   = seed * 1664525u + 1013904223u;
+            row[x] = uint8_t(seed >> 24);
+        }
+    }
+    return image;
+}
+
+// Returns true if a region from the cache matches the bitmap
+template <class Color, int TILE>
+static bool matches(TileCache<Color, TILE> & cache, PalettizedBitmap<Color> const & bitmap, int x, int y, int w, int h)
+{
+    Bitmap<Color> const expected = bitmap.decompressedRegion(x, y, w, h);
+    Bitmap<Color> const actual   = cache.region(x, y, w, h);
+    if (actual.width() != expected.width() || actual.height() != expected.height())
+        return false;
+    for (int i = 0; i < expected.height(); ++i)
+    {
+        if (memcmp(actual.data(0, i), expected.data(0, i), expected.width() * sizeof(Color)) != 0)
+            return false;
+    }
+    return true;
+}
+
+template <class Color>
+static void testRegion()
+{
+    PalettizedBitmap<Color> const bitmap = palettizedImage<Color>(75, 41);
+    TileCache<Color, 16>          cache(bitmap, 6);
+
+    struct
+    {
+        int x, y, width, height;
+    } const regions[] =
+    {
+        { 0, 0, 75, 41 },
+        { 1, 2, 1, 1 },
+        { 3, 1, 40, 20 },
+        { 15, 15, 2, 2 },
+        { 60, 30, 15, 11 },
+        { 5, 4, 33, 5 },
+        { -10, -3, 150, 80 },
+    };
+    for (auto const & r : regions)
+    {
+        EXPECT_TRUE(matches(cache, bitmap, r.x, r.y, r.width, r.height)) << r.x << ", " << r.y;
+        EXPECT_LE(cache.size(), cache.capacity());
+    }
+
+    Bitmap<Color> const empty = cache.region(75, 0, 10, 10);
+    EXPECT_EQ(empty.width(), 0);
+    EXPECT_EQ(empty.data(), nullptr);
+
+    // Pixels of a view outside the bitmap are not changed
+    Bitmap<Color> view(20, 10);
+    memset(static_cast<void *>(view.data()), 0x5a, view.pitch() * 10);
+    cache.copy(70, 35, view.view());
+    Bitmap<Color> const expected = bitmap.decompressedRegion(70, 35, 5, 6);
+    for (int y = 0; y < 10; ++y)
+    {
+        for (int x = 0; x < 20; ++x)
+        {
+            Color untouched;
+            memset(static_cast<void *>(&untouched), 0x5a, sizeof(Color));
+            Color const p = (x < 5 && y < 6) ? expected.pixel(x, y) : untouched;
+            ASSERT_EQ(view.pixel(x, y).raw(), p.raw()) << x << ", " << y;
+        }
+    }
+}
+
+TEST(TileCacheTest, Region)
+{
+    testRegion<Pixel565>();
+    testRegion<PixelRGB>();
+    testRegion<PixelARGB>();
+}
+
+TEST(TileCacheTest, LeastRecentlyUsed)
+{
+    PalettizedBitmap<PixelRGB> const bitmap = palettizedImage<PixelRGB>(64, 64);
+    TileCache<PixelRGB, 16>          cache(bitmap, 3);
+
+    cache.region(0, 0, 1, 1);
+    cache.region(16, 0, 1, 1);
+    cache.region(32, 0, 1, 1);
+    EXPECT_EQ(cache.size(), 3);
+    EXPECT_TRUE(cache.contains(0, 0));
+    EXPECT_TRUE(cache.contains(1, 0));
+    EXPECT_TRUE(cache.contains(2, 0));
+
+    // Using a tile makes it the most recently used
+    cache.region(0, 0, 1, 1);
+    cache.region(48, 0, 1, 1);
+    EXPECT_EQ(cache.size(), 3);
+    EXPECT_TRUE(cache.contains(0, 0));
+    EXPECT_FALSE(cache.contains(1, 0));
+    EXPECT_TRUE(cache.contains(2, 0));
+    EXPECT_TRUE(cache.contains(3, 0));
+
+    // A region larger than the cache leaves its last tiles
+    EXPECT_TRUE(matches(cache, bitmap, 0, 0, 64, 64));
+    EXPECT_TRUE(cache.contains(3, 3));
+    EXPECT_FALSE(cache.contains(0, 0));
+
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_FALSE(cache.contains(3, 3));
+    EXPECT_TRUE(matches(cache, bitmap, 10, 10, 30, 20));
+}
+
+TEST(TileCacheTest, Palette)
+{
+    PalettizedBitmap<PixelARGB> bitmap = palettizedImage<PixelARGB>(50, 50);
+    TileCache<PixelARGB, 16>    cache(bitmap, 16);
+    EXPECT_TRUE(matches(cache, bitmap, 0, 0, 50, 50));
+    EXPECT_TRUE(cache.contains(1, 1));
+
+    // A new palette makes every tile out of date
+    uint64_t const version = bitmap.paletteVersion();
+    bitmap.setPalette(makePalette<PixelARGB>(0x55667788u));
+    EXPECT_NE(bitmap.paletteVersion(), version);
+    EXPECT_FALSE(cache.contains(1, 1));
+    EXPECT_TRUE(matches(cache, bitmap, 0, 0, 50, 50));
+    EXPECT_TRUE(cache.contains(1, 1));
+
+    bitmap.palette()[*bitmap.data(20, 20)] = PixelARGB(0x01020304u);
+    EXPECT_FALSE(cache.contains(1, 1));
+    EXPECT_TRUE(matches(cache, bitmap, 10, 10, 20, 20));
+
+    // Versions are not shared by different bitmaps
+    PalettizedBitmap<PixelARGB> const other = palettizedImage<PixelARGB>(50, 50);
+    EXPECT_NE(other.paletteVersion(), bitmap.paletteVersion());
+}
+
+TEST(TileCacheTest, Assignment)
+{
+    PalettizedBitmap<PixelRGB> a = palettizedImage<PixelRGB>(40, 40);
+    TileCache<PixelRGB, 16>    cache(a, 9);
+    EXPECT_TRUE(matches(cache, a, 0, 0, 40, 40));
+
+    // A copy has its own version, so assigning an edited copy back makes every tile out of date
+    PalettizedBitmap<PixelRGB> b;
+    b = a;
+    EXPECT_NE(b.paletteVersion(), a.paletteVersion());
+    *b.data(5, 5) ^= 0xff;
+    a = b;
+    EXPECT_FALSE(cache.contains(0, 0));
+    EXPECT_TRUE(matches(cache, a, 0, 0, 40, 40));
+
+    PalettizedBitmap<PixelRGB> const c(a);
+    EXPECT_NE(c.paletteVersion(), a.paletteVersion());
+
+    // Moving changes both bitmaps
+    EXPECT_TRUE(cache.contains(0, 0));
+    PalettizedBitmap<PixelRGB> d(std::move(a));
+    EXPECT_FALSE(cache.contains(0, 0));
+    a = std::move(d);
+    EXPECT_FALSE(cache.contains(0, 0));
+    EXPECT_TRUE(matches(cache, a, 0, 0, 40, 40));
+}
+
+TEST(TileCacheTest, Invalidate)
+{
+    PalettizedBitmap<PixelRGB> bitmap = palettizedImage<PixelRGB>(50, 50);
+    TileCache<PixelRGB, 16>    cache(bitmap, 4);
+    EXPECT_TRUE(matches(cache, bitmap, 0, 0, 32, 32));
+    EXPECT_EQ(cache.size(), 4);
+
+    *bitmap.data(20, 5) ^= 0xff;
+    cache.invalidate(Rect{ 20, 5, 1, 1 });
+    EXPECT_EQ(cache.size(), 3);
+    EXPECT_FALSE(cache.contains(1, 0));
+    EXPECT_TRUE(cache.contains(0, 0));
+
+    // The discarded tile is reused first
+    cache.region(40, 40, 1, 1);
+    EXPECT_EQ(cache.size(), 4);
+    EXPECT_TRUE(cache.contains(0, 0));
+    EXPECT_TRUE(cache.contains(0, 1));
+    EXPECT_TRUE(cache.contains(1, 1));
+    EXPECT_TRUE(matches(cache, bitmap, 0, 0, 32, 32));
+
+    cache.invalidate(Rect{ 0, 0, 50, 50 });
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_TRUE(matches(cache, bitmap, 0, 0, 50, 50));
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}
@@ -0,0 +1,173 @@
+#include "Bitmap/TiledBitmap.h"
+
+#include "TestUtil.h"
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <cstring>
+
+template <class Pixel, int TILE>
+static void testRoundTrip(int width, int height, Execution execution)
+{
+    Bitmap<Pixel>            image = testImage<Pixel>(width, height);
+    TiledBitmap<Pixel, TILE> tiled(image.view(), execution);
+    ASSERT_EQ(tiled.width(), width);
+    ASSERT_EQ(tiled.height(), height);
+    ASSERT_EQ(tiled.tilesX(), (width + TILE - 1) / TILE);
+    ASSERT_EQ(tiled.tilesY(), (height + TILE - 1) / TILE);
+
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            Pixel p = tiled.pixel(x, y);
+            ASSERT_EQ(memcmp(image.data(x, y), &p, sizeof(Pixel)), 0);
+        }
+    }
+
+    Bitmap<Pixel> linear(width, height);
+    tiled.store(linear.view(), execution);
+    for (int y = 0; y < height; ++y)
+    {
+        ASSERT_EQ(memcmp(linear.data(0, y), image.data(0, y), width * sizeof(Pixel)), 0);
+    }
+}
+
+TEST(TiledBitmapTest, Constructor)
+{
+    TiledBitmap<uint32_t> empty;
+    EXPECT_EQ(empty.width(), 0);
+    EXPECT_EQ(empty.height(), 0);
+    EXPECT_EQ(empty.tilesX(), 0);
+
+    TiledBitmap<uint32_t> t(20, 9);
+    EXPECT_EQ(t.width(), 20);
+    EXPECT_EQ(t.height(), 9);
+    EXPECT_EQ(t.tilesX(), 3);
+    EXPECT_EQ(t.tilesY(), 2);
+
+    // Tiles are contiguous and laid out in row-major order
+    EXPECT_EQ(t.tile(1, 0), t.tile(0, 0) + 64);
+    EXPECT_EQ(t.tile(0, 1), t.tile(0, 0) + 3 * 64);
+}
+
+TEST(TiledBitmapTest, PixelAccess)
+{
+    TiledBitmap<uint16_t, 4> t(10, 7);
+    for (int y = 0; y < 7; ++y)
+    {
+        for (int x = 0; x < 10; ++x)
+        {
+            t.setPixel(x, y, uint16_t(y * 100 + x));
+        }
+    }
+    for (int y = 0; y < 7; ++y)
+    {
+        for (int x = 0; x < 10; ++x)
+        {
+            EXPECT_EQ(t.pixel(x, y), y * 100 + x);
+        }
+    }
+
+    // The pixel at (5, 6) is in tile (1, 1) at row 2 and column 1
+    EXPECT_EQ(t.tile(1, 1)[2 * 4 + 1], 605);
+}
+
+TEST(TiledBitmapTest, RoundTrip)
+{
+    testRoundTrip<uint8_t, 8>(1, 1, Execution::SEQUENTIAL);
+    testRoundTrip<uint8_t, 8>(37, 19, Execution::SEQUENTIAL);
+    testRoundTrip<Pixel565, 8>(64, 64, Execution::SEQUENTIAL);
+    testRoundTrip<PixelRGB, 16>(45, 33, Execution::SEQUENTIAL);
+    testRoundTrip<uint32_t, 64>(130, 70, Execution::SEQUENTIAL);
+    testRoundTrip<uint32_t, 8>(1000, 777, Execution::PARALLEL);
+}
+
+TEST(TiledBitmapTest, Load)
+{
+    // Loading a smaller image reuses the tiles, and loading a larger image replaces them
+    TiledBitmap<uint32_t> t(testImage<uint32_t>(40, 40).view());
+    Bitmap<uint32_t>      small = testImage<uint32_t>(9, 3, 2);
+    t.load(small.view());
+    EXPECT_EQ(t.width(), 9);
+    EXPECT_EQ(t.height(), 3);
+    EXPECT_EQ(t.pixel(8, 2), *small.data(8, 2));
+
+    Bitmap<uint32_t> large = testImage<uint32_t>(100, 50, 3);
+    t.load(large.view());
+    EXPECT_EQ(t.pixel(99, 49), *large.data(99, 49));
+
+    t.load(Bitmap<uint32_t>().view());
+    EXPECT_EQ(t.width(), 0);
+    EXPECT_EQ(t.height(), 0);
+}
+
+TEST(TiledBitmapTest, Region)
+{
+    Bitmap<uint32_t>      image = testImage<uint32_t>(50, 30);
+    TiledBitmap<uint32_t> tiled(image.view());
+
+    Bitmap<uint32_t> expected = image.region(5, 3, 21, 17);
+    Bitmap<uint32_t> actual   = tiled.region(5, 3, 21, 17);
+    ASSERT_EQ(actual.width(), 21);
+    ASSERT_EQ(actual.height(), 17);
+    for (int y = 0; y < 17; ++y)
+    {
+        EXPECT_EQ(memcmp(actual.data(0, y), expected.data(0, y), 21 * sizeof(uint32_t)), 0);
+    }
+
+    // The region is clipped to the image
+    Bitmap<uint32_t> clipped = tiled.region(-4, 25, 10, 10);
+    ASSERT_EQ(clipped.width(), 6);
+    ASSERT_EQ(clipped.height(), 5);
+    EXPECT_EQ(*clipped.data(5, 4), *image.data(5, 29));
+
+    EXPECT_EQ(tiled.region(50, 0, 10, 10).width(), 0);
+}
+
+TEST(TiledBitmapTest, Copy)
+{
+    Bitmap<uint32_t> srcImage = testImage<uint32_t>(40, 30);
+    Bitmap<uint32_t> dstImage(35, 25);
+    dstImage.fill(Rect{ 0, 0, 35, 25 }, 0x12345678);
+
+    TiledBitmap<uint32_t> src(srcImage.view());
+    TiledBitmap<uint32_t> fromTiled(dstImage.view());
+    TiledBitmap<uint32_t> fromLinear(dstImage.view());
+
+    // The copies are compared to the same copy between linear images, including clipping on all sides
+    Rect const rects[]  = { { 3, 5, 20, 11 }, { -5, -3, 30, 20 }, { 30, 20, 20, 20 }, { 0, 0, 40, 30 } };
+    int const  dsts[][2] = { { 7, 2 }, { -2, 4 }, { 20, 15 }, { -9, -6 } };
+    for (int i = 0; i < 4; ++i)
+    {
+        dstImage.copy(srcImage, rects[i], dsts[i][0], dsts[i][1]);
+        fromTiled.copy(src, rects[i], dsts[i][0], dsts[i][1]);
+        fromLinear.copy(srcImage.view(), rects[i], dsts[i][0], dsts[i][1]);
+        for (int y = 0; y < 25; ++y)
+        {
+            for (int x = 0; x < 35; ++x)
+            {
+                ASSERT_EQ(fromTiled.pixel(x, y), *dstImage.data(x, y));
+                ASSERT_EQ(fromLinear.pixel(x, y), *dstImage.data(x, y));
+            }
+        }
+    }
+}
+
+TEST(TiledBitmapTest, CopyOnWrite)
+{
+    // Copies of a tiled bitmap do not share changes
+    TiledBitmap<uint8_t> a(16, 16);
+    a.setPixel(3, 3, 1);
+    TiledBitmap<uint8_t> b = a;
+    b.setPixel(3, 3, 2);
+    EXPECT_EQ(a.pixel(3, 3), 1);
+    EXPECT_EQ(b.pixel(3, 3), 2);
+}
+
+int main(int argc, char ** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    int rv = RUN_ALL_TESTS();
+    return rv;
+}